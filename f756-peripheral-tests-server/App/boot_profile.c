@@ -0,0 +1,120 @@
+/*
+ * boot_profile.c
+ *
+ *  Created on: Aug 17, 2025
+ *      Author: User
+ */
+
+/**
+ * @file boot_profile.c
+ * @brief Source file for the boot profile.
+ * @details
+ * The core runs from the 16MHz internal oscillator until the system clock is configured, so the cycles
+ * between two stages are converted at the clock in effect at the earlier of them. The cycle counter wraps
+ * in under a minute, which the network stages may take (a DHCP server slow to answer), so a gap the HAL tick
+ * puts beyond half of that is taken from the tick instead.
+ */
+
+#include <string.h>
+
+#include "main.h"
+#include "lwip/def.h"
+#include "perf_counter.h"
+#include "server_common.h"
+#include "fast_boot.h"
+#include "boot_profile.h"
+
+#if TEST_BOOT_PROFILE_PACKET_SIZE_BYTES > OUTGOING_MESSAGE_MAX_SIZE_BYTES
+#error "Boot profile packets do not fit the outgoing message storage."
+#endif
+
+/**
+ * @brief The HAL tick gap (in ms) beyond which the cycle counter may have wrapped between two stages.
+ */
+#define BOOT_PROFILE_CYCLES_TRUSTED_MS (30000UL)
+
+static uint32_t stage_us[NUM_BOOT_STAGES] = {0};
+
+/**
+ * @brief The time, cycle count, HAL tick and core clock of the last recorded stage.
+ */
+static uint32_t last_us = 0;
+static uint32_t last_cycles = 0;
+static uint32_t last_tick = 0;
+static uint32_t last_clock_hz = 0;
+
+static char debug_buff[SERIAL_DEBUG_MAX_LEN] = {0};
+
+void boot_profile_mark(BootStage_t stage)
+{
+	if ((uint32_t)stage >= NUM_BOOT_STAGES || stage_us[stage] != 0) return;
+
+	// masking interrupts, since the scheduler may not have started yet
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	uint32_t now_cycles = perf_counter_now();
+	uint32_t now_tick = HAL_GetTick();
+
+	if (stage_us[stage] == 0)
+	{
+		if (last_clock_hz == 0)
+		{
+			// first stage: the counter was started at the top of main(), from the reset clock
+			last_clock_hz = SystemCoreClock;
+		}
+
+		if (now_tick - last_tick > BOOT_PROFILE_CYCLES_TRUSTED_MS)
+		{
+			last_us += (now_tick - last_tick) * 1000UL;
+		}
+		else
+		{
+			last_us += (uint32_t)(((uint64_t)(now_cycles - last_cycles) * 1000000UL) / last_clock_hz);
+		}
+
+		// 0 stands for "not reached", which a stage reached within the first microsecond is not
+		stage_us[stage] = (last_us != 0) ? last_us : 1;
+		last_cycles = now_cycles;
+		last_tick = now_tick;
+		last_clock_hz = SystemCoreClock;
+	}
+
+	__set_PRIMASK(primask);
+}
+
+uint32_t boot_profile_stage_us(BootStage_t stage)
+{
+	return ((uint32_t)stage < NUM_BOOT_STAGES) ? stage_us[stage] : 0;
+}
+
+void boot_profile_fill_packet(uint8_t *packet)
+{
+	packet[0] = TEST_PACKET_START_BYTE_VALUE;
+	packet[TEST_PACKET_MSG_BYTE_OFFSET] = TESTMSG_BOOT_PROFILE;
+	packet[TEST_PACKET_BOOT_FLAGS_OFFSET] = fast_boot_lease_applied() ? TEST_PACKET_BOOT_FLAG_CACHED_LEASE : 0;
+
+	for (uint32_t i = 0; i < NUM_BOOT_STAGES; i++)
+	{
+		uint32_t value_net = lwip_htonl(stage_us[i]);
+		memcpy(&packet[TEST_PACKET_BOOT_STAGES_OFFSET + (i * 4)], &value_net, sizeof(value_net));
+	}
+
+	packet[TEST_BOOT_PROFILE_PACKET_SIZE_BYTES - 1] = TEST_PACKET_END_BYTE_VALUE;
+}
+
+void boot_profile_report(void)
+{
+	if (!SERIAL_DEBUG_ENABLED) return;
+
+	snprintf(debug_buff, sizeof(debug_buff), "Boot: HAL %lu, clock %lu, peripherals %lu, registry %lu, scheduler %lu us.",
+			stage_us[BOOT_STAGE_HAL], stage_us[BOOT_STAGE_CLOCK], stage_us[BOOT_STAGE_PERIPHERALS],
+			stage_us[BOOT_STAGE_REGISTRY], stage_us[BOOT_STAGE_SCHEDULER]);
+	serial_debug_enqueue(debug_buff);
+
+	snprintf(debug_buff, sizeof(debug_buff), "Boot: lwIP %lu, link %lu, address %lu%s, listener %lu, first request %lu ms.",
+			stage_us[BOOT_STAGE_LWIP] / 1000, stage_us[BOOT_STAGE_LINK] / 1000, stage_us[BOOT_STAGE_ADDRESS] / 1000,
+			fast_boot_lease_applied() ? " (cached lease)" : "", stage_us[BOOT_STAGE_LISTENER] / 1000,
+			stage_us[BOOT_STAGE_FIRST_REQUEST] / 1000);
+	serial_debug_enqueue(debug_buff);
+}
@@ -0,0 +1,46 @@
+/*
+ * boot_profile.h
+ *
+ *  Created on: Aug 17, 2025
+ *      Author: User
+ */
+
+/**
+ * @file boot_profile.h
+ * @brief Header file for the boot profile, timing each startup stage from reset with the DWT cycle counter.
+ * @details
+ * The stages (@ref BootStage_t) run from HAL initialization in main() to the first accepted test request.
+ * Each is timed once, the first time it is reached, in microseconds since the cycle counter was started
+ * at the very top of main(). The profile is printed to the debug output when the listener is ready
+ * and on the first request, and sent to clients in @ref TESTMSG_BOOT_PROFILE packets.
+ */
+
+#ifndef BOOT_PROFILE_H_
+#define BOOT_PROFILE_H_
+
+#include <stdint.h>
+
+#include "test_packet_def.h"
+
+/**
+ * @brief Records the time of a startup stage, the first time it is reached.
+ * @details
+ * Callable before the scheduler starts and from any task, though not from interrupts.
+ * Prints nothing, since the debug output does not exist for the earliest stages.
+ */
+void boot_profile_mark(BootStage_t stage);
+/**
+ * @brief Returns the time a stage was reached at, in microseconds since reset, or 0 if it was not reached yet.
+ */
+uint32_t boot_profile_stage_us(BootStage_t stage);
+/**
+ * @brief Fills a @ref TESTMSG_BOOT_PROFILE packet with the stage times.
+ * @param [out] packet Buffer of at least @ref TEST_BOOT_PROFILE_PACKET_SIZE_BYTES bytes
+ */
+void boot_profile_fill_packet(uint8_t *packet);
+/**
+ * @brief Prints the stages reached so far to the debug output.
+ */
+void boot_profile_report(void);
+
+#endif /* BOOT_PROFILE_H_ */
@@ -0,0 +1,122 @@
+/*
+ * crc_stream.c
+ *
+ *  Created on: Aug 4, 2025
+ *      Author: User
+ */
+
+/**
+ * @file crc_stream.c
+ * @brief Source file for the incremental ('streaming') CRC utility, shared by all test tasks.
+ * @details
+ * The CRC unit is configured with output inversion disabled, so its data register holds
+ * the raw running CRC, which can be resumed later by loading it as the initial value.
+ * Every access to the unit happens inside a critical section, since streams are fed
+ * both from test tasks and from DMA interrupts.
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "crc_stream.h"
+
+extern CRC_HandleTypeDef hcrc;
+
+/**
+ * @brief The streams currently receiving data, looked up by DMA callbacks.
+ */
+static CrcStream_t * volatile active_streams[CRC_STREAM_MAX_ACTIVE] = {0};
+
+/**
+ * @brief Accumulates the stream's buffer into its CRC, up to (not including) the given offset.
+ * @details
+ * Must be called from within a critical section.
+ */
+static void crc_stream_feed(CrcStream_t *stream, uint16_t up_to)
+{
+	if (up_to > stream->len) up_to = stream->len;
+	if (up_to <= stream->fed) return;
+
+	WRITE_REG(hcrc.Instance->INIT, stream->crc);
+	__HAL_CRC_DR_RESET(&hcrc);
+	stream->crc = HAL_CRC_Accumulate(&hcrc, (uint32_t *)(stream->buff + stream->fed), up_to - stream->fed);
+	WRITE_REG(hcrc.Instance->INIT, DEFAULT_CRC_INITVALUE);
+
+	stream->fed = up_to;
+}
+
+uint32_t crc_calculate(const uint8_t *buff, uint16_t len)
+{
+	taskENTER_CRITICAL();
+	uint32_t crc = HAL_CRC_Calculate(&hcrc, (uint32_t *)buff, len);
+	taskEXIT_CRITICAL();
+
+	return crc;
+}
+
+void crc_stream_begin(CrcStream_t *stream, const void *owner, const uint8_t *buff, uint16_t len)
+{
+	stream->owner = owner;
+	stream->buff = buff;
+	stream->len = len;
+	stream->fed = 0;
+	stream->crc = DEFAULT_CRC_INITVALUE;
+
+	taskENTER_CRITICAL();
+
+	for (uint8_t i = 0; i < CRC_STREAM_MAX_ACTIVE; i++)
+	{
+		if (active_streams[i] == NULL)
+		{
+			active_streams[i] = stream;
+			break;
+		}
+	}
+
+	taskEXIT_CRITICAL();
+}
+
+CrcStream_t *crc_stream_find_from_isr(const void *owner)
+{
+	for (uint8_t i = 0; i < CRC_STREAM_MAX_ACTIVE; i++)
+	{
+		CrcStream_t *stream = active_streams[i];
+
+		if (stream != NULL && stream->owner == owner) return stream;
+	}
+
+	return NULL;
+}
+
+void crc_stream_half_from_isr(CrcStream_t *stream)
+{
+	UBaseType_t saved_interrupt_status = taskENTER_CRITICAL_FROM_ISR();
+	crc_stream_feed(stream, stream->len / 2);
+	taskEXIT_CRITICAL_FROM_ISR(saved_interrupt_status);
+}
+
+void crc_stream_complete_from_isr(CrcStream_t *stream)
+{
+	UBaseType_t saved_interrupt_status = taskENTER_CRITICAL_FROM_ISR();
+	crc_stream_feed(stream, stream->len);
+	taskEXIT_CRITICAL_FROM_ISR(saved_interrupt_status);
+}
+
+uint32_t crc_stream_finish(CrcStream_t *stream)
+{
+	taskENTER_CRITICAL();
+
+	crc_stream_feed(stream, stream->len);
+
+	for (uint8_t i = 0; i < CRC_STREAM_MAX_ACTIVE; i++)
+	{
+		if (active_streams[i] == stream)
+		{
+			active_streams[i] = NULL;
+		}
+	}
+
+	taskEXIT_CRITICAL();
+
+	return stream->crc;
+}
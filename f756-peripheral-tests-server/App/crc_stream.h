@@ -0,0 +1,74 @@
+/*
+ * crc_stream.h
+ *
+ *  Created on: Aug 4, 2025
+ *      Author: User
+ */
+
+/**
+ * @file crc_stream.h
+ * @brief Header file for the incremental ('streaming') CRC utility, shared by all test tasks.
+ */
+
+#ifndef CRC_STREAM_H_
+#define CRC_STREAM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "main.h"
+
+/**
+ * @brief Maximal count of streams that may be in progress at the same time.
+ */
+#define CRC_STREAM_MAX_ACTIVE (4)
+
+/**
+ * @brief State of a CRC computed incrementally over a buffer being filled by DMA.
+ * @details
+ * The buffer is filled by a single DMA transfer, so that the receiving peripheral always has a request pending.
+ * The hardware CRC unit is shared, so the running CRC value is kept here between calls,
+ * and every call restores it into the CRC unit before accumulating more data.
+ */
+typedef struct CrcStream
+{
+	/// The peripheral handle whose DMA callbacks feed this stream.
+	const void *owner;
+	/// The buffer being received into.
+	const uint8_t *buff;
+	/// Total count of bytes expected.
+	uint16_t len;
+	/// Count of bytes already accumulated into the CRC.
+	uint16_t fed;
+	/// The running CRC value.
+	uint32_t crc;
+} CrcStream_t;
+
+/**
+ * @brief Computes the CRC of a complete buffer in one pass, safely with respect to running streams.
+ */
+uint32_t crc_calculate(const uint8_t *buff, uint16_t len);
+/**
+ * @brief Starts a stream over the given buffer and registers it for lookup by its owner.
+ */
+void crc_stream_begin(CrcStream_t *stream, const void *owner, const uint8_t *buff, uint16_t len);
+/**
+ * @brief Finds the active stream fed by the given peripheral handle (interrupt context).
+ * @retval The stream, or NULL if no stream is registered for the handle
+ */
+CrcStream_t *crc_stream_find_from_isr(const void *owner);
+/**
+ * @brief Accumulates the first half of the buffer (interrupt context, DMA half-transfer callback).
+ */
+void crc_stream_half_from_isr(CrcStream_t *stream);
+/**
+ * @brief Accumulates the rest of the buffer (interrupt context, DMA transfer-complete callback).
+ */
+void crc_stream_complete_from_isr(CrcStream_t *stream);
+/**
+ * @brief Accumulates any data not yet covered by the DMA callbacks, and unregisters the stream.
+ * @retval The CRC of the complete buffer
+ */
+uint32_t crc_stream_finish(CrcStream_t *stream);
+
+#endif /* CRC_STREAM_H_ */
@@ -0,0 +1,188 @@
+/*
+ * fast_boot.c
+ *
+ *  Created on: Aug 16, 2025
+ *      Author: User
+ */
+
+/**
+ * @file fast_boot.c
+ * @brief Source file for fast boot.
+ * @details
+ * The record is written field by field as its values change, and its checksum updated after each write,
+ * so a reset in the middle of an update leaves it invalid rather than half old and half new.
+ * The lease is saved by the tcpip thread and the client by the listener, so every access to the record,
+ * checksum included, takes the record mutex.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "main.h"
+#include "semphr.h"
+#include "lwip/dhcp.h"
+#include "fast_boot.h"
+
+/**
+ * @brief Marks a record written by this firmware (and this layout).
+ */
+#define FAST_BOOT_MAGIC (0xFB007A01UL)
+
+/**
+ * @brief The validity flags of the record's fields.
+ */
+#define FAST_BOOT_HAS_LEASE (0x0001U)
+#define FAST_BOOT_HAS_CLIENT (0x0002U)
+
+/**
+ * @brief The record kept at the start of the backup SRAM.
+ */
+typedef struct FastBootRecord
+{
+	uint32_t magic;
+	/// @brief Mask of FAST_BOOT_HAS_ flags, telling which of the fields below are valid.
+	uint32_t flags;
+	/// @brief The lease, in network byte order.
+	uint32_t ip;
+	uint32_t netmask;
+	uint32_t gw;
+	/// @brief The last client, in network byte order (port in host byte order).
+	uint32_t client_ip;
+	uint32_t client_port;
+	/// @brief FNV-1a hash of the fields above.
+	uint32_t checksum;
+} FastBootRecord_t;
+
+#define fast_boot_record ((volatile FastBootRecord_t *)BKPSRAM_BASE)
+
+static bool cached_lease_applied = false;
+
+/// @brief Serializes the updates and reads of the record.
+static StaticSemaphore_t record_mutex_control_block;
+static SemaphoreHandle_t record_mutex = NULL;
+
+/**
+ * @brief Returns the FNV-1a hash of the record's fields (all but the checksum).
+ */
+static uint32_t record_checksum(void)
+{
+	FastBootRecord_t record;
+	uint32_t hash = 2166136261UL;
+
+	memcpy(&record, (const void *)fast_boot_record, sizeof(record));
+
+	for (uint32_t i = 0; i < offsetof(FastBootRecord_t, checksum); i++)
+	{
+		hash = (hash ^ ((const uint8_t *)&record)[i]) * 16777619UL;
+	}
+
+	return hash;
+}
+
+/**
+ * @brief Tells whether the record holds valid fields of the given flags.
+ */
+static bool record_has(uint32_t flags)
+{
+	return fast_boot_record->magic == FAST_BOOT_MAGIC
+			&& fast_boot_record->checksum == record_checksum()
+			&& (fast_boot_record->flags & flags) == flags;
+}
+
+/**
+ * @brief Starts a record over if the current one is not valid, so that fields can be added to it.
+ */
+static void record_open(void)
+{
+	if (record_has(0)) return;
+
+	memset((void *)fast_boot_record, 0, sizeof(FastBootRecord_t));
+	fast_boot_record->magic = FAST_BOOT_MAGIC;
+}
+
+bool fast_boot_init(struct netif *netif)
+{
+	__HAL_RCC_PWR_CLK_ENABLE();
+	HAL_PWR_EnableBkUpAccess();
+	__HAL_RCC_BKPSRAM_CLK_ENABLE();
+
+	record_mutex = xSemaphoreCreateMutexStatic(&record_mutex_control_block);
+
+	if (!SERVER_FAST_BOOT) return false;
+
+	xSemaphoreTake(record_mutex, portMAX_DELAY);
+
+	bool has_lease = record_has(FAST_BOOT_HAS_LEASE);
+	ip4_addr_t ip = { .addr = fast_boot_record->ip };
+	ip4_addr_t netmask = { .addr = fast_boot_record->netmask };
+	ip4_addr_t gw = { .addr = fast_boot_record->gw };
+
+	// released before the address is set, as the status callback saves the lease
+	xSemaphoreGive(record_mutex);
+
+	if (!has_lease) return false;
+
+	cached_lease_applied = true;
+	netif_set_addr(netif, &ip, &netmask, &gw);
+
+	return true;
+}
+
+void fast_boot_save_lease(const struct netif *netif)
+{
+	if (record_mutex == NULL || !dhcp_supplied_address(netif)) return;
+
+	xSemaphoreTake(record_mutex, portMAX_DELAY);
+
+	record_open();
+	fast_boot_record->ip = netif_ip4_addr(netif)->addr;
+	fast_boot_record->netmask = netif_ip4_netmask(netif)->addr;
+	fast_boot_record->gw = netif_ip4_gw(netif)->addr;
+	fast_boot_record->flags |= FAST_BOOT_HAS_LEASE;
+	fast_boot_record->checksum = record_checksum();
+
+	xSemaphoreGive(record_mutex);
+}
+
+void fast_boot_save_client(const ip_addr_t *addr, u16_t port)
+{
+	if (record_mutex == NULL) return;
+
+	xSemaphoreTake(record_mutex, portMAX_DELAY);
+
+	if (!record_has(FAST_BOOT_HAS_CLIENT) || fast_boot_record->client_ip != ip4_addr_get_u32(addr)
+			|| fast_boot_record->client_port != port)
+	{
+		record_open();
+		fast_boot_record->client_ip = ip4_addr_get_u32(addr);
+		fast_boot_record->client_port = port;
+		fast_boot_record->flags |= FAST_BOOT_HAS_CLIENT;
+		fast_boot_record->checksum = record_checksum();
+	}
+
+	xSemaphoreGive(record_mutex);
+}
+
+bool fast_boot_last_client(ip_addr_t *addr, u16_t *port)
+{
+	if (record_mutex == NULL) return false;
+
+	xSemaphoreTake(record_mutex, portMAX_DELAY);
+
+	bool has_client = record_has(FAST_BOOT_HAS_CLIENT);
+
+	if (has_client)
+	{
+		ip4_addr_set_u32(addr, fast_boot_record->client_ip);
+		*port = (u16_t)fast_boot_record->client_port;
+	}
+
+	xSemaphoreGive(record_mutex);
+
+	return has_client;
+}
+
+bool fast_boot_lease_applied(void)
+{
+	return cached_lease_applied;
+}
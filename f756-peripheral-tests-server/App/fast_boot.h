@@ -0,0 +1,63 @@
+/*
+ * fast_boot.h
+ *
+ *  Created on: Aug 16, 2025
+ *      Author: User
+ */
+
+/**
+ * @file fast_boot.h
+ * @brief Header file for fast boot, bringing the network up on the last DHCP lease.
+ * @details
+ * The last lease DHCP bound, and the last client whose request was accepted, are kept in the backup SRAM,
+ * which survives resets. On startup, the interface takes the cached address at once, while DHCP revalidates
+ * it in the background: an identical lease changes nothing, and a different one simply replaces the address.
+ * How much sooner the address is bound shows in the boot profile (see boot_profile.h).
+ */
+
+#ifndef FAST_BOOT_H_
+#define FAST_BOOT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "lwip/ip_addr.h"
+#include "lwip/netif.h"
+
+/**
+ * @brief Enables coming up on the cached lease, which may be overridden at build time (e.g. -DSERVER_FAST_BOOT=0).
+ * Leases are cached either way, so that the next build with fast boot finds one.
+ */
+#ifndef SERVER_FAST_BOOT
+#define SERVER_FAST_BOOT (1)
+#endif
+
+/**
+ * @brief Enables the backup SRAM, and gives the interface the cached address if there is a valid lease.
+ * Called once, with the core locked, after DHCP was started.
+ * @retval true The interface was given the cached address
+ * @retval false There is no valid lease, or fast boot is disabled
+ */
+bool fast_boot_init(struct netif *netif);
+/**
+ * @brief Caches the interface's lease, if its address was supplied by DHCP. Called on every address change,
+ * by the tcpip thread. Safe against a concurrent @ref fast_boot_save_client().
+ */
+void fast_boot_save_lease(const struct netif *netif);
+/**
+ * @brief Caches the address of the client whose request was last accepted. Called by the listener task,
+ * or with the raw API by its receive callback. Safe against a concurrent @ref fast_boot_save_lease().
+ */
+void fast_boot_save_client(const ip_addr_t *addr, u16_t port);
+/**
+ * @brief Returns the cached client address, from the previous run.
+ * @retval true A client was cached
+ * @retval false No client was cached
+ */
+bool fast_boot_last_client(ip_addr_t *addr, u16_t *port);
+/**
+ * @brief Tells whether the interface was brought up on the cached lease in this run.
+ */
+bool fast_boot_lease_applied(void);
+
+#endif /* FAST_BOOT_H_ */
@@ -0,0 +1,162 @@
+/*
+ * i2c_timing.c
+ *
+ *  Created on: Aug 8, 2025
+ *      Author: User
+ */
+
+/**
+ * @file i2c_timing.c
+ * @brief Source file for the I2C TIMINGR register calculator.
+ * @details
+ * Follows the timing constraints of the reference manual's I2C timings section.
+ * All durations are handled in picoseconds, to keep integer precision at kernel clocks in the tens of MHz.
+ */
+
+#include <stddef.h>
+
+#include "i2c_timing.h"
+
+#define PS_PER_S (1000000000000ULL)
+#define PS_PER_NS (1000ULL)
+
+#define TIMINGR_PRESC_POS (28)
+#define TIMINGR_SCLDEL_POS (20)
+#define TIMINGR_SDADEL_POS (16)
+#define TIMINGR_SCLH_POS (8)
+#define TIMINGR_SCLL_POS (0)
+
+#define TIMINGR_PRESC_MAX (15)
+#define TIMINGR_SCLDEL_MAX (15)
+#define TIMINGR_SDADEL_MAX (15)
+#define TIMINGR_SCLX_MAX (255)
+
+/**
+ * @brief Delay range added by the analog noise filter, in ns.
+ */
+#define ANALOG_FILTER_MIN_NS (50)
+#define ANALOG_FILTER_MAX_NS (260)
+
+/**
+ * @brief I2C specification limits of a single speed mode, in ns.
+ */
+typedef struct I2cBusSpec
+{
+	uint32_t max_hz;
+	uint32_t low_min_ns;
+	uint32_t high_min_ns;
+	uint32_t data_setup_min_ns;
+	uint32_t data_valid_max_ns;
+	uint32_t rise_max_ns;
+	uint32_t fall_max_ns;
+} I2cBusSpec_t;
+
+static const I2cBusSpec_t bus_specs[] =
+{
+	{ I2C_TIMING_STANDARD_HZ, 4700, 4000, 250, 3450, 1000, 300 },
+	{ I2C_TIMING_FAST_HZ, 1300, 600, 100, 900, 300, 300 },
+	{ I2C_TIMING_FAST_PLUS_HZ, 500, 260, 50, 450, 120, 120 },
+};
+
+static uint64_t div_ceil(uint64_t dividend, uint64_t divisor)
+{
+	return (dividend + divisor - 1) / divisor;
+}
+
+/**
+ * @brief The minimal delay by which the peripheral stretches each SCL phase beyond its programmed length:
+ * the analog filter delay, plus 2 kernel clocks of synchronization.
+ */
+static uint64_t sync_delay_ps(uint64_t clk_ps)
+{
+	return (ANALOG_FILTER_MIN_NS * PS_PER_NS) + (2 * clk_ps);
+}
+
+bool i2c_timing_compute(uint32_t i2cclk_hz, uint32_t bus_hz, uint32_t rise_ns, uint32_t fall_ns, uint32_t *timingr)
+{
+	const I2cBusSpec_t *spec = NULL;
+
+	if (i2cclk_hz == 0 || bus_hz == 0) return false;
+
+	for (uint8_t i = 0; i < sizeof(bus_specs) / sizeof(bus_specs[0]); i++)
+	{
+		if (bus_hz <= bus_specs[i].max_hz)
+		{
+			spec = &bus_specs[i];
+			break;
+		}
+	}
+
+	if (spec == NULL || rise_ns > spec->rise_max_ns || fall_ns > spec->fall_max_ns) return false;
+
+	uint64_t clk_ps = PS_PER_S / i2cclk_hz;
+	uint64_t period_ps = PS_PER_S / bus_hz;
+	uint64_t sync_ps = sync_delay_ps(clk_ps);
+	uint64_t edges_ps = (uint64_t)(rise_ns + fall_ns) * PS_PER_NS;
+
+	// tSDADEL >= tf - tAF(min) - 3 * tI2CCLK (the minimal data hold time being 0)
+	int64_t sdadel_min_ps = (int64_t)(fall_ns * PS_PER_NS)
+			- (int64_t)(ANALOG_FILTER_MIN_NS * PS_PER_NS) - (int64_t)(3 * clk_ps);
+	// tSDADEL <= tVD;DAT(max) - tr - tAF(max) - 4 * tI2CCLK
+	int64_t sdadel_max_ps = (int64_t)(spec->data_valid_max_ns * PS_PER_NS) - (int64_t)(rise_ns * PS_PER_NS)
+			- (int64_t)(ANALOG_FILTER_MAX_NS * PS_PER_NS) - (int64_t)(4 * clk_ps);
+	// tSCLDEL >= tr + tSU;DAT(min)
+	uint64_t scldel_min_ps = (uint64_t)(rise_ns + spec->data_setup_min_ns) * PS_PER_NS;
+
+	if (sdadel_max_ps < 0 || sdadel_min_ps > sdadel_max_ps) return false;
+
+	for (uint8_t presc = 0; presc <= TIMINGR_PRESC_MAX; presc++)
+	{
+		uint64_t presc_ps = (presc + 1) * clk_ps;
+
+		// SCLDEL counts from 0 (one prescaled tick), SDADEL counts from no delay at all
+		uint64_t scldel_ticks = div_ceil(scldel_min_ps, presc_ps);
+		uint64_t sdadel_ticks = sdadel_min_ps <= 0 ? 0 : div_ceil((uint64_t)sdadel_min_ps, presc_ps);
+
+		if (scldel_ticks == 0) scldel_ticks = 1;
+		if (scldel_ticks > TIMINGR_SCLDEL_MAX + 1) continue;
+		if (sdadel_ticks > TIMINGR_SDADEL_MAX) continue;
+		if ((int64_t)(sdadel_ticks * presc_ps) > sdadel_max_ps) continue;
+
+		uint64_t low_ticks = div_ceil((spec->low_min_ns * PS_PER_NS) - sync_ps, presc_ps);
+		uint64_t high_ticks = div_ceil((spec->high_min_ns * PS_PER_NS) - sync_ps, presc_ps);
+		// tSCL = tLOW + tHIGH + tr + tf, where each of tLOW and tHIGH includes its sync delay
+		uint64_t total_ticks = period_ps > (2 * sync_ps) + edges_ps ? div_ceil(period_ps - (2 * sync_ps) - edges_ps, presc_ps) : 0;
+
+		// any slack beyond the minimal phases is shared in proportion to them
+		if (low_ticks + high_ticks < total_ticks)
+		{
+			uint64_t slack = total_ticks - (low_ticks + high_ticks);
+			uint64_t low_share = div_ceil(slack * spec->low_min_ns, spec->low_min_ns + spec->high_min_ns);
+
+			low_ticks += low_share;
+			high_ticks += slack - low_share;
+		}
+
+		if (low_ticks > TIMINGR_SCLX_MAX + 1 || high_ticks > TIMINGR_SCLX_MAX + 1) continue;
+
+		*timingr = ((uint32_t)presc << TIMINGR_PRESC_POS)
+				| ((uint32_t)(scldel_ticks - 1) << TIMINGR_SCLDEL_POS)
+				| ((uint32_t)sdadel_ticks << TIMINGR_SDADEL_POS)
+				| ((uint32_t)(high_ticks - 1) << TIMINGR_SCLH_POS)
+				| ((uint32_t)(low_ticks - 1) << TIMINGR_SCLL_POS);
+
+		return true;
+	}
+
+	return false;
+}
+
+uint32_t i2c_timing_scl_hz(uint32_t i2cclk_hz, uint32_t timingr, uint32_t rise_ns, uint32_t fall_ns)
+{
+	if (i2cclk_hz == 0) return 0;
+
+	uint64_t clk_ps = PS_PER_S / i2cclk_hz;
+	uint64_t presc_ps = (((timingr >> TIMINGR_PRESC_POS) & TIMINGR_PRESC_MAX) + 1) * clk_ps;
+	uint64_t high_ticks = ((timingr >> TIMINGR_SCLH_POS) & TIMINGR_SCLX_MAX) + 1;
+	uint64_t low_ticks = ((timingr >> TIMINGR_SCLL_POS) & TIMINGR_SCLX_MAX) + 1;
+	uint64_t period_ps = ((high_ticks + low_ticks) * presc_ps) + (2 * sync_delay_ps(clk_ps))
+			+ ((uint64_t)(rise_ns + fall_ns) * PS_PER_NS);
+
+	return (uint32_t)(PS_PER_S / period_ps);
+}
@@ -0,0 +1,51 @@
+/*
+ * i2c_timing.h
+ *
+ *  Created on: Aug 8, 2025
+ *      Author: User
+ */
+
+/**
+ * @file i2c_timing.h
+ * @brief Header file for the I2C TIMINGR register calculator.
+ * @details
+ * The calculator is plain C with no dependency on the HAL or the device headers,
+ * so it can be compiled and exercised on a host machine as well as on the target.
+ */
+
+#ifndef I2C_TIMING_H_
+#define I2C_TIMING_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief The fastest bus clock of each I2C speed mode, in Hz.
+ */
+#define I2C_TIMING_STANDARD_HZ (100000)
+#define I2C_TIMING_FAST_HZ (400000)
+#define I2C_TIMING_FAST_PLUS_HZ (1000000)
+
+/**
+ * @brief Computes a TIMINGR value for the given bus clock, from the given I2C kernel clock.
+ * @details
+ * The speed mode (Standard, Fast or Fast-mode Plus) is the slowest one covering the bus clock,
+ * and its I2C specification limits, along with the bus rise and fall times, determine
+ * the data setup and hold delays, assuming the analog filter is enabled and the digital filter is disabled.
+ * The SCL high and low periods then fill the rest of the clock period, in proportion to their minimums.
+ * The smallest workable prescaler is chosen, for the finest resolution of the SCL periods.
+ * @param [in] i2cclk_hz The I2C kernel clock
+ * @param [in] bus_hz The requested bus (SCL) clock, up to @ref I2C_TIMING_FAST_PLUS_HZ
+ * @param [in] rise_ns The bus rise time, set by the pull-ups and bus capacitance
+ * @param [in] fall_ns The bus fall time
+ * @param [out] timingr The computed TIMINGR value
+ * @retval true A TIMINGR value was found
+ * @retval false The bus clock or edge times are out of the mode's range, or cannot be met from the kernel clock
+ */
+bool i2c_timing_compute(uint32_t i2cclk_hz, uint32_t bus_hz, uint32_t rise_ns, uint32_t fall_ns, uint32_t *timingr);
+/**
+ * @brief Estimates the SCL frequency a TIMINGR value yields from the given I2C kernel clock and bus edge times.
+ */
+uint32_t i2c_timing_scl_hz(uint32_t i2cclk_hz, uint32_t timingr, uint32_t rise_ns, uint32_t fall_ns);
+
+#endif /* I2C_TIMING_H_ */
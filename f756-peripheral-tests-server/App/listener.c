@@ -13,41 +13,166 @@
 
 #include "listener.h"
 #include "main.h"
+#include "ethernetif.h"
+#include "boot_profile.h"
+#include "fast_boot.h"
+#include "net_telemetry.h"
+#include "perf_counter.h"
+#include "result_journal.h"
 #include "server_common.h"
+#include "test_runner.h"
+#include "test_registry.h"
+#include "transmitter.h"
+#include "lwip/tcpip.h"
+#include "lwip/udp.h"
 
 extern struct netif gnetif;
 
 extern osMessageQueueId_t TestQueueHandle;
+extern osMessageQueueId_t InteractiveQueueHandle;
 extern osMessageQueueId_t OutboxQueueHandle;
 
 static const uint16_t recv_timeout_ms = 1000;
 static const uint16_t recv_idle_debug_secs = 60;
+static const uint16_t outbox_put_timeout_ticks = pdMS_TO_TICKS(10);
+/// The count of journal packets answering a single fetch request, and the attempts at allocating each of them.
+static const uint8_t journal_burst_packets = 16;
+static const uint8_t journal_alloc_attempts = 5;
+
+#if TEST_JOURNAL_PACKET_MAX_SIZE_BYTES + 64 > SERVER_JOURNAL_FRAME_BYTES
+#error "Journal packets do not fit the heap reserved for them in lwipopts.h."
+#endif
 
 static uint32_t recv_idle_counter_secs = 0;
 
+/**
+ * @brief Count, sum and maximum of the cycles between a packet's receive interrupt and its handling, since the last report.
+ */
+static uint32_t rx_latency_count = 0;
+static uint64_t rx_latency_cycles_sum = 0;
+static uint32_t rx_latency_cycles_max = 0;
+
+#if SERVER_UDP_RAW_API
+static struct udp_pcb *listener_pcb = NULL;
+
+/**
+ * @brief A journal fetch request, handed off by the receive callback to the listener task.
+ * A burst of journal packets waits on the journal's mutex and on the lwIP heap, which the Ethernet interface thread
+ * may not do while it holds the core lock.
+ */
+typedef struct JournalFetch
+{
+	ip_addr_t addr;
+	u16_t port;
+	uint32_t since_id;
+} JournalFetch_t;
+
+/**
+ * @brief The journal fetch requests waiting for the listener task. A request arriving while it is full is dropped,
+ * and the client asks again.
+ */
+#define JOURNAL_FETCH_QUEUE_DEPTH (4)
+static uint8_t journal_fetch_queue_storage[JOURNAL_FETCH_QUEUE_DEPTH * sizeof(JournalFetch_t)];
+static StaticQueue_t journal_fetch_queue_control_block;
+static QueueHandle_t journal_fetch_queue = NULL;
+#else
 static struct netconn *listener_conn = NULL;
-static ip4_addr_t listener_address = {0};
-static uint8_t last_link_up_idx = 0;
+#endif
 
+/**
+ * @brief Scratch buffers of @ref handle_packet and the responses it sends. With the raw API, these are only used
+ * by the receive callback (on the Ethernet interface thread), never by the listener task.
+ */
 static uint16_t next_test_id_server_half = 1;
 static TestRequest_t request_scratch = {0};
 static OutgoingMessage_t message_scratch = {0};
-
 static char debug_buff[SERIAL_DEBUG_MAX_LEN] = {0};
 
+/// @brief The listener task's own debug buffer, for what it reports outside of @ref handle_packet.
+static char task_debug_buff[SERIAL_DEBUG_MAX_LEN] = {0};
+
 /**
- * @brief Broadcasts a @ref TESTMSG_PAIRING_BEACON packet to the network,
- * alerting clients to the server's existence.
+ * @brief Sends the response constructed in @ref message_scratch.
+ * With netconns, it is put in the outbox for the transmitter task. With the raw API, the listener already
+ * runs with the lwIP core locked, so it is sent right away, unless it is to join the transmitter's batch.
  */
-static void broadcast_server_presence(void)
+static void send_message_scratch(void)
 {
-	explicit_bzero(&message_scratch, sizeof(message_scratch));
-	message_scratch.port = CLIENT_PORT;
-	message_scratch.addr = *IP4_ADDR_BROADCAST;
-	message_scratch.message[0] = TEST_PACKET_START_BYTE_VALUE;
-	message_scratch.message[TEST_PACKET_MSG_BYTE_OFFSET] = TESTMSG_PAIRING_BEACON;
-	message_scratch.message[TEST_PACKET_ID_BYTE_OFFSET] = TEST_PACKET_END_BYTE_VALUE;
-	osMessageQueuePut(OutboxQueueHandle, &message_scratch, 0, pdMS_TO_TICKS(1000));
+#if SERVER_UDP_RAW_API
+	if (SERVER_TX_BATCH_WINDOW_MS && transmitter_is_batchable(message_scratch.message[TEST_PACKET_MSG_BYTE_OFFSET]))
+	{
+		// never waits, as the callback holds the core lock
+		osMessageQueuePut(OutboxQueueHandle, &message_scratch, 0, 0);
+		return;
+	}
+
+	transmitter_send_raw(&message_scratch);
+#else
+	osMessageQueuePut(OutboxQueueHandle, &message_scratch, 0, outbox_put_timeout_ticks);
+#endif
+}
+
+/**
+ * @brief Constructs a @ref TESTMSG_PAIRING_BEACON packet, identifying the server to a client.
+ * @param [out] message The outbound message to construct
+ * @param [in] addr Destination IP address (a probing client, or a known one)
+ * @param [in] port Destination port
+ */
+static void build_beacon(OutgoingMessage_t *message, const ip_addr_t *addr, u16_t port)
+{
+	const uint32_t uid_words[] = { HAL_GetUIDw0(), HAL_GetUIDw1(), HAL_GetUIDw2() };
+	uint8_t *packet = message->message;
+
+	explicit_bzero(message, sizeof(*message));
+	message->port = port;
+	message->addr = *addr;
+	packet[0] = TEST_PACKET_START_BYTE_VALUE;
+	packet[TEST_PACKET_MSG_BYTE_OFFSET] = TESTMSG_PAIRING_BEACON;
+
+	for (uint32_t i = 0; i < sizeof(uid_words) / sizeof(uid_words[0]); i++)
+	{
+		uint32_t word_net = lwip_htonl(uid_words[i]);
+		memcpy(packet + TEST_PACKET_BEACON_UID_OFFSET + (i * sizeof(word_net)), &word_net, sizeof(word_net));
+	}
+
+	uint32_t tests_net = lwip_htonl(test_registry_mask());
+
+	packet[TEST_PACKET_BEACON_VERSION_MAJOR_OFFSET] = SERVER_FIRMWARE_VERSION_MAJOR;
+	packet[TEST_PACKET_BEACON_VERSION_MINOR_OFFSET] = SERVER_FIRMWARE_VERSION_MINOR;
+	memcpy(packet + TEST_PACKET_BEACON_TESTS_OFFSET, &tests_net, sizeof(tests_net));
+	packet[TEST_PACKET_BEACON_FEATURES_OFFSET] = TEST_PACKET_BEACON_FEATURE_JOURNAL
+			| (SERVER_TX_BATCH_WINDOW_MS ? TEST_PACKET_BEACON_FEATURE_BATCH : 0);
+	packet[TEST_BEACON_PACKET_SIZE_BYTES - 1] = TEST_PACKET_END_BYTE_VALUE;
+}
+
+/**
+ * @brief Answers a client's probe with a @ref TESTMSG_PAIRING_BEACON packet, unicast to the client alone,
+ * so that a probe reaching many servers does not have each of them broadcast to the whole network in turn.
+ */
+static void answer_probe(const ip_addr_t *addr, u16_t port)
+{
+	build_beacon(&message_scratch, addr, port);
+	send_message_scratch();
+}
+
+/**
+ * @brief Sends a @ref TESTMSG_PAIRING_BEACON packet to the client of the previous run (if fast boot cached one),
+ * so that a client still looking for the server finds it without waiting for its next probe.
+ * Called from the listener task, so the beacon goes through the outbox in either API mode.
+ */
+static void announce_to_last_client(void)
+{
+	OutgoingMessage_t beacon;
+	ip_addr_t client_addr;
+	u16_t client_port;
+
+	if (!fast_boot_last_client(&client_addr, &client_port)) return;
+
+	build_beacon(&beacon, &client_addr, client_port);
+	osMessageQueuePut(OutboxQueueHandle, &beacon, 0, outbox_put_timeout_ticks);
+
+	snprintf(task_debug_buff, sizeof(task_debug_buff), "Beacon sent to the last client, %s.", ipaddr_ntoa(&client_addr));
+	serial_debug_enqueue(task_debug_buff);
 }
 
 /**
@@ -58,6 +183,7 @@ static void broadcast_server_presence(void)
 static void send_new_test_ack(bool accepted)
 {
 	static const uint8_t repeats = 4;
+	uint32_t accepted_net = lwip_htonl(accepted ? 1 : 0);
 
 	explicit_bzero(&message_scratch, sizeof(message_scratch));
 	message_scratch.addr = request_scratch.client_addr;
@@ -66,24 +192,207 @@ static void send_new_test_ack(bool accepted)
 	*(uint32_t *)(message_scratch.message+TEST_PACKET_ID_BYTE_OFFSET) =
 	*(uint32_t *)(request_scratch.request+TEST_PACKET_ID_BYTE_OFFSET);
 	message_scratch.message[TEST_PACKET_MSG_BYTE_OFFSET] = TESTMSG_TEST_NEW_ACK;
-	message_scratch.message[TEST_PACKET_SELECTION_BYTE_OFFSET] = accepted ? 1 : 0;
+	memcpy(message_scratch.message+TEST_PACKET_SELECTION_OFFSET, &accepted_net, sizeof(accepted_net));
 	message_scratch.message[TEST_PACKET_ITERATIONS_BYTE_OFFSET] = TEST_PACKET_END_BYTE_VALUE;
 
 	for (uint8_t i = 0; i < repeats; i++)
 	{
-		osMessageQueuePut(OutboxQueueHandle, &message_scratch, 0, pdMS_TO_TICKS(1000));
+		send_message_scratch();
 	}
 }
 
+/**
+ * @brief Relays a "cancel test" request to the test runner, and acknowledges it to the sender.
+ * @param [in] packet The received cancellation packet
+ * @param [in] addr Source IP address of the requesting client
+ * @param [in] port Source port of the requesting client
+ */
+static void process_cancel_request(const uint8_t *packet, const ip_addr_t *addr, u16_t port)
+{
+	uint32_t test_id = *(uint32_t *)(packet+TEST_PACKET_ID_BYTE_OFFSET);
+	bool was_running = test_runner_request_cancel(test_id);
+	uint32_t was_running_net = lwip_htonl(was_running ? 1 : 0);
+
+	snprintf(debug_buff, sizeof(debug_buff), "Cancellation requested for %s Test ID 0x%08lX.", was_running ? "running" : "non-running", test_id);
+	serial_debug_enqueue(debug_buff);
+
+	explicit_bzero(&message_scratch, sizeof(message_scratch));
+	message_scratch.addr = *addr;
+	message_scratch.port = port;
+	message_scratch.message[0] = TEST_PACKET_START_BYTE_VALUE;
+	message_scratch.message[TEST_PACKET_MSG_BYTE_OFFSET] = TESTMSG_TEST_CANCEL_ACK;
+	*(uint32_t *)(message_scratch.message+TEST_PACKET_ID_BYTE_OFFSET) = test_id;
+	memcpy(message_scratch.message+TEST_PACKET_SELECTION_OFFSET, &was_running_net, sizeof(was_running_net));
+	message_scratch.message[TEST_PACKET_ITERATIONS_BYTE_OFFSET] = TEST_PACKET_END_BYTE_VALUE;
+
+	send_message_scratch();
+}
+
+/**
+ * @brief Answers a telemetry request with the usage of the server's network buffers.
+ * @param [in] addr Source IP address of the requesting client
+ * @param [in] port Source port of the requesting client
+ */
+static void send_telemetry(const ip_addr_t *addr, u16_t port)
+{
+	explicit_bzero(&message_scratch, sizeof(message_scratch));
+	message_scratch.addr = *addr;
+	message_scratch.port = port;
+	net_telemetry_fill_packet(message_scratch.message);
+
+	send_message_scratch();
+}
+
+/**
+ * @brief Answers a boot profile request with the time the server reached each startup stage at.
+ * @param [in] addr Source IP address of the requesting client
+ * @param [in] port Source port of the requesting client
+ */
+static void send_boot_profile(const ip_addr_t *addr, u16_t port)
+{
+	explicit_bzero(&message_scratch, sizeof(message_scratch));
+	message_scratch.addr = *addr;
+	message_scratch.port = port;
+	boot_profile_fill_packet(message_scratch.message);
+
+	send_message_scratch();
+}
+
+/**
+ * @brief Allocates the buffer of a journal packet from the lwIP heap. Called from the listener task, in either API mode.
+ * @details
+ * Frames already sent are only freed by the Ethernet interface once its transmit descriptors run out, so they are
+ * released first. If the heap is still short (the DMA has yet to send the previous packets), the next attempt is
+ * made a tick later.
+ * @retval The buffer, or NULL if the heap stayed short
+ */
+static struct pbuf *alloc_journal_pbuf(void)
+{
+	for (uint8_t attempt = 0; attempt < journal_alloc_attempts; attempt++)
+	{
+		LOCK_TCPIP_CORE();
+		ethernetif_release_tx();
+		UNLOCK_TCPIP_CORE();
+
+		struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, TEST_JOURNAL_PACKET_MAX_SIZE_BYTES, PBUF_RAM);
+
+		if (p != NULL) return p;
+
+		osDelay(1);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Sends a journal packet straight from the listener's own socket, and frees it.
+ * Journal packets are far larger than the outbox's messages, so they never go through the transmitter.
+ */
+static void send_journal_pbuf(struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+#if SERVER_UDP_RAW_API
+	LOCK_TCPIP_CORE();
+	udp_sendto(listener_pcb, p, addr, port);
+	UNLOCK_TCPIP_CORE();
+#else
+	// lwIP only borrows the netbuf for the duration of the call, so it needs no allocation of its own
+	struct netbuf buf = {0};
+	buf.p = p;
+	buf.ptr = p;
+	netconn_sendto(listener_conn, &buf, addr, port);
+#endif
+	pbuf_free(p);
+}
+
+/**
+ * @brief Answers a journal fetch request with a burst of journal packets, carrying the records following
+ * the request's SINCE ID, until the burst or the records run out. Called from the listener task, in either API mode.
+ * @param [in] since_id The request's SINCE ID
+ * @param [in] addr Source IP address of the requesting client
+ * @param [in] port Source port of the requesting client
+ */
+static void send_journal(uint32_t since_id, const ip_addr_t *addr, u16_t port)
+{
+	bool more = true;
+
+	for (uint8_t i = 0; i < journal_burst_packets && more; i++)
+	{
+		struct pbuf *p = alloc_journal_pbuf();
+
+		if (p == NULL)
+		{
+			// the client asks again, from the last record it got
+			serial_debug_enqueue("Journal burst cut short, out of heap.");
+			return;
+		}
+
+		uint16_t len = result_journal_fill_packet((uint8_t *)p->payload, &since_id, i + 1 == journal_burst_packets, &more);
+
+		pbuf_realloc(p, len);
+		send_journal_pbuf(p, addr, port);
+	}
+}
+
+/**
+ * @brief Selects the test queue matching the priority class of the last "new test request".
+ * Weakness: relies on the validity of @ref request_scratch.
+ */
+static osMessageQueueId_t select_test_queue(void)
+{
+	TestPriority_t priority = (TestPriority_t)(request_scratch.request[TEST_PACKET_FLAGS_BYTE_OFFSET] & TEST_PACKET_FLAG_PRIORITY_MASK);
+
+	return (priority == TESTPRIO_INTERACTIVE) ? InteractiveQueueHandle : TestQueueHandle;
+}
+
+/**
+ * @brief Sends a "busy" response matching the last "new test request",
+ * carrying the current test queue depth and a suggested retry delay.
+ * Weakness: relies on the validity of @ref request_scratch.
+ */
+static void send_new_test_busy(void)
+{
+	uint16_t retry_after_ms = test_runner_estimate_retry_ms();
+	uint8_t queue_depth = (uint8_t)osMessageQueueGetCount(select_test_queue());
+
+	explicit_bzero(&message_scratch, sizeof(message_scratch));
+	message_scratch.addr = request_scratch.client_addr;
+	message_scratch.port = request_scratch.client_port;
+	message_scratch.message[0] = TEST_PACKET_START_BYTE_VALUE;
+	message_scratch.message[TEST_PACKET_MSG_BYTE_OFFSET] = TESTMSG_TEST_NEW_BUSY;
+	*(uint32_t *)(message_scratch.message+TEST_PACKET_ID_BYTE_OFFSET) =
+	*(uint32_t *)(request_scratch.request+TEST_PACKET_ID_BYTE_OFFSET);
+	message_scratch.message[TEST_PACKET_BUSY_QUEUE_DEPTH_OFFSET] = queue_depth;
+	*(uint16_t *)(message_scratch.message+TEST_PACKET_BUSY_RETRY_AFTER_OFFSET) = lwip_htons(retry_after_ms);
+	message_scratch.message[TEST_PACKET_BUSY_END_OFFSET] = TEST_PACKET_END_BYTE_VALUE;
+
+	snprintf(debug_buff, sizeof(debug_buff), "Test queue full (%u waiting), client told to retry after %u ms.", queue_depth, retry_after_ms);
+	serial_debug_enqueue(debug_buff);
+
+	send_message_scratch();
+}
+
 /**
  * @brief Analyzes an incoming test request,
- * and attempts forwarding it to the test queue.
+ * and attempts forwarding it to the test queue without blocking.
  * Weakness: relies on the validity of @ref request_scratch.
- * @retval true The request was accepted and forwarded
- * @retval false The request was denied or processing failed
+ * @retval osOK The request was accepted and forwarded
+ * @retval osErrorResource The test queue is full and the request should be retried later
+ * @retval osErrorParameter The request selects no test, or a test that is not registered
+ * @retval other The request was denied or processing failed
  */
-bool process_new_test_request()
+osStatus_t process_new_test_request()
 {
+	uint32_t selection_net;
+	memcpy(&selection_net, request_scratch.request+TEST_PACKET_SELECTION_OFFSET, sizeof(selection_net));
+	uint32_t selection = lwip_ntohl(selection_net);
+
+	if (selection == 0 || (selection & ~test_registry_mask()) != 0)
+	{
+		snprintf(debug_buff, sizeof(debug_buff), "Test request selects unavailable tests (0x%08lX).", selection);
+		serial_debug_enqueue(debug_buff);
+		return osErrorParameter;
+	}
+
 	// merge client and server test IDs and update scratch buffer
 	uint16_t received_id = *(uint16_t *)(request_scratch.request+TEST_PACKET_ID_BYTE_OFFSET+2);
 	*(uint16_t *)(request_scratch.request+TEST_PACKET_ID_BYTE_OFFSET) = lwip_htons(next_test_id_server_half);
@@ -98,110 +407,247 @@ bool process_new_test_request()
 	snprintf(debug_buff, sizeof(debug_buff), "\r\nDevice received test string: %s", request_scratch.request+TEST_PACKET_STRING_HEAD_OFFSET);
 	serial_debug_enqueue(debug_buff);
 
-	// forward request to test queue
-	return (osOK == osMessageQueuePut(TestQueueHandle, &request_scratch, 0, pdMS_TO_TICKS(1000)));
+	// forward request to the queue of its priority class, never blocking the listener while it is full
+	return osMessageQueuePut(select_test_queue(), &request_scratch, 0, 0);
 }
 
 /**
- * @brief Handles socket reception timeout.
- * Currently only measures it for periodic debug printing.
+ * @brief Filters a received packet by type, and reacts to it.
+ * Test requests are copied to @ref request_scratch and forwarded to the test queues.
+ * Other packets require an immediate response, which is constructed in @ref message_scratch.
+ * @param [in] packet The packet, read in place from the Ethernet driver's zero-copy receive buffer
+ * @param [in] len The packet's length
+ * @param [in] addr Source IP address of the sender
+ * @param [in] port Source port of the sender
  */
-void handle_recv_timeout(void)
+static void handle_packet(const uint8_t *packet, uint16_t len, const ip_addr_t *addr, u16_t port)
 {
-	recv_idle_counter_secs += recv_timeout_ms/1000;
+	uint32_t irq_cycles = ethernetif_rx_batch_irq_cycles();
 
-	if (recv_idle_counter_secs >= recv_idle_debug_secs
-		&& recv_idle_counter_secs % recv_idle_debug_secs == 0)
+	if (irq_cycles != 0)
+	{
+		uint32_t latency_cycles = perf_counter_now() - irq_cycles;
+
+		rx_latency_count++;
+		rx_latency_cycles_sum += latency_cycles;
+		if (latency_cycles > rx_latency_cycles_max) rx_latency_cycles_max = latency_cycles;
+	}
+
+	if (len < PAIRING_PACKET_SIZE_BYTES || packet[0] != TEST_PACKET_START_BYTE_VALUE)
+	{
+		serial_debug_enqueue("Received invalid packet.");
+		return;
+	}
+
+	switch((TestPacketMsg_t)packet[TEST_PACKET_MSG_BYTE_OFFSET])
 	{
-		snprintf(debug_buff, sizeof(debug_buff), "Listener idle for %lu minutes.", recv_idle_counter_secs/60);
+	case TESTMSG_TEST_NEW_REQUEST:
+		if (len < TEST_REQUEST_PACKET_MIN_SIZE_BYTES || len > TEST_REQUEST_PACKET_MAX_SIZE_BYTES)
+		{
+			serial_debug_enqueue("Received test request of invalid length.");
+			break;
+		}
+
+		// save request to scratch buffer
+		explicit_bzero(&request_scratch, sizeof(request_scratch));
+		request_scratch.client_addr = *addr;
+		request_scratch.client_port = port;
+		memcpy(request_scratch.request, packet, len);
+
+		osStatus_t queue_ret = process_new_test_request();
+
+		if (queue_ret == osErrorResource)
+		{
+			// admission denied for now, client should back off and retry
+			send_new_test_busy();
+			break;
+		}
+
+		snprintf(debug_buff, sizeof(debug_buff), "Test request %sforwarded to queue.", queue_ret == osOK ? "" : "NOT ");
 		serial_debug_enqueue(debug_buff);
+
+		if (queue_ret == osOK)
+		{
+			if (boot_profile_stage_us(BOOT_STAGE_FIRST_REQUEST) == 0)
+			{
+				boot_profile_mark(BOOT_STAGE_FIRST_REQUEST);
+				boot_profile_report();
+			}
+			fast_boot_save_client(addr, port);
+		}
+
+		// confirm reception
+		send_new_test_ack(queue_ret == osOK);
+		break;
+	case TESTMSG_TEST_CANCEL_REQUEST:
+		if (len >= TEST_MSG_PACKET_SIZE_BYTES)
+		{
+			process_cancel_request(packet, addr, port);
+		}
+		break;
+	case TESTMSG_PAIRING_PROBE:
+		serial_debug_enqueue("Received a client probe packet.");
+		answer_probe(addr, port);
+		break;
+	case TESTMSG_TELEMETRY_REQUEST:
+		send_telemetry(addr, port);
+		break;
+	case TESTMSG_BOOT_PROFILE_REQUEST:
+		send_boot_profile(addr, port);
+		break;
+	case TESTMSG_JOURNAL_FETCH_REQUEST:
+		if (len >= TEST_JOURNAL_FETCH_PACKET_SIZE_BYTES)
+		{
+			uint32_t since_id_net;
+			memcpy(&since_id_net, packet + TEST_PACKET_JOURNAL_SINCE_OFFSET, sizeof(since_id_net));
+
+#if SERVER_UDP_RAW_API
+			JournalFetch_t fetch = { .addr = *addr, .port = port, .since_id = lwip_ntohl(since_id_net) };
+
+			// never waits, as the callback holds the core lock
+			if (xQueueSend(journal_fetch_queue, &fetch, 0) != pdPASS)
+			{
+				serial_debug_enqueue("Journal fetch dropped, listener busy.");
+			}
+#else
+			send_journal(lwip_ntohl(since_id_net), addr, port);
+#endif
+		}
+		break;
+	default:
+		serial_debug_enqueue("Received unexpected packet.");
+		break;
 	}
 }
 
+#if SERVER_UDP_RAW_API
 /**
- * @brief Checks whether the ethernet link status changed since the local status index was last updated.
- * @retval true Link status changed since the status idx was last updated.
- * @retval false No change since the status idx was last updated.
+ * @brief Raw API receive callback of the listener, run under the core lock (by the Ethernet interface thread)
+ * for every packet sent to @ref SERVER_PORT.
+ * The packet is handled in place, and its receive buffer released before returning. Nothing here sleeps or blocks:
+ * journal fetches, which do, are queued for the listener task.
  */
-static bool eth_link_was_down(void)
+static void listener_udp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
 {
-	uint8_t eth_link_status_idx = lwip_get_eth_link_status_idx();
+	LWIP_UNUSED_ARG(arg);
+	LWIP_UNUSED_ARG(pcb);
+
+	recv_idle_counter_secs = 0;
+	handle_packet((const uint8_t *)p->payload, p->len, addr, port);
+	pbuf_free(p);
 
-	return (eth_link_status_idx != last_link_up_idx
-			|| eth_link_status_idx == 0);
+	serial_debug_enqueue("Listener awaiting requests.");
 }
+#endif
 
 /**
- * @brief Blocks task until ethernet link is up, then updates the local status index.
+ * @brief Prints the receive path's measurements since the last report: frames drained per wake-up of the
+ * Ethernet interface thread, and the latency from the receive interrupt to the listener.
+ * @details
+ * Frames drained in one wake-up share the timestamp of the interrupt that started the batch,
+ * so the latency of the later frames in a burst includes the handling of those ahead of them.
  */
-static void await_eth_link(void)
+static void report_rx_path(void)
 {
-	uint8_t eth_link_status_idx = lwip_get_eth_link_status_idx();
+	EthernetifRxStats_t stats;
+	uint32_t cycles_per_us = SystemCoreClock / 1000000;
+
+	ethernetif_take_rx_stats(&stats);
+
+#if SERVER_UDP_RAW_API
+	// the receive callback updates the latency counters under the core lock
+	LOCK_TCPIP_CORE();
+#endif
+	uint32_t latency_count = rx_latency_count;
+	uint64_t latency_cycles_sum = rx_latency_cycles_sum;
+	uint32_t latency_cycles_max = rx_latency_cycles_max;
+
+	rx_latency_count = 0;
+	rx_latency_cycles_sum = 0;
+	rx_latency_cycles_max = 0;
+#if SERVER_UDP_RAW_API
+	UNLOCK_TCPIP_CORE();
+#endif
+
+	if (stats.wakeups == 0 || latency_count == 0) return;
+
+	snprintf(task_debug_buff, sizeof(task_debug_buff), "Rx: %lu frames in %lu wake-ups (max %lu), IRQ to listener %lu/%lu us (avg/max) over %lu packets.",
+			stats.frames, stats.wakeups, stats.frames_per_wakeup_max,
+			(uint32_t)(latency_cycles_sum / latency_count / cycles_per_us), latency_cycles_max / cycles_per_us, latency_count);
+	serial_debug_enqueue(task_debug_buff);
+}
 
-	if (eth_link_status_idx == 0)
-	{
-		serial_debug_enqueue("Waiting for ethernet link.");
+/**
+ * @brief Handles socket reception timeout.
+ * Reports the receive path once it goes idle, and measures idle time for periodic debug printing.
+ */
+void handle_recv_timeout(void)
+{
+	recv_idle_counter_secs += recv_timeout_ms/1000;
 
-		do
-		{
-			vTaskDelay(pdMS_TO_TICKS(500));
-			eth_link_status_idx = lwip_get_eth_link_status_idx();
-		} while (eth_link_status_idx == 0);
+	if (recv_idle_counter_secs == recv_timeout_ms/1000)
+	{
+		report_rx_path();
 	}
 
-	last_link_up_idx = eth_link_status_idx;
+	if (recv_idle_counter_secs >= recv_idle_debug_secs
+		&& recv_idle_counter_secs % recv_idle_debug_secs == 0)
+	{
+		snprintf(task_debug_buff, sizeof(task_debug_buff), "Listener idle for %lu minutes.", recv_idle_counter_secs/60);
+		serial_debug_enqueue(task_debug_buff);
+	}
 }
 
 /**
- * @brief Blocks task until device is assigned an IP address, then binds it to the listener if necessary.
+ * @brief Blocks task until the ethernet link is up and the device has an IP address,
+ * which the network state event group tells without polling, and clears the pending change.
+ * @details
+ * The listener is bound to any address, so an address renewed by DHCP needs no rebinding,
+ * and packets are received again as soon as the link and address are back.
  */
-static void bind_listener(void)
+static void await_network(void)
 {
-	ip4_addr_t given_address = *netif_ip4_addr(&gnetif);
+	static bool announced = false;
+	EventGroupHandle_t net_state = lwip_net_state();
 
-	if(ip4_addr_isany_val(given_address))
-	{
-		serial_debug_enqueue("Waiting for valid IP address.");
+	xEventGroupClearBits(net_state, NET_STATE_CHANGED);
 
-		while(ip4_addr_isany_val(given_address))
-		{
-			vTaskDelay(pdMS_TO_TICKS(500));
-			given_address = *netif_ip4_addr(&gnetif);
-		}
+	if ((xEventGroupGetBits(net_state) & NET_STATE_READY) != NET_STATE_READY)
+	{
+		serial_debug_enqueue("Waiting for ethernet link and IP address.");
+		xEventGroupWaitBits(net_state, NET_STATE_READY, pdFALSE, pdTRUE, portMAX_DELAY);
 	}
 
-	snprintf(debug_buff, sizeof(debug_buff), "IP acquired: %s", ip4addr_ntoa(&given_address));
-	serial_debug_enqueue(debug_buff);
+	ip4_addr_t given_address = *netif_ip4_addr(&gnetif);
+	snprintf(task_debug_buff, sizeof(task_debug_buff), "Listener reachable at IP %s and port %u.", ip4addr_ntoa(&given_address), SERVER_PORT);
+	serial_debug_enqueue(task_debug_buff);
 
-	if (listener_address.addr == given_address.addr)
+	if (!announced)
 	{
-		serial_debug_enqueue("Given IP already bound.");
-		return;
-	}
-	else
-	{
-		serial_debug_enqueue("Listener binding new IP.");
+		boot_profile_mark(BOOT_STAGE_LISTENER);
+		boot_profile_report();
+		announce_to_last_client();
+		announced = true;
 	}
+}
 
-	if (ERR_OK != netconn_bind(listener_conn, &given_address, SERVER_PORT))
-	{
-		serial_debug_enqueue("Failed to bind listener connection.");
-		vTaskDelay(pdMS_TO_TICKS(1000));
-		HAL_NVIC_SystemReset();
-	}
-	else
-	{
-		listener_address = given_address;
-		snprintf(debug_buff, sizeof(debug_buff), "Listener bound to IP %s and port %u.", ip4addr_ntoa(&given_address), SERVER_PORT);
-		serial_debug_enqueue(debug_buff);
-	}
+/**
+ * @brief Tells whether the network state changed since the listener last caught up with it, or is not ready.
+ */
+static bool network_changed(void)
+{
+	EventBits_t state = xEventGroupGetBits(lwip_net_state());
+
+	return (state & NET_STATE_CHANGED) || (state & NET_STATE_READY) != NET_STATE_READY;
 }
 
 /**
  * @details
  * The @ref test_listener_task_init function explicitly wipes @ref request_scratch, the buffer used to hold incoming packets.
  * It then initializes the @ref netconn to be used for receiving the packets,
- * and sets its timeout duration according to @ref recv_timeout_ms.
+ * and sets its timeout duration according to @ref recv_timeout_ms,
+ * or with the raw API, the PCB whose receive callback handles them, and the queue of journal fetches it hands off.
+ * Either is bound to any address on @ref SERVER_PORT, before the device even has an address.
  */
 void test_listener_task_init(void)
 {
@@ -209,48 +655,78 @@ void test_listener_task_init(void)
 
 	explicit_bzero(&request_scratch, sizeof(request_scratch));
 
+#if SERVER_UDP_RAW_API
+	err_t bind_ret = ERR_MEM;
+
+	journal_fetch_queue = xQueueCreateStatic(JOURNAL_FETCH_QUEUE_DEPTH, sizeof(JournalFetch_t),
+			journal_fetch_queue_storage, &journal_fetch_queue_control_block);
+
+	LOCK_TCPIP_CORE();
+	listener_pcb = udp_new();
+	if (listener_pcb != NULL)
+	{
+		udp_recv(listener_pcb, listener_udp_recv, NULL);
+		bind_ret = udp_bind(listener_pcb, IP4_ADDR_ANY, SERVER_PORT);
+	}
+	UNLOCK_TCPIP_CORE();
+#else
 	listener_conn = netconn_new(NETCONN_UDP);
+	err_t bind_ret = (listener_conn != NULL) ? netconn_bind(listener_conn, IP4_ADDR_ANY, SERVER_PORT) : ERR_MEM;
+#endif
 
-	if (listener_conn == NULL)
+	if (ERR_OK != bind_ret)
 	{
-		serial_debug_enqueue("Failed to create listener connection.");
+		serial_debug_enqueue("Failed to create or bind listener connection.");
 		vTaskDelay(pdMS_TO_TICKS(1000));
 		HAL_NVIC_SystemReset();
 	}
 
+#if !SERVER_UDP_RAW_API
 	netconn_set_recvtimeout(listener_conn, recv_timeout_ms);
+#endif
+	net_telemetry_report_footprint();
 }
 
 /**
  * @details
  * The @ref test_listener_task_loop function is constantly listening for incoming UDP packets.
- * It checks the ethernet link status each iteration with @ref eth_link_was_down and rebinds if necessary.
- * The received packet is then filtered by type. Test requests are held in @ref request_scratch and sent to the test queue.
- * Other packets require an immediate response, which is constructed in @ref message_scratch and sent directly to the outbox queue.
+ * It checks the network state each iteration with @ref network_changed and waits for the network if it is down.
+ * Each received packet is handled by @ref handle_packet, in place, and its netbuf then deleted exactly once,
+ * returning the Ethernet driver's receive buffer to its pool.
+ * With the raw API, packets are handled by @ref listener_udp_recv instead, and the loop only serves the journal
+ * fetches it queues, waiting on them with the same timeout, and counts idle time.
  */
 void test_listener_task_loop(void)
 {
+#if !SERVER_UDP_RAW_API
 	static struct netbuf *listener_netbuf = NULL;
 	static uint8_t *listener_pbuf = NULL;
 	static uint16_t listener_pbuf_len = 0;
 
 	static err_t recv_ret;
+#endif
 
 	/* Infinite loop */
 	for(;;)
 	{
-		if (listener_netbuf != NULL)
+		if (network_changed())
 		{
-			netbuf_delete(listener_netbuf);
+			await_network();
+			serial_debug_enqueue("Listener awaiting requests.");
 		}
 
-		if (eth_link_was_down())
+#if SERVER_UDP_RAW_API
+		JournalFetch_t fetch;
+
+		if (xQueueReceive(journal_fetch_queue, &fetch, pdMS_TO_TICKS(recv_timeout_ms)) == pdPASS)
 		{
-			await_eth_link();
-			bind_listener();
-			serial_debug_enqueue("Listener awaiting requests.");
+			send_journal(fetch.since_id, &fetch.addr, fetch.port);
 		}
-
+		else
+		{
+			handle_recv_timeout();
+		}
+#else
 		recv_ret = netconn_recv(listener_conn, &listener_netbuf);
 
 		switch(recv_ret)
@@ -258,55 +734,20 @@ void test_listener_task_loop(void)
 		case ERR_OK:
 			recv_idle_counter_secs = 0;
 			netbuf_data(listener_netbuf, (void **)&listener_pbuf, &listener_pbuf_len);
+			handle_packet(listener_pbuf, listener_pbuf_len, &listener_netbuf->addr, listener_netbuf->port);
 
-			if (listener_pbuf[0] == TEST_PACKET_START_BYTE_VALUE)
-			{
-				switch((TestPacketMsg_t)listener_pbuf[TEST_PACKET_MSG_BYTE_OFFSET])
-				{
-				case TESTMSG_TEST_NEW_REQUEST:
-					// save request to scratch buffer
-					explicit_bzero(&request_scratch, sizeof(request_scratch));
-					request_scratch.client_addr = listener_netbuf->addr;
-					request_scratch.client_port = listener_netbuf->port;
-					memcpy(request_scratch.request, listener_pbuf, listener_pbuf_len);
-
-					netbuf_delete(listener_netbuf);
-
-					bool accepted = process_new_test_request();
-
-					snprintf(debug_buff, sizeof(debug_buff), "Test request %sforwarded to queue.", accepted ? "" : "NOT ");
-					serial_debug_enqueue(debug_buff);
-
-					// confirm reception
-					send_new_test_ack(accepted);
-					break;
-				case TESTMSG_PAIRING_PROBE:
-					netbuf_delete(listener_netbuf);
-					serial_debug_enqueue("Received a client probe packet.");
-					// send out a beacon
-					broadcast_server_presence();
-					break;
-				default:
-					netbuf_delete(listener_netbuf);
-					serial_debug_enqueue("Received unexpected packet.");
-					break;
-				}
-		    }
-			else
-			{
-				netbuf_delete(listener_netbuf);
-				serial_debug_enqueue("Received invalid packet.");
-			}
-
+			netbuf_delete(listener_netbuf);
+			listener_netbuf = NULL;
 			serial_debug_enqueue("Listener awaiting requests.");
 			break;
 		case ERR_TIMEOUT:
 			handle_recv_timeout();
 			break;
 		default:
-			snprintf(debug_buff, sizeof(debug_buff), "Listener recv() error: %s", lwip_strerr(recv_ret));
-			serial_debug_enqueue(debug_buff);
+			snprintf(task_debug_buff, sizeof(task_debug_buff), "Listener recv() error: %s", lwip_strerr(recv_ret));
+			serial_debug_enqueue(task_debug_buff);
 			break;
 		}
+#endif
 	}
 }
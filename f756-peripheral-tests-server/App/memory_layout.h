@@ -0,0 +1,54 @@
+/*
+ * memory_layout.h
+ *
+ *  Created on: Aug 14, 2025
+ *      Author: User
+ */
+
+/**
+ * @file memory_layout.h
+ * @brief Header only utility placing DMA buffers in the memories the linker script defines,
+ * which keeps them coherent with the D-cache without any cache maintenance.
+ * @details
+ * With the D-cache enabled, the memories are split as follows (see STM32F756ZGTX_FLASH.ld):
+ * @verbatim
+ * 0x20000000 DTCM    peripheral DMA buffers (DMA_BUFFER), never cached
+ * 0x20010000 SRAM1   .data, .bss, heap and stack, cached (write-back)
+ * 0x20040000 DMARAM  non-cacheable (MPU region 0): lwIP RX pool, UNCACHED_BUFFER buffers,
+ *                    lwIP heap at 0x20048000, Ethernet descriptors at 0x2004C000 (MPU region 1)
+ * @endverbatim
+ * Every buffer a DMA reads or writes lies in DTCM or DMARAM. A buffer in the cached SRAM would need its
+ * cache lines cleaned before a DMA reads it, and invalidated after a DMA wrote it.
+ */
+
+#ifndef MEMORY_LAYOUT_H_
+#define MEMORY_LAYOUT_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include "main.h"
+
+/**
+ * @brief Places a (zero-initialized) buffer in DTCM, which the CPU accesses with no wait states and the cache never holds.
+ */
+#define DMA_BUFFER __attribute__((section(".dtcm_bss"), aligned(32)))
+/**
+ * @brief Places a (zero-initialized) buffer in the non-cacheable DMARAM region.
+ */
+#define UNCACHED_BUFFER __attribute__((section(".uncached_bss"), aligned(32)))
+
+/**
+ * @brief Zeroes the DTCM and non-cacheable buffers, which the startup code knows nothing of.
+ * Called once, first thing in main().
+ */
+static inline void memory_layout_init(void)
+{
+	extern uint8_t _sdtcm_bss, _edtcm_bss;
+	extern uint8_t _suncached_bss, _euncached_bss;
+
+	memset(&_sdtcm_bss, 0, (size_t)(&_edtcm_bss - &_sdtcm_bss));
+	memset(&_suncached_bss, 0, (size_t)(&_euncached_bss - &_suncached_bss));
+}
+
+#endif /* MEMORY_LAYOUT_H_ */
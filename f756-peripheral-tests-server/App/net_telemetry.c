@@ -0,0 +1,140 @@
+/*
+ * net_telemetry.c
+ *
+ *  Created on: Aug 15, 2025
+ *      Author: User
+ */
+
+/**
+ * @file net_telemetry.c
+ * @brief Source file for the network telemetry.
+ * @details
+ * lwIP's statistics are plain counters updated under the core lock, and are read here without locking,
+ * so a telemetry packet is a snapshot that may be a packet or two out of date, which is fine for sizing pools.
+ */
+
+#include <string.h>
+
+#include "main.h"
+#include "lwip/mem.h"
+#include "lwip/memp.h"
+#include "lwip/stats.h"
+#include "server_common.h"
+#include "net_telemetry.h"
+
+#if TEST_TELEMETRY_PACKET_SIZE_BYTES > OUTGOING_MESSAGE_MAX_SIZE_BYTES
+#error "Telemetry packets do not fit the outgoing message storage."
+#endif
+
+/**
+ * @brief The zero-copy receive pool, declared in ethernetif.c.
+ */
+LWIP_MEMPOOL_PROTOTYPE(RX_POOL);
+
+/**
+ * @brief Names of the reported pools, indexed by @ref TelemetryPool_t.
+ */
+static const char *const pool_names[NUM_TELEMETRY_POOLS] =
+{
+	"heap", "RX_POOL", "NETBUF", "TCPIP_MSG_INPKT", "TCPIP_MSG_API", "PBUF_POOL",
+};
+
+#if LWIP_TCPIP_CORE_LOCKING_INPUT
+/**
+ * @brief Stands for the TCPIP_MSG_INPKT pool, which does not exist while frames are input under the core lock,
+ * and is reported as holding no elements.
+ */
+static const struct memp_desc absent_pool = {0};
+#endif
+
+static char debug_buff[SERIAL_DEBUG_MAX_LEN] = {0};
+
+/**
+ * @brief Returns the descriptor of a reported pool, or NULL for the heap (which is not a pool).
+ */
+static const struct memp_desc *pool_desc(TelemetryPool_t pool)
+{
+	switch (pool)
+	{
+	case TELEMETRY_POOL_RX:
+		return &memp_RX_POOL;
+	case TELEMETRY_POOL_NETBUF:
+		return memp_pools[MEMP_NETBUF];
+	case TELEMETRY_POOL_TCPIP_INPKT:
+#if LWIP_TCPIP_CORE_LOCKING_INPUT
+		return &absent_pool;
+#else
+		return memp_pools[MEMP_TCPIP_MSG_INPKT];
+#endif
+	case TELEMETRY_POOL_TCPIP_API:
+		return memp_pools[MEMP_TCPIP_MSG_API];
+	case TELEMETRY_POOL_PBUF:
+		return memp_pools[MEMP_PBUF_POOL];
+	case TELEMETRY_POOL_HEAP:
+	default:
+		return NULL;
+	}
+}
+
+/**
+ * @brief Writes a 16 bit value into a packet, in network byte order.
+ */
+static void put_u16(uint8_t *field, uint16_t value)
+{
+	uint16_t value_net = lwip_htons(value);
+	memcpy(field, &value_net, sizeof(value_net));
+}
+
+void net_telemetry_report_footprint(void)
+{
+	uint32_t total_bytes = MEM_SIZE;
+
+	for (uint32_t i = 0; i < NUM_TELEMETRY_POOLS; i++)
+	{
+		const struct memp_desc *desc = pool_desc((TelemetryPool_t)i);
+		uint32_t count = (desc != NULL) ? desc->num : 1;
+		uint32_t element_bytes = (desc != NULL) ? (desc->size + MEMP_SIZE) : MEM_SIZE;
+
+		if (desc != NULL) total_bytes += count * element_bytes;
+
+		snprintf(debug_buff, sizeof(debug_buff), "lwIP %s: %lu x %lu B.", pool_names[i], count, element_bytes);
+		serial_debug_enqueue(debug_buff);
+	}
+
+	snprintf(debug_buff, sizeof(debug_buff), "lwIP buffers: %lu B in total, sized for %u requests in flight (stats %s).",
+			total_bytes, SERVER_MAX_INFLIGHT_REQUESTS, NET_DIAGNOSTICS ? "on" : "off");
+	serial_debug_enqueue(debug_buff);
+}
+
+void net_telemetry_fill_packet(uint8_t *packet)
+{
+	memset(packet, 0, TEST_TELEMETRY_PACKET_SIZE_BYTES);
+	packet[0] = TEST_PACKET_START_BYTE_VALUE;
+	packet[TEST_PACKET_MSG_BYTE_OFFSET] = TESTMSG_TELEMETRY;
+	packet[TEST_PACKET_TELEMETRY_FLAGS_OFFSET] = NET_DIAGNOSTICS ? TEST_PACKET_TELEMETRY_FLAG_STATS : 0;
+
+	for (uint32_t i = 0; i < NUM_TELEMETRY_POOLS; i++)
+	{
+		uint8_t *block = packet + TEST_PACKET_TELEMETRY_POOLS_OFFSET + (i * TEST_TELEMETRY_POOL_SIZE_BYTES);
+		const struct memp_desc *desc = pool_desc((TelemetryPool_t)i);
+
+		put_u16(block + TEST_TELEMETRY_POOL_AVAIL_OFFSET, (desc != NULL) ? desc->num : MEM_SIZE);
+
+#if NET_DIAGNOSTICS
+		const struct stats_mem *stats = (desc != NULL) ? desc->stats : &lwip_stats.mem;
+
+		if (stats == NULL) continue;
+
+		put_u16(block + TEST_TELEMETRY_POOL_USED_OFFSET, stats->used);
+		put_u16(block + TEST_TELEMETRY_POOL_MAX_OFFSET, stats->max);
+		put_u16(block + TEST_TELEMETRY_POOL_ERR_OFFSET, stats->err);
+#endif
+	}
+
+#if NET_DIAGNOSTICS
+	put_u16(packet + TEST_PACKET_TELEMETRY_MBOX_ERRORS_OFFSET, lwip_stats.sys.mbox.err);
+	put_u16(packet + TEST_PACKET_TELEMETRY_UDP_DROPS_OFFSET, lwip_stats.udp.drop);
+#endif
+
+	packet[TEST_TELEMETRY_PACKET_SIZE_BYTES - 1] = TEST_PACKET_END_BYTE_VALUE;
+}
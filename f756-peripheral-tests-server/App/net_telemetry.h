@@ -0,0 +1,31 @@
+/*
+ * net_telemetry.h
+ *
+ *  Created on: Aug 15, 2025
+ *      Author: User
+ */
+
+/**
+ * @file net_telemetry.h
+ * @brief Header file for the network telemetry, reporting the usage of lwIP's buffers to clients and to the debug output.
+ * @details
+ * The pool capacities are always reported. Their usage, peaks and failures need lwIP's statistics,
+ * which a diagnostic build enables (see NET_DIAGNOSTICS in lwipopts.h).
+ */
+
+#ifndef NET_TELEMETRY_H_
+#define NET_TELEMETRY_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Prints the RAM taken by each reported pool (capacity times element size) to the debug output.
+ */
+void net_telemetry_report_footprint(void);
+/**
+ * @brief Fills a @ref TESTMSG_TELEMETRY packet of @ref TEST_TELEMETRY_PACKET_SIZE_BYTES bytes.
+ * @param [out] packet The packet buffer
+ */
+void net_telemetry_fill_packet(uint8_t *packet);
+
+#endif /* NET_TELEMETRY_H_ */
@@ -0,0 +1,53 @@
+/*
+ * perf_counter.h
+ *
+ *  Created on: Aug 6, 2025
+ *      Author: User
+ */
+
+/**
+ * @file perf_counter.h
+ * @brief Header only utility for timing short operations with the core's DWT cycle counter.
+ * @details
+ * The cycle counter wraps after 2^32 core clock cycles (just under a minute at 72MHz),
+ * so it is only suited for measuring operations well below that.
+ */
+
+#ifndef PERF_COUNTER_H_
+#define PERF_COUNTER_H_
+
+#include <stdint.h>
+
+#include "main.h"
+
+/**
+ * @brief Enables the DWT cycle counter. Called once at startup.
+ */
+static inline void perf_counter_init(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	// the Cortex-M7 DWT is write-locked out of reset
+	DWT->LAR = 0xC5ACCE55;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+ * @brief Returns the current cycle count, to be subtracted from a later one (wrapping is harmless).
+ */
+static inline uint32_t perf_counter_now(void)
+{
+	return DWT->CYCCNT;
+}
+
+/**
+ * @brief Converts a count of bytes moved over a count of cycles into bytes per second.
+ * @retval The throughput, or 0 if no cycles were measured
+ */
+static inline uint32_t perf_counter_bytes_per_sec(uint64_t bytes, uint64_t cycles)
+{
+	if (cycles == 0) return 0;
+	return (uint32_t)((bytes * SystemCoreClock) / cycles);
+}
+
+#endif /* PERF_COUNTER_H_ */
@@ -0,0 +1,903 @@
+/*
+ * peripheral_sweeps.c
+ *
+ *  Created on: Aug 6, 2025
+ *      Author: User
+ */
+
+/**
+ * @file peripheral_sweeps.c
+ * @brief Source file in which the peripheral sweeps are implemented.
+ * @details
+ * A sweep reconfigures its peripheral pair at runtime through a list of settings,
+ * and records a @ref TestSweepStep_t for every setting into its instance's sweep log,
+ * from where the test runner forwards the steps to the client as they complete.
+ * Throughput is measured with the DWT cycle counter, over error-free transfers only.
+ */
+
+#include "main.h"
+#include "cmsis_os2.h"
+#include "tim.h"
+#include "crc_stream.h"
+#include "i2c_timing.h"
+#include "memory_layout.h"
+#include "perf_counter.h"
+#include "peripheral_sweeps.h"
+
+#define COUNT_OF(arr) (sizeof(arr) / sizeof((arr)[0]))
+
+/**
+ * @brief The delay (in ticks) allowed for a DMA reception to conclude after its peer finished transmitting.
+ */
+#define SWEEP_RX_SETTLE_TICKS (pdMS_TO_TICKS(20))
+/**
+ * @brief The delay (in ticks) allowed for a DMA-to-DMA transfer to conclude, even at the slowest setting.
+ */
+#define SWEEP_DMA_TIMEOUT_TICKS (pdMS_TO_TICKS(50))
+/**
+ * @brief The I2C bus rise and fall times (in ns) assumed when computing timings for the I2C sweep.
+ */
+#define SWEEP_I2C_RISE_NS (25)
+#define SWEEP_I2C_FALL_NS (10)
+/**
+ * @brief Number of samples in each half of the ADC sweep's circular DMA buffer.
+ */
+#define SWEEP_ADC_HALF_SAMPLES (1024)
+/**
+ * @brief Number of samples the ADC sweep takes per iteration, at each sample rate.
+ */
+#define SWEEP_ADC_CAPTURE_SAMPLES (8192)
+/**
+ * @brief ADC clock cycles per conversion: the configured 3 sampling cycles, and 12 for a 12 bit conversion.
+ */
+#define SWEEP_ADC_CONVERSION_CYCLES (15)
+/**
+ * @brief The thread flag set by the ADC DMA callbacks whenever a half of the buffer is filled.
+ */
+#define SWEEP_ADC_HALF_FILLED_FLAG (0x01)
+
+extern UART_HandleTypeDef huart2;
+extern UART_HandleTypeDef huart6;
+extern SPI_HandleTypeDef hspi3;
+extern SPI_HandleTypeDef hspi5;
+extern I2C_HandleTypeDef hi2c1;
+extern I2C_HandleTypeDef hi2c2;
+extern ADC_HandleTypeDef hadc1;
+
+/**
+ * @brief Cycle count at which the SPI master's last full-duplex DMA transfer completed.
+ */
+static volatile uint32_t spi_master_done_cycles = 0;
+
+/**
+ * @brief Timestamps the completion of the SPI master's full-duplex DMA transfers.
+ */
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+	if (hspi == &hspi3)
+	{
+		spi_master_done_cycles = perf_counter_now();
+	}
+}
+
+/**
+ * @brief Cycle count at which the last I2C master transfer completed (including its STOP condition).
+ */
+static volatile uint32_t i2c_master_done_cycles = 0;
+
+/**
+ * @brief Timestamps the completion of I2C master transmissions.
+ */
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	i2c_master_done_cycles = perf_counter_now();
+}
+
+/**
+ * @brief Timestamps the completion of I2C master receptions.
+ */
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	i2c_master_done_cycles = perf_counter_now();
+}
+
+/**
+ * @brief Circular DMA buffer of the ADC sweep (in DTCM), filled one half at a time while the other is being reduced.
+ */
+static uint16_t adc_stream_buff[2 * SWEEP_ADC_HALF_SAMPLES] DMA_BUFFER;
+/**
+ * @brief The thread reducing the ADC stream, or NULL when no stream is running.
+ */
+static osThreadId_t volatile adc_stream_thread = NULL;
+/**
+ * @brief Count of buffer halves filled since the stream started.
+ */
+static volatile uint32_t adc_stream_halves_filled = 0;
+/**
+ * @brief Cycle counts at which the first and the latest buffer halves were filled.
+ */
+static volatile uint32_t adc_stream_first_cycles = 0;
+static volatile uint32_t adc_stream_last_cycles = 0;
+
+/**
+ * @brief Counts and timestamps a filled half of the ADC buffer, and wakes the thread reducing it (interrupt context).
+ */
+static void adc_stream_half_filled_from_isr(void)
+{
+	if (adc_stream_thread == NULL) return;
+
+	uint32_t now_cycles = perf_counter_now();
+
+	if (adc_stream_halves_filled == 0)
+	{
+		adc_stream_first_cycles = now_cycles;
+	}
+
+	adc_stream_last_cycles = now_cycles;
+	adc_stream_halves_filled++;
+	osThreadFlagsSet(adc_stream_thread, SWEEP_ADC_HALF_FILLED_FLAG);
+}
+
+void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef *hadc)
+{
+	if (hadc == &hadc1) adc_stream_half_filled_from_isr();
+}
+
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc)
+{
+	if (hadc == &hadc1) adc_stream_half_filled_from_isr();
+}
+
+/**
+ * @brief Appends a completed step to the instance's sweep log, and counts it in the instance's statistics.
+ */
+static void sweep_record_step(TestUnitInstance_t *instance, const TestSweepStep_t *step)
+{
+	uint8_t idx = instance->sweep_log.steps_done;
+
+	if (idx >= TEST_SWEEP_MAX_STEPS) return;
+
+	instance->sweep_log.steps[idx] = *step;
+	instance->stats.iterations_done++;
+
+	if (step->errors > 0)
+	{
+		instance->stats.iterations_failed++;
+	}
+
+	// published last, as the test runner forwards every step below steps_done
+	instance->sweep_log.steps_done = idx + 1;
+}
+
+/**
+ * @brief Tells whether a sweep should stop before its next step, as it was cancelled,
+ * or the test runner preempts it (its remaining steps then run once the runner resumes it).
+ */
+static bool sweep_interrupted(const TestUnitInstance_t *instance)
+{
+	return instance->cancel || instance->preempt;
+}
+
+/**
+ * @brief Tells whether any step a preempted sweep recorded before it was resumed was error-free.
+ * A sweep resumes from the first step it has not recorded (@ref TestSweepLog_t steps_done), which is 0 on a new request.
+ */
+static bool sweep_resumed_error_free(const TestUnitInstance_t *instance)
+{
+	for (uint8_t i = 0; i < instance->sweep_log.steps_done; i++)
+	{
+		if (instance->sweep_log.steps[i].transfers > 0 && instance->sweep_log.steps[i].errors == 0) return true;
+	}
+
+	return false;
+}
+
+/**
+ * @brief Applies a baud rate (with 8x oversampling) to a UART, keeping the rest of its configuration.
+ */
+static HAL_StatusTypeDef sweep_uart_configure(UART_HandleTypeDef *huart, uint32_t baud_rate)
+{
+	huart->Init.BaudRate = baud_rate;
+	huart->Init.OverSampling = UART_OVERSAMPLING_8;
+	return HAL_UART_Init(huart);
+}
+
+TestOutcome_t sweep_uart(TestUnitInstance_t *instance)
+{
+	static const uint32_t baud_rates[] =
+	{
+		115200, 230400, 460800, 921600, 1000000, 1500000, 2000000, 3000000, 4000000, 4500000,
+	};
+
+	static char uart_sweep_rx_buff[TEST_PACKET_STR_MAX_LEN] DMA_BUFFER;
+	static CrcStream_t uart_sweep_rx_stream;
+
+	const TestReferenceData_t *reference = instance->reference;
+	uint8_t transfers_per_step = instance->iterations > 0 ? instance->iterations : 1;
+
+	// with 8x oversampling, a UART can run at up to 1/8 of its kernel clock (PCLK1 for UART2, PCLK2 for UART6)
+	uint32_t pclk1 = HAL_RCC_GetPCLK1Freq();
+	uint32_t pclk2 = HAL_RCC_GetPCLK2Freq();
+	uint32_t max_baud_rate = (pclk1 < pclk2 ? pclk1 : pclk2) / 8;
+
+	UART_InitTypeDef uart2_init_saved = huart2.Init;
+	UART_InitTypeDef uart6_init_saved = huart6.Init;
+
+	uint8_t step_count = 0;
+
+	while (step_count < COUNT_OF(baud_rates) && step_count < TEST_SWEEP_MAX_STEPS
+			&& baud_rates[step_count] <= max_baud_rate)
+	{
+		step_count++;
+	}
+
+	instance->sweep_log.step_count = step_count;
+
+	bool any_error_free = sweep_resumed_error_free(instance);
+
+	for (uint8_t i = instance->sweep_log.steps_done; i < step_count && !sweep_interrupted(instance); i++)
+	{
+		TestSweepStep_t step = { .setting = baud_rates[i] };
+		uint64_t clean_bytes = 0;
+		uint64_t clean_cycles = 0;
+
+		if (HAL_OK != sweep_uart_configure(&huart2, baud_rates[i])
+			|| HAL_OK != sweep_uart_configure(&huart6, baud_rates[i]))
+		{
+			step.transfers = transfers_per_step;
+			step.errors = transfers_per_step;
+			sweep_record_step(instance, &step);
+			continue;
+		}
+
+		for (uint8_t t = 0; t < transfers_per_step && !instance->cancel; t++)
+		{
+			bzero(uart_sweep_rx_buff, sizeof(uart_sweep_rx_buff));
+			crc_stream_begin(&uart_sweep_rx_stream, &huart6, (uint8_t *)uart_sweep_rx_buff, reference->test_string_len);
+
+			bool completed = false;
+			uint32_t cycles = 0;
+
+			if (HAL_OK == HAL_UART_Receive_DMA(&huart6, (uint8_t *)uart_sweep_rx_buff, reference->test_string_len))
+			{
+				uint32_t start_cycles = perf_counter_now();
+
+				if (HAL_OK == HAL_UART_Transmit(&huart2, (uint8_t *)reference->test_string_buff, reference->test_string_len, TEST_TIMEOUT_TICKS))
+				{
+					// the transmit only returns once the last frame is on the wire, which bounds the transfer time
+					cycles = perf_counter_now() - start_cycles;
+
+					TickType_t settle_start_ticks = xTaskGetTickCount();
+
+					while (huart6.RxState == HAL_UART_STATE_BUSY_RX
+						&& (xTaskGetTickCount() - settle_start_ticks) < SWEEP_RX_SETTLE_TICKS)
+					{
+						vTaskDelay(1);
+					}
+
+					completed = (huart6.RxState != HAL_UART_STATE_BUSY_RX);
+				}
+			}
+
+			if (huart6.ErrorCode != HAL_UART_ERROR_NONE)
+			{
+				step.bus_errors++;
+			}
+
+			HAL_UART_DMAStop(&huart6);
+			uint32_t rx_crc = crc_stream_finish(&uart_sweep_rx_stream);
+			step.transfers++;
+
+			if (completed && rx_crc == reference->test_string_crc)
+			{
+				clean_bytes += reference->test_string_len;
+				clean_cycles += cycles;
+			}
+			else
+			{
+				step.errors++;
+			}
+		}
+
+		step.throughput = perf_counter_bytes_per_sec(clean_bytes, clean_cycles);
+
+		if (step.transfers > 0 && step.errors == 0)
+		{
+			any_error_free = true;
+		}
+
+		sweep_record_step(instance, &step);
+	}
+
+	huart2.Init = uart2_init_saved;
+	huart6.Init = uart6_init_saved;
+	HAL_UART_Init(&huart2);
+	HAL_UART_Init(&huart6);
+
+	return any_error_free ? TESTOUTCOME_PASS : TESTOUTCOME_DATA_ERROR;
+}
+
+/**
+ * @brief Applies a frame size to both SPI peripherals and a baud rate prescaler to the master,
+ * matching the data alignment of all four of their DMA streams to the frame size.
+ */
+static HAL_StatusTypeDef sweep_spi_configure(uint32_t prescaler, uint32_t data_size)
+{
+	DMA_HandleTypeDef *dma_handles[] = { hspi3.hdmarx, hspi3.hdmatx, hspi5.hdmarx, hspi5.hdmatx };
+	bool wide = (data_size == SPI_DATASIZE_16BIT);
+
+	for (uint8_t i = 0; i < COUNT_OF(dma_handles); i++)
+	{
+		dma_handles[i]->Init.PeriphDataAlignment = wide ? DMA_PDATAALIGN_HALFWORD : DMA_PDATAALIGN_BYTE;
+		dma_handles[i]->Init.MemDataAlignment = wide ? DMA_MDATAALIGN_HALFWORD : DMA_MDATAALIGN_BYTE;
+		if (HAL_OK != HAL_DMA_Init(dma_handles[i])) return HAL_ERROR;
+	}
+
+	hspi3.Init.BaudRatePrescaler = prescaler;
+	hspi3.Init.DataSize = data_size;
+	hspi5.Init.DataSize = data_size;
+
+	if (HAL_OK != HAL_SPI_Init(&hspi3)) return HAL_ERROR;
+	return HAL_SPI_Init(&hspi5);
+}
+
+TestOutcome_t sweep_spi(TestUnitInstance_t *instance)
+{
+	static const struct { uint32_t prescaler; uint16_t divisor; } prescalers[] =
+	{
+		{ SPI_BAUDRATEPRESCALER_2, 2 }, { SPI_BAUDRATEPRESCALER_4, 4 },
+		{ SPI_BAUDRATEPRESCALER_8, 8 }, { SPI_BAUDRATEPRESCALER_16, 16 },
+		{ SPI_BAUDRATEPRESCALER_32, 32 }, { SPI_BAUDRATEPRESCALER_64, 64 },
+		{ SPI_BAUDRATEPRESCALER_128, 128 }, { SPI_BAUDRATEPRESCALER_256, 256 },
+	};
+
+	// halfword aligned, as 16 bit frames are moved by halfword DMA transfers
+	static uint16_t master_tx_buff[TEST_PACKET_STR_MAX_LEN/2] DMA_BUFFER;
+	static uint16_t master_rx_buff[TEST_PACKET_STR_MAX_LEN/2] DMA_BUFFER;
+	static uint16_t slave_tx_buff[TEST_PACKET_STR_MAX_LEN/2] DMA_BUFFER;
+	static uint16_t slave_rx_buff[TEST_PACKET_STR_MAX_LEN/2] DMA_BUFFER;
+
+	const TestReferenceData_t *reference = instance->reference;
+	uint8_t len = reference->test_string_len;
+	uint8_t transfers_per_step = instance->iterations > 0 ? instance->iterations : 1;
+	uint32_t data_size = (len % 2 == 0) ? SPI_DATASIZE_16BIT : SPI_DATASIZE_8BIT;
+	uint16_t frames = (data_size == SPI_DATASIZE_16BIT) ? len / 2 : len;
+	uint32_t spi3_kernel_clock = HAL_RCC_GetPCLK1Freq();
+
+	SPI_InitTypeDef spi3_init_saved = hspi3.Init;
+	SPI_InitTypeDef spi5_init_saved = hspi5.Init;
+	DMA_InitTypeDef dma_init_saved[4] = { hspi3.hdmarx->Init, hspi3.hdmatx->Init, hspi5.hdmarx->Init, hspi5.hdmatx->Init };
+
+	memcpy(master_tx_buff, reference->test_string_buff, len);
+	memcpy(slave_tx_buff, reference->test_string_buff, len);
+
+	instance->sweep_log.step_count = COUNT_OF(prescalers);
+
+	bool any_error_free = sweep_resumed_error_free(instance);
+
+	for (uint8_t i = instance->sweep_log.steps_done; i < COUNT_OF(prescalers) && !sweep_interrupted(instance); i++)
+	{
+		TestSweepStep_t step = { .setting = spi3_kernel_clock / prescalers[i].divisor };
+		uint64_t clean_bytes = 0;
+		uint64_t clean_cycles = 0;
+
+		if (HAL_OK != sweep_spi_configure(prescalers[i].prescaler, data_size))
+		{
+			step.transfers = transfers_per_step;
+			step.errors = transfers_per_step;
+			sweep_record_step(instance, &step);
+			continue;
+		}
+
+		for (uint8_t t = 0; t < transfers_per_step && !instance->cancel; t++)
+		{
+			bzero(master_rx_buff, sizeof(master_rx_buff));
+			bzero(slave_rx_buff, sizeof(slave_rx_buff));
+			spi_master_done_cycles = 0;
+
+			bool completed = false;
+			uint32_t cycles = 0;
+
+			// the slave is armed first, so that it is ready for the master's first clock
+			if (HAL_OK == HAL_SPI_TransmitReceive_DMA(&hspi5, (uint8_t *)slave_tx_buff, (uint8_t *)slave_rx_buff, frames))
+			{
+				uint32_t start_cycles = perf_counter_now();
+
+				if (HAL_OK == HAL_SPI_TransmitReceive_DMA(&hspi3, (uint8_t *)master_tx_buff, (uint8_t *)master_rx_buff, frames))
+				{
+					TickType_t start_ticks = xTaskGetTickCount();
+
+					while ((hspi3.State != HAL_SPI_STATE_READY || hspi5.State != HAL_SPI_STATE_READY)
+						&& (xTaskGetTickCount() - start_ticks) < SWEEP_DMA_TIMEOUT_TICKS)
+					{
+						vTaskDelay(1);
+					}
+
+					completed = (hspi3.State == HAL_SPI_STATE_READY && hspi5.State == HAL_SPI_STATE_READY);
+					cycles = spi_master_done_cycles - start_cycles;
+				}
+			}
+
+			if (hspi3.ErrorCode != HAL_SPI_ERROR_NONE || hspi5.ErrorCode != HAL_SPI_ERROR_NONE)
+			{
+				step.bus_errors++;
+			}
+
+			if (!completed)
+			{
+				HAL_SPI_DMAStop(&hspi3);
+				HAL_SPI_DMAStop(&hspi5);
+			}
+
+			step.transfers++;
+
+			if (completed
+				&& crc_calculate((uint8_t *)master_rx_buff, len) == reference->test_string_crc
+				&& crc_calculate((uint8_t *)slave_rx_buff, len) == reference->test_string_crc)
+			{
+				// full duplex, so the string crossed the bus in both directions at once
+				clean_bytes += 2 * len;
+				clean_cycles += cycles;
+			}
+			else
+			{
+				step.errors++;
+			}
+		}
+
+		step.throughput = perf_counter_bytes_per_sec(clean_bytes, clean_cycles);
+
+		if (step.transfers > 0 && step.errors == 0)
+		{
+			any_error_free = true;
+		}
+
+		sweep_record_step(instance, &step);
+	}
+
+	hspi3.hdmarx->Init = dma_init_saved[0];
+	hspi3.hdmatx->Init = dma_init_saved[1];
+	hspi5.hdmarx->Init = dma_init_saved[2];
+	hspi5.hdmatx->Init = dma_init_saved[3];
+	HAL_DMA_Init(hspi3.hdmarx);
+	HAL_DMA_Init(hspi3.hdmatx);
+	HAL_DMA_Init(hspi5.hdmarx);
+	HAL_DMA_Init(hspi5.hdmatx);
+	hspi3.Init = spi3_init_saved;
+	hspi5.Init = spi5_init_saved;
+	HAL_SPI_Init(&hspi3);
+	HAL_SPI_Init(&hspi5);
+
+	return any_error_free ? TESTOUTCOME_PASS : TESTOUTCOME_DATA_ERROR;
+}
+
+/**
+ * @brief Applies a TIMINGR value to both I2C peripherals, along with the Fast-mode Plus drive of their pins when needed.
+ */
+static HAL_StatusTypeDef sweep_i2c_configure(uint32_t timing, uint32_t bus_hz)
+{
+	if (bus_hz > I2C_TIMING_FAST_HZ)
+	{
+		HAL_I2CEx_EnableFastModePlus(I2C_FASTMODEPLUS_I2C1);
+		HAL_I2CEx_EnableFastModePlus(I2C_FASTMODEPLUS_I2C2);
+	}
+	else
+	{
+		HAL_I2CEx_DisableFastModePlus(I2C_FASTMODEPLUS_I2C1);
+		HAL_I2CEx_DisableFastModePlus(I2C_FASTMODEPLUS_I2C2);
+	}
+
+	hi2c1.Init.Timing = timing;
+	hi2c2.Init.Timing = timing;
+
+	if (HAL_OK != HAL_I2C_Init(&hi2c1)) return HAL_ERROR;
+	return HAL_I2C_Init(&hi2c2);
+}
+
+/**
+ * @brief Returns both I2C peripherals (and their DMA streams) to a clean state after a stalled transfer.
+ */
+static void sweep_i2c_recover(void)
+{
+	HAL_I2C_DeInit(&hi2c1);
+	HAL_I2C_DeInit(&hi2c2);
+	HAL_I2C_Init(&hi2c1);
+	HAL_I2C_Init(&hi2c2);
+}
+
+/**
+ * @brief Counts the errors flagged by the I2C peripherals during a transfer into the step's counters.
+ * @details
+ * The error codes of both sides are merged, so that every counter grows by at most one per transfer.
+ */
+static void sweep_i2c_count_errors(TestSweepStep_t *step)
+{
+	uint32_t error_code = hi2c1.ErrorCode | hi2c2.ErrorCode;
+
+	if (error_code & HAL_I2C_ERROR_AF) step->nacks++;
+	if (error_code & HAL_I2C_ERROR_ARLO) step->arb_losses++;
+	if (error_code & ~(HAL_I2C_ERROR_AF | HAL_I2C_ERROR_ARLO)) step->bus_errors++;
+}
+
+/**
+ * @brief Runs a single DMA-to-DMA I2C transfer, in which the master either transmits to or receives from the slave.
+ * @param [out] cycles Cycles from the start of the master's transfer to its completion
+ * @retval true The transfer concluded on both sides (successfully or not) within the timeout
+ * @retval false The transfer could not start, or stalled
+ */
+static bool sweep_i2c_transfer(I2C_HandleTypeDef *master, I2C_HandleTypeDef *slave, bool master_transmits,
+		uint8_t *tx_buff, uint8_t *rx_buff, uint8_t len, uint32_t *cycles)
+{
+	HAL_StatusTypeDef status;
+
+	// the slave is armed first, so that it acknowledges the master's address
+	status = master_transmits ? HAL_I2C_Slave_Receive_DMA(slave, rx_buff, len) : HAL_I2C_Slave_Transmit_DMA(slave, tx_buff, len);
+
+	if (HAL_OK != status) return false;
+
+	uint32_t start_cycles = perf_counter_now();
+
+	status = master_transmits
+			? HAL_I2C_Master_Transmit_DMA(master, slave->Init.OwnAddress1, tx_buff, len)
+			: HAL_I2C_Master_Receive_DMA(master, slave->Init.OwnAddress1, rx_buff, len);
+
+	if (HAL_OK != status) return false;
+
+	TickType_t start_ticks = xTaskGetTickCount();
+
+	while ((master->State != HAL_I2C_STATE_READY || slave->State != HAL_I2C_STATE_READY)
+		&& (xTaskGetTickCount() - start_ticks) < SWEEP_DMA_TIMEOUT_TICKS)
+	{
+		vTaskDelay(1);
+	}
+
+	*cycles = i2c_master_done_cycles - start_cycles;
+
+	return (master->State == HAL_I2C_STATE_READY && slave->State == HAL_I2C_STATE_READY);
+}
+
+TestOutcome_t sweep_i2c(TestUnitInstance_t *instance)
+{
+	static const uint32_t bus_clocks[] = { I2C_TIMING_STANDARD_HZ, I2C_TIMING_FAST_HZ, I2C_TIMING_FAST_PLUS_HZ };
+
+	static uint8_t i2c_sweep_rx_buff_1[TEST_PACKET_STR_MAX_LEN] DMA_BUFFER;
+	static uint8_t i2c_sweep_rx_buff_2[TEST_PACKET_STR_MAX_LEN] DMA_BUFFER;
+
+	const TestReferenceData_t *reference = instance->reference;
+	uint8_t len = reference->test_string_len;
+	uint8_t transfers_per_step = instance->iterations > 0 ? instance->iterations : 1;
+	// both I2C peripherals are clocked by PCLK1
+	uint32_t i2cclk_hz = HAL_RCC_GetPCLK1Freq();
+
+	uint32_t i2c1_timing_saved = hi2c1.Init.Timing;
+	uint32_t i2c2_timing_saved = hi2c2.Init.Timing;
+
+	instance->sweep_log.step_count = COUNT_OF(bus_clocks);
+
+	bool any_error_free = sweep_resumed_error_free(instance);
+
+	for (uint8_t i = instance->sweep_log.steps_done; i < COUNT_OF(bus_clocks) && !sweep_interrupted(instance); i++)
+	{
+		TestSweepStep_t step = { .setting = bus_clocks[i] };
+		uint64_t clean_bytes = 0;
+		uint64_t clean_cycles = 0;
+		uint32_t timing = 0;
+
+		if (!i2c_timing_compute(i2cclk_hz, bus_clocks[i], SWEEP_I2C_RISE_NS, SWEEP_I2C_FALL_NS, &timing)
+			|| HAL_OK != sweep_i2c_configure(timing, bus_clocks[i]))
+		{
+			step.transfers = transfers_per_step;
+			step.errors = transfers_per_step;
+			sweep_record_step(instance, &step);
+			continue;
+		}
+
+		for (uint8_t t = 0; t < transfers_per_step && !instance->cancel; t++)
+		{
+			bzero(i2c_sweep_rx_buff_1, sizeof(i2c_sweep_rx_buff_1));
+			bzero(i2c_sweep_rx_buff_2, sizeof(i2c_sweep_rx_buff_2));
+
+			uint32_t cycles_to_slave = 0;
+			uint32_t cycles_to_master = 0;
+
+			// I2C1 transmits as master and as slave, and I2C2 receives as slave and as master,
+			// so both directions run on the DMA streams the pair has (I2C1 TX and I2C2 RX)
+			bool completed = sweep_i2c_transfer(&hi2c1, &hi2c2, true,
+					(uint8_t *)reference->test_string_buff, i2c_sweep_rx_buff_1, len, &cycles_to_slave);
+			sweep_i2c_count_errors(&step);
+
+			if (completed)
+			{
+				completed = sweep_i2c_transfer(&hi2c2, &hi2c1, false,
+						(uint8_t *)reference->test_string_buff, i2c_sweep_rx_buff_2, len, &cycles_to_master);
+				sweep_i2c_count_errors(&step);
+			}
+
+			if (!completed)
+			{
+				sweep_i2c_recover();
+			}
+
+			step.transfers++;
+
+			if (completed
+				&& crc_calculate(i2c_sweep_rx_buff_1, len) == reference->test_string_crc
+				&& crc_calculate(i2c_sweep_rx_buff_2, len) == reference->test_string_crc)
+			{
+				clean_bytes += 2 * len;
+				clean_cycles += cycles_to_slave + cycles_to_master;
+			}
+			else
+			{
+				step.errors++;
+			}
+		}
+
+		step.throughput = perf_counter_bytes_per_sec(clean_bytes, clean_cycles);
+
+		if (step.transfers > 0 && step.errors == 0)
+		{
+			any_error_free = true;
+		}
+
+		sweep_record_step(instance, &step);
+	}
+
+	HAL_I2CEx_DisableFastModePlus(I2C_FASTMODEPLUS_I2C1);
+	HAL_I2CEx_DisableFastModePlus(I2C_FASTMODEPLUS_I2C2);
+	hi2c1.Init.Timing = i2c1_timing_saved;
+	hi2c2.Init.Timing = i2c2_timing_saved;
+	HAL_I2C_Init(&hi2c1);
+	HAL_I2C_Init(&hi2c2);
+
+	return any_error_free ? TESTOUTCOME_PASS : TESTOUTCOME_DATA_ERROR;
+}
+
+/**
+ * @brief Sets TIM6 to emit a trigger (TRGO) at the given rate, as close as its clock allows.
+ */
+static HAL_StatusTypeDef sweep_adc_configure(uint32_t sample_rate)
+{
+	// APB1 timers are clocked at twice PCLK1 whenever APB1 is divided
+	uint32_t timer_clock = HAL_RCC_GetPCLK1Freq();
+
+	if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1)
+	{
+		timer_clock *= 2;
+	}
+
+	htim6.Init.Prescaler = 0;
+	htim6.Init.Period = (timer_clock / sample_rate) - 1;
+
+	return HAL_TIM_Base_Init(&htim6);
+}
+
+/**
+ * @brief Runs a single capture of the ADC stream, reducing each buffer half into the statistics as soon as it is filled.
+ * @param [out] samples_timed Samples converted between the first and the last buffer half interrupts
+ * @param [out] cycles Cycles elapsed between the first and the last buffer half interrupts
+ * @retval true The capture completed, with every half reduced before the DMA came back around to it
+ * @retval false The capture could not start, stalled, or overran its reduction
+ */
+static bool sweep_adc_capture(uint32_t sample_rate, SampleStats_t *stats, uint32_t *samples_timed, uint32_t *cycles)
+{
+	uint32_t halves_needed = SWEEP_ADC_CAPTURE_SAMPLES / SWEEP_ADC_HALF_SAMPLES;
+	uint32_t half_timeout_ticks = pdMS_TO_TICKS(((SWEEP_ADC_HALF_SAMPLES * 1000) / sample_rate) + 50);
+	uint32_t halves_done = 0;
+	bool overrun = false;
+
+	adc_stream_halves_filled = 0;
+	adc_stream_thread = osThreadGetId();
+	osThreadFlagsClear(SWEEP_ADC_HALF_FILLED_FLAG);
+
+	if (HAL_OK == HAL_ADC_Start_DMA(&hadc1, (uint32_t *)adc_stream_buff, COUNT_OF(adc_stream_buff))
+		&& HAL_OK == HAL_TIM_Base_Start(&htim6))
+	{
+		while (halves_done < halves_needed && !overrun)
+		{
+			if (halves_done >= adc_stream_halves_filled)
+			{
+				if (osThreadFlagsWait(SWEEP_ADC_HALF_FILLED_FLAG, osFlagsWaitAny, half_timeout_ticks) & osFlagsError) break;
+				continue;
+			}
+
+			// the first half filled is the lower one, and they alternate from there
+			sample_stats_accumulate(stats, adc_stream_buff + ((halves_done % 2) * SWEEP_ADC_HALF_SAMPLES), SWEEP_ADC_HALF_SAMPLES);
+			halves_done++;
+
+			// once the next half is filled too, the DMA is already writing over the half just reduced
+			if (adc_stream_halves_filled > halves_done)
+			{
+				overrun = true;
+			}
+		}
+	}
+
+	HAL_TIM_Base_Stop(&htim6);
+	HAL_ADC_Stop_DMA(&hadc1);
+	adc_stream_thread = NULL;
+
+	uint32_t halves_filled = adc_stream_halves_filled;
+
+	*samples_timed = halves_filled > 1 ? (halves_filled - 1) * SWEEP_ADC_HALF_SAMPLES : 0;
+	*cycles = halves_filled > 1 ? adc_stream_last_cycles - adc_stream_first_cycles : 0;
+
+	return (halves_done == halves_needed && !overrun);
+}
+
+TestOutcome_t sweep_adc(TestUnitInstance_t *instance)
+{
+	static const uint32_t sample_rates[] = { 10000, 50000, 100000, 250000, 500000, 1000000, 2000000 };
+
+	uint8_t captures_per_step = instance->iterations > 0 ? instance->iterations : 1;
+
+	// the ADC clock is PCLK2 divided by the common prescaler (2, 4, 6 or 8)
+	uint32_t adc_clock = HAL_RCC_GetPCLK2Freq() / (2 * ((hadc1.Init.ClockPrescaler >> ADC_CCR_ADCPRE_Pos) + 1));
+	uint32_t max_sample_rate = adc_clock / SWEEP_ADC_CONVERSION_CYCLES;
+
+	ADC_InitTypeDef adc_init_saved = hadc1.Init;
+	DMA_InitTypeDef dma_init_saved = hadc1.DMA_Handle->Init;
+	TIM_Base_InitTypeDef tim_init_saved = htim6.Init;
+
+	// conversions triggered by TIM6, streamed as halfwords into the circular buffer
+	hadc1.Init.ExternalTrigConv = ADC_EXTERNALTRIGCONV_T6_TRGO;
+	hadc1.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_RISING;
+	hadc1.Init.DMAContinuousRequests = ENABLE;
+	hadc1.DMA_Handle->Init.Mode = DMA_CIRCULAR;
+	hadc1.DMA_Handle->Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+	hadc1.DMA_Handle->Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+
+	bool configured = (HAL_OK == HAL_DMA_Init(hadc1.DMA_Handle) && HAL_OK == HAL_ADC_Init(&hadc1));
+
+	uint8_t step_count = 0;
+
+	while (step_count < COUNT_OF(sample_rates) && step_count < TEST_SWEEP_MAX_STEPS
+			&& sample_rates[step_count] <= max_sample_rate)
+	{
+		step_count++;
+	}
+
+	instance->sweep_log.step_count = step_count;
+
+	bool any_error_free = sweep_resumed_error_free(instance);
+
+	for (uint8_t i = instance->sweep_log.steps_done; i < step_count && !sweep_interrupted(instance); i++)
+	{
+		TestSweepStep_t step = { .setting = sample_rates[i] };
+		uint64_t timed_samples = 0;
+		uint64_t timed_cycles = 0;
+
+		sample_stats_reset(&step.noise);
+
+		if (!configured || HAL_OK != sweep_adc_configure(sample_rates[i]))
+		{
+			step.transfers = captures_per_step;
+			step.errors = captures_per_step;
+			sweep_record_step(instance, &step);
+			continue;
+		}
+
+		for (uint8_t t = 0; t < captures_per_step && !instance->cancel; t++)
+		{
+			uint32_t samples = 0;
+			uint32_t cycles = 0;
+			bool completed = sweep_adc_capture(sample_rates[i], &step.noise, &samples, &cycles);
+
+			if (hadc1.ErrorCode != HAL_ADC_ERROR_NONE)
+			{
+				step.bus_errors++;
+			}
+
+			step.transfers++;
+
+			if (completed)
+			{
+				timed_samples += samples;
+				timed_cycles += cycles;
+			}
+			else
+			{
+				step.errors++;
+			}
+		}
+
+		// samples (rather than bytes) per second
+		step.throughput = perf_counter_bytes_per_sec(timed_samples, timed_cycles);
+
+		if (step.transfers > 0 && step.errors == 0)
+		{
+			any_error_free = true;
+		}
+
+		sweep_record_step(instance, &step);
+	}
+
+	hadc1.Init = adc_init_saved;
+	hadc1.DMA_Handle->Init = dma_init_saved;
+	htim6.Init = tim_init_saved;
+	HAL_DMA_Init(hadc1.DMA_Handle);
+	HAL_ADC_Init(&hadc1);
+	HAL_TIM_Base_Init(&htim6);
+
+	return any_error_free ? TESTOUTCOME_PASS : TESTOUTCOME_DATA_ERROR;
+}
+
+TestOutcome_t sweep_timer(TestUnitInstance_t *instance)
+{
+	static const struct
+	{
+		uint16_t prescaler;
+		uint16_t period;
+	} timebases[] =
+	{
+		// 10kHz to 1MHz at a 72MHz timer clock, the slowest ones prescaled (at a coarser capture resolution)
+		{ 8, 799 }, { 1, 1799 }, { 0, 1439 }, { 0, 719 }, { 0, 287 }, { 0, 143 }, { 0, 71 },
+	};
+
+	static const int32_t capture_error_tolerance = 10;
+	static const uint8_t duty_variation_count = 8;
+
+	uint8_t captures_per_step = instance->iterations > 0 ? instance->iterations : 1;
+	uint8_t step_count = COUNT_OF(timebases);
+	uint32_t clock_hz = timer_capture_clock_hz();
+
+	instance->sweep_log.step_count = step_count;
+
+	bool any_error_free = sweep_resumed_error_free(instance);
+
+	for (uint8_t i = instance->sweep_log.steps_done; i < step_count && !sweep_interrupted(instance); i++)
+	{
+		uint32_t prescaler = timebases[i].prescaler;
+		uint32_t period = timebases[i].period;
+		TestSweepStep_t step = { .setting = clock_hz / ((prescaler + 1) * (period + 1)) };
+		uint64_t timed_edges = 0;
+		uint64_t timed_cycles = 0;
+
+		capture_stats_reset(&step.capture);
+
+		for (uint8_t t = 0; t < captures_per_step && !instance->cancel; t++)
+		{
+			// the duty cycle steps through 1/9 to 8/9 over the step's captures
+			uint32_t pulse = ((period + 1) * ((t % duty_variation_count) + 1)) / (duty_variation_count + 1);
+			CaptureStats_t capture;
+
+			capture_stats_reset(&capture);
+
+			uint32_t start_cycles = perf_counter_now();
+			bool completed = timer_capture_run(prescaler, period, pulse, TIMER_CAPTURE_MAX_EDGES, &capture);
+			uint32_t cycles = perf_counter_now() - start_cycles;
+
+			step.transfers++;
+
+			if (!completed)
+			{
+				step.errors++;
+				continue;
+			}
+
+			capture_stats_merge(&step.capture, &capture);
+
+			if (capture.duty_error_min < -capture_error_tolerance
+				|| capture.duty_error_max > capture_error_tolerance)
+			{
+				step.errors++;
+				continue;
+			}
+
+			timed_edges += TIMER_CAPTURE_MAX_EDGES;
+			timed_cycles += cycles;
+		}
+
+		// captured periods (rather than bytes) per second
+		step.throughput = perf_counter_bytes_per_sec(timed_edges, timed_cycles);
+
+		if (step.transfers > 0 && step.errors == 0)
+		{
+			any_error_free = true;
+		}
+
+		sweep_record_step(instance, &step);
+	}
+
+	return any_error_free ? TESTOUTCOME_PASS : TESTOUTCOME_DATA_ERROR;
+}
@@ -0,0 +1,78 @@
+/*
+ * peripheral_sweeps.h
+ *
+ *  Created on: Aug 6, 2025
+ *      Author: User
+ */
+
+/**
+ * @file peripheral_sweeps.h
+ * @brief Header file for the peripheral sweep implementations, which qualify a peripheral pair
+ * over a range of settings rather than at its single configured one.
+ */
+
+#ifndef PERIPHERAL_SWEEPS_H_
+#define PERIPHERAL_SWEEPS_H_
+
+#include "peripheral_tests.h"
+
+/**
+ * @brief The UART sweep implementation.
+ * @details
+ * This function reconfigures UART2 and UART6 (with 8x oversampling) through a list of baud rates,
+ * up to the highest one their kernel clocks allow, and at each rate runs the instance's iterations
+ * of DMA loopback transfers from UART2 to UART6, measuring their throughput.
+ * The original configuration is restored when the sweep concludes.
+ * @retval TESTOUTCOME_PASS At least one baud rate was error-free
+ * @retval TESTOUTCOME_DATA_ERROR No baud rate was error-free
+ */
+TestOutcome_t sweep_uart(TestUnitInstance_t *instance);
+/**
+ * @brief The SPI sweep (benchmark) implementation.
+ * @details
+ * This function runs both SPI3 (master) and SPI5 (slave) on DMA, exchanging the reference string
+ * in both directions at once, while sweeping the master's baud rate prescaler from 2 to 256.
+ * Strings of even length are sent as 16 bit frames, halving the count of DMA requests.
+ * Each step reports the SCK frequency and the full-duplex throughput (bytes moved in both directions).
+ * The original configuration is restored when the sweep concludes.
+ * @retval TESTOUTCOME_PASS At least one prescaler was error-free
+ * @retval TESTOUTCOME_DATA_ERROR No prescaler was error-free
+ */
+TestOutcome_t sweep_spi(TestUnitInstance_t *instance);
+/**
+ * @brief The I2C sweep (benchmark) implementation.
+ * @details
+ * This function steps I2C1 and I2C2 through Standard mode, Fast mode and Fast-mode Plus,
+ * with TIMINGR values computed for the current I2C kernel clock (see @ref i2c_timing_compute()),
+ * and at each speed runs the instance's iterations of DMA-to-DMA transfers in both directions,
+ * counting NACKs and arbitration losses apart from other bus errors.
+ * The original timings are restored when the sweep concludes.
+ * @retval TESTOUTCOME_PASS At least one speed was error-free
+ * @retval TESTOUTCOME_DATA_ERROR No speed was error-free
+ */
+TestOutcome_t sweep_i2c(TestUnitInstance_t *instance);
+/**
+ * @brief The ADC sweep (characterization) implementation.
+ * @details
+ * This function streams conversions triggered by TIM6 into a circular DMA buffer, at a list of
+ * sample rates up to the highest one the ADC clock allows, and reduces each half of the buffer
+ * while the other is being filled, into the step's sample statistics (range, mean, RMS noise, histogram).
+ * Each iteration captures 8192 samples, and fails if the reduction fell behind.
+ * The original configuration is restored when the sweep concludes.
+ * @retval TESTOUTCOME_PASS At least one sample rate was sustained in every iteration
+ * @retval TESTOUTCOME_DATA_ERROR No sample rate was sustained
+ */
+TestOutcome_t sweep_adc(TestUnitInstance_t *instance);
+/**
+ * @brief The timer sweep (characterization) implementation.
+ * @details
+ * This function runs TIM1's PWM loopback through a list of timebases (prescaler and period) from 10kHz to 1MHz,
+ * and at each one runs the instance's iterations of DMA captures of 1024 periods, stepping the duty cycle
+ * from 1/9 to 8/9, into the step's capture statistics (duty error, duty and period jitter, frequency error).
+ * A capture fails if any of its high times was off by more than 10 ticks.
+ * @retval TESTOUTCOME_PASS At least one timebase was error-free
+ * @retval TESTOUTCOME_DATA_ERROR No timebase was error-free
+ */
+TestOutcome_t sweep_timer(TestUnitInstance_t *instance);
+
+#endif /* PERIPHERAL_SWEEPS_H_ */
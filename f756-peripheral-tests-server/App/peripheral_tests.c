@@ -10,10 +10,13 @@
  * @brief Source file in which the actual peripheral tests are implemented.
  */
 
-#include <math.h>
-
 #include "main.h"
+#include "crc_stream.h"
+#include "memory_layout.h"
+#include "perf_counter.h"
 #include "peripheral_tests.h"
+#include "peripheral_sweeps.h"
+#include "test_registry.h"
 
 /**
  * @brief The UART peripheral test implementation.
@@ -21,22 +24,26 @@
  * This function transfers data between several buffers
  * using peripherals UART2 and UART6, in both directions,
  * with and without DMA. The transfer results is compared
- * to the reference string using CRC.
- * @retval true Test Success
- * @retval false Test Failure
+ * to the reference string using CRC, accumulated from the DMA callbacks
+ * while the string is still being received.
+ * @retval TESTOUTCOME_PASS Test Success
+ * @retval TESTOUTCOME_TIMEOUT A peripheral operation did not complete
+ * @retval TESTOUTCOME_DATA_ERROR The result did not match the reference (detail is filled for data transfers)
  */
-static bool test_uart(void);
+static TestOutcome_t test_uart(const TestReferenceData_t *reference, TestErrorDetail_t *detail);
 /**
  * @brief The Timer peripheral test implementation.
  * @details
  * This function tests the Timer 1 Input Capture and PWM Generation capabilities,
- * using channel 2 and channel 3, respectively.
+ * using channels 1 and 2, and channel 3, respectively.
  * A series of PWM signals with different duty cycles are generated on channel 3,
- * and Channel 2 is expected to measure those duty cycle values within a reasonable tolerance.
- * @retval true Test Success
- * @retval false Test Failure
+ * and for each one, channel 2 captures the high time of @ref TIMER_CAPTURE_MAX_EDGES periods on DMA,
+ * every one of which is expected to match the duty cycle within a reasonable tolerance.
+ * @retval TESTOUTCOME_PASS Test Success
+ * @retval TESTOUTCOME_TIMEOUT A peripheral operation did not complete
+ * @retval TESTOUTCOME_DATA_ERROR The result did not match the reference (detail is filled for data transfers)
  */
-static bool test_timer(void);
+static TestOutcome_t test_timer(const TestReferenceData_t *reference, TestErrorDetail_t *detail);
 /**
  * @brief The SPI peripheral test implementation.
  * @details
@@ -44,10 +51,11 @@ static bool test_timer(void);
  * using peripherals SPI3 and SPI5, in both directions,
  * with and without DMA. The transfer results is compared
  * to the reference string using CRC.
- * @retval true Test Success
- * @retval false Test Failure
+ * @retval TESTOUTCOME_PASS Test Success
+ * @retval TESTOUTCOME_TIMEOUT A peripheral operation did not complete
+ * @retval TESTOUTCOME_DATA_ERROR The result did not match the reference (detail is filled for data transfers)
  */
-static bool test_spi(void);
+static TestOutcome_t test_spi(const TestReferenceData_t *reference, TestErrorDetail_t *detail);
 /**
  * @brief The I2C peripheral test implementation.
  * @details
@@ -55,247 +63,576 @@ static bool test_spi(void);
  * using peripherals I2C1 and I2C2, in both directions,
  * with and without DMA. The transfer results is compared
  * to the reference string using CRC.
- * @retval true Test Success
- * @retval false Test Failure
+ * @retval TESTOUTCOME_PASS Test Success
+ * @retval TESTOUTCOME_TIMEOUT A peripheral operation did not complete
+ * @retval TESTOUTCOME_DATA_ERROR The result did not match the reference (detail is filled for data transfers)
  */
-static bool test_i2c(void);
+static TestOutcome_t test_i2c(const TestReferenceData_t *reference, TestErrorDetail_t *detail);
 /**
  * @brief The ADC peripheral test implementation.
  * @details
  * This function evalutes the reading from peripheral ADC1,
  * which is connected directly to 3.3v output and expected
  * to approximate the maximal reading (4095).
- * @retval true Test Success
- * @retval false Test Failure
+ * @retval TESTOUTCOME_PASS Test Success
+ * @retval TESTOUTCOME_TIMEOUT A peripheral operation did not complete
+ * @retval TESTOUTCOME_DATA_ERROR The result did not match the reference (detail is filled for data transfers)
  */
-static bool test_adc(void);
+static TestOutcome_t test_adc(const TestReferenceData_t *reference, TestErrorDetail_t *detail);
 
 extern UART_HandleTypeDef huart2;
 extern UART_HandleTypeDef huart6;
-extern TIM_HandleTypeDef htim1;
 extern SPI_HandleTypeDef hspi3;
 extern SPI_HandleTypeDef hspi5;
 extern I2C_HandleTypeDef hi2c1;
 extern I2C_HandleTypeDef hi2c2;
 extern ADC_HandleTypeDef hadc1;
-extern CRC_HandleTypeDef hcrc;
 
-const TestUnitDefinition_t test_definitions[NUM_POSSIBLE_TESTS] =
+/**
+ * @brief Definitions of the built-in test units, registered by @ref peripheral_tests_register().
+ */
+static const TestUnitDefinition_t timer_definition =
+{
+	.name = "Timer\0", .resources = TESTRES_TIM1,
+	.params = TESTPARAM_ITERATIONS | TESTPARAM_FAIL_FAST | TESTPARAM_SWEEP,
+	.results = TESTRESULT_DETAIL | TESTRESULT_SWEEP_STEP | TESTRESULT_SWEEP_CAPTURE,
+	.func = test_timer, .sweep = sweep_timer,
+};
+static const TestUnitDefinition_t uart_definition =
 {
-	{ .name = "Timer\0", .func = test_timer, },
-	{ .name = "UART\0", .func = test_uart, },
-	{ .name = "SPI\0", .func = test_spi, },
-	{ .name = "I2C\0", .func = test_i2c, },
-	{ .name = "ADC\0", .func = test_adc, },
+	.name = "UART\0", .resources = TESTRES_UART2 | TESTRES_UART6,
+	.params = TESTPARAM_ITERATIONS | TESTPARAM_STRING | TESTPARAM_FAIL_FAST | TESTPARAM_SWEEP,
+	.results = TESTRESULT_DETAIL | TESTRESULT_SWEEP_STEP,
+	.func = test_uart, .sweep = sweep_uart,
+};
+static const TestUnitDefinition_t spi_definition =
+{
+	.name = "SPI\0", .resources = TESTRES_SPI3 | TESTRES_SPI5,
+	.params = TESTPARAM_ITERATIONS | TESTPARAM_STRING | TESTPARAM_FAIL_FAST | TESTPARAM_SWEEP,
+	.results = TESTRESULT_DETAIL | TESTRESULT_SWEEP_STEP,
+	.func = test_spi, .sweep = sweep_spi,
+};
+static const TestUnitDefinition_t i2c_definition =
+{
+	.name = "I2C\0", .resources = TESTRES_I2C1 | TESTRES_I2C2,
+	.params = TESTPARAM_ITERATIONS | TESTPARAM_STRING | TESTPARAM_FAIL_FAST | TESTPARAM_SWEEP,
+	.results = TESTRESULT_DETAIL | TESTRESULT_SWEEP_STEP,
+	.func = test_i2c, .sweep = sweep_i2c,
+};
+static const TestUnitDefinition_t adc_definition =
+{
+	.name = "ADC\0", .resources = TESTRES_ADC1 | TESTRES_TIM6,
+	.params = TESTPARAM_ITERATIONS | TESTPARAM_FAIL_FAST | TESTPARAM_SWEEP,
+	.results = TESTRESULT_DETAIL | TESTRESULT_SWEEP_STEP | TESTRESULT_SWEEP_NOISE,
+	.func = test_adc, .sweep = sweep_adc,
 };
 
 TestUnitInstance_t test_instances[NUM_POSSIBLE_TESTS] =
 {
-	{ .state = TESTSTATE_READY, .iterations = 0 },
-	{ .state = TESTSTATE_READY, .iterations = 0 },
-	{ .state = TESTSTATE_READY, .iterations = 0 },
-	{ .state = TESTSTATE_READY, .iterations = 0 },
-	{ .state = TESTSTATE_READY, .iterations = 0 },
+	{ .state = TESTSTATE_READY, .iterations = 0, .reference = NULL },
+	{ .state = TESTSTATE_READY, .iterations = 0, .reference = NULL },
+	{ .state = TESTSTATE_READY, .iterations = 0, .reference = NULL },
+	{ .state = TESTSTATE_READY, .iterations = 0, .reference = NULL },
+	{ .state = TESTSTATE_READY, .iterations = 0, .reference = NULL },
 };
 
-static volatile TestReferenceData_t test_reference = {0};
+/**
+ * @brief Reference data for each priority class, indexed by @ref TestPriority_t.
+ * Its strings are the sources of the transmitting DMAs, hence its place in DTCM.
+ */
+static TestReferenceData_t test_references[TESTPRIO_INTERACTIVE+1] DMA_BUFFER;
+
+/**
+ * @brief The count of passes over each benchmark buffer in @ref peripheral_tests_benchmark_memory().
+ */
+#define MEMORY_BENCHMARK_ROUNDS (256)
+
+/**
+ * @brief Pairs of (expected, received) benchmark buffers, one in each memory a buffer may be placed in.
+ */
+static uint8_t benchmark_dtcm_buff[2][TEST_PACKET_STR_MAX_LEN] DMA_BUFFER;
+static uint8_t benchmark_cached_buff[2][TEST_PACKET_STR_MAX_LEN] __attribute__((aligned(32)));
+static uint8_t benchmark_uncached_buff[2][TEST_PACKET_STR_MAX_LEN] UNCACHED_BUFFER;
+
+/**
+ * @brief Counts the set bits of a word, using a branchless SWAR reduction.
+ */
+static inline uint32_t popcount32(uint32_t x)
+{
+	x = x - ((x >> 1) & 0x55555555UL);
+	x = (x & 0x33333333UL) + ((x >> 2) & 0x33333333UL);
+	x = (x + (x >> 4)) & 0x0F0F0F0FUL;
+	return (x * 0x01010101UL) >> 24;
+}
+
+/**
+ * @brief Compares two buffers a word at a time, counting flipped bits with XOR and popcount.
+ * @details
+ * Words are loaded with memcpy, which compiles to single (unaligned capable) loads on the Cortex-M7,
+ * and only the trailing bytes that do not fill a word are compared one at a time.
+ * It only runs once a buffer's CRC did not match (see @ref evaluate_rx_buffer()), so it stays in flash.
+ * @param [in] expected The reference data
+ * @param [in] received The transferred data
+ * @param [in] len Length of both buffers in bytes
+ * @param [out] first_error_offset Offset of the earliest mismatching byte, untouched if the buffers match
+ * @retval The total count of flipped bits
+ */
+static uint32_t count_bit_errors(const uint8_t *expected, const uint8_t *received, uint16_t len, uint16_t *first_error_offset)
+{
+	uint32_t bit_errors = 0;
+	bool mismatch_found = false;
+	uint16_t i = 0;
+
+	for (; i + sizeof(uint32_t) <= len; i += sizeof(uint32_t))
+	{
+		uint32_t expected_word;
+		uint32_t received_word;
+		memcpy(&expected_word, expected+i, sizeof(expected_word));
+		memcpy(&received_word, received+i, sizeof(received_word));
+
+		uint32_t diff = expected_word ^ received_word;
+
+		if (diff != 0)
+		{
+			if (!mismatch_found)
+			{
+				// little endian: the lowest set bit belongs to the earliest byte
+				*first_error_offset = i + (__builtin_ctz(diff) >> 3);
+				mismatch_found = true;
+			}
+
+			bit_errors += popcount32(diff);
+		}
+	}
+
+	for (; i < len; i++)
+	{
+		uint32_t diff = expected[i] ^ received[i];
+
+		if (diff != 0)
+		{
+			if (!mismatch_found)
+			{
+				*first_error_offset = i;
+				mismatch_found = true;
+			}
+
+			bit_errors += popcount32(diff);
+		}
+	}
+
+	return bit_errors;
+}
+
+/**
+ * @brief Evaluates a received buffer against the reference string.
+ * @details
+ * The CRC comparison settles the common (matching) case, and only on a mismatch
+ * is the received data compared in full, accumulating its error detail.
+ * @param [in] rx_crc The CRC of the received buffer, usually accumulated while it was being received
+ * @retval TESTOUTCOME_PASS The buffer matches the reference string
+ * @retval TESTOUTCOME_DATA_ERROR The buffer does not match, and detail was updated
+ */
+static TestOutcome_t evaluate_rx_buffer(const TestReferenceData_t *reference, const char *rx_buff, uint32_t rx_crc, TestErrorDetail_t *detail)
+{
+	if (rx_crc == reference->test_string_crc) return TESTOUTCOME_PASS;
+
+	uint16_t first_error_offset = TEST_RESULTS_NO_ERROR_OFFSET;
+	detail->bit_errors += count_bit_errors((const uint8_t *)reference->test_string_buff, (const uint8_t *)rx_buff,
+			reference->test_string_len, &first_error_offset);
+
+	if (first_error_offset < detail->first_error_offset)
+	{
+		detail->first_error_offset = first_error_offset;
+	}
+
+	return TESTOUTCOME_DATA_ERROR;
+}
 
-static bool test_timer(void)
+static TestOutcome_t test_timer(const TestReferenceData_t *reference, TestErrorDetail_t *detail)
 {
-	static const uint32_t capture_error_tolerance = 10;
-	static const uint16_t capture_delay_ticks = pdMS_TO_TICKS(50);
+	static const int32_t capture_error_tolerance = 10;
+	// a ~70kHz PWM at the full timer clock, so that each capture takes about 15ms
+	static const uint32_t capture_prescaler = 0;
+	static const uint32_t capture_period = 1023;
 	static const uint8_t duty_variation_count = 8;
 
-	uint32_t generated_duty_cycle;
-	uint32_t captured_duty_cycle;
-	uint32_t capture_error_amount;
+	CaptureStats_t stats;
 
 	for (int i = 0; i < duty_variation_count; i++)
 	{
-		generated_duty_cycle = htim1.Instance->ARR / pow(2, i+1);
-		htim1.Instance->CCR3 = generated_duty_cycle;
-		if (HAL_OK != HAL_TIM_PWM_Start(&htim1, TIM_CHANNEL_3)
-			|| HAL_OK != HAL_TIM_IC_Start(&htim1, TIM_CHANNEL_2))
+		// duty cycles from 1/9 to 8/9, clear of pulses too short for the capture path
+		uint32_t generated_duty_cycle = ((capture_period + 1) * (i + 1)) / (duty_variation_count + 1);
+
+		capture_stats_reset(&stats);
+
+		if (!timer_capture_run(capture_prescaler, capture_period, generated_duty_cycle, TIMER_CAPTURE_MAX_EDGES, &stats))
 		{
-			HAL_TIM_IC_Stop(&htim1, TIM_CHANNEL_2);
-			HAL_TIM_PWM_Stop(&htim1, TIM_CHANNEL_3);
-			return false;
+			return TESTOUTCOME_TIMEOUT;
 		}
-		vTaskDelay(capture_delay_ticks);
-		HAL_TIM_IC_Stop(&htim1, TIM_CHANNEL_2);
-		HAL_TIM_PWM_Stop(&htim1, TIM_CHANNEL_3);
-		captured_duty_cycle = HAL_TIM_ReadCapturedValue(&htim1, TIM_CHANNEL_2);
 
-		capture_error_amount = captured_duty_cycle > generated_duty_cycle
-				? captured_duty_cycle - generated_duty_cycle
-				: generated_duty_cycle - captured_duty_cycle;
-
-		if (capture_error_amount > capture_error_tolerance) return false;
+		if (stats.duty_error_min < -capture_error_tolerance
+			|| stats.duty_error_max > capture_error_tolerance) return TESTOUTCOME_DATA_ERROR;
 	}
 
-	return true;
+	return TESTOUTCOME_PASS;
 }
 
-static bool test_uart(void)
+static TestOutcome_t test_uart(const TestReferenceData_t *reference, TestErrorDetail_t *detail)
 {
-	static char uart_test_rx_buff_1[TEST_PACKET_STR_MAX_LEN] = {0};
-	static char uart_test_rx_buff_2[TEST_PACKET_STR_MAX_LEN] = {0};
+	static char uart_test_rx_buff_1[TEST_PACKET_STR_MAX_LEN] DMA_BUFFER;
+	static char uart_test_rx_buff_2[TEST_PACKET_STR_MAX_LEN] DMA_BUFFER;
+
+	static CrcStream_t uart_rx_stream;
 
 	bzero(uart_test_rx_buff_1, sizeof(uart_test_rx_buff_1));
 	bzero(uart_test_rx_buff_2, sizeof(uart_test_rx_buff_2));
 
-	if(HAL_OK != HAL_UART_Receive_DMA(&huart6, (uint8_t *)uart_test_rx_buff_1, test_reference.test_string_len)
-			|| HAL_OK != HAL_UART_Transmit(&huart2, (uint8_t *)test_reference.test_string_buff, test_reference.test_string_len, TEST_TIMEOUT_TICKS))
+	// a single transfer for the whole string, as re-arming the DMA midway would overrun the receiver at high baud rates
+	crc_stream_begin(&uart_rx_stream, &huart6, (uint8_t *)uart_test_rx_buff_1, reference->test_string_len);
+
+	if(HAL_OK != HAL_UART_Receive_DMA(&huart6, (uint8_t *)uart_test_rx_buff_1, reference->test_string_len)
+			|| HAL_OK != HAL_UART_Transmit(&huart2, (uint8_t *)reference->test_string_buff, reference->test_string_len, TEST_TIMEOUT_TICKS))
 	{
 		HAL_UART_DMAStop(&huart6);
-		return false;
+		crc_stream_finish(&uart_rx_stream);
+		return TESTOUTCOME_TIMEOUT;
 	}
 
 	vTaskDelay(TEST_GAP_TICKS);
 	HAL_UART_DMAStop(&huart6);
 
-	if (HAL_CRC_Calculate(&hcrc, uart_test_rx_buff_1, test_reference.test_string_len)
-		!= test_reference.test_string_crc) return false;
+	if (TESTOUTCOME_PASS != evaluate_rx_buffer(reference, uart_test_rx_buff_1,
+			crc_stream_finish(&uart_rx_stream), detail)) return TESTOUTCOME_DATA_ERROR;
+
+	crc_stream_begin(&uart_rx_stream, &huart2, (uint8_t *)uart_test_rx_buff_2, reference->test_string_len);
 
-	if (HAL_OK != HAL_UART_Receive_DMA(&huart2, (uint8_t *)uart_test_rx_buff_2, test_reference.test_string_len)
-			|| HAL_OK != HAL_UART_Transmit(&huart6, (uint8_t *)uart_test_rx_buff_1, test_reference.test_string_len, TEST_TIMEOUT_TICKS))
+	if (HAL_OK != HAL_UART_Receive_DMA(&huart2, (uint8_t *)uart_test_rx_buff_2, reference->test_string_len)
+			|| HAL_OK != HAL_UART_Transmit(&huart6, (uint8_t *)uart_test_rx_buff_1, reference->test_string_len, TEST_TIMEOUT_TICKS))
 	{
 		HAL_UART_DMAStop(&huart2);
-		return false;
+		crc_stream_finish(&uart_rx_stream);
+		return TESTOUTCOME_TIMEOUT;
 	}
 
 	vTaskDelay(TEST_GAP_TICKS);
 	HAL_UART_DMAStop(&huart2);
 
-	return (HAL_CRC_Calculate(&hcrc, uart_test_rx_buff_2, test_reference.test_string_len)
-			== test_reference.test_string_crc);
+	return evaluate_rx_buffer(reference, uart_test_rx_buff_2, crc_stream_finish(&uart_rx_stream), detail);
 }
 
-static bool test_spi(void)
+static TestOutcome_t test_spi(const TestReferenceData_t *reference, TestErrorDetail_t *detail)
 {
-	static char spi_rx_buff_1[TEST_PACKET_STR_MAX_LEN] = {0};
-	static char spi_rx_buff_2[TEST_PACKET_STR_MAX_LEN] = {0};
-	static char spi_rx_buff_dummy[TEST_PACKET_STR_MAX_LEN] = {0};
-	static char spi_tx_buff_dummy[TEST_PACKET_STR_MAX_LEN] = {0};
+	static char spi_rx_buff_1[TEST_PACKET_STR_MAX_LEN] DMA_BUFFER;
+	static char spi_rx_buff_2[TEST_PACKET_STR_MAX_LEN] DMA_BUFFER;
+	static char spi_rx_buff_dummy[TEST_PACKET_STR_MAX_LEN] DMA_BUFFER;
+	static char spi_tx_buff_dummy[TEST_PACKET_STR_MAX_LEN] DMA_BUFFER;
+
+	static CrcStream_t spi_rx_stream;
 
 	bzero(spi_rx_buff_1, sizeof(spi_rx_buff_1));
 	bzero(spi_rx_buff_2, sizeof(spi_rx_buff_2));
 
-	if (HAL_OK != HAL_SPI_Receive_DMA(&hspi5, (uint8_t *)spi_rx_buff_1, test_reference.test_string_len)
-			|| HAL_OK != HAL_SPI_Transmit(&hspi3, (uint8_t *)test_reference.test_string_buff, test_reference.test_string_len, TEST_TIMEOUT_TICKS))
+	crc_stream_begin(&spi_rx_stream, &hspi5, (uint8_t *)spi_rx_buff_1, reference->test_string_len);
+
+	if (HAL_OK != HAL_SPI_Receive_DMA(&hspi5, (uint8_t *)spi_rx_buff_1, reference->test_string_len)
+			|| HAL_OK != HAL_SPI_Transmit(&hspi3, (uint8_t *)reference->test_string_buff, reference->test_string_len, TEST_TIMEOUT_TICKS))
 	{
 		HAL_SPI_DMAStop(&hspi5);
-		return false;
+		crc_stream_finish(&spi_rx_stream);
+		return TESTOUTCOME_TIMEOUT;
 	}
 
 	vTaskDelay(TEST_GAP_TICKS);
 	HAL_SPI_DMAStop(&hspi5);
 
-	if (HAL_CRC_Calculate(&hcrc, spi_rx_buff_1, test_reference.test_string_len)
-			!= test_reference.test_string_crc) return false;
+	if (TESTOUTCOME_PASS != evaluate_rx_buffer(reference, spi_rx_buff_1,
+			crc_stream_finish(&spi_rx_stream), detail)) return TESTOUTCOME_DATA_ERROR;
 
-	if (HAL_OK != HAL_SPI_TransmitReceive_DMA(&hspi5, (uint8_t *)spi_rx_buff_1, (uint8_t *)spi_rx_buff_dummy, test_reference.test_string_len)
-			|| HAL_OK != HAL_SPI_TransmitReceive(&hspi3, (uint8_t *)spi_tx_buff_dummy, (uint8_t *)spi_rx_buff_2, test_reference.test_string_len, TEST_TIMEOUT_TICKS))
+	if (HAL_OK != HAL_SPI_TransmitReceive_DMA(&hspi5, (uint8_t *)spi_rx_buff_1, (uint8_t *)spi_rx_buff_dummy, reference->test_string_len)
+			|| HAL_OK != HAL_SPI_TransmitReceive(&hspi3, (uint8_t *)spi_tx_buff_dummy, (uint8_t *)spi_rx_buff_2, reference->test_string_len, TEST_TIMEOUT_TICKS))
 	{
 		HAL_SPI_DMAStop(&hspi5);
-		return false;
+		return TESTOUTCOME_TIMEOUT;
 	}
 
 	vTaskDelay(TEST_GAP_TICKS);
 	HAL_SPI_DMAStop(&hspi5);
 
-	return (HAL_CRC_Calculate(&hcrc, spi_rx_buff_2, test_reference.test_string_len)
-				== test_reference.test_string_crc);
+	return evaluate_rx_buffer(reference, spi_rx_buff_2,
+			crc_calculate((uint8_t *)spi_rx_buff_2, reference->test_string_len), detail);
 }
 
-static bool test_i2c(void)
+static TestOutcome_t test_i2c(const TestReferenceData_t *reference, TestErrorDetail_t *detail)
 {
-	static char i2c_rx_buff_1[TEST_PACKET_STR_MAX_LEN] = {0};
-	static char i2c_rx_buff_2[TEST_PACKET_STR_MAX_LEN] = {0};
+	static char i2c_rx_buff_1[TEST_PACKET_STR_MAX_LEN] DMA_BUFFER;
+	static char i2c_rx_buff_2[TEST_PACKET_STR_MAX_LEN] DMA_BUFFER;
+
+	static CrcStream_t i2c_rx_stream;
 
 	bzero(i2c_rx_buff_1, sizeof(i2c_rx_buff_1));
 	bzero(i2c_rx_buff_2, sizeof(i2c_rx_buff_2));
 
-	if (HAL_OK != HAL_I2C_Slave_Receive_DMA(&hi2c1, (uint8_t *)i2c_rx_buff_1, test_reference.test_string_len)
-			|| HAL_OK != HAL_I2C_Master_Transmit(&hi2c2, hi2c1.Init.OwnAddress1, (uint8_t *)test_reference.test_string_buff, test_reference.test_string_len, TEST_TIMEOUT_TICKS))
+	crc_stream_begin(&i2c_rx_stream, &hi2c1, (uint8_t *)i2c_rx_buff_1, reference->test_string_len);
+
+	if (HAL_OK != HAL_I2C_Slave_Receive_DMA(&hi2c1, (uint8_t *)i2c_rx_buff_1, reference->test_string_len)
+			|| HAL_OK != HAL_I2C_Master_Transmit(&hi2c2, hi2c1.Init.OwnAddress1, (uint8_t *)reference->test_string_buff, reference->test_string_len, TEST_TIMEOUT_TICKS))
 	{
 		HAL_DMA_Abort(hi2c1.hdmarx);
-		return false;
+		crc_stream_finish(&i2c_rx_stream);
+		return TESTOUTCOME_TIMEOUT;
 	}
 
 	vTaskDelay(TEST_GAP_TICKS);
 	HAL_DMA_Abort(hi2c1.hdmarx);
 
-	if (HAL_CRC_Calculate(&hcrc, i2c_rx_buff_1, test_reference.test_string_len)
-				!= test_reference.test_string_crc) return false;
+	if (TESTOUTCOME_PASS != evaluate_rx_buffer(reference, i2c_rx_buff_1,
+			crc_stream_finish(&i2c_rx_stream), detail)) return TESTOUTCOME_DATA_ERROR;
 
-	if (HAL_OK != HAL_I2C_Slave_Transmit_DMA(&hi2c1, (uint8_t *)i2c_rx_buff_1, test_reference.test_string_len)
-			|| HAL_OK != HAL_I2C_Master_Receive(&hi2c2, hi2c1.Init.OwnAddress1, (uint8_t *)i2c_rx_buff_2, test_reference.test_string_len, TEST_TIMEOUT_TICKS))
+	if (HAL_OK != HAL_I2C_Slave_Transmit_DMA(&hi2c1, (uint8_t *)i2c_rx_buff_1, reference->test_string_len)
+			|| HAL_OK != HAL_I2C_Master_Receive(&hi2c2, hi2c1.Init.OwnAddress1, (uint8_t *)i2c_rx_buff_2, reference->test_string_len, TEST_TIMEOUT_TICKS))
 	{
 		HAL_DMA_Abort(hi2c1.hdmatx);
-		return false;
+		return TESTOUTCOME_TIMEOUT;
 	}
 
 	vTaskDelay(TEST_GAP_TICKS);
 	HAL_DMA_Abort(hi2c1.hdmatx);
 
-	return (HAL_CRC_Calculate(&hcrc, i2c_rx_buff_2, test_reference.test_string_len)
-					== test_reference.test_string_crc);
+	return evaluate_rx_buffer(reference, i2c_rx_buff_2,
+			crc_calculate((uint8_t *)i2c_rx_buff_2, reference->test_string_len), detail);
 }
 
-static bool test_adc(void)
+static TestOutcome_t test_adc(const TestReferenceData_t *reference, TestErrorDetail_t *detail)
 {
 	static const uint32_t adc_min_val = 4000;
 	static const uint32_t adc_max_val = 4095;
 
 	uint32_t adc_val = 0;
 
-	if (HAL_OK != HAL_ADC_Start_DMA(&hadc1, &adc_val, 1)) return false;
+	// a single sample, so no DMA: with EOCSelection set, polling for the conversion fails whenever DMA is enabled
+	if (HAL_OK != HAL_ADC_Start(&hadc1)) return TESTOUTCOME_TIMEOUT;
+
+	HAL_StatusTypeDef poll_ret = HAL_ADC_PollForConversion(&hadc1, TEST_TIMEOUT_TICKS);
+
+	if (poll_ret == HAL_OK) adc_val = HAL_ADC_GetValue(&hadc1);
+
+	HAL_ADC_Stop(&hadc1);
 
-	HAL_ADC_PollForConversion(&hadc1, TEST_TIMEOUT_TICKS);
-	HAL_ADC_Stop_DMA(&hadc1);
+	if (poll_ret != HAL_OK) return TESTOUTCOME_TIMEOUT;
 
-	return (adc_val >= adc_min_val && adc_val <= adc_max_val);
+	return (adc_val >= adc_min_val && adc_val <= adc_max_val)
+			? TESTOUTCOME_PASS : TESTOUTCOME_DATA_ERROR;
 }
 
-void test_reference_prepare(char *test_str, uint8_t test_str_len)
+/**
+ * @brief Accumulates the first half of a UART DMA reception into the CRC stream receiving it, if any.
+ */
+void HAL_UART_RxHalfCpltCallback(UART_HandleTypeDef *huart)
 {
-	if (test_str_len > sizeof(test_reference.test_string_buff))
+	CrcStream_t *stream = crc_stream_find_from_isr(huart);
+	if (stream != NULL) crc_stream_half_from_isr(stream);
+}
+
+/**
+ * @brief Accumulates the rest of a completed UART DMA reception into the CRC stream receiving it, if any.
+ */
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+	CrcStream_t *stream = crc_stream_find_from_isr(huart);
+	if (stream != NULL) crc_stream_complete_from_isr(stream);
+}
+
+/**
+ * @brief Accumulates the first half of an SPI DMA reception into the CRC stream receiving it, if any.
+ */
+void HAL_SPI_RxHalfCpltCallback(SPI_HandleTypeDef *hspi)
+{
+	CrcStream_t *stream = crc_stream_find_from_isr(hspi);
+	if (stream != NULL) crc_stream_half_from_isr(stream);
+}
+
+/**
+ * @brief Accumulates the rest of a completed SPI DMA reception into the CRC stream receiving it, if any.
+ */
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+	CrcStream_t *stream = crc_stream_find_from_isr(hspi);
+	if (stream != NULL) crc_stream_complete_from_isr(stream);
+}
+
+/**
+ * @brief Accumulates a completed I2C slave reception into the CRC stream receiving it, if any.
+ * The I2C driver has no half-transfer callback, so the whole buffer is accumulated at once.
+ */
+void HAL_I2C_SlaveRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	CrcStream_t *stream = crc_stream_find_from_isr(hi2c);
+	if (stream != NULL) crc_stream_complete_from_isr(stream);
+}
+
+const TestReferenceData_t *test_reference_prepare(TestPriority_t priority, char *test_str, uint8_t test_str_len)
+{
+	TestReferenceData_t *reference = &test_references[priority == TESTPRIO_INTERACTIVE ? TESTPRIO_INTERACTIVE : TESTPRIO_BULK];
+
+	if (test_str_len > sizeof(reference->test_string_buff))
 	{
-		test_str_len = sizeof(test_reference.test_string_buff);
+		test_str_len = sizeof(reference->test_string_buff);
 	}
 
-	explicit_bzero((void *)&test_reference, sizeof(test_reference));
+	explicit_bzero(reference, sizeof(*reference));
 
-	test_reference.test_string_len = test_str_len;
-	strncpy((char *)test_reference.test_string_buff, test_str, test_str_len);
-	test_reference.test_string_crc = HAL_CRC_Calculate(&hcrc, test_reference.test_string_buff, test_reference.test_string_len);
+	reference->test_string_len = test_str_len;
+	strncpy(reference->test_string_buff, test_str, test_str_len);
+	reference->test_string_crc = crc_calculate((uint8_t *)reference->test_string_buff, reference->test_string_len);
+
+	return reference;
 }
 
-void test_task_loop(uint8_t test_index)
+void peripheral_tests_benchmark_memory(void)
 {
-	static uint16_t test_task_poll_delay_ticks = pdMS_TO_TICKS(100);
-	static uint16_t test_task_iteration_delay_ticks = pdMS_TO_TICKS(10);
+	static const char *memory_names[] = { "DTCM", "SRAM1 (cached)", "SRAM2 (non-cacheable)" };
+	uint8_t (*const buffs[])[TEST_PACKET_STR_MAX_LEN] = { benchmark_dtcm_buff, benchmark_cached_buff, benchmark_uncached_buff };
+	static const uint64_t bytes = (uint64_t)MEMORY_BENCHMARK_ROUNDS * TEST_PACKET_STR_MAX_LEN;
+
+	char debug_buff[SERIAL_DEBUG_MAX_LEN];
+	// keeps the compiler from dropping the measured calls
+	volatile uint32_t sink = 0;
+
+	if (!SERIAL_DEBUG_ENABLED) return;
 
-	for(;;)
+	for (uint32_t i = 0; i < sizeof(buffs) / sizeof(buffs[0]); i++)
 	{
-		vTaskDelay(test_task_poll_delay_ticks);
+		uint16_t first_error_offset = 0;
+
+		for (uint32_t j = 0; j < TEST_PACKET_STR_MAX_LEN; j++)
+		{
+			buffs[i][0][j] = (uint8_t)j;
+			buffs[i][1][j] = (uint8_t)j;
+		}
 
-		if (test_instances[test_index].state == TESTSTATE_PENDING)
+		uint32_t start_cycles = perf_counter_now();
+		for (uint32_t round = 0; round < MEMORY_BENCHMARK_ROUNDS; round++)
 		{
-			test_instances[test_index].state = TESTSTATE_BUSY;
+			sink += crc_calculate(buffs[i][1], TEST_PACKET_STR_MAX_LEN);
+		}
+		uint32_t crc_cycles = perf_counter_now() - start_cycles;
+
+		start_cycles = perf_counter_now();
+		for (uint32_t round = 0; round < MEMORY_BENCHMARK_ROUNDS; round++)
+		{
+			sink += count_bit_errors(buffs[i][0], buffs[i][1], TEST_PACKET_STR_MAX_LEN, &first_error_offset);
+		}
+		uint32_t compare_cycles = perf_counter_now() - start_cycles;
+
+		snprintf(debug_buff, sizeof(debug_buff), "Memory benchmark, %s: CRC %lu kB/s, compare %lu kB/s.", memory_names[i],
+				perf_counter_bytes_per_sec(bytes, crc_cycles) / 1000, perf_counter_bytes_per_sec(bytes, compare_cycles) / 1000);
+		serial_debug_enqueue(debug_buff);
+	}
+}
+
+bool peripheral_tests_register(void)
+{
+	bool registered = true;
 
-			bool passed = true;
+	registered &= test_registry_register(TESTIDX_TIMER, &timer_definition);
+	registered &= test_registry_register(TESTIDX_UART, &uart_definition);
+	registered &= test_registry_register(TESTIDX_SPI, &spi_definition);
+	registered &= test_registry_register(TESTIDX_I2C, &i2c_definition);
+	registered &= test_registry_register(TESTIDX_ADC, &adc_definition);
 
-			while(passed == true && test_instances[test_index].iterations > 0)
+	return registered;
+}
+
+bool test_unit_run_batch(uint8_t test_index, uint8_t batch)
+{
+	static const uint16_t test_iteration_delay_ticks = pdMS_TO_TICKS(10);
+
+	TestUnitInstance_t *instance = &test_instances[test_index];
+	const TestUnitDefinition_t *definition = test_registry_get(test_index);
+
+	if (definition == NULL) return false;
+	if (instance->state != TESTSTATE_PENDING && instance->state != TESTSTATE_BUSY) return false;
+
+	instance->state = TESTSTATE_BUSY;
+
+	if (instance->sweep && definition->sweep != NULL)
+	{
+		TestOutcome_t outcome = definition->sweep(instance);
+
+		if (instance->preempt && !instance->cancel && instance->sweep_log.steps_done < instance->sweep_log.step_count)
+		{
+			// the iterations (transfers per step) and recorded steps are kept for when the runner resumes the instance
+			instance->state = TESTSTATE_PREEMPTED;
+			return false;
+		}
+
+		instance->iterations = 0;
+		instance->state = (outcome == TESTOUTCOME_PASS && !instance->cancel)
+				? TESTSTATE_SUCCESS : TESTSTATE_FAILURE;
+		return false;
+	}
+
+	bool failed_fast = false;
+
+	while(instance->iterations > 0 && batch > 0)
+	{
+		// abandon the request, or yield to a higher priority one, between iterations
+		if (instance->cancel || instance->preempt) break;
+
+		TestErrorDetail_t detail = { .bit_errors = 0, .first_error_offset = TEST_RESULTS_NO_ERROR_OFFSET };
+
+		vTaskDelay(test_iteration_delay_ticks);
+		TestOutcome_t outcome = definition->func(instance->reference, &detail);
+		instance->iterations--;
+		instance->stats.iterations_done++;
+		batch--;
+
+		if (outcome != TESTOUTCOME_PASS)
+		{
+			instance->stats.iterations_failed++;
+
+			if (outcome == TESTOUTCOME_TIMEOUT)
+			{
+				instance->stats.timeouts++;
+			}
+			else
+			{
+				instance->stats.data_errors++;
+			}
+
+			instance->stats.bit_errors += detail.bit_errors;
+
+			if (detail.first_error_offset < instance->stats.first_error_offset)
+			{
+				instance->stats.first_error_offset = detail.first_error_offset;
+			}
+
+			if (instance->fail_fast)
 			{
-				vTaskDelay(test_task_iteration_delay_ticks);
-				passed = test_definitions[test_index].func();
-				test_instances[test_index].iterations--;
+				failed_fast = true;
+				break;
 			}
+		}
+	}
 
-			test_instances[test_index].iterations = 0;
-			test_instances[test_index].state = passed ? TESTSTATE_SUCCESS : TESTSTATE_FAILURE;
+	if (!instance->cancel && !failed_fast && instance->iterations > 0)
+	{
+		if (instance->preempt)
+		{
+			// remaining iterations are kept for when the runner resumes the instance
+			instance->state = TESTSTATE_PREEMPTED;
+			return false;
 		}
+
+		// the batch is spent, the instance stays BUSY until its next batch
+		return true;
 	}
+
+	// a cancelled test did not run all of its iterations, and so did not pass
+	bool passed = (instance->stats.iterations_failed == 0 && instance->iterations == 0);
+	instance->iterations = 0;
+	instance->state = passed ? TESTSTATE_SUCCESS : TESTSTATE_FAILURE;
+
+	return false;
 }
@@ -13,6 +13,9 @@
 #ifndef INC_PERIPHERAL_TESTS_H_
 #define INC_PERIPHERAL_TESTS_H_
 
+#include "sample_stats.h"
+#include "timer_capture.h"
+
 /**
  * @brief The timeout value (in ticks) to be used by tested peripherals where applicable.
  */
@@ -21,6 +24,10 @@
  * @brief The delay time (in ticks) between test related operations.
  */
 #define TEST_GAP_TICKS (pdMS_TO_TICKS(500))
+/**
+ * @brief The maximal count of steps (settings) a sweep may record.
+ */
+#define TEST_SWEEP_MAX_STEPS (12)
 
 /**
  * @brief Type of variables representing the current state of a test unit.
@@ -32,8 +39,89 @@ typedef volatile enum PeripheralTestState
 	TESTSTATE_BUSY = 2,
 	TESTSTATE_SUCCESS = 3,
 	TESTSTATE_FAILURE = 4,
+	TESTSTATE_PREEMPTED = 5,
 } PeripheralTestState_t;
 
+/**
+ * @brief Outcome of a single test iteration.
+ */
+typedef enum TestOutcome
+{
+	/// The iteration completed and its data matched the reference
+	TESTOUTCOME_PASS = 0,
+	/// A peripheral operation did not complete (timeout, bus or HAL error)
+	TESTOUTCOME_TIMEOUT = 1,
+	/// The iteration completed, but its data did not match the reference
+	TESTOUTCOME_DATA_ERROR = 2,
+} TestOutcome_t;
+
+/**
+ * @brief Data structure holding the mismatch detail of a single test iteration.
+ */
+typedef struct TestErrorDetail
+{
+	/// @brief Count of flipped bits between the reference and the transferred data.
+	uint32_t bit_errors;
+	/// @brief Offset of the earliest mismatching byte, or @ref TEST_RESULTS_NO_ERROR_OFFSET.
+	uint8_t first_error_offset;
+} TestErrorDetail_t;
+
+/**
+ * @brief Data structure holding the failure statistics accumulated by a test unit over a request.
+ */
+typedef struct TestUnitStats
+{
+	/// @brief Number of iterations run so far.
+	uint8_t iterations_done;
+	/// @brief Number of failed iterations so far (timeouts and data errors).
+	uint8_t iterations_failed;
+	/// @brief Number of iterations failed due to a peripheral operation not completing.
+	uint8_t timeouts;
+	/// @brief Number of iterations failed due to mismatching data.
+	uint8_t data_errors;
+	/// @brief Total count of flipped bits over all iterations.
+	uint32_t bit_errors;
+	/// @brief Offset of the earliest mismatching byte over all iterations, or @ref TEST_RESULTS_NO_ERROR_OFFSET.
+	uint8_t first_error_offset;
+} TestUnitStats_t;
+
+/**
+ * @brief Data structure holding the measurements of a single sweep step.
+ */
+typedef struct TestSweepStep
+{
+	/// @brief The setting the step ran at (e.g. baud rate, or bus clock in Hz).
+	uint32_t setting;
+	/// @brief Measured throughput in bytes per second, averaged over the step's error-free transfers.
+	uint32_t throughput;
+	/// @brief Number of transfers run at this setting.
+	uint16_t transfers;
+	/// @brief Number of transfers that timed out or whose data did not match the reference.
+	uint16_t errors;
+	/// @brief Number of transfers during which the peripheral flagged a bus level error (e.g. framing, noise, overrun).
+	uint16_t bus_errors;
+	/// @brief Number of transfers that were not acknowledged by their addressee (I2C only).
+	uint16_t nacks;
+	/// @brief Number of transfers during which a master lost bus arbitration (I2C only).
+	uint16_t arb_losses;
+	/// @brief Statistics of the samples taken at this setting (ADC only, empty otherwise).
+	SampleStats_t noise;
+	/// @brief Statistics of the PWM periods captured at this setting (timer only, empty otherwise).
+	CaptureStats_t capture;
+} TestSweepStep_t;
+
+/**
+ * @brief Data structure holding the steps recorded by a test unit's sweep over the current request.
+ */
+typedef struct TestSweepLog
+{
+	/// @brief Number of steps the sweep is going to run.
+	uint8_t step_count;
+	/// @brief Number of steps recorded so far.
+	uint8_t steps_done;
+	TestSweepStep_t steps[TEST_SWEEP_MAX_STEPS];
+} TestSweepLog_t;
+
 /**
  * @brief Data structure holding reference variables used to evaluate currently running tests.
  */
@@ -47,15 +135,6 @@ typedef struct TestReferenceData
 	uint8_t test_string_len;
 } TestReferenceData_t;
 
-/**
- * @brief Type of variables holding static data used by a specific test.
- */
-typedef struct TestUnitDefinition
-{
-	const char name[16];
-	bool (*func)(void);
-} TestUnitDefinition_t;
-
 /**
  * @brief Type of variables holding dynamic data used by a specific test.
  */
@@ -63,28 +142,67 @@ typedef struct TestUnitInstance
 {
 	volatile PeripheralTestState_t state : 8;
 	volatile uint8_t iterations;
+	/// @brief Failure statistics accumulated for the current request.
+	volatile TestUnitStats_t stats;
+	/// @brief Whether the unit should stop at its first failed iteration.
+	volatile bool fail_fast;
+	/// @brief Set by the test runner to have the unit yield (as PREEMPTED) before its next iteration.
+	volatile bool preempt;
+	/// @brief Set by the test runner to have the unit abandon its remaining iterations (as FAILURE).
+	volatile bool cancel;
+	/// @brief Whether the unit should run its sweep (see @ref TEST_PACKET_FLAG_SWEEP) instead of plain iterations.
+	volatile bool sweep;
+	/// @brief Steps recorded by the unit's sweep for the current request.
+	volatile TestSweepLog_t sweep_log;
+	/// @brief Reference data of the request currently assigned to the unit.
+	const TestReferenceData_t * volatile reference;
 } TestUnitInstance_t;
 
-/**
- * @brief Array of variables holding static data about test units.
- */
-extern const TestUnitDefinition_t test_definitions[NUM_POSSIBLE_TESTS];
 /**
  * @brief Array of variables holding the dynamic state of test units.
  */
 extern TestUnitInstance_t test_instances[NUM_POSSIBLE_TESTS];
 
-void test_reference_prepare(char *test_str, uint8_t test_str_len);
+/**
+ * @brief Prepares the reference data used to evaluate requests of the given priority class.
+ * @details
+ * Each priority class has its own reference data, so that an interactive request
+ * may run alongside (or preempt) a bulk request carrying a different test string.
+ * @retval Pointer to the prepared reference data, to be assigned to the request's test instances.
+ */
+const TestReferenceData_t *test_reference_prepare(TestPriority_t priority, char *test_str, uint8_t test_str_len);
+
+/**
+ * @brief Measures the CRC and compare paths (see @ref test_reference_prepare() and the test evaluations)
+ * over buffers in DTCM, in cached SRAM1 and in the non-cacheable region, and prints their throughputs to the debug output.
+ */
+void peripheral_tests_benchmark_memory(void);
+
+/**
+ * @brief Registers the built-in test units (see test_registry.h) at their @ref PeripheralTestIdx_t indices.
+ * Called once at startup, before the test tasks run.
+ * @retval true Every unit was registered
+ * @retval false A unit could not be registered
+ */
+bool peripheral_tests_register(void);
 
 /**
- * @brief A generic loop used by the tasks running individual peripheral tests.
+ * @brief Runs a batch of iterations of the test instance associated with the given index. Called by the test executor's workers.
  * @details
- * This generic loop manages the test instance associated with the given index.
- * When it detects a state change to PENDING, it progresses the state to BUSY.
- * It then runs the bespoke test implementation, whose return value is finally
- * assigned to the state field when finished.
- * @param [in] test_index Index key to the data used by the task to run tests.
+ * A PENDING instance is progressed to BUSY, and runs up to the given count of iterations of its bespoke test implementation.
+ * Once no iterations are left, the outcome is assigned to the state field.
+ * Failed iterations are counted (with their mismatch detail) in the instance's statistics, and unless the instance is set to fail fast, the remaining iterations still run.
+ * If the test runner raises the instance's preempt flag, the batch yields before
+ * the next iteration, leaving the remaining iterations intact and the state PREEMPTED.
+ * If the test runner raises the instance's cancel flag, the remaining iterations are dropped.
+ * An instance set to sweep runs its registered definition's sweep in a single batch instead, with its iterations used
+ * as the transfer count of every step. A sweep is preempted (as PREEMPTED, keeping its recorded steps) or cancelled
+ * between steps, and a preempted sweep resumes from its first unrecorded step.
+ * @param [in] test_index Index key to the data used to run the test.
+ * @param [in] batch The largest count of iterations to run.
+ * @retval true Iterations are left, and the instance (still BUSY) needs another batch
+ * @retval false The instance concluded, was preempted, or had nothing to run
  */
-void test_task_loop(uint8_t test_index);
+bool test_unit_run_batch(uint8_t test_index, uint8_t batch);
 
 #endif /* INC_PERIPHERAL_TESTS_H_ */
@@ -0,0 +1,491 @@
+/*
+ * result_journal.c
+ *
+ *  Created on: Aug 18, 2025
+ *      Author: User
+ */
+
+/**
+ * @file result_journal.c
+ * @brief Source file for the result journal.
+ * @details
+ * A slot's record ID is programmed after the rest of the record, so a record whose programming was cut short
+ * by a reset either has no ID (and is skipped, as are free slots) or fails its checksum (and is skipped as well).
+ * Valid records' IDs increase with their position, so the records following an ID are found with a linear scan,
+ * which the next packet of a burst resumes where the previous one stopped.
+ * A sector is only trusted as the journal's if every slot holding an ID holds a valid record, with IDs increasing,
+ * which a sector programmed by anything else all but never passes. Such a 'foreign' sector is erased before use.
+ * Flash is read through the D-cache, so the lines of whatever was programmed or erased are invalidated.
+ * Appending, flushing and filling packets all take the journal mutex, so packets never see half programmed records.
+ */
+
+#include <string.h>
+
+#include "main.h"
+#include "semphr.h"
+#include "lwip/def.h"
+#include "test_packet_def.h"
+#include "result_journal.h"
+
+/**
+ * @brief The count of flash sectors the journal cycles through, and their size.
+ */
+#define JOURNAL_SECTOR_COUNT (2)
+#define JOURNAL_SECTOR_BYTES (256UL * 1024UL)
+/**
+ * @brief The count of record slots in a sector (the remainder of the sector is left unused).
+ */
+#define JOURNAL_SLOTS_PER_SECTOR (JOURNAL_SECTOR_BYTES / TEST_JOURNAL_RECORD_SIZE_BYTES)
+/**
+ * @brief The ID read from a slot that was never programmed.
+ */
+#define JOURNAL_FREE_ID (0xFFFFFFFFUL)
+
+/**
+ * @brief The journal's sectors, in the order they are filled in (see the JOURNAL region of STM32F756ZGTX_FLASH.ld).
+ */
+static const struct
+{
+	uint32_t sector;
+	uint32_t address;
+} journal_sectors[JOURNAL_SECTOR_COUNT] =
+{
+	{ FLASH_SECTOR_6, 0x08080000UL },
+	{ FLASH_SECTOR_7, 0x080C0000UL },
+};
+
+/**
+ * @brief A position in the journal: a slot of a sector, counted from the sector holding the oldest records
+ * (@ref JOURNAL_SECTOR_COUNT for the records waiting in RAM).
+ */
+typedef struct JournalPosition
+{
+	uint8_t sector_step;
+	uint32_t slot;
+} JournalPosition_t;
+
+/// @brief The sector being filled, and its next free slot.
+static uint8_t active_sector = 0;
+static uint32_t active_slot = 0;
+static uint32_t next_record_id = 1;
+/// @brief Whether the sector after the active one was erased, ready to be filled once the active one is full.
+static bool next_sector_erased = false;
+/// @brief The sectors found holding something else than journal records, which are erased before use.
+static bool sector_foreign[JOURNAL_SECTOR_COUNT] = {0};
+
+/// @brief The records appended since the last flush.
+static uint8_t pending_records[RESULT_JOURNAL_PENDING_RECORDS][TEST_JOURNAL_RECORD_SIZE_BYTES] __attribute__((aligned(4)));
+static uint8_t pending_count = 0;
+/// @brief The count of records dropped on a full @ref pending_records since the last flush.
+static uint32_t dropped_count = 0;
+
+/// @brief Where the last packet stopped, and the ID of its last record, for the next packet of the burst to resume from.
+static JournalPosition_t cursor = {0};
+static uint32_t cursor_id = 0;
+
+static StaticSemaphore_t journal_mutex_control_block;
+static SemaphoreHandle_t journal_mutex = NULL;
+
+static char debug_buff[SERIAL_DEBUG_MAX_LEN] = {0};
+
+/**
+ * @brief Returns the FNV-1a hash of a record's fields (all but the checksum).
+ */
+static uint32_t record_checksum(const uint8_t *record)
+{
+	uint32_t hash = 2166136261UL;
+
+	for (uint32_t i = 0; i < TEST_JOURNAL_RECORD_CHECKSUM_OFFSET; i++)
+	{
+		hash = (hash ^ record[i]) * 16777619UL;
+	}
+
+	return hash;
+}
+
+static uint32_t get_u32(const uint8_t *field)
+{
+	uint32_t value_net;
+	memcpy(&value_net, field, sizeof(value_net));
+	return lwip_ntohl(value_net);
+}
+
+static void put_u32(uint8_t *field, uint32_t value)
+{
+	uint32_t value_net = lwip_htonl(value);
+	memcpy(field, &value_net, sizeof(value_net));
+}
+
+static const uint8_t *slot_record(uint8_t sector, uint32_t slot)
+{
+	return (const uint8_t *)(journal_sectors[sector].address + (slot * TEST_JOURNAL_RECORD_SIZE_BYTES));
+}
+
+/**
+ * @brief Returns the record at a position, or NULL if the position holds no valid record.
+ */
+static const uint8_t *position_record(const JournalPosition_t *position)
+{
+	if (position->sector_step == JOURNAL_SECTOR_COUNT)
+	{
+		return (position->slot < pending_count) ? pending_records[position->slot] : NULL;
+	}
+
+	uint8_t sector = (active_sector + 1 + position->sector_step) % JOURNAL_SECTOR_COUNT;
+
+	if (sector_foreign[sector]) return NULL;
+
+	const uint8_t *record = slot_record(sector, position->slot);
+	uint32_t id = get_u32(record + TEST_JOURNAL_RECORD_ID_OFFSET);
+
+	if (id == JOURNAL_FREE_ID || get_u32(record + TEST_JOURNAL_RECORD_CHECKSUM_OFFSET) != record_checksum(record)) return NULL;
+
+	return record;
+}
+
+/**
+ * @brief Finds the first valid record at or past a position, moving the position onto it.
+ * @retval The record, or NULL if there is none
+ */
+static const uint8_t *seek_record(JournalPosition_t *position)
+{
+	while (position->sector_step <= JOURNAL_SECTOR_COUNT)
+	{
+		uint32_t slot_count = (position->sector_step == JOURNAL_SECTOR_COUNT) ? pending_count
+				: (position->sector_step == JOURNAL_SECTOR_COUNT - 1) ? active_slot : JOURNAL_SLOTS_PER_SECTOR;
+
+		for (; position->slot < slot_count; position->slot++)
+		{
+			const uint8_t *record = position_record(position);
+			if (record != NULL) return record;
+		}
+
+		position->sector_step++;
+		position->slot = 0;
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Makes the CPU read what was just programmed or erased, rather than stale cache lines.
+ */
+static void invalidate_flash_lines(uint32_t address, uint32_t len)
+{
+	uint32_t start = address & ~(uint32_t)31;
+	uint32_t end = (address + len + 31) & ~(uint32_t)31;
+
+	SCB_InvalidateDCache_by_Addr((uint32_t *)start, (int32_t)(end - start));
+}
+
+/**
+ * @brief Tells whether a slot and every slot after it in its sector are erased.
+ */
+static bool slots_erased_from(uint8_t sector, uint32_t slot)
+{
+	const uint32_t *word = (const uint32_t *)slot_record(sector, slot);
+	const uint32_t *end = (const uint32_t *)slot_record(sector, JOURNAL_SLOTS_PER_SECTOR);
+
+	for (; word < end; word++)
+	{
+		if (*word != 0xFFFFFFFFUL) return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Erases a sector, dropping its records. Called with the flash unlocked.
+ */
+static bool erase_sector(uint8_t sector)
+{
+	FLASH_EraseInitTypeDef erase = {0};
+	uint32_t sector_error = 0;
+
+	erase.TypeErase = FLASH_TYPEERASE_SECTORS;
+	erase.Sector = journal_sectors[sector].sector;
+	erase.NbSectors = 1;
+	erase.VoltageRange = FLASH_VOLTAGE_RANGE_3;
+
+	if (HAL_OK != HAL_FLASHEx_Erase(&erase, &sector_error)) return false;
+
+	invalidate_flash_lines(journal_sectors[sector].address, JOURNAL_SECTOR_BYTES);
+	sector_foreign[sector] = false;
+	cursor_id = 0;
+
+	return true;
+}
+
+/**
+ * @brief Makes the (erased) sector after the active one the active sector.
+ */
+static void advance_sector(void)
+{
+	active_sector = (active_sector + 1) % JOURNAL_SECTOR_COUNT;
+	active_slot = 0;
+	// the next sector now holds the oldest records
+	next_sector_erased = false;
+	// the sector steps of every position just shifted
+	cursor_id = 0;
+}
+
+/**
+ * @brief Checks that a sector's programmed slots (those before [free_slot]) hold journal records,
+ * and counts them and finds the newest one.
+ * @details
+ * Slots with no ID are those whose programming was cut short or failed. Any other slot must hold a record
+ * passing its checksum, with an ID above the previous record's.
+ * @retval true The sector belongs to the journal
+ * @retval false The sector holds something else
+ */
+static bool scan_sector(uint8_t sector, uint32_t free_slot, uint32_t *record_count, uint32_t *newest_id)
+{
+	uint32_t previous_id = 0;
+
+	*record_count = 0;
+
+	for (uint32_t slot = 0; slot < free_slot; slot++)
+	{
+		const uint8_t *record = slot_record(sector, slot);
+		uint32_t id = get_u32(record + TEST_JOURNAL_RECORD_ID_OFFSET);
+
+		if (id == JOURNAL_FREE_ID) continue;
+
+		if (id == 0 || id <= previous_id
+			|| get_u32(record + TEST_JOURNAL_RECORD_CHECKSUM_OFFSET) != record_checksum(record)) return false;
+
+		previous_id = id;
+		(*record_count)++;
+	}
+
+	*newest_id = previous_id;
+	return true;
+}
+
+/**
+ * @brief Programs a record into the active sector's next free slot, its ID last. Called with the flash unlocked.
+ */
+static bool program_record(const uint8_t *record)
+{
+	uint32_t address = (uint32_t)slot_record(active_sector, active_slot);
+	uint32_t word;
+
+	// the slot is used up either way, as a failed write may have left it half programmed
+	active_slot++;
+
+	for (uint32_t offset = 4; offset < TEST_JOURNAL_RECORD_SIZE_BYTES; offset += 4)
+	{
+		memcpy(&word, record + offset, sizeof(word));
+		if (HAL_OK != HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, address + offset, word)) return false;
+	}
+
+	memcpy(&word, record + TEST_JOURNAL_RECORD_ID_OFFSET, sizeof(word));
+	if (HAL_OK != HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, address + TEST_JOURNAL_RECORD_ID_OFFSET, word)) return false;
+
+	invalidate_flash_lines(address, TEST_JOURNAL_RECORD_SIZE_BYTES);
+	return true;
+}
+
+void result_journal_init(void)
+{
+	uint32_t free_slots[JOURNAL_SECTOR_COUNT];
+	uint32_t newest_id = 0;
+	uint32_t record_count = 0;
+	bool active_found = false;
+
+	journal_mutex = xSemaphoreCreateMutexStatic(&journal_mutex_control_block);
+
+	for (uint8_t sector = 0; sector < JOURNAL_SECTOR_COUNT; sector++)
+	{
+		uint32_t sector_records = 0;
+		uint32_t sector_newest_id = 0;
+		uint32_t free_slot = JOURNAL_SLOTS_PER_SECTOR;
+
+		// the free slots are those past the last programmed one
+		while (free_slot > 0 && slots_erased_from(sector, free_slot - 1)) free_slot--;
+
+		free_slots[sector] = free_slot;
+		sector_foreign[sector] = !scan_sector(sector, free_slot, &sector_records, &sector_newest_id);
+
+		if (sector_foreign[sector]) continue;
+
+		record_count += sector_records;
+
+		// the sector being filled is the one with the newest record, or else the first one the journal may use
+		if (sector_newest_id > newest_id || !active_found)
+		{
+			if (sector_newest_id > newest_id) newest_id = sector_newest_id;
+			active_sector = sector;
+			active_found = true;
+		}
+	}
+
+	// with no trusted sector, the first one is erased and filled first
+	active_slot = sector_foreign[active_sector] ? 0 : free_slots[active_sector];
+
+	uint8_t next_sector = (active_sector + 1) % JOURNAL_SECTOR_COUNT;
+	next_sector_erased = !sector_foreign[next_sector] && free_slots[next_sector] == 0;
+	next_record_id = newest_id + 1;
+
+	snprintf(debug_buff, sizeof(debug_buff), "Result journal: %lu records in flash, next ID %lu, sector %u of %u, %lu of %lu slots used%s.",
+			record_count, next_record_id, active_sector + 1, JOURNAL_SECTOR_COUNT, active_slot, JOURNAL_SLOTS_PER_SECTOR,
+			(sector_foreign[0] || sector_foreign[1]) ? " (foreign data found, to be erased)" : "");
+	serial_debug_enqueue(debug_buff);
+}
+
+void result_journal_append(const uint8_t *results_packet, const uint8_t *request_packet, uint32_t duration_ms)
+{
+	if (journal_mutex == NULL) return;
+
+	xSemaphoreTake(journal_mutex, portMAX_DELAY);
+
+	if (pending_count == RESULT_JOURNAL_PENDING_RECORDS)
+	{
+		// flash is only touched while the runner is idle, so the newest records give way
+		dropped_count++;
+		xSemaphoreGive(journal_mutex);
+		return;
+	}
+
+	uint8_t *record = pending_records[pending_count];
+
+	memset(record, 0, TEST_JOURNAL_RECORD_SIZE_BYTES);
+	put_u32(record + TEST_JOURNAL_RECORD_ID_OFFSET, next_record_id++);
+	memcpy(record + TEST_JOURNAL_RECORD_TEST_ID_OFFSET, results_packet + TEST_PACKET_ID_BYTE_OFFSET, 4);
+	memcpy(record + TEST_JOURNAL_RECORD_SELECTION_OFFSET, request_packet + TEST_PACKET_SELECTION_OFFSET, 4);
+	memcpy(record + TEST_JOURNAL_RECORD_PASSED_OFFSET, results_packet + TEST_PACKET_SELECTION_OFFSET, 4);
+	put_u32(record + TEST_JOURNAL_RECORD_DURATION_OFFSET, duration_ms);
+	record[TEST_JOURNAL_RECORD_ITERATIONS_OFFSET] = request_packet[TEST_PACKET_ITERATIONS_BYTE_OFFSET];
+	memcpy(record + TEST_JOURNAL_RECORD_DETAIL_OFFSET, results_packet + TEST_PACKET_RESULTS_DETAIL_OFFSET,
+			TEST_RESULTS_DETAIL_SIZE_BYTES * NUM_POSSIBLE_TESTS);
+	put_u32(record + TEST_JOURNAL_RECORD_CHECKSUM_OFFSET, record_checksum(record));
+
+	pending_count++;
+
+	xSemaphoreGive(journal_mutex);
+}
+
+void result_journal_flush(void)
+{
+	if (journal_mutex == NULL) return;
+
+	xSemaphoreTake(journal_mutex, portMAX_DELAY);
+
+	uint8_t next_sector = (active_sector + 1) % JOURNAL_SECTOR_COUNT;
+	bool erase_active = sector_foreign[active_sector];
+	// the next sector is erased ahead of need, so that programming records never waits on an erase
+	bool erase_next = !next_sector_erased
+			&& (sector_foreign[next_sector] || (JOURNAL_SLOTS_PER_SECTOR - active_slot) <= RESULT_JOURNAL_PENDING_RECORDS);
+
+	if (pending_count == 0 && dropped_count == 0 && !erase_active && !erase_next)
+	{
+		xSemaphoreGive(journal_mutex);
+		return;
+	}
+
+	uint32_t start_ticks = HAL_GetTick();
+	uint8_t erased = 0;
+	uint8_t programmed = 0;
+	uint8_t done = 0;
+
+	HAL_FLASH_Unlock();
+	__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ALL_ERRORS);
+
+	if (erase_active && erase_sector(active_sector))
+	{
+		active_slot = 0;
+		erased++;
+	}
+
+	if (erase_next && erase_sector(next_sector))
+	{
+		next_sector_erased = true;
+		erased++;
+	}
+
+	for (; done < pending_count && !sector_foreign[active_sector]; done++)
+	{
+		if (active_slot >= JOURNAL_SLOTS_PER_SECTOR)
+		{
+			// kept in RAM for the next flush to retry, if the erase failed
+			if (!next_sector_erased) break;
+			advance_sector();
+		}
+
+		if (program_record(pending_records[done])) programmed++;
+	}
+
+	HAL_FLASH_Lock();
+
+	snprintf(debug_buff, sizeof(debug_buff), "Result journal: %u of %u records programmed, %u sectors erased, %lu dropped, in %lu ms.",
+			programmed, pending_count, erased, dropped_count, HAL_GetTick() - start_ticks);
+
+	// records that could not be programmed are dropped, rather than retried forever
+	memmove(pending_records, pending_records[done], (pending_count - done) * TEST_JOURNAL_RECORD_SIZE_BYTES);
+	pending_count -= done;
+	dropped_count = 0;
+	cursor_id = 0;
+
+	xSemaphoreGive(journal_mutex);
+
+	serial_debug_enqueue(debug_buff);
+}
+
+uint16_t result_journal_fill_packet(uint8_t *packet, uint32_t *since_id, bool burst_end, bool *more)
+{
+	uint8_t count = 0;
+	uint32_t after_id = *since_id;
+
+	packet[0] = TEST_PACKET_START_BYTE_VALUE;
+	packet[TEST_PACKET_MSG_BYTE_OFFSET] = TESTMSG_JOURNAL_RECORDS;
+	put_u32(packet + TEST_PACKET_JOURNAL_AFTER_ID_OFFSET, after_id);
+	*more = false;
+
+	if (journal_mutex != NULL)
+	{
+		xSemaphoreTake(journal_mutex, portMAX_DELAY);
+
+		JournalPosition_t position = {0};
+		const uint8_t *record;
+
+		if (cursor_id != 0 && cursor_id == after_id)
+		{
+			position = cursor;
+		}
+
+		while ((record = seek_record(&position)) != NULL)
+		{
+			uint32_t id = get_u32(record + TEST_JOURNAL_RECORD_ID_OFFSET);
+
+			if (id > after_id)
+			{
+				if (count == TEST_JOURNAL_RECORDS_PER_PACKET)
+				{
+					*more = true;
+					break;
+				}
+
+				memcpy(packet + TEST_PACKET_JOURNAL_RECORDS_OFFSET + (count * TEST_JOURNAL_RECORD_SIZE_BYTES), record, TEST_JOURNAL_RECORD_SIZE_BYTES);
+				count++;
+				*since_id = id;
+			}
+
+			position.slot++;
+		}
+
+		// resumed from by the next packet of the burst, which follows this one's last record
+		// (past the last record, a fresh scan is needed to pick up the records appended meanwhile)
+		cursor = position;
+		cursor_id = *more ? *since_id : 0;
+
+		xSemaphoreGive(journal_mutex);
+	}
+
+	packet[TEST_PACKET_JOURNAL_FLAGS_OFFSET] = (*more ? TEST_PACKET_JOURNAL_FLAG_MORE : 0) | (burst_end ? TEST_PACKET_JOURNAL_FLAG_BURST_END : 0);
+	packet[TEST_PACKET_JOURNAL_COUNT_OFFSET] = count;
+
+	uint16_t len = TEST_PACKET_JOURNAL_RECORDS_OFFSET + (count * TEST_JOURNAL_RECORD_SIZE_BYTES) + 1;
+	packet[len - 1] = TEST_PACKET_END_BYTE_VALUE;
+
+	return len;
+}
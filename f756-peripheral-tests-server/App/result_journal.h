@@ -0,0 +1,70 @@
+/*
+ * result_journal.h
+ *
+ *  Created on: Aug 18, 2025
+ *      Author: User
+ */
+
+/**
+ * @file result_journal.h
+ * @brief Header file for the result journal, keeping the results of every concluded request in flash,
+ * for clients to fetch those they missed (see @ref TESTMSG_JOURNAL_FETCH_REQUEST).
+ * @details
+ * The journal is append-only, in the last two flash sectors (the JOURNAL region of the linker script),
+ * in records of @ref TEST_JOURNAL_RECORD_SIZE_BYTES bytes, laid out as in journal packets.
+ * Records fill one sector, then the next, and the sector holding the oldest records is erased shortly before
+ * the active one fills up, so both sectors wear evenly and the journal holds nearly a sector of records at least.
+ * Records are numbered from 1, and their IDs keep increasing across resets.
+ * Appended records are only kept in RAM, and programmed by @ref result_journal_flush() once the test runner is idle.
+ */
+
+#ifndef RESULT_JOURNAL_H_
+#define RESULT_JOURNAL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief The count of records kept in RAM until the test runner is idle, which may be overridden at build time
+ * (e.g. -DRESULT_JOURNAL_PENDING_RECORDS=64 for servers that stay busy through long runs of requests).
+ * Records appended past it, before the next flush, are dropped.
+ */
+#ifndef RESULT_JOURNAL_PENDING_RECORDS
+#define RESULT_JOURNAL_PENDING_RECORDS (32)
+#endif
+
+/**
+ * @brief Finds the newest record and the next free slot in flash. Called once, by the test runner task, before any other call.
+ * @details
+ * A sector holding anything but journal records (e.g. left over by other firmware) holds no records for the journal,
+ * and is erased by the first flush rather than programmed over.
+ */
+void result_journal_init(void);
+/**
+ * @brief Appends the results of a concluded request to the journal's records in RAM. Never touches flash.
+ * @param [in] results_packet The request's @ref TESTMSG_TEST_OVER_RESULTS packet
+ * @param [in] request_packet The request's @ref TESTMSG_TEST_NEW_REQUEST packet
+ * @param [in] duration_ms The time the request took to run
+ */
+void result_journal_append(const uint8_t *results_packet, const uint8_t *request_packet, uint32_t duration_ms);
+/**
+ * @brief Programs the records appended since the last flush into flash, and erases the sector to be filled next
+ * when the active one nears its end.
+ * @details
+ * The flash has a single bank, so every fetch from it stalls while it is programmed (about 20us per word),
+ * and for a second or two while a sector is erased: this must only be called by the test runner while it is idle,
+ * with no test instance running.
+ */
+void result_journal_flush(void);
+/**
+ * @brief Fills a @ref TESTMSG_JOURNAL_RECORDS packet with the records following a record ID,
+ * those still waiting in RAM included.
+ * @param [out] packet Buffer of at least @ref TEST_JOURNAL_PACKET_MAX_SIZE_BYTES bytes
+ * @param [in,out] since_id The ID the records follow, updated to the ID of the packet's last record
+ * @param [in] burst_end Whether the packet is the last of its burst (see @ref TEST_PACKET_JOURNAL_FLAG_BURST_END)
+ * @param [out] more Whether records follow the packet's last one
+ * @retval The length of the packet
+ */
+uint16_t result_journal_fill_packet(uint8_t *packet, uint32_t *since_id, bool burst_end, bool *more);
+
+#endif /* RESULT_JOURNAL_H_ */
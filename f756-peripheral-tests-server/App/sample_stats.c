@@ -0,0 +1,154 @@
+/*
+ * sample_stats.c
+ *
+ *  Created on: Aug 9, 2025
+ *      Author: User
+ */
+
+/**
+ * @file sample_stats.c
+ * @brief Source file for the streaming reduction kernel over blocks of ADC samples.
+ */
+
+#include <strings.h>
+
+#include "main.h"
+#include "sample_stats.h"
+
+/**
+ * @brief Integer square root, rounded down.
+ */
+static uint32_t isqrt64(uint64_t value)
+{
+	uint64_t root = 0;
+	uint64_t bit = 1ULL << 62;
+
+	while (bit > value) bit >>= 2;
+
+	while (bit != 0)
+	{
+		if (value >= root + bit)
+		{
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else
+		{
+			root >>= 1;
+		}
+
+		bit >>= 2;
+	}
+
+	return (uint32_t)root;
+}
+
+void sample_stats_reset(SampleStats_t *stats)
+{
+	bzero(stats, sizeof(*stats));
+	stats->min = UINT16_MAX;
+}
+
+void sample_stats_accumulate(SampleStats_t *stats, const uint16_t *samples, uint32_t count)
+{
+	if (count == 0) return;
+
+	if (stats->count == 0)
+	{
+		uint32_t first_sum = 0;
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			first_sum += samples[i];
+		}
+
+		stats->center = (first_sum + (count / 2)) / count;
+	}
+
+	uint16_t min = stats->min;
+	uint16_t max = stats->max;
+	int32_t sum = 0;
+	uint64_t sum_squares = stats->sum_squares;
+	uint32_t i = 0;
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+	if (((uintptr_t)samples & 0x3) == 0)
+	{
+		// two samples per word, each instruction below working on both halfwords at once
+		const uint32_t *pairs = (const uint32_t *)samples;
+		uint32_t center_pair = ((uint32_t)stats->center << 16) | stats->center;
+		uint32_t min_pair = ((uint32_t)min << 16) | min;
+		uint32_t max_pair = ((uint32_t)max << 16) | max;
+
+		for (; i + 1 < count; i += 2)
+		{
+			uint32_t pair = *pairs++;
+
+			// USUB16 sets a GE flag per halfword where the first operand is higher or same, SEL picks by them
+			__USUB16(pair, min_pair);
+			min_pair = __SEL(min_pair, pair);
+			__USUB16(pair, max_pair);
+			max_pair = __SEL(pair, max_pair);
+
+			uint32_t deviation_pair = __SSUB16(pair, center_pair);
+			sum = (int32_t)__SMLAD(deviation_pair, 0x00010001, (uint32_t)sum);
+			sum_squares = __SMLALD(deviation_pair, deviation_pair, sum_squares);
+		}
+
+		uint16_t min_low = min_pair & 0xFFFF;
+		uint16_t min_high = min_pair >> 16;
+		uint16_t max_low = max_pair & 0xFFFF;
+		uint16_t max_high = max_pair >> 16;
+
+		min = min_low < min_high ? min_low : min_high;
+		max = max_low > max_high ? max_low : max_high;
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		int32_t deviation = (int32_t)samples[i] - stats->center;
+
+		if (samples[i] < min) min = samples[i];
+		if (samples[i] > max) max = samples[i];
+		sum += deviation;
+		sum_squares += (uint64_t)(deviation * deviation);
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		int32_t bin = (int32_t)samples[i] - stats->center + (SAMPLE_STATS_HISTOGRAM_BINS / 2);
+
+		if (bin < 0) bin = 0;
+		if (bin >= SAMPLE_STATS_HISTOGRAM_BINS) bin = SAMPLE_STATS_HISTOGRAM_BINS - 1;
+		stats->histogram[bin]++;
+	}
+
+	stats->min = min;
+	stats->max = max;
+	stats->sum += sum;
+	stats->sum_squares = sum_squares;
+	stats->count += count;
+}
+
+uint32_t sample_stats_mean_milli(const SampleStats_t *stats)
+{
+	if (stats->count == 0) return 0;
+
+	int64_t mean_milli = ((int64_t)stats->center * 1000) + ((stats->sum * 1000) / (int64_t)stats->count);
+
+	return mean_milli < 0 ? 0 : (uint32_t)mean_milli;
+}
+
+uint32_t sample_stats_stddev_milli(const SampleStats_t *stats)
+{
+	if (stats->count == 0) return 0;
+
+	double mean_deviation = (double)stats->sum / stats->count;
+	double variance = ((double)stats->sum_squares / stats->count) - (mean_deviation * mean_deviation);
+
+	if (variance <= 0) return 0;
+
+	// variance in millionths of an LSB squared, whose root is in thousandths of an LSB
+	return isqrt64((uint64_t)(variance * 1000000.0));
+}
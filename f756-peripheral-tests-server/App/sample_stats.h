@@ -0,0 +1,68 @@
+/*
+ * sample_stats.h
+ *
+ *  Created on: Aug 9, 2025
+ *      Author: User
+ */
+
+/**
+ * @file sample_stats.h
+ * @brief Header file for the streaming reduction kernel over blocks of ADC samples.
+ */
+
+#ifndef SAMPLE_STATS_H_
+#define SAMPLE_STATS_H_
+
+#include <stdint.h>
+
+#include "test_packet_def.h"
+
+/**
+ * @brief Number of 1 LSB histogram bins around the center code.
+ */
+#define SAMPLE_STATS_HISTOGRAM_BINS (TEST_PACKET_NOISE_HISTOGRAM_BINS)
+
+/**
+ * @brief Data structure accumulating statistics over a stream of samples, one block at a time.
+ * @details
+ * Moments are accumulated as deviations from a center code (the rounded mean of the first block),
+ * which keeps the sums small and the variance free of cancellation errors.
+ */
+typedef struct SampleStats
+{
+	/// @brief Number of samples accumulated.
+	uint32_t count;
+	/// @brief Lowest sample.
+	uint16_t min;
+	/// @brief Highest sample.
+	uint16_t max;
+	/// @brief The code that deviations are taken from.
+	uint16_t center;
+	/// @brief Sum of the deviations from the center.
+	int64_t sum;
+	/// @brief Sum of the squared deviations from the center.
+	uint64_t sum_squares;
+	/// @brief Sample counts by deviation from the center, lowest first, the outer bins also counting the tails.
+	uint32_t histogram[SAMPLE_STATS_HISTOGRAM_BINS];
+} SampleStats_t;
+
+/**
+ * @brief Clears the statistics, ahead of a new stream.
+ */
+void sample_stats_reset(SampleStats_t *stats);
+/**
+ * @brief Accumulates a block of samples into the statistics.
+ * @details
+ * On cores with the DSP extension, word aligned blocks are reduced two samples at a time with SIMD instructions.
+ */
+void sample_stats_accumulate(SampleStats_t *stats, const uint16_t *samples, uint32_t count);
+/**
+ * @brief Returns the mean of the accumulated samples, in thousandths of an LSB.
+ */
+uint32_t sample_stats_mean_milli(const SampleStats_t *stats);
+/**
+ * @brief Returns the standard deviation (RMS noise) of the accumulated samples, in thousandths of an LSB.
+ */
+uint32_t sample_stats_stddev_milli(const SampleStats_t *stats);
+
+#endif /* SAMPLE_STATS_H_ */
@@ -25,6 +25,32 @@
 #include "lwip/ip_addr.h"
 #include "test_packet_def.h"
 
+/**
+ * @brief Selects the API the listener and transmitter use, which may be overridden at build time (e.g. -DSERVER_UDP_RAW_API=1).
+ * @details
+ * With netconns (0), each received packet is posted by the stack to the listener's receive mailbox in a netbuf,
+ * and each reply travels through the outbox to the transmitter task.
+ * With the raw API (1), packets are handled by a receive callback, under the core lock, which answers pairing,
+ * cancellation and telemetry requests on the spot (test request replies join the transmitter's batch if
+ * @ref SERVER_TX_BATCH_WINDOW_MS is set). Test requests are still copied out to the test queues,
+ * and journal fetches to the listener task, so that the callback never blocks the stack
+ * and the Ethernet driver's receive buffers are never held for longer than a callback.
+ */
+#ifndef SERVER_UDP_RAW_API
+#define SERVER_UDP_RAW_API (0)
+#endif
+
+/**
+ * @brief The firmware version the server identifies itself with in its beacons, raised along with the packet definitions.
+ */
+#define SERVER_FIRMWARE_VERSION_MAJOR (1)
+#define SERVER_FIRMWARE_VERSION_MINOR (1)
+
+/**
+ * @brief Size of the largest packet the server may send, which determines the outbound message storage size.
+ */
+#define OUTGOING_MESSAGE_MAX_SIZE_BYTES (SERVER_PACKET_MAX_SIZE_BYTES)
+
 /**
  * @brief A data structure for variables holding an incoming test request.
  */
@@ -48,7 +74,7 @@ typedef struct OutgoingMessage
     /// Destination port of the outbound message.
 	u16_t port;
     /// Storage buffer for the complete outbound message packet.
-	uint8_t message[TEST_MSG_PACKET_SIZE_BYTES];
+	uint8_t message[OUTGOING_MESSAGE_MAX_SIZE_BYTES];
 } OutgoingMessage_t;
 
 #endif /* SERVER_COMMON_H_ */
@@ -0,0 +1,240 @@
+/*
+ * test_executor.c
+ *
+ *  Created on: Aug 13, 2025
+ *      Author: User
+ */
+
+/**
+ * @file test_executor.c
+ * @brief Source file for the test executor's worker pool.
+ * @details
+ * The ready queue and the resource locks are plain FreeRTOS objects, since the CMSIS wrappers
+ * offer neither queueing at the front nor waiting on several event flags while clearing them at once.
+ * Every resource lock is a bit of a single event group, set while the resource is free,
+ * so a worker takes all of a unit's locks in one atomic wait, and two workers can never deadlock.
+ * The workers' measurements are kept per worker, so that they are updated without locking.
+ * The test units' peripherals are left out of main() to bring the network up sooner, and initialized here
+ * the first time a unit driving them runs, once the worker holds their locks.
+ */
+
+#include "main.h"
+#include "adc.h"
+#include "i2c.h"
+#include "spi.h"
+#include "tim.h"
+#include "usart.h"
+#include "queue.h"
+#include "event_groups.h"
+#include "perf_counter.h"
+#include "test_registry.h"
+#include "test_executor.h"
+
+/**
+ * @brief The event group bits usable as resource locks (the top 8 bits are reserved by FreeRTOS).
+ */
+#define TEST_RESOURCE_LOCKS_MASK (0x00FFFFFFUL)
+
+/**
+ * @brief A unit waiting in the ready queue for a worker.
+ */
+typedef struct TestWorkItem
+{
+	/// @brief The unit's @ref PeripheralTestIdx_t index.
+	uint8_t test_idx;
+	/// @brief The cycle count at which the unit was queued.
+	uint32_t queued_cycles;
+} TestWorkItem_t;
+
+/**
+ * @brief The measurements of a single worker, since the last report.
+ */
+typedef struct TestWorkerStats
+{
+	/// @brief Number of batches run.
+	uint32_t batches;
+	/// @brief Sum and maximum of the cycles between queueing a unit and a worker picking it up.
+	uint64_t latency_cycles_sum;
+	uint32_t latency_cycles_max;
+	/// @brief Maximum of the cycles spent waiting for a unit's resource locks.
+	uint32_t lock_wait_cycles_max;
+	/// @brief Sum of the cycles spent running batches.
+	uint64_t busy_cycles;
+} TestWorkerStats_t;
+
+static uint32_t worker_stacks[TEST_WORKER_POOL_SIZE][TEST_WORKER_STACK_WORDS];
+static StaticTask_t worker_control_blocks[TEST_WORKER_POOL_SIZE];
+static TaskHandle_t worker_handles[TEST_WORKER_POOL_SIZE];
+static TestWorkerStats_t worker_stats[TEST_WORKER_POOL_SIZE];
+
+/**
+ * @brief The ready queue, holding at most one item per unit.
+ */
+static uint8_t ready_queue_storage[NUM_POSSIBLE_TESTS * sizeof(TestWorkItem_t)];
+static StaticQueue_t ready_queue_control_block;
+static QueueHandle_t ready_queue = NULL;
+
+static StaticEventGroup_t resource_locks_control_block;
+static EventGroupHandle_t resource_locks = NULL;
+
+/**
+ * @brief The CubeMX generated initialization of each resource, in @ref TestResource_t bit order.
+ */
+static void (*const resource_init_funcs[])(void) =
+{
+	MX_TIM1_Init, MX_TIM6_Init, MX_USART2_UART_Init, MX_USART6_UART_Init,
+	MX_SPI3_Init, MX_SPI5_Init, MX_I2C1_Init, MX_I2C2_Init, MX_ADC1_Init,
+};
+/**
+ * @brief Mask of the resources initialized so far.
+ */
+static uint32_t initialized_resources = 0;
+
+static char debug_buff[SERIAL_DEBUG_MAX_LEN] = {0};
+
+/**
+ * @brief Initializes the resources of a unit that were not yet, on the unit's first run.
+ * Called with the resources' locks held, so no other worker drives them meanwhile.
+ * @details
+ * Other workers may be initializing other resources, and the generated code enables the clocks and configures
+ * the pins with unguarded read-modify-writes of the shared RCC and GPIO registers, hence the suspended scheduler.
+ */
+static void ensure_resources_initialized(uint32_t resources)
+{
+	uint32_t missing = resources & ~initialized_resources;
+
+	if (missing == 0) return;
+
+	uint32_t start_cycles = perf_counter_now();
+
+	vTaskSuspendAll();
+	for (uint32_t i = 0; i < sizeof(resource_init_funcs) / sizeof(resource_init_funcs[0]); i++)
+	{
+		if (missing & (1UL << i)) resource_init_funcs[i]();
+	}
+	initialized_resources |= missing;
+	xTaskResumeAll();
+
+	// workers may get here at once, so not in the shared debug buffer
+	char message[SERIAL_DEBUG_MAX_LEN];
+	snprintf(message, sizeof(message), "Test executor: peripherals 0x%03lX initialized on first use in %lu us.",
+			missing, (perf_counter_now() - start_cycles) / (SystemCoreClock / 1000000));
+	serial_debug_enqueue(message);
+}
+
+/**
+ * @brief Prints the RAM taken by the worker pool, against one task (of the same stack size) per registered unit.
+ */
+static void report_pool_footprint(void)
+{
+	static const uint32_t task_bytes = (TEST_WORKER_STACK_WORDS * sizeof(uint32_t)) + sizeof(StaticTask_t);
+	uint32_t unit_count = __builtin_popcount(test_registry_mask());
+	uint32_t pool_bytes = TEST_WORKER_POOL_SIZE * task_bytes;
+	uint32_t per_unit_bytes = unit_count * task_bytes;
+
+	snprintf(debug_buff, sizeof(debug_buff), "Test executor: %u workers for %lu units, %lu B of stacks and TCBs (%ld B saved).",
+			TEST_WORKER_POOL_SIZE, unit_count, pool_bytes, (int32_t)(per_unit_bytes - pool_bytes));
+	serial_debug_enqueue(debug_buff);
+}
+
+/**
+ * @brief Operation loop of a worker task, running batches of the units it pulls from the ready queue.
+ * @param [in] argument The worker's index in the pool
+ */
+static void test_worker_task(void *argument)
+{
+	uint32_t worker_idx = (uint32_t)argument;
+	TestWorkerStats_t *stats = &worker_stats[worker_idx];
+	TestWorkItem_t item;
+
+	if (worker_idx == 0) report_pool_footprint();
+
+	for(;;)
+	{
+		if (pdTRUE != xQueueReceive(ready_queue, &item, portMAX_DELAY)) continue;
+
+		uint32_t picked_cycles = perf_counter_now();
+		const TestUnitDefinition_t *definition = test_registry_get(item.test_idx);
+
+		if (definition == NULL) continue;
+
+		EventBits_t locks = definition->resources & TEST_RESOURCE_LOCKS_MASK;
+
+		if (locks != 0)
+		{
+			xEventGroupWaitBits(resource_locks, locks, pdTRUE, pdTRUE, portMAX_DELAY);
+		}
+
+		ensure_resources_initialized(definition->resources);
+
+		uint32_t locked_cycles = perf_counter_now();
+		bool batches_left = test_unit_run_batch(item.test_idx, TEST_WORKER_BATCH_ITERATIONS);
+
+		if (locks != 0)
+		{
+			xEventGroupSetBits(resource_locks, locks);
+		}
+
+		uint32_t done_cycles = perf_counter_now();
+		uint32_t latency_cycles = picked_cycles - item.queued_cycles;
+
+		stats->batches++;
+		stats->latency_cycles_sum += latency_cycles;
+		if (latency_cycles > stats->latency_cycles_max) stats->latency_cycles_max = latency_cycles;
+		if (locked_cycles - picked_cycles > stats->lock_wait_cycles_max) stats->lock_wait_cycles_max = locked_cycles - picked_cycles;
+		stats->busy_cycles += done_cycles - locked_cycles;
+
+		if (batches_left)
+		{
+			// back of the queue, so that the other ready units get their turn
+			item.queued_cycles = perf_counter_now();
+			xQueueSendToBack(ready_queue, &item, portMAX_DELAY);
+		}
+	}
+}
+
+void test_executor_init(void)
+{
+	ready_queue = xQueueCreateStatic(NUM_POSSIBLE_TESTS, sizeof(TestWorkItem_t), ready_queue_storage, &ready_queue_control_block);
+	resource_locks = xEventGroupCreateStatic(&resource_locks_control_block);
+	xEventGroupSetBits(resource_locks, TEST_RESOURCE_LOCKS_MASK);
+
+	for (uint32_t i = 0; i < TEST_WORKER_POOL_SIZE; i++)
+	{
+		worker_handles[i] = xTaskCreateStatic(test_worker_task, "TestWorker", TEST_WORKER_STACK_WORDS,
+				(void *)i, (UBaseType_t)osPriorityNormal, worker_stacks[i], &worker_control_blocks[i]);
+	}
+}
+
+bool test_executor_dispatch(uint8_t test_idx, bool urgent)
+{
+	TestWorkItem_t item = { .test_idx = test_idx, .queued_cycles = perf_counter_now() };
+
+	if (urgent)
+	{
+		return pdTRUE == xQueueSendToFront(ready_queue, &item, 0);
+	}
+
+	return pdTRUE == xQueueSendToBack(ready_queue, &item, 0);
+}
+
+void test_executor_report(void)
+{
+	if (!SERIAL_DEBUG_ENABLED) return;
+
+	uint32_t cycles_per_us = SystemCoreClock / 1000000;
+
+	for (uint32_t i = 0; i < TEST_WORKER_POOL_SIZE; i++)
+	{
+		TestWorkerStats_t stats = worker_stats[i];
+		worker_stats[i] = (TestWorkerStats_t){0};
+
+		if (stats.batches == 0) continue;
+
+		snprintf(debug_buff, sizeof(debug_buff), "Worker %lu: %lu batches, %lu ms busy, latency %lu/%lu us (avg/max), lock wait %lu us, %lu words of stack free.",
+				i, stats.batches, (uint32_t)(stats.busy_cycles / (cycles_per_us * 1000)),
+				(uint32_t)(stats.latency_cycles_sum / stats.batches / cycles_per_us), stats.latency_cycles_max / cycles_per_us,
+				stats.lock_wait_cycles_max / cycles_per_us, (uint32_t)uxTaskGetStackHighWaterMark(worker_handles[i]));
+		serial_debug_enqueue(debug_buff);
+	}
+}
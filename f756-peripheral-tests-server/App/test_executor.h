@@ -0,0 +1,60 @@
+/*
+ * test_executor.h
+ *
+ *  Created on: Aug 13, 2025
+ *      Author: User
+ */
+
+/**
+ * @file test_executor.h
+ * @brief Header file for the test executor, a pool of worker tasks running the test units the test runner dispatches.
+ * @details
+ * Rather than one task per test unit, a fixed pool of workers pulls (unit, iteration batch) work items
+ * from a ready queue. A unit with iterations left after its batch is queued again, so that a pool smaller
+ * than the count of units still serves all of them in turn.
+ * Before running a batch, a worker takes the locks of every peripheral the unit drives (its registered
+ * resources) at once, so units sharing a peripheral never run alongside each other.
+ */
+
+#ifndef TEST_EXECUTOR_H_
+#define TEST_EXECUTOR_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief The count of worker tasks, which may be overridden at build time (e.g. -DTEST_WORKER_POOL_SIZE=1).
+ * @details
+ * Test units with disjoint resources run concurrently up to this count.
+ */
+#ifndef TEST_WORKER_POOL_SIZE
+#define TEST_WORKER_POOL_SIZE (2)
+#endif
+/**
+ * @brief The stack size of each worker task (in words), fitting the deepest test unit.
+ */
+#define TEST_WORKER_STACK_WORDS (1024)
+/**
+ * @brief The largest count of iterations a worker runs for a unit before queueing it again.
+ */
+#define TEST_WORKER_BATCH_ITERATIONS (8)
+
+/**
+ * @brief Creates the ready queue, the resource locks and the worker tasks. Called once, from @ref MX_FREERTOS_Init().
+ */
+void test_executor_init(void);
+/**
+ * @brief Queues a test unit whose instance was just set PENDING, to be picked up by the next free worker.
+ * @param [in] test_idx The unit's @ref PeripheralTestIdx_t index
+ * @param [in] urgent Whether the unit is queued ahead of the others (for interactive requests)
+ * @retval true The unit was queued
+ * @retval false The ready queue is full, which only happens if the unit was already queued
+ */
+bool test_executor_dispatch(uint8_t test_idx, bool urgent);
+/**
+ * @brief Prints the executor's measurements since the last call (dispatch latency, lock waits, busy time
+ * and stack headroom of each worker) to the debug output, and clears them.
+ */
+void test_executor_report(void);
+
+#endif /* TEST_EXECUTOR_H_ */
@@ -0,0 +1,53 @@
+/*
+ * test_registry.c
+ *
+ *  Created on: Aug 12, 2025
+ *      Author: User
+ */
+
+/**
+ * @file test_registry.c
+ * @brief Source file for the registry of test units.
+ * @details
+ * Registration happens once at startup, before any other task reads the registry,
+ * so lookups need no locking.
+ */
+
+#include <stddef.h>
+
+#include "test_registry.h"
+
+#if NUM_POSSIBLE_TESTS > TEST_SELECTION_MAX_TESTS
+#error "The SELECTION field cannot address every test type."
+#endif
+
+/**
+ * @brief The registered definitions, indexed by @ref PeripheralTestIdx_t.
+ */
+static const TestUnitDefinition_t *registry[NUM_POSSIBLE_TESTS] = {0};
+/**
+ * @brief Mask of the registered indices.
+ */
+static uint32_t registry_mask = 0;
+
+bool test_registry_register(PeripheralTestIdx_t idx, const TestUnitDefinition_t *definition)
+{
+	if ((uint32_t)idx >= NUM_POSSIBLE_TESTS || registry[idx] != NULL) return false;
+	if (definition == NULL || definition->func == NULL) return false;
+	if ((definition->params & TESTPARAM_SWEEP) && definition->sweep == NULL) return false;
+
+	registry[idx] = definition;
+	registry_mask |= (1UL << idx);
+
+	return true;
+}
+
+const TestUnitDefinition_t *test_registry_get(uint8_t idx)
+{
+	return (idx < NUM_POSSIBLE_TESTS) ? registry[idx] : NULL;
+}
+
+uint32_t test_registry_mask(void)
+{
+	return registry_mask;
+}
@@ -0,0 +1,108 @@
+/*
+ * test_registry.h
+ *
+ *  Created on: Aug 12, 2025
+ *      Author: User
+ */
+
+/**
+ * @file test_registry.h
+ * @brief Header file for the registry of test units, which the test runner and the test tasks look test units up in.
+ * @details
+ * A test unit is described by a @ref TestUnitDefinition_t, registered at startup at its @ref PeripheralTestIdx_t index,
+ * which is also the position of its bit in the SELECTION field of packets.
+ * Adding a test unit therefore only takes a definition, a registration call, and a raise of @ref NUM_POSSIBLE_TESTS.
+ */
+
+#ifndef TEST_REGISTRY_H_
+#define TEST_REGISTRY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "test_packet_def.h"
+#include "peripheral_tests.h"
+
+/**
+ * @brief The peripherals a test unit drives, so that units sharing none of them may run alongside each other.
+ * The test executor initializes them on first use, in this bit order.
+ */
+typedef enum TestResource
+{
+	TESTRES_TIM1 = 0x0001,
+	TESTRES_TIM6 = 0x0002,
+	TESTRES_UART2 = 0x0004,
+	TESTRES_UART6 = 0x0008,
+	TESTRES_SPI3 = 0x0010,
+	TESTRES_SPI5 = 0x0020,
+	TESTRES_I2C1 = 0x0040,
+	TESTRES_I2C2 = 0x0080,
+	TESTRES_ADC1 = 0x0100,
+} TestResource_t;
+
+/**
+ * @brief The fields of a "new test request" packet a test unit makes use of (its parameter schema).
+ */
+typedef enum TestParam
+{
+	/// The unit runs the requested count of iterations
+	TESTPARAM_ITERATIONS = 0x01,
+	/// The unit transfers (and is evaluated against) the request's test string
+	TESTPARAM_STRING = 0x02,
+	/// The unit can stop at its first failed iteration (see @ref TEST_PACKET_FLAG_FAIL_FAST)
+	TESTPARAM_FAIL_FAST = 0x04,
+	/// The unit can run a sweep instead of plain iterations (see @ref TEST_PACKET_FLAG_SWEEP)
+	TESTPARAM_SWEEP = 0x08,
+} TestParam_t;
+
+/**
+ * @brief The packets a test unit reports its results in (its result schema), on top of the results packet.
+ */
+typedef enum TestResultKind
+{
+	/// The unit fills its block of the results and progress packets
+	TESTRESULT_DETAIL = 0x01,
+	/// The unit's sweep reports its steps in @ref TESTMSG_TEST_SWEEP_STEP packets
+	TESTRESULT_SWEEP_STEP = 0x02,
+	/// The unit's sweep steps are followed by @ref TESTMSG_TEST_SWEEP_NOISE packets
+	TESTRESULT_SWEEP_NOISE = 0x04,
+	/// The unit's sweep steps are followed by @ref TESTMSG_TEST_SWEEP_CAPTURE packets
+	TESTRESULT_SWEEP_CAPTURE = 0x08,
+} TestResultKind_t;
+
+/**
+ * @brief Type of variables holding static data used by a specific test.
+ */
+typedef struct TestUnitDefinition
+{
+	const char name[16];
+	/// @brief The peripherals the unit drives, as a mask of @ref TestResource_t values.
+	uint32_t resources;
+	/// @brief The request fields the unit makes use of, as a mask of @ref TestParam_t values.
+	uint8_t params;
+	/// @brief The packets the unit reports in, as a mask of @ref TestResultKind_t values.
+	uint8_t results;
+	TestOutcome_t (*func)(const TestReferenceData_t *reference, TestErrorDetail_t *detail);
+	/// @brief Optional sweep implementation, running each of the instance's iterations at every step.
+	TestOutcome_t (*sweep)(TestUnitInstance_t *instance);
+} TestUnitDefinition_t;
+
+/**
+ * @brief Registers a test unit at the given index. Called at startup, before the test tasks run.
+ * @details
+ * The definition is referenced rather than copied, so it must outlive the registry (i.e. be static).
+ * @retval true The unit was registered
+ * @retval false The index is out of range or already taken, or the definition is incomplete
+ * (no implementation, or a sweep parameter without a sweep implementation)
+ */
+bool test_registry_register(PeripheralTestIdx_t idx, const TestUnitDefinition_t *definition);
+/**
+ * @brief Returns the definition registered at the given index, or NULL if there is none.
+ */
+const TestUnitDefinition_t *test_registry_get(uint8_t idx);
+/**
+ * @brief Returns the mask of registered indices, in the bit order of the SELECTION field.
+ */
+uint32_t test_registry_mask(void);
+
+#endif /* TEST_REGISTRY_H_ */
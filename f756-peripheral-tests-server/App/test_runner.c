@@ -1,175 +1,652 @@
-/*
- * test_runner.c
- *
- *  Created on: Jul 14, 2025
- *      Author: User
- */
-
-/**
- * @file test_runner.c
- * @brief The 'Test Runner' task is in charge of fetching test requests from the test queue,
- * running them one request at a time (as a single request may span several test types and many iterations),
- * and finally, composing the test results into a packet and forwarding them to the outbox queue.
- */
-
-#include "server_common.h"
-#include "test_runner.h"
-
-static const uint16_t test_runner_delay_ticks = (pdMS_TO_TICKS(250));
-
-extern osMessageQueueId_t TestQueueHandle;
-extern osMessageQueueId_t OutboxQueueHandle;
-extern CRC_HandleTypeDef hcrc;
-
-static TestRequest_t current_test = {0};
-static OutgoingMessage_t message_scratch = {0};
-static char debug_buff[256] = {0};
-
-/**
- * @brief Sets the prepared outbound message packet
- * to carry the test results, and sends it to the out queue.
- */
-static void send_test_results(uint8_t results_byte)
-{
-	message_scratch.message[TEST_PACKET_MSG_BYTE_OFFSET] = TESTMSG_TEST_OVER_RESULTS;
-	message_scratch.message[TEST_PACKET_SELECTION_BYTE_OFFSET] = results_byte;
-	osMessageQueuePut(OutboxQueueHandle, &message_scratch, 0, HAL_MAX_DELAY);
-	serial_debug_enqueue("Results forwarded to outbox.");
-}
-
-/**
- * @brief Sets the prepared outbound message packet
- * to carry a "test start" confirmation, and sends it to the out queue.
- */
-static void send_test_start_confirmation(void)
-{
-	message_scratch.message[TEST_PACKET_MSG_BYTE_OFFSET] = TESTMSG_TEST_START_ACK;
-	message_scratch.message[TEST_PACKET_SELECTION_BYTE_OFFSET] = 0x01;
-	osMessageQueuePut(OutboxQueueHandle, &message_scratch, 0, HAL_MAX_DELAY);
-}
-
-/**
- * @brief Prepares the outbound message buffer by using
- * the currently processed "new test" request packet as a base.
- */
-static void prepare_out_message(void)
-{
-	explicit_bzero(&message_scratch, sizeof(message_scratch));
-	message_scratch.addr = current_test.client_addr;
-	message_scratch.port = current_test.client_port;
-	memcpy(message_scratch.message, current_test.request, TEST_MSG_PACKET_SIZE_BYTES);
-	message_scratch.message[TEST_PACKET_ITERATIONS_BYTE_OFFSET] = TEST_PACKET_END_BYTE_VALUE;
-}
-
-/**
- * @brief Repeatedly polls test instance data until
- * all requested tests are marked finished.
- * @retval the byte encoding the test results
- */
-static uint8_t await_tests_completion(uint8_t ordered_test_count)
-{
-	uint8_t completed_tests = 0;
-	uint8_t test_results_byte = 0;
-
-	serial_debug_enqueue("Test Runner awaiting test completion.");
-
-	while(completed_tests < ordered_test_count)
-	{
-		vTaskDelay(test_runner_delay_ticks);
-
-		for (uint8_t i = 0; i < NUM_POSSIBLE_TESTS; i++)
-		{
-		switch(test_instances[i].state)
-		{
-		case TESTSTATE_SUCCESS:
-			  test_results_byte |= (1 << (uint8_t)i);
-			  // intentional fallthrough, success & failure operation nearly identical
-		case TESTSTATE_FAILURE:
-			  if (SERIAL_DEBUG_ENABLED)
-			  {
-				  snprintf(debug_buff, sizeof(debug_buff), "%s Test %s.", test_definitions[i].name,
-					  test_instances[i].state == TESTSTATE_SUCCESS ? "Success" : "Failure");
-				  serial_debug_enqueue(debug_buff);
-			  }
-			  test_instances[i].state = TESTSTATE_READY;
-			  completed_tests++;
-			  break;
-		default:
-			  break;
-		  }
-		}
-	}
-
-	serial_debug_enqueue("Tests concluded.");
-	return test_results_byte;
-}
-
-/**
- * @brief Signals that the tests should start running
- * by updating the test instance data.
- * @retval the count of selected tests
- */
-static uint8_t signal_tests_start()
-{
-	uint8_t ordered_test_count = 0;
-	uint8_t test_selection_byte = current_test.request[TEST_PACKET_SELECTION_BYTE_OFFSET];
-
-	for (uint8_t i = 0; i < NUM_POSSIBLE_TESTS; i++)
-	{
-		if (0x01 & (test_selection_byte >> (uint8_t)i))
-		{
-			ordered_test_count++;
-			test_instances[i].iterations = current_test.request[TEST_PACKET_ITERATIONS_BYTE_OFFSET];
-			test_instances[i].state = TESTSTATE_PENDING;
-
-			snprintf(debug_buff, sizeof(debug_buff), "%s Test Ordered.", test_definitions[i].name);
-			serial_debug_enqueue(debug_buff);
-		}
-		else
-		{
-			test_instances[i].state = TESTSTATE_READY;
-		}
-	}
-
-	return ordered_test_count;
-}
-
-void test_runner_task_init(void)
-{
-	serial_debug_enqueue("Test Runner task initialized.");
-}
-
-void test_runner_task_loop(void)
-{
-	uint8_t test_results_byte = 0x00;
-	uint8_t ordered_test_count = 0;
-	osStatus queue_ret;
-
-	for(;;)
-	{
-		vTaskDelay(test_runner_delay_ticks);
-		queue_ret = osMessageQueueGet(TestQueueHandle, &current_test, 0, HAL_MAX_DELAY);
-
-		if (osOK == queue_ret)
-		{
-			serial_debug_enqueue("Test Runner executing requested test.");
-
-			test_reference_prepare((char *)(current_test.request+TEST_PACKET_STRING_HEAD_OFFSET), current_test.request[TEST_PACKET_STRING_LEN_OFFSET]);
-			ordered_test_count = signal_tests_start();
-
-			prepare_out_message();
-			send_test_start_confirmation();
-
-			test_results_byte = await_tests_completion(ordered_test_count);
-
-			send_test_results(test_results_byte);
-		}
-		else if (queue_ret == osErrorTimeout)
-		{
-		}
-		else
-		{
-			snprintf(debug_buff, sizeof(debug_buff), "CMSIS error code %ld fetching test request from queue.", queue_ret);
-			serial_debug_enqueue(debug_buff);
-		}	}
-}
+/*
+ * test_runner.c
+ *
+ *  Created on: Jul 14, 2025
+ *      Author: User
+ */
+
+/**
+ * @file test_runner.c
+ * @brief The 'Test Runner' task is in charge of fetching test requests from the test queues,
+ * running them one request at a time (as a single request may span several test types and many iterations),
+ * and finally, composing the test results into a packet and forwarding them to the outbox queue.
+ * @details
+ * Requests are served by priority class: the interactive queue is always drained before the bulk queue,
+ * and a running bulk request is preempted between iterations (or sweep steps) of any test unit an interactive request needs.
+ * While a request runs, the runner periodically reports its progress, and stops it early if the client cancels it.
+ * The results of every request are journaled in flash as well, and the journal is flushed whenever the runner is idle.
+ */
+
+#include "server_common.h"
+#include "result_journal.h"
+#include "test_runner.h"
+#include "test_registry.h"
+#include "test_executor.h"
+
+static const uint16_t test_runner_delay_ticks = (pdMS_TO_TICKS(250));
+static const uint16_t retry_estimate_min_ms = 250;
+static const uint16_t retry_estimate_max_ms = 30000;
+
+static const uint16_t preempt_poll_ticks = (pdMS_TO_TICKS(10));
+static const uint16_t progress_interval_ticks = (pdMS_TO_TICKS(1000));
+
+#define CANCELLED_QUEUED_IDS_MAX (8)
+
+extern osMessageQueueId_t TestQueueHandle;
+extern osMessageQueueId_t InteractiveQueueHandle;
+extern osMessageQueueId_t OutboxQueueHandle;
+extern CRC_HandleTypeDef hcrc;
+
+static TestRequest_t current_test = {0};
+static TestRequest_t interactive_test = {0};
+static OutgoingMessage_t message_scratch = {0};
+static char debug_buff[256] = {0};
+
+/// Moving average of request durations, read by the listener to estimate retry delays.
+static volatile uint32_t avg_request_duration_ms = 0;
+/// Tick count at which the current request started, or 0 while idle.
+static volatile TickType_t current_request_start_ticks = 0;
+
+/// Test IDs of the running request of each priority class, or 0 while idle.
+static volatile uint32_t running_test_ids[TESTPRIO_INTERACTIVE+1] = {0};
+/// Set by the listener when the running request of a priority class should be cancelled.
+static volatile bool cancel_requested[TESTPRIO_INTERACTIVE+1] = {0};
+/// Ring of test IDs cancelled while (presumably) still queued, to be dropped once dequeued.
+static volatile uint32_t cancelled_queued_ids[CANCELLED_QUEUED_IDS_MAX] = {0};
+static volatile uint8_t cancelled_queued_next_idx = 0;
+
+bool test_runner_request_cancel(uint32_t test_id)
+{
+	if (test_id == 0) return false;
+
+	for (uint8_t p = TESTPRIO_BULK; p <= TESTPRIO_INTERACTIVE; p++)
+	{
+		if (running_test_ids[p] == test_id)
+		{
+			cancel_requested[p] = true;
+			return true;
+		}
+	}
+
+	cancelled_queued_ids[cancelled_queued_next_idx] = test_id;
+	cancelled_queued_next_idx = (cancelled_queued_next_idx + 1) % CANCELLED_QUEUED_IDS_MAX;
+	return false;
+}
+
+/**
+ * @brief Checks whether a dequeued request was cancelled while it was waiting, consuming the cancellation.
+ */
+static bool take_queued_cancellation(uint32_t test_id)
+{
+	for (uint8_t i = 0; i < CANCELLED_QUEUED_IDS_MAX; i++)
+	{
+		if (cancelled_queued_ids[i] == test_id)
+		{
+			cancelled_queued_ids[i] = 0;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @brief Folds the duration of a concluded request into @ref avg_request_duration_ms.
+ */
+static void record_request_duration(TickType_t start_ticks)
+{
+	uint32_t duration_ms = (xTaskGetTickCount() - start_ticks) * portTICK_PERIOD_MS;
+
+	// exponential moving average with a weight of 1/4 for the newest sample
+	avg_request_duration_ms = (avg_request_duration_ms == 0)
+			? duration_ms
+			: (3 * avg_request_duration_ms + duration_ms) / 4;
+}
+
+uint16_t test_runner_estimate_retry_ms(void)
+{
+	uint32_t estimate_ms = avg_request_duration_ms;
+	TickType_t start_ticks = current_request_start_ticks;
+
+	// the running request has already consumed part of its expected duration
+	if (start_ticks != 0)
+	{
+		uint32_t elapsed_ms = (xTaskGetTickCount() - start_ticks) * portTICK_PERIOD_MS;
+		estimate_ms = (elapsed_ms < estimate_ms) ? estimate_ms - elapsed_ms : 0;
+	}
+
+	if (estimate_ms < retry_estimate_min_ms) estimate_ms = retry_estimate_min_ms;
+	if (estimate_ms > retry_estimate_max_ms) estimate_ms = retry_estimate_max_ms;
+
+	return (uint16_t)estimate_ms;
+}
+
+/**
+ * @brief Returns the SELECTION field of the given request, in host byte order.
+ */
+static uint32_t request_selection(const TestRequest_t *request)
+{
+	uint32_t selection_net;
+
+	memcpy(&selection_net, request->request+TEST_PACKET_SELECTION_OFFSET, sizeof(selection_net));
+	return lwip_ntohl(selection_net);
+}
+
+/**
+ * @brief Prepares the outbound message buffer by using
+ * the given "new test" request packet as a base.
+ */
+static void prepare_out_message(const TestRequest_t *request)
+{
+	explicit_bzero(&message_scratch, sizeof(message_scratch));
+	message_scratch.addr = request->client_addr;
+	message_scratch.port = request->client_port;
+	memcpy(message_scratch.message, request->request, TEST_MSG_PACKET_SIZE_BYTES);
+	message_scratch.message[TEST_PACKET_ITERATIONS_BYTE_OFFSET] = TEST_PACKET_END_BYTE_VALUE;
+}
+
+/**
+ * @brief Sets the outbound message packet
+ * to carry the test results, followed by the failure detail of every test,
+ * sends it to the out queue, and appends it to the result journal.
+ */
+static void send_test_results(const TestRequest_t *request, uint32_t test_results, const TestUnitStats_t *stats, uint32_t duration_ms)
+{
+	uint32_t results_net = lwip_htonl(test_results);
+
+	prepare_out_message(request);
+	message_scratch.message[TEST_PACKET_MSG_BYTE_OFFSET] = TESTMSG_TEST_OVER_RESULTS;
+	memcpy(message_scratch.message+TEST_PACKET_SELECTION_OFFSET, &results_net, sizeof(results_net));
+
+	for (uint8_t i = 0; i < NUM_POSSIBLE_TESTS; i++)
+	{
+		uint8_t *detail = message_scratch.message + TEST_PACKET_RESULTS_DETAIL_OFFSET + (TEST_RESULTS_DETAIL_SIZE_BYTES * i);
+		uint32_t bit_errors_net = lwip_htonl(stats[i].bit_errors);
+
+		detail[TEST_RESULTS_DETAIL_DONE_OFFSET] = stats[i].iterations_done;
+		detail[TEST_RESULTS_DETAIL_FAILED_OFFSET] = stats[i].iterations_failed;
+		detail[TEST_RESULTS_DETAIL_TIMEOUTS_OFFSET] = stats[i].timeouts;
+		detail[TEST_RESULTS_DETAIL_DATA_ERRORS_OFFSET] = stats[i].data_errors;
+		memcpy(detail + TEST_RESULTS_DETAIL_BIT_ERRORS_OFFSET, &bit_errors_net, sizeof(bit_errors_net));
+		detail[TEST_RESULTS_DETAIL_FIRST_ERROR_OFFSET] = stats[i].first_error_offset;
+	}
+
+	message_scratch.message[TEST_RESULTS_PACKET_SIZE_BYTES-1] = TEST_PACKET_END_BYTE_VALUE;
+	osMessageQueuePut(OutboxQueueHandle, &message_scratch, 0, HAL_MAX_DELAY);
+	serial_debug_enqueue("Results forwarded to outbox.");
+
+	result_journal_append(message_scratch.message, request->request, duration_ms);
+}
+
+/**
+ * @brief Sets the outbound message packet
+ * to carry a "test start" confirmation, and sends it to the out queue.
+ */
+static void send_test_start_confirmation(const TestRequest_t *request)
+{
+	uint32_t accepted_net = lwip_htonl(1);
+
+	prepare_out_message(request);
+	message_scratch.message[TEST_PACKET_MSG_BYTE_OFFSET] = TESTMSG_TEST_START_ACK;
+	memcpy(message_scratch.message+TEST_PACKET_SELECTION_OFFSET, &accepted_net, sizeof(accepted_net));
+	osMessageQueuePut(OutboxQueueHandle, &message_scratch, 0, HAL_MAX_DELAY);
+}
+
+/**
+ * @brief Sets the outbound message packet to carry the progress counters
+ * of the given request, and sends it to the out queue without blocking (progress reports are best-effort).
+ */
+static void send_test_progress(const TestRequest_t *request, const uint8_t *iterations_done, const uint8_t *iterations_failed)
+{
+	prepare_out_message(request);
+	message_scratch.message[TEST_PACKET_MSG_BYTE_OFFSET] = TESTMSG_TEST_PROGRESS;
+
+	for (uint8_t i = 0; i < NUM_POSSIBLE_TESTS; i++)
+	{
+		message_scratch.message[TEST_PACKET_PROGRESS_COUNTERS_OFFSET+(2*i)] = iterations_done[i];
+		message_scratch.message[TEST_PACKET_PROGRESS_COUNTERS_OFFSET+(2*i)+1] = iterations_failed[i];
+	}
+
+	message_scratch.message[TEST_PROGRESS_PACKET_SIZE_BYTES-1] = TEST_PACKET_END_BYTE_VALUE;
+	osMessageQueuePut(OutboxQueueHandle, &message_scratch, 0, 0);
+}
+
+/**
+ * @brief Sets the outbound message packet to carry the sample statistics of a sweep step, and sends it to the out queue.
+ */
+static void send_sweep_noise(const TestRequest_t *request, uint8_t step_idx, const SampleStats_t *noise)
+{
+	uint32_t samples_net = lwip_htonl(noise->count);
+	uint16_t min_net = lwip_htons(noise->min);
+	uint16_t max_net = lwip_htons(noise->max);
+	uint32_t mean_net = lwip_htonl(sample_stats_mean_milli(noise));
+	uint32_t stddev_net = lwip_htonl(sample_stats_stddev_milli(noise));
+	uint16_t center_net = lwip_htons(noise->center);
+
+	prepare_out_message(request);
+	message_scratch.message[TEST_PACKET_MSG_BYTE_OFFSET] = TESTMSG_TEST_SWEEP_NOISE;
+	message_scratch.message[TEST_PACKET_NOISE_STEP_OFFSET] = step_idx;
+	memcpy(message_scratch.message+TEST_PACKET_NOISE_SAMPLES_OFFSET, &samples_net, sizeof(samples_net));
+	memcpy(message_scratch.message+TEST_PACKET_NOISE_MIN_OFFSET, &min_net, sizeof(min_net));
+	memcpy(message_scratch.message+TEST_PACKET_NOISE_MAX_OFFSET, &max_net, sizeof(max_net));
+	memcpy(message_scratch.message+TEST_PACKET_NOISE_MEAN_OFFSET, &mean_net, sizeof(mean_net));
+	memcpy(message_scratch.message+TEST_PACKET_NOISE_STDDEV_OFFSET, &stddev_net, sizeof(stddev_net));
+	memcpy(message_scratch.message+TEST_PACKET_NOISE_CENTER_OFFSET, &center_net, sizeof(center_net));
+
+	for (uint8_t i = 0; i < TEST_PACKET_NOISE_HISTOGRAM_BINS; i++)
+	{
+		uint32_t bin_net = lwip_htonl(noise->histogram[i]);
+		memcpy(message_scratch.message+TEST_PACKET_NOISE_HISTOGRAM_OFFSET+(i*sizeof(bin_net)), &bin_net, sizeof(bin_net));
+	}
+
+	message_scratch.message[TEST_NOISE_PACKET_SIZE_BYTES-1] = TEST_PACKET_END_BYTE_VALUE;
+	osMessageQueuePut(OutboxQueueHandle, &message_scratch, 0, HAL_MAX_DELAY);
+}
+
+/**
+ * @brief Sets the outbound message packet to carry the capture statistics of a sweep step, and sends it to the out queue.
+ */
+static void send_sweep_capture(const TestRequest_t *request, uint8_t step_idx, const CaptureStats_t *capture)
+{
+	uint32_t fields_net[] =
+	{
+		lwip_htonl(capture->edges),
+		lwip_htonl((uint32_t)capture_stats_duty_error_mean_ps(capture)),
+		lwip_htonl((uint32_t)(capture->duty_error_min * (int32_t)capture->tick_ps)),
+		lwip_htonl((uint32_t)(capture->duty_error_max * (int32_t)capture->tick_ps)),
+		lwip_htonl(capture_stats_duty_jitter_ps(capture)),
+		lwip_htonl(capture_stats_period_jitter_ps(capture)),
+		lwip_htonl((uint32_t)capture_stats_frequency_error_ppm(capture)),
+	};
+
+	prepare_out_message(request);
+	message_scratch.message[TEST_PACKET_MSG_BYTE_OFFSET] = TESTMSG_TEST_SWEEP_CAPTURE;
+	message_scratch.message[TEST_PACKET_CAPTURE_STEP_OFFSET] = step_idx;
+	// the fields are laid out back to back, in the order above
+	memcpy(message_scratch.message+TEST_PACKET_CAPTURE_EDGES_OFFSET, fields_net, sizeof(fields_net));
+	message_scratch.message[TEST_CAPTURE_PACKET_SIZE_BYTES-1] = TEST_PACKET_END_BYTE_VALUE;
+	osMessageQueuePut(OutboxQueueHandle, &message_scratch, 0, HAL_MAX_DELAY);
+}
+
+/**
+ * @brief Sets the outbound message packet to carry each sweep step the given test has recorded
+ * since the last call, and sends them to the out queue.
+ * @param [in,out] steps_sent Count of the test's steps already sent, updated accordingly
+ */
+static void send_sweep_steps(const TestRequest_t *request, uint8_t test_idx, uint8_t *steps_sent)
+{
+	volatile TestSweepLog_t *log = &test_instances[test_idx].sweep_log;
+	const TestUnitDefinition_t *definition = test_registry_get(test_idx);
+
+	while (*steps_sent < log->steps_done)
+	{
+		TestSweepStep_t step = log->steps[*steps_sent];
+		uint32_t setting_net = lwip_htonl(step.setting);
+		uint32_t throughput_net = lwip_htonl(step.throughput);
+		uint16_t transfers_net = lwip_htons(step.transfers);
+		uint16_t errors_net = lwip_htons(step.errors);
+		uint16_t bus_errors_net = lwip_htons(step.bus_errors);
+		uint16_t nacks_net = lwip_htons(step.nacks);
+		uint16_t arb_losses_net = lwip_htons(step.arb_losses);
+
+		prepare_out_message(request);
+		message_scratch.message[TEST_PACKET_MSG_BYTE_OFFSET] = TESTMSG_TEST_SWEEP_STEP;
+		message_scratch.message[TEST_PACKET_SWEEP_TEST_OFFSET] = test_idx;
+		message_scratch.message[TEST_PACKET_SWEEP_STEP_OFFSET] = *steps_sent;
+		message_scratch.message[TEST_PACKET_SWEEP_STEP_COUNT_OFFSET] = log->step_count;
+		memcpy(message_scratch.message+TEST_PACKET_SWEEP_SETTING_OFFSET, &setting_net, sizeof(setting_net));
+		memcpy(message_scratch.message+TEST_PACKET_SWEEP_THROUGHPUT_OFFSET, &throughput_net, sizeof(throughput_net));
+		memcpy(message_scratch.message+TEST_PACKET_SWEEP_TRANSFERS_OFFSET, &transfers_net, sizeof(transfers_net));
+		memcpy(message_scratch.message+TEST_PACKET_SWEEP_ERRORS_OFFSET, &errors_net, sizeof(errors_net));
+		memcpy(message_scratch.message+TEST_PACKET_SWEEP_BUS_ERRORS_OFFSET, &bus_errors_net, sizeof(bus_errors_net));
+		memcpy(message_scratch.message+TEST_PACKET_SWEEP_NACKS_OFFSET, &nacks_net, sizeof(nacks_net));
+		memcpy(message_scratch.message+TEST_PACKET_SWEEP_ARB_LOSSES_OFFSET, &arb_losses_net, sizeof(arb_losses_net));
+		message_scratch.message[TEST_SWEEP_PACKET_SIZE_BYTES-1] = TEST_PACKET_END_BYTE_VALUE;
+		osMessageQueuePut(OutboxQueueHandle, &message_scratch, 0, HAL_MAX_DELAY);
+
+		if (SERIAL_DEBUG_ENABLED)
+		{
+			snprintf(debug_buff, sizeof(debug_buff), "%s sweep step %u/%u: setting %lu, %lu B/s, %u of %u transfers failed.",
+					definition->name, *steps_sent + 1, log->step_count,
+					step.setting, step.throughput, step.errors, step.transfers);
+			serial_debug_enqueue(debug_buff);
+		}
+
+		if ((definition->results & TESTRESULT_SWEEP_NOISE) && step.noise.count > 0)
+		{
+			send_sweep_noise(request, *steps_sent, &step.noise);
+		}
+
+		if ((definition->results & TESTRESULT_SWEEP_CAPTURE) && step.capture.edges > 0)
+		{
+			send_sweep_capture(request, *steps_sent, &step.capture);
+		}
+
+		(*steps_sent)++;
+	}
+}
+
+static void run_interactive_requests(void);
+
+/**
+ * @brief Repeatedly polls test instance data until
+ * all tests selected by the given request are marked finished.
+ * While awaiting a bulk request, any queued interactive requests are run in between.
+ * Progress is reported to the client every @ref progress_interval_ticks, sweep steps are forwarded as they complete,
+ * and a cancellation request is relayed to the request's test instances.
+ * The final statistics of every selected test are copied into stats.
+ * @retval the mask encoding the test results
+ */
+static uint32_t await_tests_completion(const TestRequest_t *request, TestPriority_t priority, uint8_t ordered_test_count, TestUnitStats_t *stats)
+{
+	uint8_t completed_tests = 0;
+	uint32_t test_results = 0;
+	uint32_t test_selection = request_selection(request);
+	uint8_t iterations_done[NUM_POSSIBLE_TESTS] = {0};
+	uint8_t iterations_failed[NUM_POSSIBLE_TESTS] = {0};
+	uint8_t sweep_steps_sent[NUM_POSSIBLE_TESTS] = {0};
+	TickType_t last_progress_ticks = xTaskGetTickCount();
+
+	serial_debug_enqueue("Test Runner awaiting test completion.");
+
+	while(completed_tests < ordered_test_count)
+	{
+		vTaskDelay(test_runner_delay_ticks);
+
+		if (priority == TESTPRIO_BULK)
+		{
+			run_interactive_requests();
+		}
+
+		for (uint8_t i = 0; i < NUM_POSSIBLE_TESTS; i++)
+		{
+		if (!(test_selection & (1UL << i))) continue;
+
+		if (cancel_requested[priority] && test_instances[i].state != TESTSTATE_READY)
+		{
+			test_instances[i].cancel = true;
+		}
+
+		if (test_instances[i].state != TESTSTATE_READY)
+		{
+			stats[i] = test_instances[i].stats;
+			iterations_done[i] = stats[i].iterations_done;
+			iterations_failed[i] = stats[i].iterations_failed;
+		}
+
+		if (test_instances[i].sweep)
+		{
+			send_sweep_steps(request, i, &sweep_steps_sent[i]);
+		}
+
+		switch(test_instances[i].state)
+		{
+		case TESTSTATE_SUCCESS:
+			  test_results |= (1UL << i);
+			  // intentional fallthrough, success & failure operation nearly identical
+		case TESTSTATE_FAILURE:
+			  // the unit may have concluded after the snapshot above, so its final counters are taken again
+			  stats[i] = test_instances[i].stats;
+			  iterations_done[i] = stats[i].iterations_done;
+			  iterations_failed[i] = stats[i].iterations_failed;
+
+			  if (test_instances[i].sweep)
+			  {
+				  send_sweep_steps(request, i, &sweep_steps_sent[i]);
+			  }
+
+			  if (SERIAL_DEBUG_ENABLED)
+			  {
+				  snprintf(debug_buff, sizeof(debug_buff), "%s Test %s (%u of %u iterations failed%s).", test_registry_get(i)->name,
+					  test_instances[i].state == TESTSTATE_SUCCESS ? "Success" : "Failure",
+					  iterations_failed[i], iterations_done[i], test_instances[i].cancel ? ", cancelled" : "");
+				  serial_debug_enqueue(debug_buff);
+			  }
+			  test_instances[i].cancel = false;
+			  test_instances[i].state = TESTSTATE_READY;
+			  completed_tests++;
+			  break;
+		default:
+			  break;
+		  }
+		}
+
+		if (completed_tests < ordered_test_count
+			&& (xTaskGetTickCount() - last_progress_ticks) >= progress_interval_ticks)
+		{
+			last_progress_ticks = xTaskGetTickCount();
+			send_test_progress(request, iterations_done, iterations_failed);
+		}
+	}
+
+	serial_debug_enqueue("Tests concluded.");
+	return test_results;
+}
+
+/**
+ * @brief Signals that the tests should start running
+ * by updating the test instance data, and dispatching them to the test executor
+ * (ahead of any queued units, for interactive requests).
+ * Instances not selected by the request are left untouched,
+ * as they may still be serving a preempted request.
+ * @retval the count of selected tests
+ */
+static uint8_t signal_tests_start(const TestRequest_t *request, TestPriority_t priority, const TestReferenceData_t *reference)
+{
+	uint8_t ordered_test_count = 0;
+	uint32_t test_selection = request_selection(request);
+
+	for (uint8_t i = 0; i < NUM_POSSIBLE_TESTS; i++)
+	{
+		if (test_selection & (1UL << i))
+		{
+			const TestUnitDefinition_t *definition = test_registry_get(i);
+
+			ordered_test_count++;
+			test_instances[i].reference = reference;
+			test_instances[i].stats.iterations_done = 0;
+			test_instances[i].stats.iterations_failed = 0;
+			test_instances[i].stats.timeouts = 0;
+			test_instances[i].stats.data_errors = 0;
+			test_instances[i].stats.bit_errors = 0;
+			test_instances[i].stats.first_error_offset = TEST_RESULTS_NO_ERROR_OFFSET;
+			test_instances[i].fail_fast = (request->request[TEST_PACKET_FLAGS_BYTE_OFFSET] & TEST_PACKET_FLAG_FAIL_FAST) != 0;
+			test_instances[i].cancel = false;
+			test_instances[i].sweep = (request->request[TEST_PACKET_FLAGS_BYTE_OFFSET] & TEST_PACKET_FLAG_SWEEP) != 0
+					&& (definition->params & TESTPARAM_SWEEP);
+			test_instances[i].sweep_log.step_count = 0;
+			test_instances[i].sweep_log.steps_done = 0;
+			test_instances[i].iterations = request->request[TEST_PACKET_ITERATIONS_BYTE_OFFSET];
+			test_instances[i].state = TESTSTATE_PENDING;
+			test_executor_dispatch(i, priority == TESTPRIO_INTERACTIVE);
+
+			snprintf(debug_buff, sizeof(debug_buff), "%s Test Ordered.", definition->name);
+			serial_debug_enqueue(debug_buff);
+		}
+	}
+
+	return ordered_test_count;
+}
+
+/**
+ * @brief Runs a single request from start to finish, including its start confirmation and results.
+ */
+static void run_request(const TestRequest_t *request, TestPriority_t priority)
+{
+	uint32_t test_id = *(uint32_t *)(request->request+TEST_PACKET_ID_BYTE_OFFSET);
+	TickType_t start_ticks = xTaskGetTickCount();
+
+	if (take_queued_cancellation(test_id))
+	{
+		serial_debug_enqueue("Dropped request cancelled while queued.");
+		return;
+	}
+
+	cancel_requested[priority] = false;
+	running_test_ids[priority] = test_id;
+
+	const TestReferenceData_t *reference = test_reference_prepare(priority,
+			(char *)(request->request+TEST_PACKET_STRING_HEAD_OFFSET), request->request[TEST_PACKET_STRING_LEN_OFFSET]);
+	uint8_t ordered_test_count = signal_tests_start(request, priority, reference);
+
+	send_test_start_confirmation(request);
+
+	TestUnitStats_t stats[NUM_POSSIBLE_TESTS] = {0};
+	uint32_t test_results = await_tests_completion(request, priority, ordered_test_count, stats);
+
+	send_test_results(request, test_results, stats, (xTaskGetTickCount() - start_ticks) * portTICK_PERIOD_MS);
+	test_executor_report();
+
+	running_test_ids[priority] = 0;
+	cancel_requested[priority] = false;
+}
+
+/**
+ * @brief Asks the selected test instances to yield between iterations (or sweep steps),
+ * waits until none of them is running, and stashes their state.
+ */
+static void preempt_instances(uint32_t test_selection, TestUnitInstance_t *stash)
+{
+	for (uint8_t i = 0; i < NUM_POSSIBLE_TESTS; i++)
+	{
+		if (test_selection & (1UL << i))
+		{
+			test_instances[i].preempt = true;
+		}
+	}
+
+	for (uint8_t i = 0; i < NUM_POSSIBLE_TESTS; i++)
+	{
+		if (!(test_selection & (1UL << i))) continue;
+
+		while (test_instances[i].state == TESTSTATE_PENDING
+			|| test_instances[i].state == TESTSTATE_BUSY)
+		{
+			vTaskDelay(preempt_poll_ticks);
+		}
+
+		stash[i].state = test_instances[i].state;
+		stash[i].iterations = test_instances[i].iterations;
+		stash[i].stats = test_instances[i].stats;
+		stash[i].fail_fast = test_instances[i].fail_fast;
+		stash[i].cancel = test_instances[i].cancel;
+		stash[i].sweep = test_instances[i].sweep;
+		stash[i].sweep_log = test_instances[i].sweep_log;
+		stash[i].reference = test_instances[i].reference;
+		test_instances[i].preempt = false;
+
+		if (stash[i].state == TESTSTATE_PREEMPTED && stash[i].sweep)
+		{
+			snprintf(debug_buff, sizeof(debug_buff), "%s sweep preempted with %u of %u steps done.", test_registry_get(i)->name,
+					stash[i].sweep_log.steps_done, stash[i].sweep_log.step_count);
+			serial_debug_enqueue(debug_buff);
+		}
+		else if (stash[i].state == TESTSTATE_PREEMPTED)
+		{
+			snprintf(debug_buff, sizeof(debug_buff), "%s Test preempted with %u iterations left.", test_registry_get(i)->name, stash[i].iterations);
+			serial_debug_enqueue(debug_buff);
+		}
+	}
+}
+
+/**
+ * @brief Restores the stashed state of preempted test instances,
+ * re-dispatching the interrupted ones with their remaining iterations.
+ */
+static void resume_instances(uint32_t test_selection, const TestUnitInstance_t *stash)
+{
+	for (uint8_t i = 0; i < NUM_POSSIBLE_TESTS; i++)
+	{
+		if (!(test_selection & (1UL << i))) continue;
+
+		test_instances[i].iterations = stash[i].iterations;
+		test_instances[i].stats = stash[i].stats;
+		test_instances[i].fail_fast = stash[i].fail_fast;
+		test_instances[i].cancel = stash[i].cancel;
+		test_instances[i].sweep = stash[i].sweep;
+		test_instances[i].sweep_log = stash[i].sweep_log;
+		test_instances[i].reference = stash[i].reference;
+		test_instances[i].state = (stash[i].state == TESTSTATE_PREEMPTED)
+				? TESTSTATE_PENDING : stash[i].state;
+
+		if (test_instances[i].state == TESTSTATE_PENDING)
+		{
+			test_executor_dispatch(i, false);
+		}
+	}
+}
+
+/**
+ * @brief Tells whether any test instance is waiting for or held by a worker.
+ */
+static bool any_instance_running(void)
+{
+	for (uint8_t i = 0; i < NUM_POSSIBLE_TESTS; i++)
+	{
+		if (test_instances[i].state == TESTSTATE_PENDING || test_instances[i].state == TESTSTATE_BUSY) return true;
+	}
+
+	return false;
+}
+
+/**
+ * @brief Runs every queued interactive request, preempting
+ * only those test instances each of them actually needs.
+ */
+static void run_interactive_requests(void)
+{
+	static TestUnitInstance_t stash[NUM_POSSIBLE_TESTS] = {0};
+
+	while (osOK == osMessageQueueGet(InteractiveQueueHandle, &interactive_test, 0, 0))
+	{
+		uint32_t test_selection = request_selection(&interactive_test);
+
+		serial_debug_enqueue("Test Runner executing interactive request.");
+
+		preempt_instances(test_selection, stash);
+		run_request(&interactive_test, TESTPRIO_INTERACTIVE);
+		resume_instances(test_selection, stash);
+	}
+}
+
+void test_runner_task_init(void)
+{
+	serial_debug_enqueue("Test Runner task initialized.");
+	result_journal_init();
+	peripheral_tests_benchmark_memory();
+}
+
+void test_runner_task_loop(void)
+{
+	osStatus queue_ret;
+
+	for(;;)
+	{
+		vTaskDelay(test_runner_delay_ticks);
+		run_interactive_requests();
+
+		// blocks for no longer than a runner delay, so that interactive requests are picked up promptly
+		queue_ret = osMessageQueueGet(TestQueueHandle, &current_test, 0, test_runner_delay_ticks);
+
+		if (osOK == queue_ret)
+		{
+			serial_debug_enqueue("Test Runner executing requested test.");
+			current_request_start_ticks = xTaskGetTickCount();
+
+			run_request(&current_test, TESTPRIO_BULK);
+
+			record_request_duration(current_request_start_ticks);
+			current_request_start_ticks = 0;
+		}
+		else if (queue_ret == osErrorTimeout || queue_ret == osErrorResource)
+		{
+			// idle, so the flash stalls hold no test up
+			if (!any_instance_running()) result_journal_flush();
+		}
+		else
+		{
+			snprintf(debug_buff, sizeof(debug_buff), "CMSIS error code %ld fetching test request from queue.", queue_ret);
+			serial_debug_enqueue(debug_buff);
+		}
+	}
+}
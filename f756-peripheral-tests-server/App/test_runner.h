@@ -17,5 +17,21 @@
 
 void test_runner_task_init(void);
 void test_runner_task_loop(void);
+/**
+ * @brief Estimates how long (in milliseconds) a client should wait before a slot frees up in the test queue.
+ * @details
+ * The estimate is based on a moving average of recent request durations,
+ * since at least the currently running request must conclude before the queue can accept another.
+ */
+uint16_t test_runner_estimate_retry_ms(void);
+/**
+ * @brief Requests cancellation of the test with the given ID.
+ * @details
+ * A running test is stopped between iterations, and its results are sent as usual.
+ * Otherwise the ID is remembered, and the request is dropped if it is later fetched from a test queue.
+ * @retval true The test is currently running, and is being cancelled
+ * @retval false The test is not running, and will be dropped if still queued
+ */
+bool test_runner_request_cancel(uint32_t test_id);
 
 #endif /* TEST_RUNNER_H_ */
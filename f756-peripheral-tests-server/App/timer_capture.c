@@ -0,0 +1,207 @@
+/*
+ * timer_capture.c
+ *
+ *  Created on: Aug 10, 2025
+ *      Author: User
+ */
+
+/**
+ * @file timer_capture.c
+ * @brief Source file for the DMA driven input capture of TIM1's PWM loopback, and the statistics reduced from it.
+ * @details
+ * Both capture channels are read by DMA (channel 1 on DMA2 stream 6, channel 2 on DMA2 stream 2),
+ * so a capture of any length costs only two interrupts, and the statistics are reduced afterwards.
+ */
+
+#include <math.h>
+
+#include "main.h"
+#include "cmsis_os2.h"
+#include "tim.h"
+#include "memory_layout.h"
+#include "timer_capture.h"
+
+/**
+ * @brief The thread flags set by the capture DMA callbacks, once a channel's buffer is filled.
+ */
+#define TIMER_CAPTURE_STRETCHES_FLAG (0x01)
+#define TIMER_CAPTURE_HIGHS_FLAG (0x02)
+/**
+ * @brief The delay (in ticks) allowed for a capture to conclude, on top of its expected duration.
+ */
+#define TIMER_CAPTURE_SETTLE_TICKS (pdMS_TO_TICKS(20))
+
+/**
+ * @brief Capture buffers of channels 1 and 2 (DMA targets, in DTCM), one more than the longest capture, for the discarded first period.
+ */
+static uint16_t capture_stretch_buff[TIMER_CAPTURE_MAX_EDGES + 1] DMA_BUFFER;
+static uint16_t capture_high_buff[TIMER_CAPTURE_MAX_EDGES + 1] DMA_BUFFER;
+/**
+ * @brief The thread waiting for a capture, or NULL when no capture is running.
+ */
+static osThreadId_t volatile capture_thread = NULL;
+
+/**
+ * @brief Wakes the thread waiting for a capture, once either channel's DMA transfer completes.
+ */
+void HAL_TIM_IC_CaptureCallback(TIM_HandleTypeDef *htim)
+{
+	if (htim != &htim1 || capture_thread == NULL) return;
+
+	if (htim->Channel == HAL_TIM_ACTIVE_CHANNEL_1)
+	{
+		osThreadFlagsSet(capture_thread, TIMER_CAPTURE_STRETCHES_FLAG);
+	}
+	else if (htim->Channel == HAL_TIM_ACTIVE_CHANNEL_2)
+	{
+		osThreadFlagsSet(capture_thread, TIMER_CAPTURE_HIGHS_FLAG);
+	}
+}
+
+void capture_stats_reset(CaptureStats_t *stats)
+{
+	*stats = (CaptureStats_t){0};
+}
+
+void capture_stats_accumulate(CaptureStats_t *stats, const uint16_t *stretches, const uint16_t *highs, uint32_t count, uint16_t pulse)
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		int32_t duty_error = (int32_t)highs[i] - (int32_t)pulse;
+		uint32_t stretch = stretches[i];
+
+		if (stats->edges == 0 && i == 0)
+		{
+			stats->duty_error_min = duty_error;
+			stats->duty_error_max = duty_error;
+		}
+		else if (duty_error < stats->duty_error_min)
+		{
+			stats->duty_error_min = duty_error;
+		}
+		else if (duty_error > stats->duty_error_max)
+		{
+			stats->duty_error_max = duty_error;
+		}
+
+		stats->duty_error_sum += duty_error;
+		stats->duty_error_sum_squares += (uint64_t)((int64_t)duty_error * duty_error);
+		stats->stretch_sum += stretch;
+		stats->stretch_sum_squares += (uint64_t)stretch * stretch;
+	}
+
+	stats->edges += count;
+}
+
+void capture_stats_merge(CaptureStats_t *stats, const CaptureStats_t *other)
+{
+	if (other->edges == 0) return;
+
+	if (stats->edges == 0)
+	{
+		*stats = *other;
+		return;
+	}
+
+	if (other->duty_error_min < stats->duty_error_min) stats->duty_error_min = other->duty_error_min;
+	if (other->duty_error_max > stats->duty_error_max) stats->duty_error_max = other->duty_error_max;
+
+	stats->edges += other->edges;
+	stats->duty_error_sum += other->duty_error_sum;
+	stats->duty_error_sum_squares += other->duty_error_sum_squares;
+	stats->stretch_sum += other->stretch_sum;
+	stats->stretch_sum_squares += other->stretch_sum_squares;
+}
+
+/**
+ * @brief Returns the standard deviation of a sum and sum of squares over the accumulated periods, in ticks.
+ */
+static double capture_stats_stddev(const CaptureStats_t *stats, double sum, double sum_squares)
+{
+	if (stats->edges < 2) return 0.0;
+
+	double mean = sum / stats->edges;
+	double variance = (sum_squares / stats->edges) - (mean * mean);
+
+	return variance > 0.0 ? sqrt(variance) : 0.0;
+}
+
+int32_t capture_stats_duty_error_mean_ps(const CaptureStats_t *stats)
+{
+	if (stats->edges == 0) return 0;
+
+	return (int32_t)lround(((double)stats->duty_error_sum / stats->edges) * stats->tick_ps);
+}
+
+uint32_t capture_stats_duty_jitter_ps(const CaptureStats_t *stats)
+{
+	double jitter = capture_stats_stddev(stats, (double)stats->duty_error_sum, (double)stats->duty_error_sum_squares);
+	return (uint32_t)lround(jitter * stats->tick_ps);
+}
+
+uint32_t capture_stats_period_jitter_ps(const CaptureStats_t *stats)
+{
+	double jitter = capture_stats_stddev(stats, (double)stats->stretch_sum, (double)stats->stretch_sum_squares);
+	return (uint32_t)lround(jitter * stats->tick_ps);
+}
+
+int32_t capture_stats_frequency_error_ppm(const CaptureStats_t *stats)
+{
+	if (stats->edges == 0 || stats->nominal_period == 0) return 0;
+
+	double mean_period = stats->nominal_period + ((double)stats->stretch_sum / stats->edges);
+
+	return (int32_t)lround(((stats->nominal_period / mean_period) - 1.0) * 1000000.0);
+}
+
+uint32_t timer_capture_clock_hz(void)
+{
+	uint32_t pclk2 = HAL_RCC_GetPCLK2Freq();
+
+	// timers on a divided APB run at twice its clock
+	return (RCC->CFGR & RCC_CFGR_PPRE2) == RCC_CFGR_PPRE2_DIV1 ? pclk2 : 2 * pclk2;
+}
+
+bool timer_capture_run(uint32_t prescaler, uint32_t period, uint32_t pulse, uint16_t edges, CaptureStats_t *stats)
+{
+	if (edges == 0 || edges > TIMER_CAPTURE_MAX_EDGES || pulse > period) return false;
+
+	uint32_t clock_hz = timer_capture_clock_hz();
+	uint64_t capture_ticks = (uint64_t)(edges + 1) * (prescaler + 1) * (period + 1);
+	uint32_t timeout_ticks = pdMS_TO_TICKS((uint32_t)((capture_ticks * 1000) / clock_hz) + 1) + TIMER_CAPTURE_SETTLE_TICKS;
+
+	__HAL_TIM_SET_PRESCALER(&htim1, prescaler);
+	__HAL_TIM_SET_AUTORELOAD(&htim1, period);
+	__HAL_TIM_SET_COMPARE(&htim1, TIM_CHANNEL_3, pulse);
+	// loads the prescaler, which is otherwise only applied at the next update event
+	htim1.Instance->EGR = TIM_EGR_UG;
+
+	capture_thread = osThreadGetId();
+	osThreadFlagsClear(TIMER_CAPTURE_STRETCHES_FLAG | TIMER_CAPTURE_HIGHS_FLAG);
+
+	uint32_t flags = osFlagsError;
+
+	if (HAL_OK == HAL_TIM_IC_Start_DMA(&htim1, TIM_CHANNEL_1, (uint32_t *)capture_stretch_buff, edges + 1)
+		&& HAL_OK == HAL_TIM_IC_Start_DMA(&htim1, TIM_CHANNEL_2, (uint32_t *)capture_high_buff, edges + 1)
+		&& HAL_OK == HAL_TIM_PWM_Start(&htim1, TIM_CHANNEL_3))
+	{
+		flags = osThreadFlagsWait(TIMER_CAPTURE_STRETCHES_FLAG | TIMER_CAPTURE_HIGHS_FLAG, osFlagsWaitAll, timeout_ticks);
+	}
+
+	HAL_TIM_PWM_Stop(&htim1, TIM_CHANNEL_3);
+	HAL_TIM_IC_Stop_DMA(&htim1, TIM_CHANNEL_1);
+	HAL_TIM_IC_Stop_DMA(&htim1, TIM_CHANNEL_2);
+	capture_thread = NULL;
+
+	__HAL_TIM_SET_PRESCALER(&htim1, htim1.Init.Prescaler);
+	__HAL_TIM_SET_AUTORELOAD(&htim1, htim1.Init.Period);
+	htim1.Instance->EGR = TIM_EGR_UG;
+
+	if ((flags & osFlagsError) != 0) return false;
+
+	stats->tick_ps = (uint32_t)((1000000000000ULL * (prescaler + 1)) / clock_hz);
+	stats->nominal_period = period + 1;
+	capture_stats_accumulate(stats, capture_stretch_buff + 1, capture_high_buff + 1, edges, pulse);
+
+	return true;
+}
@@ -0,0 +1,103 @@
+/*
+ * timer_capture.h
+ *
+ *  Created on: Aug 10, 2025
+ *      Author: User
+ */
+
+/**
+ * @file timer_capture.h
+ * @brief Header file for the DMA driven input capture of TIM1's PWM loopback, and the statistics reduced from it.
+ */
+
+#ifndef TIMER_CAPTURE_H_
+#define TIMER_CAPTURE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Maximal count of edges (PWM periods) a single capture may record.
+ */
+#define TIMER_CAPTURE_MAX_EDGES (1024)
+
+/**
+ * @brief Data structure accumulating statistics over the PWM periods captured at a single timebase.
+ * @details
+ * The timer counter is reset by every rising edge on its input, after the latency of the input path,
+ * and channel 1 captures the count reached by then, which is how much the loopback stretches the period.
+ * Channel 2 captures the count at every falling edge, i.e. the high time of the pulse.
+ * Everything is accumulated in timer ticks, and converted to picoseconds when reported.
+ */
+typedef struct CaptureStats
+{
+	/// @brief Number of periods accumulated.
+	uint32_t edges;
+	/// @brief Duration of a timer tick, in picoseconds.
+	uint32_t tick_ps;
+	/// @brief The configured period, in ticks.
+	uint32_t nominal_period;
+	/// @brief Lowest and highest difference between a captured high time and the configured pulse, in ticks.
+	int32_t duty_error_min;
+	int32_t duty_error_max;
+	/// @brief Sum of the high time differences.
+	int64_t duty_error_sum;
+	/// @brief Sum of the squared high time differences.
+	uint64_t duty_error_sum_squares;
+	/// @brief Sum of the period stretches.
+	uint64_t stretch_sum;
+	/// @brief Sum of the squared period stretches.
+	uint64_t stretch_sum_squares;
+} CaptureStats_t;
+
+/**
+ * @brief Clears the statistics, ahead of a new timebase.
+ */
+void capture_stats_reset(CaptureStats_t *stats);
+/**
+ * @brief Accumulates a capture's pairs of period stretches and high times into the statistics.
+ * @param [in] pulse The configured pulse (compare value), in ticks
+ */
+void capture_stats_accumulate(CaptureStats_t *stats, const uint16_t *stretches, const uint16_t *highs, uint32_t count, uint16_t pulse);
+/**
+ * @brief Adds the statistics of another capture at the same timebase into the given ones.
+ */
+void capture_stats_merge(CaptureStats_t *stats, const CaptureStats_t *other);
+/**
+ * @brief Returns the mean difference between the captured high times and the configured pulse, in picoseconds.
+ */
+int32_t capture_stats_duty_error_mean_ps(const CaptureStats_t *stats);
+/**
+ * @brief Returns the standard deviation of the differences between the captured high times and the configured pulses (duty jitter), in picoseconds.
+ */
+uint32_t capture_stats_duty_jitter_ps(const CaptureStats_t *stats);
+/**
+ * @brief Returns the standard deviation of the captured periods (period jitter), in picoseconds.
+ */
+uint32_t capture_stats_period_jitter_ps(const CaptureStats_t *stats);
+/**
+ * @brief Returns the deviation of the mean captured frequency from the configured one, in parts per million.
+ */
+int32_t capture_stats_frequency_error_ppm(const CaptureStats_t *stats);
+
+/**
+ * @brief Returns the frequency of TIM1's kernel clock, ahead of its prescaler.
+ */
+uint32_t timer_capture_clock_hz(void);
+/**
+ * @brief Runs TIM1's PWM loopback at the given timebase and pulse, and captures the given count of periods on DMA.
+ * @details
+ * Channel 3 generates the PWM, which channels 1 and 2 capture through the loopback, each into its own buffer.
+ * The first period is discarded, since the counter is not yet synchronized to its input by then.
+ * The timer's configured timebase is restored afterwards. Must be called from a thread.
+ * @param [in] prescaler The timer prescaler (PSC) to run at
+ * @param [in] period The auto-reload value (ARR) to run at, one less than the period in ticks
+ * @param [in] pulse The compare value (CCR3), i.e. the high time in ticks
+ * @param [in] edges Count of periods to capture, up to @ref TIMER_CAPTURE_MAX_EDGES
+ * @param [in,out] stats The statistics to accumulate the captured periods into
+ * @retval true The capture completed
+ * @retval false The capture could not be started, or did not complete in time
+ */
+bool timer_capture_run(uint32_t prescaler, uint32_t period, uint32_t pulse, uint16_t edges, CaptureStats_t *stats);
+
+#endif /* TIMER_CAPTURE_H_ */
@@ -9,36 +9,218 @@
  * @file transmitter.c
  * @brief The 'Transmitter' task is in charge of fetching outbound packets from the outbox queue
  * and sending them to the intended recipient, utilizing best-effort UDP over an ethernet link.
+ * @details
+ * When built with @ref SERVER_TX_BATCH_WINDOW_MS, packets about test requests bound for the same client
+ * within the window are coalesced into a single batch packet, sent once the window closes or the batch is full.
  */
 
 #include "server_common.h"
 #include "transmitter.h"
+#include "lwip/tcpip.h"
+#include "lwip/udp.h"
 
-extern struct netif gnetif;
 extern osMessageQueueId_t OutboxQueueHandle;
 
+#if SERVER_UDP_RAW_API
+static struct udp_pcb *transmitter_pcb = NULL;
+#else
 static struct netconn *transmitter_conn = NULL;
+#endif
 static OutgoingMessage_t current_message = {0};
 
+#if SERVER_TX_BATCH_WINDOW_MS
+/// @brief Storage buffer for the batch packet being filled, and its current size (0 while no batch is open).
+static uint8_t batch_packet[TEST_BATCH_PACKET_MAX_SIZE_BYTES] = {0};
+static uint16_t batch_size = 0;
+/// @brief Destination of the open batch.
+static ip_addr_t batch_addr;
+static u16_t batch_port = 0;
+/// @brief The tick count at which the open batch was started.
+static uint32_t batch_start_ticks = 0;
+#endif
+
 static char debug_buff[SERIAL_DEBUG_MAX_LEN] = {0};
 
+uint8_t transmitter_packet_size(uint8_t msg)
+{
+	switch (msg)
+	{
+	case TESTMSG_PAIRING_BEACON:
+		return TEST_BEACON_PACKET_SIZE_BYTES;
+	case TESTMSG_TEST_NEW_BUSY:
+		return TEST_BUSY_PACKET_SIZE_BYTES;
+	case TESTMSG_TEST_PROGRESS:
+		return TEST_PROGRESS_PACKET_SIZE_BYTES;
+	case TESTMSG_TEST_OVER_RESULTS:
+		return TEST_RESULTS_PACKET_SIZE_BYTES;
+	case TESTMSG_TEST_SWEEP_STEP:
+		return TEST_SWEEP_PACKET_SIZE_BYTES;
+	case TESTMSG_TEST_SWEEP_NOISE:
+		return TEST_NOISE_PACKET_SIZE_BYTES;
+	case TESTMSG_TEST_SWEEP_CAPTURE:
+		return TEST_CAPTURE_PACKET_SIZE_BYTES;
+	case TESTMSG_TELEMETRY:
+		return TEST_TELEMETRY_PACKET_SIZE_BYTES;
+	case TESTMSG_BOOT_PROFILE:
+		return TEST_BOOT_PROFILE_PACKET_SIZE_BYTES;
+	default:
+		return TEST_MSG_PACKET_SIZE_BYTES;
+	}
+}
+
+#if SERVER_UDP_RAW_API
+/**
+ * @brief Sends a packet with the raw API. Must be called with the lwIP core locked.
+ */
+static bool send_packet_raw(const uint8_t *packet, uint16_t packet_size, const ip_addr_t *addr, u16_t port)
+{
+	if (transmitter_pcb == NULL) return false;
+
+	// room is left ahead of the payload for every header, so none is chained on the way out
+	struct pbuf *out_pbuf = pbuf_alloc(PBUF_TRANSPORT, packet_size, PBUF_RAM);
+
+	if (out_pbuf == NULL) return false;
+
+	memcpy(out_pbuf->payload, packet, packet_size);
+	err_t send_ret = udp_sendto(transmitter_pcb, out_pbuf, addr, port);
+	// the driver holds its own reference until the frame is sent
+	pbuf_free(out_pbuf);
+
+	return send_ret == ERR_OK;
+}
+
+bool transmitter_send_raw(const OutgoingMessage_t *message)
+{
+	return send_packet_raw(message->message, transmitter_packet_size(message->message[TEST_PACKET_MSG_BYTE_OFFSET]),
+			&message->addr, message->port);
+}
+#endif
+
+/**
+ * @brief Sends a packet from the transmitter task.
+ */
+static void send_packet(const uint8_t *packet, uint16_t packet_size, const ip_addr_t *addr, u16_t port)
+{
+	snprintf(debug_buff, sizeof(debug_buff), "Outgoing packet size: %u.", packet_size);
+	serial_debug_enqueue(debug_buff);
+
+#if SERVER_UDP_RAW_API
+	LOCK_TCPIP_CORE();
+	send_packet_raw(packet, packet_size, addr, port);
+	UNLOCK_TCPIP_CORE();
+#else
+	struct netbuf *out_netbuf = netbuf_new();
+
+	if (out_netbuf == NULL) return;
+
+	void *out_pbuf = netbuf_alloc(out_netbuf, packet_size);
+
+	if (out_pbuf != NULL)
+	{
+		memcpy(out_pbuf, packet, packet_size);
+		netconn_sendto(transmitter_conn, out_netbuf, addr, port);
+	}
+
+	netbuf_delete(out_netbuf);
+#endif
+}
+
+bool transmitter_is_batchable(uint8_t msg)
+{
+	switch (msg)
+	{
+	case TESTMSG_TEST_NEW_ACK:
+	case TESTMSG_TEST_NEW_BUSY:
+	case TESTMSG_TEST_START_ACK:
+	case TESTMSG_TEST_OVER_RESULTS:
+	case TESTMSG_TEST_CANCEL_ACK:
+	case TESTMSG_TEST_PROGRESS:
+	case TESTMSG_TEST_SWEEP_STEP:
+	case TESTMSG_TEST_SWEEP_NOISE:
+	case TESTMSG_TEST_SWEEP_CAPTURE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+#if SERVER_TX_BATCH_WINDOW_MS
+/**
+ * @brief Sends the open batch, if any, and closes it. A batch of a single packet is sent as that packet.
+ */
+static void flush_batch(void)
+{
+	if (batch_size == 0) return;
+
+	uint8_t count = batch_packet[TEST_PACKET_BATCH_COUNT_OFFSET];
+
+	if (count == 1)
+	{
+		send_packet(batch_packet + TEST_PACKET_BATCH_RECORDS_OFFSET + 1, batch_packet[TEST_PACKET_BATCH_RECORDS_OFFSET], &batch_addr, batch_port);
+	}
+	else
+	{
+		batch_packet[batch_size++] = TEST_PACKET_END_BYTE_VALUE;
+		send_packet(batch_packet, batch_size, &batch_addr, batch_port);
+
+		snprintf(debug_buff, sizeof(debug_buff), "Transmitter batched %u packets.", count);
+		serial_debug_enqueue(debug_buff);
+	}
+
+	batch_size = 0;
+}
+
+/**
+ * @brief Adds a message to the open batch, first sending the batch if it is bound elsewhere or too full to take it.
+ */
+static void add_to_batch(const OutgoingMessage_t *message, uint8_t packet_size)
+{
+	if (batch_size != 0 && (batch_port != message->port || !ip_addr_cmp(&batch_addr, &message->addr)
+			|| batch_size + 1 + packet_size + 1 > TEST_BATCH_PACKET_MAX_SIZE_BYTES))
+	{
+		flush_batch();
+	}
+
+	if (batch_size == 0)
+	{
+		batch_packet[0] = TEST_PACKET_START_BYTE_VALUE;
+		batch_packet[TEST_PACKET_MSG_BYTE_OFFSET] = TESTMSG_BATCH;
+		batch_packet[TEST_PACKET_BATCH_COUNT_OFFSET] = 0;
+		batch_size = TEST_PACKET_BATCH_RECORDS_OFFSET;
+		ip_addr_copy(batch_addr, message->addr);
+		batch_port = message->port;
+		batch_start_ticks = osKernelGetTickCount();
+	}
+
+	batch_packet[batch_size++] = packet_size;
+	memcpy(batch_packet + batch_size, message->message, packet_size);
+	batch_size += packet_size;
+	batch_packet[TEST_PACKET_BATCH_COUNT_OFFSET]++;
+}
+#endif
+
 void transmitter_task_init(void)
 {
 	serial_debug_enqueue("Ethernet Transmitter Task started.");
 
+#if SERVER_UDP_RAW_API
+	LOCK_TCPIP_CORE();
+	transmitter_pcb = udp_new();
+	UNLOCK_TCPIP_CORE();
+
+	if (transmitter_pcb == NULL)
+#else
 	transmitter_conn = netconn_new(NETCONN_UDP);
 
 	if (transmitter_conn == NULL)
+#endif
 	{
 		serial_debug_enqueue("Failed to create transmitter connection.");
 		vTaskDelay(pdMS_TO_TICKS(1000));
 		HAL_NVIC_SystemReset();
 	}
 
-	while(ip4_addr_isany_val(*netif_ip4_addr(&gnetif)))
-	{
-		vTaskDelay(pdMS_TO_TICKS(500));
-	}
+	xEventGroupWaitBits(lwip_net_state(), NET_STATE_IP_BOUND, pdFALSE, pdTRUE, portMAX_DELAY);
 }
 
 void transmitter_task_loop(void)
@@ -48,50 +230,62 @@ void transmitter_task_loop(void)
 	static osStatus_t outbox_ret;
 	static uint8_t packet_size;
 
-	static struct netbuf *out_netbuf = NULL;
-	static void *out_pbuf = NULL;
-
 	serial_debug_enqueue("Transmitter waiting for outgoing messages.");
 
 	for (;;)
 	{
 		vTaskDelay(pdMS_TO_TICKS(10));
-		outbox_ret = osMessageQueueGet(OutboxQueueHandle, &current_message, 0, outbox_timeout);
+
+		uint32_t timeout = outbox_timeout;
+
+#if SERVER_TX_BATCH_WINDOW_MS
+		static const uint32_t batch_window = pdMS_TO_TICKS(SERVER_TX_BATCH_WINDOW_MS);
+
+		if (batch_size != 0)
+		{
+			uint32_t elapsed = osKernelGetTickCount() - batch_start_ticks;
+			timeout = (elapsed < batch_window) ? (batch_window - elapsed) : 0;
+		}
+#endif
+
+		outbox_ret = osMessageQueueGet(OutboxQueueHandle, &current_message, 0, timeout);
 
 		switch(outbox_ret)
 		{
 		case osOK:
 			serial_debug_enqueue("Transmitter handling outgoing message.");
 
-			switch (current_message.message[TEST_PACKET_MSG_BYTE_OFFSET])
+			packet_size = transmitter_packet_size(current_message.message[TEST_PACKET_MSG_BYTE_OFFSET]);
+
+#if SERVER_TX_BATCH_WINDOW_MS
+			if (transmitter_is_batchable(current_message.message[TEST_PACKET_MSG_BYTE_OFFSET]))
 			{
-			case TESTMSG_PAIRING_BEACON:
-				packet_size = PAIRING_PACKET_SIZE_BYTES;
-				break;
-			case TESTMSG_TEST_OVER_RESULTS:
-				packet_size = TEST_REQUEST_PACKET_MIN_SIZE_BYTES;
-				break;
-			default:
-				packet_size = TEST_MSG_PACKET_SIZE_BYTES;
+				add_to_batch(&current_message, packet_size);
 				break;
 			}
 
-			snprintf(debug_buff, sizeof(debug_buff), "Outgoing packet size: %u.", packet_size);
-			serial_debug_enqueue(debug_buff);
+			// sent after the batched ones, so that a client gets them in order
+			flush_batch();
+#endif
 
-			out_netbuf = netbuf_new();
-			out_pbuf = netbuf_alloc(out_netbuf, packet_size);
-			memcpy(out_pbuf, current_message.message, packet_size);
-			netconn_sendto(transmitter_conn, out_netbuf, &current_message.addr, current_message.port);
-			netbuf_delete(out_netbuf);
+			send_packet(current_message.message, packet_size, &current_message.addr, current_message.port);
 
 			serial_debug_enqueue("Transmitter waiting for outgoing messages.");
 			break;
 		case osErrorTimeout:
+		case osErrorResource:
 			break;
 		default:
 			serial_debug_enqueue("Error fetching from Outbox queue.");
 			break;
 		}
+
+#if SERVER_TX_BATCH_WINDOW_MS
+		if (batch_size != 0 && osKernelGetTickCount() - batch_start_ticks >= batch_window)
+		{
+			flush_batch();
+			serial_debug_enqueue("Transmitter waiting for outgoing messages.");
+		}
+#endif
 	}
 }
@@ -13,7 +13,43 @@
 #ifndef TRANSMITTER_H_
 #define TRANSMITTER_H_
 
+#include <stdbool.h>
+#include <stdint.h>
+
+struct OutgoingMessage;
+
+/**
+ * @brief The window (in milliseconds) within which packets about test requests bound for the same client are sent together
+ * in a single batch packet (@ref TESTMSG_BATCH), or 0 to send each on its own.
+ * May be overridden at build time (e.g. -DSERVER_TX_BATCH_WINDOW_MS=5).
+ * @details
+ * Acknowledgements and results are a few bytes each, so headers make up most of what is on the wire, and every packet
+ * costs a pass through the stack. Batching trades up to the window of latency for fewer, fuller packets,
+ * which pays off when a client keeps many requests in flight.
+ * With @ref SERVER_UDP_RAW_API, the listener's replies about test requests are then left to the transmitter too,
+ * rather than sent from the receive callback, so that they are batched alike.
+ */
+#ifndef SERVER_TX_BATCH_WINDOW_MS
+#define SERVER_TX_BATCH_WINDOW_MS (0)
+#endif
+
 void transmitter_task_init(void);
 void transmitter_task_loop(void);
+/**
+ * @brief Returns the size of the packets of the given @ref TestPacketMsg_t type the server sends.
+ */
+uint8_t transmitter_packet_size(uint8_t msg);
+/**
+ * @brief Tells whether messages of the given @ref TestPacketMsg_t type are about a test request,
+ * and so are batched (see @ref SERVER_TX_BATCH_WINDOW_MS).
+ */
+bool transmitter_is_batchable(uint8_t msg);
+/**
+ * @brief Sends a message right away, with the raw API, bypassing the outbox. Only built with @ref SERVER_UDP_RAW_API.
+ * Must be called with the lwIP core locked (as it is in a raw API receive callback).
+ * @retval true The message was handed to the Ethernet driver
+ * @retval false The transmitter has not created its PCB yet, no pbuf could be allocated, or sending failed
+ */
+bool transmitter_send_raw(const struct OutgoingMessage *message);
 
 #endif /* TRANSMITTER_H_ */
@@ -25,7 +25,8 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
-
+#include "boot_profile.h"
+#include "test_executor.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -37,7 +38,10 @@ typedef StaticQueue_t osStaticMessageQDef_t;
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
-
+/**
+ * @brief The startup event flag set once lwIP is initialized, which the network facing tasks wait for.
+ */
+#define STARTUP_FLAG_LWIP_READY (0x01U)
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -47,7 +51,7 @@ typedef StaticQueue_t osStaticMessageQDef_t;
 
 /* Private variables ---------------------------------------------------------*/
 /* USER CODE BEGIN Variables */
-static bool lwip_initialized = false;
+static osEventFlagsId_t startup_flags = NULL;
 /* USER CODE END Variables */
 /* Definitions for defaultTask */
 osThreadId_t defaultTaskHandle;
@@ -73,66 +77,6 @@ const osThreadAttr_t ListenerTask_attributes = {
   .stack_size = sizeof(ListenerTaskBuffer),
   .priority = (osPriority_t) osPriorityHigh,
 };
-/* Definitions for UARTTestTask */
-osThreadId_t UARTTestTaskHandle;
-uint32_t UARTTestTaskBuffer[ 1024 ];
-osStaticThreadDef_t UARTTestTaskControlBlock;
-const osThreadAttr_t UARTTestTask_attributes = {
-  .name = "UARTTestTask",
-  .cb_mem = &UARTTestTaskControlBlock,
-  .cb_size = sizeof(UARTTestTaskControlBlock),
-  .stack_mem = &UARTTestTaskBuffer[0],
-  .stack_size = sizeof(UARTTestTaskBuffer),
-  .priority = (osPriority_t) osPriorityNormal,
-};
-/* Definitions for I2CTestTask */
-osThreadId_t I2CTestTaskHandle;
-uint32_t I2CTestTaskBuffer[ 1024 ];
-osStaticThreadDef_t I2CTestTaskControlBlock;
-const osThreadAttr_t I2CTestTask_attributes = {
-  .name = "I2CTestTask",
-  .cb_mem = &I2CTestTaskControlBlock,
-  .cb_size = sizeof(I2CTestTaskControlBlock),
-  .stack_mem = &I2CTestTaskBuffer[0],
-  .stack_size = sizeof(I2CTestTaskBuffer),
-  .priority = (osPriority_t) osPriorityNormal,
-};
-/* Definitions for SPITestTask */
-osThreadId_t SPITestTaskHandle;
-uint32_t SPITestTaskBuffer[ 1024 ];
-osStaticThreadDef_t SPITestTaskControlBlock;
-const osThreadAttr_t SPITestTask_attributes = {
-  .name = "SPITestTask",
-  .cb_mem = &SPITestTaskControlBlock,
-  .cb_size = sizeof(SPITestTaskControlBlock),
-  .stack_mem = &SPITestTaskBuffer[0],
-  .stack_size = sizeof(SPITestTaskBuffer),
-  .priority = (osPriority_t) osPriorityNormal,
-};
-/* Definitions for TimerTestTask */
-osThreadId_t TimerTestTaskHandle;
-uint32_t TimerTestTaskBuffer[ 256 ];
-osStaticThreadDef_t TimerTestTaskControlBlock;
-const osThreadAttr_t TimerTestTask_attributes = {
-  .name = "TimerTestTask",
-  .cb_mem = &TimerTestTaskControlBlock,
-  .cb_size = sizeof(TimerTestTaskControlBlock),
-  .stack_mem = &TimerTestTaskBuffer[0],
-  .stack_size = sizeof(TimerTestTaskBuffer),
-  .priority = (osPriority_t) osPriorityNormal,
-};
-/* Definitions for ADCTestTask */
-osThreadId_t ADCTestTaskHandle;
-uint32_t ADCTestTaskBuffer[ 512 ];
-osStaticThreadDef_t ADCTestTaskControlBlock;
-const osThreadAttr_t ADCTestTask_attributes = {
-  .name = "ADCTestTask",
-  .cb_mem = &ADCTestTaskControlBlock,
-  .cb_size = sizeof(ADCTestTaskControlBlock),
-  .stack_mem = &ADCTestTaskBuffer[0],
-  .stack_size = sizeof(ADCTestTaskBuffer),
-  .priority = (osPriority_t) osPriorityNormal,
-};
 /* Definitions for TransmitterTask */
 osThreadId_t TransmitterTaskHandle;
 uint32_t TransmitterTaskBuffer[ 1024 ];
@@ -180,9 +124,20 @@ const osMessageQueueAttr_t TestQueue_attributes = {
   .mq_mem = &TestQueueBuffer,
   .mq_size = sizeof(TestQueueBuffer)
 };
+/* Definitions for InteractiveQueue */
+osMessageQueueId_t InteractiveQueueHandle;
+uint8_t InteractiveQueueBuffer[ 4 * 256 ];
+osStaticMessageQDef_t InteractiveQueueControlBlock;
+const osMessageQueueAttr_t InteractiveQueue_attributes = {
+  .name = "InteractiveQueue",
+  .cb_mem = &InteractiveQueueControlBlock,
+  .cb_size = sizeof(InteractiveQueueControlBlock),
+  .mq_mem = &InteractiveQueueBuffer,
+  .mq_size = sizeof(InteractiveQueueBuffer)
+};
 /* Definitions for OutboxQueue */
 osMessageQueueId_t OutboxQueueHandle;
-uint8_t OutboxQueueBuffer[ 32 * 32 ];
+uint8_t OutboxQueueBuffer[ 32 * 64 ];
 osStaticMessageQDef_t OutboxQueueControlBlock;
 const osMessageQueueAttr_t OutboxQueue_attributes = {
   .name = "OutboxQueue",
@@ -210,11 +165,6 @@ const osMessageQueueAttr_t DebugQueue_attributes = {
 
 void StartDefaultTask(void *argument);
 void StartListenerTask(void *argument);
-void StartUARTTestTask(void *argument);
-void StartI2CTestTask(void *argument);
-void StartSPITestTask(void *argument);
-void StartTimerTestTask(void *argument);
-void StartADCTestTask(void *argument);
 void StartTransmitterTask(void *argument);
 void StartTestRunnerTask(void *argument);
 void StartDebugTask(void *argument);
@@ -248,8 +198,11 @@ void MX_FREERTOS_Init(void) {
   /* creation of TestQueue */
   TestQueueHandle = osMessageQueueNew (16, 256, &TestQueue_attributes);
 
+  /* creation of InteractiveQueue */
+  InteractiveQueueHandle = osMessageQueueNew (4, 256, &InteractiveQueue_attributes);
+
   /* creation of OutboxQueue */
-  OutboxQueueHandle = osMessageQueueNew (32, 32, &OutboxQueue_attributes);
+  OutboxQueueHandle = osMessageQueueNew (32, 64, &OutboxQueue_attributes);
 
   /* creation of DebugQueue */
   DebugQueueHandle = osMessageQueueNew (64, 160, &DebugQueue_attributes);
@@ -265,21 +218,6 @@ void MX_FREERTOS_Init(void) {
   /* creation of ListenerTask */
   ListenerTaskHandle = osThreadNew(StartListenerTask, NULL, &ListenerTask_attributes);
 
-  /* creation of UARTTestTask */
-  UARTTestTaskHandle = osThreadNew(StartUARTTestTask, NULL, &UARTTestTask_attributes);
-
-  /* creation of I2CTestTask */
-  I2CTestTaskHandle = osThreadNew(StartI2CTestTask, NULL, &I2CTestTask_attributes);
-
-  /* creation of SPITestTask */
-  SPITestTaskHandle = osThreadNew(StartSPITestTask, NULL, &SPITestTask_attributes);
-
-  /* creation of TimerTestTask */
-  TimerTestTaskHandle = osThreadNew(StartTimerTestTask, NULL, &TimerTestTask_attributes);
-
-  /* creation of ADCTestTask */
-  ADCTestTaskHandle = osThreadNew(StartADCTestTask, NULL, &ADCTestTask_attributes);
-
   /* creation of TransmitterTask */
   TransmitterTaskHandle = osThreadNew(StartTransmitterTask, NULL, &TransmitterTask_attributes);
 
@@ -291,10 +229,12 @@ void MX_FREERTOS_Init(void) {
 
   /* USER CODE BEGIN RTOS_THREADS */
   /* add threads, ... */
+  test_executor_init();
   /* USER CODE END RTOS_THREADS */
 
   /* USER CODE BEGIN RTOS_EVENTS */
   /* add events, ... */
+  startup_flags = osEventFlagsNew(NULL);
   /* USER CODE END RTOS_EVENTS */
 
 }
@@ -311,7 +251,7 @@ void StartDefaultTask(void *argument)
   /* init code for LWIP */
   MX_LWIP_Init();
   /* USER CODE BEGIN StartDefaultTask */
-  lwip_initialized = true;
+  osEventFlagsSet(startup_flags, STARTUP_FLAG_LWIP_READY);
   /* Infinite loop */
   for(;;)
   {
@@ -330,8 +270,9 @@ void StartDefaultTask(void *argument)
 void StartListenerTask(void *argument)
 {
   /* USER CODE BEGIN StartListenerTask */
-  vTaskDelay(pdMS_TO_TICKS(200));
-  while (!lwip_initialized) vTaskDelay(pdMS_TO_TICKS(100));
+  /* the first task to run (the highest priority, created first) */
+  boot_profile_mark(BOOT_STAGE_SCHEDULER);
+  osEventFlagsWait(startup_flags, STARTUP_FLAG_LWIP_READY, osFlagsNoClear, osWaitForever);
   test_listener_task_init();
   /* Infinite loop */
   for(;;)
@@ -341,96 +282,6 @@ void StartListenerTask(void *argument)
   /* USER CODE END StartListenerTask */
 }
 
-/* USER CODE BEGIN Header_StartUARTTestTask */
-/**
-* @brief Function implementing the UARTTestTask thread.
-* @param argument: Not used
-* @retval None
-*/
-/* USER CODE END Header_StartUARTTestTask */
-void StartUARTTestTask(void *argument)
-{
-  /* USER CODE BEGIN StartUARTTestTask */
-  /* Infinite loop */
-  for(;;)
-  {
-	  test_task_loop(TESTIDX_UART);
-  }
-  /* USER CODE END StartUARTTestTask */
-}
-
-/* USER CODE BEGIN Header_StartI2CTestTask */
-/**
-* @brief Function implementing the I2CTestTask thread.
-* @param argument: Not used
-* @retval None
-*/
-/* USER CODE END Header_StartI2CTestTask */
-void StartI2CTestTask(void *argument)
-{
-  /* USER CODE BEGIN StartI2CTestTask */
-  /* Infinite loop */
-  for(;;)
-  {
-	  test_task_loop(TESTIDX_I2C);
-  }
-  /* USER CODE END StartI2CTestTask */
-}
-
-/* USER CODE BEGIN Header_StartSPITestTask */
-/**
-* @brief Function implementing the SPITestTask thread.
-* @param argument: Not used
-* @retval None
-*/
-/* USER CODE END Header_StartSPITestTask */
-void StartSPITestTask(void *argument)
-{
-  /* USER CODE BEGIN StartSPITestTask */
-  /* Infinite loop */
-  for(;;)
-  {
-	  test_task_loop(TESTIDX_SPI);
-  }
-  /* USER CODE END StartSPITestTask */
-}
-
-/* USER CODE BEGIN Header_StartTimerTestTask */
-/**
-* @brief Function implementing the TimerTestTask thread.
-* @param argument: Not used
-* @retval None
-*/
-/* USER CODE END Header_StartTimerTestTask */
-void StartTimerTestTask(void *argument)
-{
-  /* USER CODE BEGIN StartTimerTestTask */
-  /* Infinite loop */
-  for(;;)
-  {
-	  test_task_loop(TESTIDX_TIMER);
-  }
-  /* USER CODE END StartTimerTestTask */
-}
-
-/* USER CODE BEGIN Header_StartADCTestTask */
-/**
-* @brief Function implementing the ADCTestTask thread.
-* @param argument: Not used
-* @retval None
-*/
-/* USER CODE END Header_StartADCTestTask */
-void StartADCTestTask(void *argument)
-{
-  /* USER CODE BEGIN StartADCTestTask */
-  /* Infinite loop */
-  for(;;)
-  {
-	  test_task_loop(TESTIDX_ADC);
-  }
-  /* USER CODE END StartADCTestTask */
-}
-
 /* USER CODE BEGIN Header_StartTransmitterTask */
 /**
 * @brief Function implementing the TransmitterTask thread.
@@ -441,8 +292,7 @@ void StartADCTestTask(void *argument)
 void StartTransmitterTask(void *argument)
 {
   /* USER CODE BEGIN StartTransmitterTask */
-  vTaskDelay(pdMS_TO_TICKS(200));
-  while (!lwip_initialized) vTaskDelay(pdMS_TO_TICKS(100));
+  osEventFlagsWait(startup_flags, STARTUP_FLAG_LWIP_READY, osFlagsNoClear, osWaitForever);
   transmitter_task_init();
   /* Infinite loop */
   for(;;)
@@ -462,8 +312,7 @@ void StartTransmitterTask(void *argument)
 void StartTestRunnerTask(void *argument)
 {
   /* USER CODE BEGIN StartTestRunnerTask */
-  vTaskDelay(pdMS_TO_TICKS(200));
-  while (!lwip_initialized) vTaskDelay(pdMS_TO_TICKS(100));
+  osEventFlagsWait(startup_flags, STARTUP_FLAG_LWIP_READY, osFlagsNoClear, osWaitForever);
   test_runner_task_init();
   /* Infinite loop */
   for(;;)
@@ -29,8 +29,12 @@
 #include <string.h>
 
 /* USER CODE BEGIN 0 */
-static volatile uint8_t eth_link_status_idx = 0;
+#include "boot_profile.h"
+#include "fast_boot.h"
+
 static uint8_t eth_last_link_up_idx = 0;
+static StaticEventGroup_t net_state_control_block;
+static EventGroupHandle_t net_state = NULL;
 static char debug_buff[SERIAL_DEBUG_MAX_LEN] = {0};
 /* USER CODE END 0 */
 /* Private function prototypes -----------------------------------------------*/
@@ -53,9 +57,44 @@ osThreadAttr_t attributes;
 /* USER CODE END OS_THREAD_ATTR_CMSIS_RTOS_V2 */
 
 /* USER CODE BEGIN 2 */
-uint8_t lwip_get_eth_link_status_idx(void)
+EventGroupHandle_t lwip_net_state(void)
+{
+	return net_state;
+}
+
+/**
+  * @brief  Publishes whether the interface has an IPv4 address, flagging a change if it does not match the published state
+  * @param  netif: the network interface
+  * @retval None
+  */
+static void publish_ip_state(struct netif *netif)
+{
+	bool bound = !ip4_addr_isany_val(*netif_ip4_addr(netif));
+	bool was_bound = (xEventGroupGetBits(net_state) & NET_STATE_IP_BOUND) != 0;
+
+	if (bound == was_bound) return;
+
+	if (bound)
+	{
+		boot_profile_mark(BOOT_STAGE_ADDRESS);
+		xEventGroupSetBits(net_state, NET_STATE_IP_BOUND | NET_STATE_CHANGED);
+	}
+	else
+	{
+		xEventGroupClearBits(net_state, NET_STATE_IP_BOUND);
+		xEventGroupSetBits(net_state, NET_STATE_CHANGED);
+	}
+}
+
+/**
+  * @brief  Notify the User about the network interface status (up or down, and its address)
+  * @param  netif: the network interface
+  * @retval None
+  */
+static void ethernet_status_updated(struct netif *netif)
 {
-	return eth_link_status_idx;
+	fast_boot_save_lease(netif);
+	publish_ip_state(netif);
 }
 /* USER CODE END 2 */
 
@@ -86,6 +125,9 @@ void MX_LWIP_Init(void)
 
   /* Create the Ethernet link handler thread */
 /* USER CODE BEGIN H7_OS_THREAD_NEW_CMSIS_RTOS_V2 */
+  /* the network state is published from the link thread's first callback on */
+  net_state = xEventGroupCreateStatic(&net_state_control_block);
+
   memset(&attributes, 0x0, sizeof(osThreadAttr_t));
   attributes.name = "EthLink";
   attributes.stack_size = INTERFACE_THREAD_STACK_SIZE;
@@ -97,7 +139,14 @@ void MX_LWIP_Init(void)
   dhcp_start(&gnetif);
 
 /* USER CODE BEGIN 3 */
+  /* DHCP binding, renewing to another address or releasing it all go through the status callback */
+  LOCK_TCPIP_CORE();
+  netif_set_status_callback(&gnetif, ethernet_status_updated);
+  /* come up on the cached lease right away, while DHCP revalidates it */
+  fast_boot_init(&gnetif);
+  UNLOCK_TCPIP_CORE();
 
+  boot_profile_mark(BOOT_STAGE_LWIP);
 /* USER CODE END 3 */
 }
 
@@ -121,7 +170,9 @@ static void ethernet_link_status_updated(struct netif *netif)
 	  uint8_t new_idx = eth_last_link_up_idx == UINT8_MAX ?
 			  1 : eth_last_link_up_idx + 1;
 	  eth_last_link_up_idx = new_idx;
-	  eth_link_status_idx = new_idx;
+	  boot_profile_mark(BOOT_STAGE_LINK);
+	  xEventGroupSetBits(net_state, NET_STATE_LINK_UP | NET_STATE_CHANGED);
+	  publish_ip_state(netif);
 	  snprintf(debug_buff, sizeof(debug_buff), "Ethernet link is up (index %u).", new_idx);
 	  serial_debug_enqueue(debug_buff);
 /* USER CODE END 5 */
@@ -129,7 +180,8 @@ static void ethernet_link_status_updated(struct netif *netif)
   else /* netif is down */
   {
 /* USER CODE BEGIN 6 */
-	  eth_link_status_idx = 0;
+	  xEventGroupClearBits(net_state, NET_STATE_LINK_UP);
+	  xEventGroupSetBits(net_state, NET_STATE_CHANGED);
 	  snprintf(debug_buff, sizeof(debug_buff), "Ethernet link is down (index %u).", eth_last_link_up_idx);
 	  serial_debug_enqueue(debug_buff);
 /* USER CODE END 6 */
@@ -41,7 +41,27 @@
 #endif /* WITH_RTOS */
 
 /* USER CODE BEGIN 0 */
-uint8_t lwip_get_eth_link_status_idx(void);
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "event_groups.h"
+
+/**
+  * @brief  Network state bits, published in the event group returned by lwip_net_state(),
+  *         which tasks block on rather than polling the interface
+  */
+/* The Ethernet link is up */
+#define NET_STATE_LINK_UP (0x01U)
+/* The interface has an IPv4 address (bound by DHCP) */
+#define NET_STATE_IP_BOUND (0x02U)
+/* Set on every change of the bits above, and cleared by the task that follows the changes (the listener) */
+#define NET_STATE_CHANGED (0x04U)
+/* Both the link and an address, so that packets can be exchanged */
+#define NET_STATE_READY (NET_STATE_LINK_UP | NET_STATE_IP_BOUND)
+
+/**
+  * @brief  Returns the network state event group, created by MX_LWIP_Init()
+  */
+EventGroupHandle_t lwip_net_state(void);
 /* USER CODE END 0 */
 
 /* Global Variables ----------------------------------------------------------*/
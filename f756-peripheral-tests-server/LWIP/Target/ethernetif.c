@@ -33,7 +33,8 @@
 
 /* Within 'USER CODE' section, code will be kept by default at each generation */
 /* USER CODE BEGIN 0 */
-
+#include "perf_counter.h"
+#include "task.h"
 /* USER CODE END 0 */
 
 /* Private define ------------------------------------------------------------*/
@@ -42,8 +43,8 @@
 /* Time to block waiting for transmissions to finish */
 #define ETHIF_TX_TIMEOUT (2000U)
 /* USER CODE BEGIN OS_THREAD_STACK_SIZE_WITH_RTOS */
-/* Stack size of the interface thread */
-#define INTERFACE_THREAD_STACK_SIZE ( 1024 )
+/* Stack size of the interface thread, which runs the stack's input (and the listener's raw API callback) under the core lock */
+#define INTERFACE_THREAD_STACK_SIZE ( 2048 )
 /* USER CODE END OS_THREAD_STACK_SIZE_WITH_RTOS */
 /* Network interface name */
 #define IFNAME0 's'
@@ -120,10 +121,16 @@ ETH_DMADescTypeDef DMATxDscrTab[ETH_TX_DESC_CNT] __attribute__((section(".TxDecr
 #endif
 
 /* USER CODE BEGIN 2 */
+/* The RX buffers are written by the Ethernet DMA, so they go to the non-cacheable region (see memory_layout.h) */
+__attribute__((section(".Rx_PoolSection"))) extern u8_t memp_memory_RX_POOL_base[];
 
+/* Frames stay in RX_POOL until the listener deletes their netbuf, so the pool must cover the DMA's own
+ * buffers and a full receive burst (see SERVER_UDP_RX_BURST_PACKETS in lwipopts.h) */
+#if ETH_RX_BUFFER_CNT < (ETH_RX_DESC_CNT + SERVER_UDP_RX_BURST_PACKETS)
+#error "ETH_RX_BUFFER_CNT cannot hold the Rx descriptors' buffers and a full receive burst."
+#endif
 /* USER CODE END 2 */
 
-osSemaphoreId RxPktSemaphore = NULL;   /* Semaphore to signal incoming packets */
 osSemaphoreId TxPktSemaphore = NULL;   /* Semaphore to signal transmit packet complete */
 
 /* Global Ethernet handle */
@@ -145,7 +152,16 @@ lan8742_IOCtx_t  LAN8742_IOCtx = {ETH_PHY_IO_Init,
                                   ETH_PHY_IO_GetTick};
 
 /* USER CODE BEGIN 3 */
-
+/* The interface thread, notified directly (rather than through a semaphore) of received frames and refilled buffers */
+static osThreadId_t EthIfThreadId = NULL;
+/* Cycle count of the receive interrupt that opened the pending batch of frames, 0 while none is pending */
+static volatile uint32_t RxPendingIrqCycles = 0;
+/* Cycle count of the receive interrupt that opened the batch last drained */
+static volatile uint32_t RxBatchIrqCycles = 0;
+static EthernetifRxStats_t RxStats = {0};
+
+static void ethernetif_notify_input_from_isr(void);
+static void ethernetif_notify_input(void);
 /* USER CODE END 3 */
 
 /* Private functions ---------------------------------------------------------*/
@@ -158,7 +174,11 @@ void pbuf_free_custom(struct pbuf *p);
   */
 void HAL_ETH_RxCpltCallback(ETH_HandleTypeDef *handlerEth)
 {
-  osSemaphoreRelease(RxPktSemaphore);
+  if (RxPendingIrqCycles == 0)
+  {
+    RxPendingIrqCycles = perf_counter_now() | 1U;
+  }
+  ethernetif_notify_input_from_isr();
 }
 /**
   * @brief  Ethernet Tx Transfer completed callback
@@ -178,12 +198,35 @@ void HAL_ETH_ErrorCallback(ETH_HandleTypeDef *handlerEth)
 {
   if((HAL_ETH_GetDMAError(handlerEth) & ETH_DMASR_RBUS) == ETH_DMASR_RBUS)
   {
-     osSemaphoreRelease(RxPktSemaphore);
+     ethernetif_notify_input_from_isr();
   }
 }
 
 /* USER CODE BEGIN 4 */
+/**
+  * @brief  Wakes the interface thread from an interrupt, switching to it on exit if it preempts the interrupted task
+  * @retval None
+  */
+static void ethernetif_notify_input_from_isr(void)
+{
+  BaseType_t higher_priority_woken = pdFALSE;
+
+  if (EthIfThreadId == NULL) return;
+
+  vTaskNotifyGiveFromISR((TaskHandle_t)EthIfThreadId, &higher_priority_woken);
+  portYIELD_FROM_ISR(higher_priority_woken);
+}
+
+/**
+  * @brief  Wakes the interface thread from a task
+  * @retval None
+  */
+static void ethernetif_notify_input(void)
+{
+  if (EthIfThreadId == NULL) return;
 
+  xTaskNotifyGive((TaskHandle_t)EthIfThreadId);
+}
 /* USER CODE END 4 */
 
 /*******************************************************************************
@@ -261,9 +304,6 @@ static void low_level_init(struct netif *netif)
     netif->flags |= NETIF_FLAG_BROADCAST;
   #endif /* LWIP_ARP */
 
-  /* create a binary semaphore used for informing ethernetif of frame reception */
-  RxPktSemaphore = osSemaphoreNew(1, 0, NULL);
-
   /* create a binary semaphore used for informing ethernetif of frame transmission */
   TxPktSemaphore = osSemaphoreNew(1, 0, NULL);
 
@@ -273,7 +313,7 @@ static void low_level_init(struct netif *netif)
   attributes.name = "EthIf";
   attributes.stack_size = INTERFACE_THREAD_STACK_SIZE;
   attributes.priority = osPriorityRealtime;
-  osThreadNew(ethernetif_input, netif, &attributes);
+  EthIfThreadId = osThreadNew(ethernetif_input, netif, &attributes);
 /* USER CODE END OS_THREAD_NEW_CMSIS_RTOS_V2 */
 
 /* USER CODE BEGIN PHY_PRE_CONFIG */
@@ -467,22 +507,41 @@ void ethernetif_input(void* argument)
 {
   struct pbuf *p = NULL;
   struct netif *netif = (struct netif *) argument;
+  uint32_t frames;
 
   for( ;; )
   {
-    if (osSemaphoreAcquire(RxPktSemaphore, TIME_WAITING_FOR_INPUT) == osOK)
+    /* however many interrupts were raised since the last wake-up, every ready descriptor is drained at once */
+    if (ulTaskNotifyTake(pdTRUE, TIME_WAITING_FOR_INPUT) != 0)
     {
+      taskENTER_CRITICAL();
+      if (RxPendingIrqCycles != 0)
+      {
+        RxBatchIrqCycles = RxPendingIrqCycles;
+        RxPendingIrqCycles = 0;
+      }
+      taskEXIT_CRITICAL();
+
+      frames = 0;
       do
       {
         p = low_level_input( netif );
         if (p != NULL)
         {
+          frames++;
           if (netif->input( p, netif) != ERR_OK )
           {
             pbuf_free(p);
           }
         }
       } while(p!=NULL);
+
+      RxStats.wakeups++;
+      RxStats.frames += frames;
+      if (frames > RxStats.frames_per_wakeup_max)
+      {
+        RxStats.frames_per_wakeup_max = frames;
+      }
     }
   }
 }
@@ -582,7 +641,7 @@ void pbuf_free_custom(struct pbuf *p)
   if (RxAllocStatus == RX_ALLOC_ERROR)
   {
     RxAllocStatus = RX_ALLOC_OK;
-    osSemaphoreRelease(RxPktSemaphore);
+    ethernetif_notify_input();
   }
 }
 
@@ -911,8 +970,7 @@ void HAL_ETH_RxLinkCallback(void **pStart, void **pEnd, uint8_t *buff, uint16_t
     p->tot_len += Length;
   }
 
-  /* Invalidate data cache because Rx DMA's writing to physical memory makes it stale. */
-  SCB_InvalidateDCache_by_Addr((uint32_t *)buff, Length);
+  /* No cache maintenance: the RX pool is in the non-cacheable region, so the CPU reads what the DMA wrote. */
 
 /* USER CODE END HAL ETH RxLinkCallback */
 }
@@ -927,6 +985,22 @@ void HAL_ETH_TxFreeCallback(uint32_t * buff)
 }
 
 /* USER CODE BEGIN 8 */
+uint32_t ethernetif_rx_batch_irq_cycles(void)
+{
+  return RxBatchIrqCycles;
+}
+
+void ethernetif_take_rx_stats(EthernetifRxStats_t *stats)
+{
+  taskENTER_CRITICAL();
+  *stats = RxStats;
+  RxStats = (EthernetifRxStats_t){0};
+  taskEXIT_CRITICAL();
+}
 
+void ethernetif_release_tx(void)
+{
+  HAL_ETH_ReleaseTxPacket(&heth);
+}
 /* USER CODE END 8 */
 
@@ -40,6 +40,31 @@ u32_t sys_jiffies(void);
 u32_t sys_now(void);
 
 /* USER CODE BEGIN 1 */
+/**
+  * @brief  The receive path's measurements since they were last taken
+  */
+typedef struct EthernetifRxStats
+{
+  /* Count of times the interface thread was woken up, and of frames it handed to the stack */
+  uint32_t wakeups;
+  uint32_t frames;
+  /* Largest count of frames handed to the stack in a single wake-up */
+  uint32_t frames_per_wakeup_max;
+} EthernetifRxStats_t;
 
+/**
+  * @brief  Returns the cycle count (see perf_counter.h) of the receive interrupt that opened the batch
+  *         of frames the interface thread last drained, or 0 before the first frame
+  */
+uint32_t ethernetif_rx_batch_irq_cycles(void);
+/**
+  * @brief  Copies the receive path's measurements, and clears them
+  */
+void ethernetif_take_rx_stats(EthernetifRxStats_t *stats);
+/**
+  * @brief  Frees the frames the Ethernet DMA is done sending, which are otherwise only freed
+  *         once every transmit descriptor is taken. Called with the core locked
+  */
+void ethernetif_release_tx(void);
 /* USER CODE END 1 */
 #endif
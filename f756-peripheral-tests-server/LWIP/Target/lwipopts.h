@@ -30,7 +30,38 @@
 
 /* Within 'USER CODE' section, code will be kept by default at each generation */
 /* USER CODE BEGIN 0 */
-
+/**
+ * @brief The count of requests the server is sized to have in flight at once (one per client),
+ * which the UDP receive path's pools and mailboxes are derived from (see USER CODE 1).
+ */
+#define SERVER_MAX_INFLIGHT_REQUESTS (4)
+/**
+ * @brief The count of packets a single in-flight request may have queued at once on the receive path
+ * (a pairing probe, the request itself, and a cancellation or retry).
+ */
+#define SERVER_PACKETS_PER_REQUEST (3)
+/**
+ * @brief The largest burst of UDP packets the listener may fall behind on without dropping any.
+ */
+#define SERVER_UDP_RX_BURST_PACKETS (SERVER_MAX_INFLIGHT_REQUESTS * SERVER_PACKETS_PER_REQUEST)
+/**
+ * @brief The count of messages that may wait in the tcpip mailbox at once
+ * (received frames and netconn calls take the core lock instead, leaving the link and DHCP callbacks).
+ */
+#define SERVER_TCPIP_CALLBACKS (2)
+/**
+ * @brief The count of journal packets that may be in the Ethernet DMA's hands at once (see listener.c),
+ * and the heap they take, each with its UDP, IP and Ethernet headers and pbuf, rounded up.
+ */
+#define SERVER_JOURNAL_TX_FRAMES (2)
+#define SERVER_JOURNAL_FRAME_BYTES (1280)
+/**
+ * @brief Enables lwIP's statistics (memory pools, heap, mailboxes and protocol counters), reported in telemetry packets.
+ * A diagnostic build sets it to 1 (e.g. -DNET_DIAGNOSTICS=1); otherwise the telemetry only carries the pool sizes.
+ */
+#ifndef NET_DIAGNOSTICS
+#define NET_DIAGNOSTICS (0)
+#endif
 /* USER CODE END 0 */
 
 #ifdef __cplusplus
@@ -135,7 +166,37 @@
 #define IP_DEBUG LWIP_DBG_ON
 /*-----------------------------------------------------------------------------*/
 /* USER CODE BEGIN 1 */
+/*
+ * Receive path sizing, derived from SERVER_MAX_INFLIGHT_REQUESTS rather than set one by one.
+ * Every received frame is held in the zero-copy RX_POOL of ethernetif.c from the Ethernet DMA
+ * to the listener's netbuf_delete(), passing through the listener's receive mailbox,
+ * which takes a netbuf per packet, so both are sized for a whole burst.
+ * The interface thread drains the DMA and runs the input of each frame itself, under the core lock,
+ * so frames never wait in the tcpip mailbox (and no TCPIP_MSG_INPKT pool is needed).
+ */
+#define LWIP_TCPIP_CORE_LOCKING_INPUT 1
+#undef DEFAULT_UDP_RECVMBOX_SIZE
+#define DEFAULT_UDP_RECVMBOX_SIZE SERVER_UDP_RX_BURST_PACKETS
+#undef TCPIP_MBOX_SIZE
+#define TCPIP_MBOX_SIZE SERVER_TCPIP_CALLBACKS
+/* one netbuf per queued packet, one held by the listener and one by the transmitter */
+#define MEMP_NUM_NETBUF (SERVER_UDP_RX_BURST_PACKETS + 2)
+/* frames are received into RX_POOL, so PBUF_POOL is only kept for the stack's own (unused) needs */
+#define PBUF_POOL_SIZE 2
+/* address changes (DHCP bound, renewed or released) are published to the network state event group (see lwip.c) */
+#define LWIP_NETIF_STATUS_CALLBACK 1
+/* the outgoing messages, plus the journal packets the listener streams in bursts (the heap ends below the Ethernet descriptors) */
+#undef MEM_SIZE
+#define MEM_SIZE (2048 + (SERVER_JOURNAL_TX_FRAMES * SERVER_JOURNAL_FRAME_BYTES))
 
+#if NET_DIAGNOSTICS
+#undef LWIP_STATS
+#define LWIP_STATS 1
+#define MEM_STATS 1
+#define MEMP_STATS 1
+#define SYS_STATS 1
+#define UDP_STATS 1
+#endif
 /* USER CODE END 1 */
 
 #ifdef __cplusplus
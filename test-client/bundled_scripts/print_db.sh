@@ -2,4 +2,8 @@ sqlite3 tests.db <<EOF
 .mode table ;
 SELECT * FROM requests ;
 SELECT * FROM results ;
+SELECT * FROM result_details ;
+SELECT * FROM sweep_steps ;
+SELECT * FROM sweep_noise ;
+SELECT * FROM sweep_capture ;
 EOF
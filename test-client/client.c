@@ -5,14 +5,52 @@
 
 #include "common.h"
 #include "networking_common.h"
+#include "spsc_queue.h"
 #include "db.h"
 #include "client.h"
 
 #define SOCKET_TIMEOUT_SEC (4)
+#define RECEIVER_POLL_MS (250)
+#define RECEIVER_BATCH_DATAGRAMS (32)
+#define RECEIVER_QUEUE_SLOTS (1024)
+#define SEND_BATCH_DATAGRAMS (32)
+#define MAX_KNOWN_SERVERS (16)
+#define BENCHMARK_START_RATE (1000)
+#define BENCHMARK_MAX_RATE (512000)
+#define BENCHMARK_STEP_SECS (1)
+#define BENCHMARK_DRAIN_MS (200)
+#define SOCKET_BENCHMARK_DATAGRAMS (200000)
+#define SOCKET_BENCHMARK_ROUND (128)
 #define NEW_TEST_ACK_TIMEOUT_SEC (8)
+#define BUSY_BACKOFF_BASE_MS (250)
+#define BUSY_BACKOFF_MAX_MS (30000)
+#define BUSY_BACKOFF_SLICE_MS (50)
+#define CANCEL_ACK_ATTEMPTS (2)
+#define BEACON_UID_STR_LEN ((TEST_PACKET_BEACON_UID_SIZE_BYTES * 2) + 1)
+#define JOURNAL_FETCH_ATTEMPTS (3)
+#define CLIENT_RX_BUFFER_SIZE (((SERVER_PACKET_MAX_SIZE_BYTES > TEST_JOURNAL_PACKET_MAX_SIZE_BYTES) ? SERVER_PACKET_MAX_SIZE_BYTES : TEST_JOURNAL_PACKET_MAX_SIZE_BYTES)+1)
+
+/**
+ * @brief A datagram passed from the receiver thread to the protocol thread.
+ */
+typedef struct ClientDatagram
+{
+    ssize_t size;
+    struct sockaddr_in from;
+    uint8_t data[CLIENT_RX_BUFFER_SIZE];
+} ClientDatagram_t;
 
 /// @brief Socket handle for both incoming and outgoing communication.
 static int sockfd = 0;
+/// @brief Datagrams received by the receiver thread, for the protocol (main) thread.
+static SpscQueue_t rx_queue = {0};
+static pthread_t receiver_thread;
+static atomic_bool receiver_running = false;
+/// @brief Counts of datagrams received, dropped on a full @ref rx_queue, and dropped by the kernel on a full socket buffer.
+static _Atomic uint64_t rx_received = 0;
+static _Atomic uint64_t rx_calls = 0;
+static _Atomic uint64_t rx_queue_drops = 0;
+static _Atomic uint64_t rx_kernel_drops = 0;
 /// @brief Destination address of the testing server.
 static struct sockaddr_in server_rx_addr = {0};
 /// @brief Required length variable for @ref server_rx_addr.
@@ -20,13 +58,27 @@ static socklen_t server_rx_addr_len = sizeof(server_rx_addr);
 /// @brief Storage buffer for outgoing packets.
 static uint8_t client_tx_buffer[TEST_REQUEST_PACKET_MAX_SIZE_BYTES+1] = {0};
 /// @brief Storage buffer for incoming packets.
-static uint8_t client_rx_buffer[TEST_REQUEST_PACKET_MIN_SIZE_BYTES+1] = {0};
+static uint8_t client_rx_buffer[CLIENT_RX_BUFFER_SIZE] = {0};
 /// @brief Storage buffer for the last sent "new test request" packet.
 static uint8_t latest_request_buffer[TEST_REQUEST_PACKET_MAX_SIZE_BYTES+1] = {0};
 /// @brief Records the clock time when the last "new test request" was saved.
 static struct timespec latest_request_clock = {0};
+/// @brief Storage buffer for the last received batch packet, whose packets are handed out one at a time.
+static uint8_t client_batch_buffer[TEST_BATCH_PACKET_MAX_SIZE_BYTES] = {0};
+/// @brief Size of the batch packet in @ref client_batch_buffer, and offset of its next packet's length byte.
+static size_t client_batch_size = 0;
+static size_t client_batch_offset = 0;
+/// @brief Source address of the batch packet in @ref client_batch_buffer.
+static struct sockaddr_in client_batch_addr = {0};
+/// @brief The port the client binds to, or 0 for one picked by the OS (see @ref client_set_options()).
+static uint16_t client_port = CLIENT_PORT;
+/// @brief The address of the only server to pair with, if the client was given one.
+static struct in_addr fixed_server_addr = {0};
+static bool is_server_fixed = false;
 /// @brief False until client is paired with server.
 static bool is_paired = false;
+/// @brief Highest error-free setting reported by each test's sweep for the last request, or 0 if none.
+static uint32_t sweep_best_setting[NUM_POSSIBLE_TESTS] = {0};
 
 /**
  * @brief Sends a [length] sized portion of [buffer] to the paired test server.
@@ -49,6 +101,200 @@ static bool client_send_packet(uint8_t *buffer, size_t length)
     return true;
 }
 
+/**
+ * @brief Sends the same packet to each of [count] destinations, in batches of up to @ref SEND_BATCH_DATAGRAMS
+ * datagrams per system call (with sendmmsg), rather than one sendto() per destination.
+ * This function is static as it is typically wrapped by other client functions.
+ * @return The count of destinations the packet was sent to
+ */
+static int client_send_packet_to_many(uint8_t *buffer, size_t length, const struct sockaddr_in *destinations, int count)
+{
+    struct iovec iovec = { .iov_base = buffer, .iov_len = length };
+    struct mmsghdr messages[SEND_BATCH_DATAGRAMS] = {0};
+    int sent_count = 0;
+
+    while (sent_count < count)
+    {
+        int batch_count = ((count - sent_count) < SEND_BATCH_DATAGRAMS) ? (count - sent_count) : SEND_BATCH_DATAGRAMS;
+
+        for (int i = 0; i < batch_count; i++)
+        {
+            messages[i].msg_hdr.msg_iov = &iovec;
+            messages[i].msg_hdr.msg_iovlen = 1;
+            messages[i].msg_hdr.msg_name = (void *)&destinations[sent_count + i];
+            messages[i].msg_hdr.msg_namelen = sizeof(destinations[sent_count + i]);
+        }
+
+        // stops at the first datagram that fails, which the next call retries (and reports)
+        int batch_sent = sendmmsg(sockfd, messages, batch_count, 0);
+
+        if (batch_sent <= 0)
+        {
+            perror("sendmmsg failed");
+            break;
+        }
+
+        sent_count += batch_sent;
+    }
+
+    printf("Sent packet of size %lu to %d destinations.\n", length, sent_count);
+
+    return sent_count;
+}
+
+/**
+ * @brief Operation loop of the receiver thread, which drains the socket in batches (with recvmmsg)
+ * into @ref rx_queue, so that the socket buffer never fills up while the protocol thread prints or waits on the DB.
+ */
+static void *client_receiver_thread(void *argument)
+{
+    static uint8_t buffers[RECEIVER_BATCH_DATAGRAMS][CLIENT_RX_BUFFER_SIZE];
+    static struct sockaddr_in addrs[RECEIVER_BATCH_DATAGRAMS];
+    static struct iovec iovecs[RECEIVER_BATCH_DATAGRAMS];
+    static struct mmsghdr messages[RECEIVER_BATCH_DATAGRAMS];
+    static uint8_t controls[RECEIVER_BATCH_DATAGRAMS][CMSG_SPACE(sizeof(uint32_t))];
+
+    (void)argument;
+
+    for (int i = 0; i < RECEIVER_BATCH_DATAGRAMS; i++)
+    {
+        iovecs[i].iov_base = buffers[i];
+        iovecs[i].iov_len = sizeof(buffers[i]);
+        messages[i].msg_hdr.msg_iov = &iovecs[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+        messages[i].msg_hdr.msg_name = &addrs[i];
+    }
+
+    while (atomic_load(&receiver_running))
+    {
+        for (int i = 0; i < RECEIVER_BATCH_DATAGRAMS; i++)
+        {
+            messages[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+            messages[i].msg_hdr.msg_control = controls[i];
+            messages[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+        }
+
+        // blocks for the first datagram (up to the socket timeout), then takes whatever else is queued
+        int count = recvmmsg(sockfd, messages, RECEIVER_BATCH_DATAGRAMS, MSG_WAITFORONE, NULL);
+
+        if (count <= 0) continue;
+
+        atomic_fetch_add(&rx_calls, 1);
+
+        for (int i = 0; i < count; i++)
+        {
+            ClientDatagram_t *datagram = spsc_queue_reserve(&rx_queue);
+
+            if (datagram == NULL)
+            {
+                atomic_fetch_add(&rx_queue_drops, 1);
+                continue;
+            }
+
+            datagram->size = messages[i].msg_len;
+            memcpy(&datagram->from, &addrs[i], sizeof(datagram->from));
+            memcpy(datagram->data, buffers[i], messages[i].msg_len);
+            spsc_queue_publish(&rx_queue);
+        }
+
+        atomic_fetch_add(&rx_received, count);
+
+        // the kernel's count of datagrams dropped on this socket so far, attached to every datagram
+        struct msghdr *last = &messages[count - 1].msg_hdr;
+
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(last); cmsg != NULL; cmsg = CMSG_NXTHDR(last, cmsg))
+        {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+            {
+                uint32_t kernel_drops;
+                memcpy(&kernel_drops, CMSG_DATA(cmsg), sizeof(kernel_drops));
+                atomic_store(&rx_kernel_drops, kernel_drops);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Takes the next datagram the receiver thread queued, like recvfrom() would from the socket.
+ * This function is static as it is typically wrapped by other client functions.
+ * @param [out] buffer Storage for the datagram, which is truncated to [buffer_size]
+ * @param [out] from The datagram's source address, or NULL
+ * @param [in,out] from_len Length of [from]
+ * @return The size of the datagram, or -1 if none arrived within @ref SOCKET_TIMEOUT_SEC (errno set to EAGAIN),
+ * or if the client is terminating (EINTR)
+ */
+static ssize_t client_pop_datagram(uint8_t *buffer, size_t buffer_size, struct sockaddr_in *from, socklen_t *from_len)
+{
+    ClientDatagram_t *datagram = spsc_queue_peek(&rx_queue, SOCKET_TIMEOUT_SEC * 1000);
+
+    if (datagram == NULL)
+    {
+        errno = should_terminate ? EINTR : EAGAIN;
+        return -1;
+    }
+
+    ssize_t size = ((size_t)datagram->size > buffer_size) ? (ssize_t)buffer_size : datagram->size;
+
+    memcpy(buffer, datagram->data, size);
+
+    if (from != NULL && from_len != NULL)
+    {
+        memcpy(from, &datagram->from, (*from_len < sizeof(datagram->from)) ? *from_len : sizeof(datagram->from));
+        *from_len = sizeof(datagram->from);
+    }
+
+    spsc_queue_release(&rx_queue);
+
+    return size;
+}
+
+/**
+ * @brief Receives a packet into the incoming buffer, unpacking batch packets (@ref TESTMSG_BATCH)
+ * so that the packets they carry are returned one per call, as if each had arrived on its own.
+ * This function is static as it is typically wrapped by other client functions.
+ * @param [out] from The packet's source address
+ * @param [in,out] from_len Length of [from]
+ * @return The size of the packet, or the return value of @ref client_pop_datagram() if nothing was received
+ */
+static ssize_t client_receive_packet(struct sockaddr_in *from, socklen_t *from_len)
+{
+    while (client_batch_offset + 1 >= client_batch_size)
+    {
+        ssize_t received_bytes = client_pop_datagram(client_rx_buffer, sizeof(client_rx_buffer)-1, from, from_len);
+
+        if (received_bytes < TEST_PACKET_BATCH_RECORDS_OFFSET+1 || received_bytes > TEST_BATCH_PACKET_MAX_SIZE_BYTES
+            || client_rx_buffer[0] != TEST_PACKET_START_BYTE_VALUE
+            || client_rx_buffer[TEST_PACKET_MSG_BYTE_OFFSET] != TESTMSG_BATCH)
+        {
+            return received_bytes;
+        }
+
+        memcpy(client_batch_buffer, client_rx_buffer, received_bytes);
+        memcpy(&client_batch_addr, from, sizeof(client_batch_addr));
+        // the end byte is never the start of a packet
+        client_batch_size = received_bytes - 1;
+        client_batch_offset = TEST_PACKET_BATCH_RECORDS_OFFSET;
+    }
+
+    size_t packet_size = client_batch_buffer[client_batch_offset];
+
+    if (packet_size == 0 || client_batch_offset + 1 + packet_size > client_batch_size)
+    {
+        // truncated, so the rest of the batch is dropped
+        client_batch_size = 0;
+        client_batch_offset = 0;
+        return client_receive_packet(from, from_len);
+    }
+
+    memcpy(client_rx_buffer, client_batch_buffer + client_batch_offset + 1, packet_size);
+    memcpy(from, &client_batch_addr, sizeof(client_batch_addr));
+    client_batch_offset += 1 + packet_size;
+
+    return packet_size;
+}
+
 /**
  * @brief Sets @ref server_rx_addr to broadcast, and sends a portion of the outgoing buffer corresponding to the size of a pairing packet.
  * This function is static since it is only ever called internally by @ref client_try_pairing().
@@ -66,68 +312,658 @@ static bool client_send_pairing_packet(void)
     return client_send_packet(client_tx_buffer, PAIRING_PACKET_SIZE_BYTES);
 }
 
+/**
+ * @brief Pairs with the server that sent the beacon in the incoming buffer, and records it as the last server seen.
+ * This function is static since it is only ever called internally by @ref client_await_beacon().
+ * @param [in] from The beacon's source address
+ * @param [in] known The servers the server must be one of, or NULL for any server
+ * @param [in] known_count Length of [known]
+ * @retval true Paired with the server
+ * @retval false The server is not a known one
+ */
+static bool client_handle_beacon(const struct sockaddr_in *from, const KnownServer_t *known, size_t known_count)
+{
+    char uid[BEACON_UID_STR_LEN] = {0};
+    char firmware_version[8] = {0};
+    uint32_t tests_net;
+
+    for (uint8_t i = 0; i < TEST_PACKET_BEACON_UID_SIZE_BYTES; i++)
+    {
+        snprintf(uid + (2 * i), sizeof(uid) - (2 * i), "%02X", client_rx_buffer[TEST_PACKET_BEACON_UID_OFFSET + i]);
+    }
+
+    if (known != NULL)
+    {
+        size_t i = 0;
+
+        while (i < known_count && strcmp(uid, known[i].uid) != 0) i++;
+
+        if (i == known_count)
+        {
+            printf("Server at IP %s is not a known one (UID %s).\n", inet_ntoa(from->sin_addr), uid);
+            return false;
+        }
+    }
+
+    snprintf(firmware_version, sizeof(firmware_version), "%u.%u",
+        client_rx_buffer[TEST_PACKET_BEACON_VERSION_MAJOR_OFFSET], client_rx_buffer[TEST_PACKET_BEACON_VERSION_MINOR_OFFSET]);
+    memcpy(&tests_net, client_rx_buffer+TEST_PACKET_BEACON_TESTS_OFFSET, sizeof(tests_net));
+
+    server_rx_addr = *from;
+    server_rx_addr.sin_port = htons(SERVER_PORT);
+    server_rx_addr_len = sizeof(server_rx_addr);
+    is_paired = true;
+
+    printf("Paired with server at IP %s !\n", inet_ntoa(server_rx_addr.sin_addr));
+    printf("Server UID %s, firmware %s, tests available 0x%08X, features 0x%02X.\n",
+        uid, firmware_version, ntohl(tests_net), client_rx_buffer[TEST_PACKET_BEACON_FEATURES_OFFSET]);
+
+    db_save_server(uid, inet_ntoa(server_rx_addr.sin_addr), firmware_version, ntohl(tests_net),
+        client_rx_buffer[TEST_PACKET_BEACON_FEATURES_OFFSET]);
+
+    return true;
+}
+
+/**
+ * @brief Waits for a server's beacon answering the probe just sent, and pairs with that server.
+ * This function is static since it is only ever called internally by @ref client_try_pairing().
+ * @param [in] known The servers the server must be one of, or NULL for any server
+ * @param [in] known_count Length of [known]
+ * @param [in] reprobe Whether to broadcast another probe each time the socket times out, rather than give up
+ */
+static void client_await_beacon(const KnownServer_t *known, size_t known_count, bool reprobe)
+{
+    struct sockaddr_in new_server_addr = {0};
+    socklen_t new_server_addr_len = sizeof(new_server_addr);
+
+    printf("Awaiting a server beacon.\n");
+
+    while (!should_terminate && !is_paired)
+    {
+        ssize_t received_bytes = client_pop_datagram(client_rx_buffer, sizeof(client_rx_buffer), &new_server_addr, &new_server_addr_len);
+
+        if (received_bytes <= 0)
+        {
+            int err = errno;
+            if (err == ETIMEDOUT || err == EAGAIN || err == EWOULDBLOCK)
+            {
+                if (!reprobe) return;
+                client_send_pairing_packet();
+            }
+            else perror("Receiving failed");
+            continue;
+        }
+
+        printf("Received packet of size %ld.\n", received_bytes);
+
+        if (client_rx_buffer[0] == TEST_PACKET_START_BYTE_VALUE
+                && client_rx_buffer[TEST_PACKET_MSG_BYTE_OFFSET] == TESTMSG_PAIRING_PROBE)
+        {
+            // our broadcast, or another client's (which may be bound to any port)
+            continue;
+        }
+        else if (received_bytes >= TEST_BEACON_PACKET_SIZE_BYTES && client_rx_buffer[0] == TEST_PACKET_START_BYTE_VALUE
+                && client_rx_buffer[TEST_PACKET_MSG_BYTE_OFFSET] == TESTMSG_PAIRING_BEACON
+                && client_rx_buffer[TEST_BEACON_PACKET_SIZE_BYTES-1] == TEST_PACKET_END_BYTE_VALUE)
+        {
+            // another known server may still answer, until the timeout
+            client_handle_beacon(&new_server_addr, known, known_count);
+        }
+        else
+        {
+            printf("Received unexpected packet.\n");
+            break;
+        }
+    }
+}
+
 void client_try_pairing(void)
 {
-    static struct sockaddr_in new_server_addr = {0};
-    static socklen_t new_server_addr_len = sizeof(new_server_addr);
+    static bool known_server_probed = false;
 
     if (is_paired || should_terminate) return;
 
     client_fill_pairing_packet();
 
-    if (!client_send_pairing_packet())
-    {
-        printf("Failed to send pairing packet.\n");
-        sleep(1);
-        return;
-    }
+    if (is_server_fixed)
+    {
+        server_rx_addr.sin_addr = fixed_server_addr;
+        server_rx_addr.sin_port = htons(SERVER_PORT);
+        server_rx_addr.sin_family = AF_INET;
+
+        printf("Probing the server at IP %s.\n", inet_ntoa(fixed_server_addr));
+
+        if (client_send_packet(client_tx_buffer, PAIRING_PACKET_SIZE_BYTES))
+        {
+            client_await_beacon(NULL, 0, false);
+        }
+        return;
+    }
+
+    if (!known_server_probed)
+    {
+        KnownServer_t known[MAX_KNOWN_SERVERS];
+        struct sockaddr_in known_addrs[MAX_KNOWN_SERVERS] = {0};
+        size_t known_count = db_known_servers(known, MAX_KNOWN_SERVERS);
+        int probe_count = 0;
+
+        known_server_probed = true;
+
+        // skipping discovery, as long as a server seen before still answers at its address
+        for (size_t i = 0; i < known_count; i++)
+        {
+            if (inet_aton(known[i].address, &known_addrs[probe_count].sin_addr) == 0) continue;
+
+            known_addrs[probe_count].sin_port = htons(SERVER_PORT);
+            known_addrs[probe_count].sin_family = AF_INET;
+            probe_count++;
+
+            printf("Probing the known server at IP %s (UID %s).\n", known[i].address, known[i].uid);
+        }
+
+        if (probe_count > 0)
+        {
+            if (client_send_packet_to_many(client_tx_buffer, PAIRING_PACKET_SIZE_BYTES, known_addrs, probe_count) > 0)
+            {
+                client_await_beacon(known, known_count, false);
+            }
+
+            if (is_paired) return;
+
+            printf("No known server answered, looking for servers.\n");
+        }
+    }
+
+    if (!client_send_pairing_packet())
+    {
+        printf("Failed to send pairing packet.\n");
+        sleep(1);
+        return;
+    }
+
+    client_await_beacon(NULL, 0, true);
+}
+
+/**
+ * @brief Prints a single, self-overwriting line of progress counters carried by a progress packet.
+ * This function is static since it is only ever called internally by @ref client_await_response().
+ */
+static void client_print_progress(void)
+{
+    uint32_t selection = packet_selection_get(latest_request_buffer);
+    uint8_t iterations = latest_request_buffer[TEST_PACKET_ITERATIONS_BYTE_OFFSET];
+
+    printf("\rProgress:");
+
+    for (uint8_t i = 0; i < NUM_POSSIBLE_TESTS; i++)
+    {
+        if (selection & ((uint32_t)1 << i))
+        {
+            printf(" | %s %u/%u (%u failed)", test_names[i],
+                    client_rx_buffer[TEST_PACKET_PROGRESS_COUNTERS_OFFSET+(2*i)], iterations,
+                    client_rx_buffer[TEST_PACKET_PROGRESS_COUNTERS_OFFSET+(2*i)+1]);
+        }
+    }
+
+    printf(" |");
+    fflush(stdout);
+}
+
+/**
+ * @brief Prints the failure detail of a single test, as carried by the received results packet.
+ * This function is static since it is only ever called internally by @ref client_await_response().
+ */
+static void client_print_result_details(uint8_t test_index)
+{
+    const uint8_t *detail = client_rx_buffer + TEST_PACKET_RESULTS_DETAIL_OFFSET + (TEST_RESULTS_DETAIL_SIZE_BYTES * test_index);
+    uint32_t bit_errors_net;
+    memcpy(&bit_errors_net, detail + TEST_RESULTS_DETAIL_BIT_ERRORS_OFFSET, sizeof(bit_errors_net));
+
+    printf("    %u of %u iterations failed (%u timeouts, %u data errors, %u bit errors",
+            detail[TEST_RESULTS_DETAIL_FAILED_OFFSET], detail[TEST_RESULTS_DETAIL_DONE_OFFSET],
+            detail[TEST_RESULTS_DETAIL_TIMEOUTS_OFFSET], detail[TEST_RESULTS_DETAIL_DATA_ERRORS_OFFSET],
+            ntohl(bit_errors_net));
+
+    if (detail[TEST_RESULTS_DETAIL_FIRST_ERROR_OFFSET] != TEST_RESULTS_NO_ERROR_OFFSET)
+    {
+        printf(", first at byte %u", detail[TEST_RESULTS_DETAIL_FIRST_ERROR_OFFSET]);
+    }
+
+    printf(").\n");
+}
+
+/**
+ * @brief Prints a sweep step carried by the received sweep packet, and tracks the highest error-free setting of its test.
+ * This function is static since it is only ever called internally by @ref client_await_response().
+ */
+static void client_handle_sweep_step(void)
+{
+    uint8_t test_idx = client_rx_buffer[TEST_PACKET_SWEEP_TEST_OFFSET];
+    uint32_t setting_net;
+    uint32_t throughput_net;
+    uint16_t transfers_net;
+    uint16_t errors_net;
+    uint16_t bus_errors_net;
+    uint16_t nacks_net;
+    uint16_t arb_losses_net;
+
+    if (test_idx >= NUM_POSSIBLE_TESTS) return;
+
+    memcpy(&setting_net, client_rx_buffer+TEST_PACKET_SWEEP_SETTING_OFFSET, sizeof(setting_net));
+    memcpy(&throughput_net, client_rx_buffer+TEST_PACKET_SWEEP_THROUGHPUT_OFFSET, sizeof(throughput_net));
+    memcpy(&transfers_net, client_rx_buffer+TEST_PACKET_SWEEP_TRANSFERS_OFFSET, sizeof(transfers_net));
+    memcpy(&errors_net, client_rx_buffer+TEST_PACKET_SWEEP_ERRORS_OFFSET, sizeof(errors_net));
+    memcpy(&bus_errors_net, client_rx_buffer+TEST_PACKET_SWEEP_BUS_ERRORS_OFFSET, sizeof(bus_errors_net));
+    memcpy(&nacks_net, client_rx_buffer+TEST_PACKET_SWEEP_NACKS_OFFSET, sizeof(nacks_net));
+    memcpy(&arb_losses_net, client_rx_buffer+TEST_PACKET_SWEEP_ARB_LOSSES_OFFSET, sizeof(arb_losses_net));
+
+    uint32_t setting = ntohl(setting_net);
+    uint16_t transfers = ntohs(transfers_net);
+    uint16_t errors = ntohs(errors_net);
+
+    printf("\n%s sweep step %u/%u: setting %u | %u B/s | %u of %u transfers failed | %u bus errors",
+            test_names[test_idx], client_rx_buffer[TEST_PACKET_SWEEP_STEP_OFFSET] + 1, client_rx_buffer[TEST_PACKET_SWEEP_STEP_COUNT_OFFSET],
+            setting, ntohl(throughput_net), errors, transfers, ntohs(bus_errors_net));
+
+    if (test_idx == TESTIDX_I2C)
+    {
+        printf(" | %u NACKs | %u arbitration losses", ntohs(nacks_net), ntohs(arb_losses_net));
+    }
+
+    fflush(stdout);
+
+    if (transfers > 0 && errors == 0 && setting > sweep_best_setting[test_idx])
+    {
+        sweep_best_setting[test_idx] = setting;
+    }
+
+    db_append_sweep_step(client_rx_buffer);
+}
+
+/**
+ * @brief Prints the sample statistics carried by the received noise packet, which follows the sweep step it belongs to.
+ * This function is static since it is only ever called internally by @ref client_await_response().
+ */
+static void client_handle_sweep_noise(void)
+{
+    uint32_t samples_net;
+    uint16_t min_net;
+    uint16_t max_net;
+    uint32_t mean_net;
+    uint32_t stddev_net;
+    uint16_t center_net;
+
+    memcpy(&samples_net, client_rx_buffer+TEST_PACKET_NOISE_SAMPLES_OFFSET, sizeof(samples_net));
+    memcpy(&min_net, client_rx_buffer+TEST_PACKET_NOISE_MIN_OFFSET, sizeof(min_net));
+    memcpy(&max_net, client_rx_buffer+TEST_PACKET_NOISE_MAX_OFFSET, sizeof(max_net));
+    memcpy(&mean_net, client_rx_buffer+TEST_PACKET_NOISE_MEAN_OFFSET, sizeof(mean_net));
+    memcpy(&stddev_net, client_rx_buffer+TEST_PACKET_NOISE_STDDEV_OFFSET, sizeof(stddev_net));
+    memcpy(&center_net, client_rx_buffer+TEST_PACKET_NOISE_CENTER_OFFSET, sizeof(center_net));
+
+    uint32_t mean_milli = ntohl(mean_net);
+    uint32_t stddev_milli = ntohl(stddev_net);
+    int16_t center = ntohs(center_net);
+
+    printf("\n    %u samples | range %u-%u | mean %u.%03u | noise %u.%03u LSB RMS\n    histogram:",
+            ntohl(samples_net), ntohs(min_net), ntohs(max_net),
+            mean_milli / 1000, mean_milli % 1000, stddev_milli / 1000, stddev_milli % 1000);
+
+    for (uint8_t i = 0; i < TEST_PACKET_NOISE_HISTOGRAM_BINS; i++)
+    {
+        uint32_t bin_net;
+        memcpy(&bin_net, client_rx_buffer+TEST_PACKET_NOISE_HISTOGRAM_OFFSET+(i*sizeof(bin_net)), sizeof(bin_net));
+        printf(" [%d] %u", center + i - (TEST_PACKET_NOISE_HISTOGRAM_BINS / 2), ntohl(bin_net));
+    }
+
+    fflush(stdout);
+
+    db_append_sweep_noise(client_rx_buffer);
+}
+
+/**
+ * @brief Prints the capture statistics carried by the received capture packet, which follows the sweep step it belongs to.
+ * This function is static since it is only ever called internally by @ref client_await_response().
+ */
+static void client_handle_sweep_capture(void)
+{
+    uint32_t fields_net[7];
+
+    // the fields are laid out back to back, from EDGES to FREQ ERR PPM
+    memcpy(fields_net, client_rx_buffer+TEST_PACKET_CAPTURE_EDGES_OFFSET, sizeof(fields_net));
+
+    printf("\n    %u periods | duty error %d ps (%d to %d) | duty jitter %u ps | period jitter %u ps | frequency error %d ppm",
+            ntohl(fields_net[0]), (int32_t)ntohl(fields_net[1]), (int32_t)ntohl(fields_net[2]), (int32_t)ntohl(fields_net[3]),
+            ntohl(fields_net[4]), ntohl(fields_net[5]), (int32_t)ntohl(fields_net[6]));
+    fflush(stdout);
+
+    db_append_sweep_capture(client_rx_buffer);
+}
+
+/**
+ * @brief Asks the server to cancel the given test, and waits briefly for its acknowledgement.
+ * This function is static since it is only ever called internally by @ref client_await_response(),
+ * when the user terminates the client while a test is still running.
+ */
+static void client_cancel_test(uint32_t test_id)
+{
+    struct sockaddr_in server_tx_addr = server_rx_addr;
+    socklen_t server_tx_addr_len = sizeof(server_tx_addr);
+
+    printf("\nCancelling test ID %u (0x%08X).\n", test_id, test_id);
+
+    client_fill_test_message_packet(TESTMSG_TEST_CANCEL_REQUEST, ntohl(test_id));
+
+    for (uint8_t attempt = 0; attempt < CANCEL_ACK_ATTEMPTS; attempt++)
+    {
+        if (!client_send_test_message_packet()) continue;
+
+        ssize_t received_bytes = client_receive_packet(&server_tx_addr, &server_tx_addr_len);
+
+        if (received_bytes >= TEST_MSG_PACKET_SIZE_BYTES
+            && client_rx_buffer[0] == TEST_PACKET_START_BYTE_VALUE
+            && client_rx_buffer[TEST_PACKET_MSG_BYTE_OFFSET] == TESTMSG_TEST_CANCEL_ACK
+            && *(uint32_t *)(client_rx_buffer+TEST_PACKET_ID_BYTE_OFFSET) == test_id)
+        {
+            printf("Device acknowledged cancellation, test was %s.\n",
+                    packet_selection_get(client_rx_buffer) ? "running" : "not running");
+            return;
+        }
+    }
+
+    printf("No cancellation acknowledgement received.\n");
+}
+
+bool client_is_paired(void)
+{
+    return is_paired;
+}
+
+/**
+ * @brief Prints the network buffer usage carried by the received telemetry packet.
+ * This function is static since it is only ever called internally by @ref client_request_telemetry().
+ */
+static void client_print_telemetry(void)
+{
+    static const char *pool_names[NUM_TELEMETRY_POOLS] =
+    {
+        "Heap (bytes)", "RX_POOL", "NETBUF", "TCPIP_MSG_INPKT", "TCPIP_MSG_API", "PBUF_POOL",
+    };
+    bool has_stats = client_rx_buffer[TEST_PACKET_TELEMETRY_FLAGS_OFFSET] & TEST_PACKET_TELEMETRY_FLAG_STATS;
+    uint16_t field_net;
+
+    printf("\nServer network buffers%s:\n", has_stats ? "" : " (capacities only, the server was built without statistics)");
+
+    for (uint8_t i = 0; i < NUM_TELEMETRY_POOLS; i++)
+    {
+        const uint8_t *block = client_rx_buffer + TEST_PACKET_TELEMETRY_POOLS_OFFSET + (TEST_TELEMETRY_POOL_SIZE_BYTES * i);
+        uint16_t fields[4];
+
+        for (uint8_t j = 0; j < 4; j++)
+        {
+            memcpy(&field_net, block + (2 * j), sizeof(field_net));
+            fields[j] = ntohs(field_net);
+        }
+
+        printf("    %-16s avail %5u", pool_names[i], fields[TEST_TELEMETRY_POOL_AVAIL_OFFSET / 2]);
+
+        if (has_stats)
+        {
+            printf(", used %5u, peak %5u, failed %5u", fields[TEST_TELEMETRY_POOL_USED_OFFSET / 2],
+                    fields[TEST_TELEMETRY_POOL_MAX_OFFSET / 2], fields[TEST_TELEMETRY_POOL_ERR_OFFSET / 2]);
+        }
+
+        printf("\n");
+    }
+
+    if (has_stats)
+    {
+        uint16_t udp_drops_net;
+        memcpy(&field_net, client_rx_buffer + TEST_PACKET_TELEMETRY_MBOX_ERRORS_OFFSET, sizeof(field_net));
+        memcpy(&udp_drops_net, client_rx_buffer + TEST_PACKET_TELEMETRY_UDP_DROPS_OFFSET, sizeof(udp_drops_net));
+        printf("    Packets dropped on full mailboxes: %u, in UDP: %u.\n", ntohs(field_net), ntohs(udp_drops_net));
+    }
+}
+
+/**
+ * @brief Prints the startup stage times carried by the received boot profile packet.
+ * This function is static since it is only ever called internally by @ref client_request_telemetry().
+ */
+static void client_print_boot_profile(void)
+{
+    static const char *stage_names[NUM_BOOT_STAGES] =
+    {
+        "HAL", "Clock", "Peripherals", "Registry", "Scheduler",
+        "lwIP", "Link up", "Address", "Listener ready", "First request",
+    };
+    bool cached_lease = client_rx_buffer[TEST_PACKET_BOOT_FLAGS_OFFSET] & TEST_PACKET_BOOT_FLAG_CACHED_LEASE;
+    uint32_t field_net;
+
+    printf("\nServer boot profile (time since reset%s):\n", cached_lease ? ", came up on its cached lease" : "");
+
+    for (uint8_t i = 0; i < NUM_BOOT_STAGES; i++)
+    {
+        memcpy(&field_net, client_rx_buffer + TEST_PACKET_BOOT_STAGES_OFFSET + (4 * i), sizeof(field_net));
+        uint32_t stage_us = ntohl(field_net);
+
+        if (stage_us == 0)
+        {
+            printf("    %-16s not reached yet\n", stage_names[i]);
+        }
+        else
+        {
+            printf("    %-16s %10.3f ms\n", stage_names[i], stage_us / 1000.0);
+        }
+    }
+}
+
+/**
+ * @brief Sends a request in a pairing sized packet to the paired server, and waits for the packet it answers with.
+ * This function is static since it is only ever called internally by @ref client_request_telemetry() and @ref client_measure_round_trip().
+ * @param [in] request The message type of the request
+ * @param [in] answer The message type of the expected answer
+ * @param [in] answer_size The size of the expected answer, in bytes
+ * @retval true The answer was received, into the incoming packet buffer
+ * @retval false The request could not be sent, or no answer arrived before the socket timed out
+ */
+static bool client_info_exchange(TestPacketMsg_t request, TestPacketMsg_t answer, ssize_t answer_size)
+{
+    explicit_bzero(client_tx_buffer, PAIRING_PACKET_SIZE_BYTES);
+    client_tx_buffer[0] = TEST_PACKET_START_BYTE_VALUE;
+    client_tx_buffer[TEST_PACKET_MSG_BYTE_OFFSET] = request;
+    client_tx_buffer[TEST_PACKET_ID_BYTE_OFFSET] = TEST_PACKET_END_BYTE_VALUE;
+
+    if (!client_send_packet(client_tx_buffer, PAIRING_PACKET_SIZE_BYTES)) return false;
+
+    while (!should_terminate)
+    {
+        ssize_t received_bytes = client_pop_datagram(client_rx_buffer, sizeof(client_rx_buffer), NULL, NULL);
+
+        if (received_bytes <= 0) return false;
+
+        if (received_bytes >= answer_size && client_rx_buffer[0] == TEST_PACKET_START_BYTE_VALUE
+                && client_rx_buffer[TEST_PACKET_MSG_BYTE_OFFSET] == answer)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool client_request_telemetry(void)
+{
+    if (!client_info_exchange(TESTMSG_TELEMETRY_REQUEST, TESTMSG_TELEMETRY, TEST_TELEMETRY_PACKET_SIZE_BYTES))
+    {
+        printf("No telemetry received.\n");
+        return false;
+    }
+
+    client_print_telemetry();
+
+    if (!client_info_exchange(TESTMSG_BOOT_PROFILE_REQUEST, TESTMSG_BOOT_PROFILE, TEST_BOOT_PROFILE_PACKET_SIZE_BYTES))
+    {
+        printf("No boot profile received.\n");
+        return false;
+    }
+
+    client_print_boot_profile();
+    return true;
+}
+
+bool client_measure_round_trip(uint16_t count)
+{
+    struct timespec start_clock;
+    struct timespec exchange_clock;
+    float min_ms = 0;
+    float max_ms = 0;
+    float sum_ms = 0;
+    uint16_t answered = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start_clock);
+
+    for (uint16_t i = 0; i < count && !should_terminate; i++)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &exchange_clock);
+
+        if (!client_info_exchange(TESTMSG_TELEMETRY_REQUEST, TESTMSG_TELEMETRY, TEST_TELEMETRY_PACKET_SIZE_BYTES)) continue;
+
+        float elapsed_ms = seconds_since_clock(exchange_clock) * 1000;
+
+        min_ms = (answered == 0 || elapsed_ms < min_ms) ? elapsed_ms : min_ms;
+        max_ms = (elapsed_ms > max_ms) ? elapsed_ms : max_ms;
+        sum_ms += elapsed_ms;
+        answered++;
+    }
+
+    float total_secs = seconds_since_clock(start_clock);
+
+    if (answered == 0)
+    {
+        printf("No telemetry received.\n");
+        return false;
+    }
+
+    printf("\nRound trips answered: %u of %u.\n", answered, count);
+    printf("Round trip time (ms): min %.3f, avg %.3f, max %.3f.\n", min_ms, sum_ms / answered, max_ms);
+    printf("Throughput: %.1f requests/s.\n", answered / total_secs);
+    return true;
+}
+
+/**
+ * @brief Returns the FNV-1a hash of a journal record's fields (all but the checksum).
+ */
+static uint32_t client_journal_record_checksum(const uint8_t *record)
+{
+    uint32_t hash = 2166136261UL;
+
+    for (uint32_t i = 0; i < TEST_JOURNAL_RECORD_CHECKSUM_OFFSET; i++)
+    {
+        hash = (hash ^ record[i]) * 16777619UL;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Asks the paired server for its journal records following [since_id].
+ * This function is static since it is only ever called internally by @ref client_resync_journal().
+ */
+static bool client_send_journal_fetch(uint32_t since_id)
+{
+    uint32_t since_id_net = htonl(since_id);
+
+    client_tx_buffer[0] = TEST_PACKET_START_BYTE_VALUE;
+    client_tx_buffer[TEST_PACKET_MSG_BYTE_OFFSET] = TESTMSG_JOURNAL_FETCH_REQUEST;
+    memcpy(client_tx_buffer+TEST_PACKET_JOURNAL_SINCE_OFFSET, &since_id_net, sizeof(since_id_net));
+    client_tx_buffer[TEST_JOURNAL_FETCH_PACKET_SIZE_BYTES-1] = TEST_PACKET_END_BYTE_VALUE;
+
+    return client_send_packet(client_tx_buffer, TEST_JOURNAL_FETCH_PACKET_SIZE_BYTES);
+}
+
+bool client_resync_journal(void)
+{
+    struct timespec start_clock;
+    uint32_t last_id = db_last_journal_record();
+    uint32_t received = 0;
+    uint32_t filed = 0;
+    uint8_t attempts = 1;
+    bool done = false;
+
+    printf("Fetching the server's journal since record %u.\n", last_id);
+    clock_gettime(CLOCK_MONOTONIC, &start_clock);
+
+    if (!client_send_journal_fetch(last_id)) return false;
 
-    printf("Awaiting a server beacon.\n");
+    db_begin();
 
-    while (!should_terminate && !is_paired)
+    while (!done && !should_terminate)
     {
-        ssize_t received_bytes = recvfrom(sockfd, client_rx_buffer, sizeof(client_rx_buffer), 0, (struct sockaddr*)&new_server_addr, &new_server_addr_len);
-
+        ssize_t received_bytes = client_pop_datagram(client_rx_buffer, sizeof(client_rx_buffer), NULL, NULL);
 
         if (received_bytes <= 0)
         {
-            int err = errno;
-            if (err == ETIMEDOUT || err == EAGAIN || err == EWOULDBLOCK)
-            {
-                client_send_pairing_packet();
-            }
-            else perror("Receiving failed");
+            // lost the end of a burst (or the request itself), so asking again from the last record filed
+            if (attempts++ >= JOURNAL_FETCH_ATTEMPTS || !client_send_journal_fetch(last_id)) break;
             continue;
         }
 
-        printf("Received packet of size %ld.\n", received_bytes);
-
-        if(new_server_addr.sin_port == CLIENT_PORT)
+        if (received_bytes < TEST_PACKET_JOURNAL_RECORDS_OFFSET+1 || client_rx_buffer[0] != TEST_PACKET_START_BYTE_VALUE
+                || client_rx_buffer[TEST_PACKET_MSG_BYTE_OFFSET] != TESTMSG_JOURNAL_RECORDS)
         {
-            // most likely our broadcast
             continue;
         }
-        else if (received_bytes == 3 && client_rx_buffer[0] == TEST_PACKET_START_BYTE_VALUE
-                && client_rx_buffer[TEST_PACKET_MSG_BYTE_OFFSET] == TESTMSG_PAIRING_BEACON
-                && client_rx_buffer[TEST_PACKET_ID_BYTE_OFFSET] == TEST_PACKET_END_BYTE_VALUE)
+
+        uint8_t flags = client_rx_buffer[TEST_PACKET_JOURNAL_FLAGS_OFFSET];
+        uint8_t count = client_rx_buffer[TEST_PACKET_JOURNAL_COUNT_OFFSET];
+        uint32_t after_id_net;
+        memcpy(&after_id_net, client_rx_buffer+TEST_PACKET_JOURNAL_AFTER_ID_OFFSET, sizeof(after_id_net));
+
+        // a packet following a lost (or corrupt) one is skipped, and the rest of the burst with it
+        if (ntohl(after_id_net) == last_id
+                && received_bytes >= TEST_PACKET_JOURNAL_RECORDS_OFFSET + (count * TEST_JOURNAL_RECORD_SIZE_BYTES) + 1)
         {
-                server_rx_addr = new_server_addr;
-                server_rx_addr.sin_port = htons(SERVER_PORT);
-                server_rx_addr_len = new_server_addr_len;
-                printf("Paired with server at IP %s !\n", inet_ntoa(server_rx_addr.sin_addr));
-                is_paired = true;
+            uint8_t i;
+
+            for (i = 0; i < count; i++)
+            {
+                const uint8_t *record = client_rx_buffer + TEST_PACKET_JOURNAL_RECORDS_OFFSET + (i * TEST_JOURNAL_RECORD_SIZE_BYTES);
+                uint32_t field_net;
+
+                memcpy(&field_net, record+TEST_JOURNAL_RECORD_CHECKSUM_OFFSET, sizeof(field_net));
+
+                if (ntohl(field_net) != client_journal_record_checksum(record))
+                {
+                    printf("Journal record following %u is corrupt.\n", last_id);
+                    break;
+                }
+
+                memcpy(&field_net, record+TEST_JOURNAL_RECORD_ID_OFFSET, sizeof(field_net));
+                last_id = ntohl(field_net);
+                received++;
+
+                if (db_append_journal_record(record)) filed++;
+            }
+
+            attempts = 1;
+            done = (i == count) && !(flags & TEST_PACKET_JOURNAL_FLAG_MORE);
         }
-        else
+
+        if (!done && (flags & TEST_PACKET_JOURNAL_FLAG_BURST_END))
         {
-            printf("Received unexpected packet.\n");
-            break;
+            if (!client_send_journal_fetch(last_id)) break;
         }
     }
-}
 
-bool client_is_paired(void)
-{
-    return is_paired;
+    db_commit();
+
+    float total_secs = seconds_since_clock(start_clock);
+
+    printf("\nJournal records received: %u (%u new), up to record %u, in %.3f s (%.1f records/s).\n",
+        received, filed, last_id, total_secs, received / total_secs);
+
+    if (!done) printf("The journal could not be fetched in full.\n");
+
+    return done;
 }
 
 bool client_send_test_message_packet(void)
@@ -145,20 +981,22 @@ void client_save_test_request(void)
     clock_gettime(CLOCK_MONOTONIC, &latest_request_clock);
     explicit_bzero(latest_request_buffer, sizeof(latest_request_buffer));
     memcpy(latest_request_buffer, client_tx_buffer, sizeof(client_tx_buffer));
+    memset(sweep_best_setting, 0, sizeof(sweep_best_setting));
 }
 
-void client_await_response(void)
+uint16_t client_await_response(void)
 {
     struct sockaddr_in server_tx_addr = server_rx_addr;
     socklen_t server_tx_addr_len = sizeof(server_tx_addr);
     bool request_acknowledged = false;
     bool test_over = false;
+    uint16_t retry_after_ms = 0;
 
     uint8_t ack_timeout_counter = 0;
 
     while (!should_terminate && !test_over)
     {
-        ssize_t received_bytes = recvfrom(sockfd, client_rx_buffer, sizeof(client_rx_buffer)-1, 0, (struct sockaddr*)&server_tx_addr, &server_tx_addr_len);
+        ssize_t received_bytes = client_receive_packet(&server_tx_addr, &server_tx_addr_len);
 
         if (received_bytes <= 0)
         {
@@ -204,7 +1042,7 @@ void client_await_response(void)
                     *(uint32_t *)(latest_request_buffer+TEST_PACKET_ID_BYTE_OFFSET) = received_id_full;
                     db_append_request(latest_request_buffer);
 
-                    if (client_rx_buffer[TEST_PACKET_SELECTION_BYTE_OFFSET] == 0)
+                    if (packet_selection_get(client_rx_buffer) == 0)
                     {
                         printf("Device REJECTED test request, updated Test ID: %u (0x%08X).\n", received_id_full, received_id_full);
                         test_over = true;
@@ -214,6 +1052,24 @@ void client_await_response(void)
                     printf("Device acknowledged test request, updated Test ID: %u (0x%08X).\n", received_id_full, received_id_full);
                 }
                 break;
+            case TESTMSG_TEST_NEW_BUSY:
+                if (request_acknowledged || received_bytes < TEST_BUSY_PACKET_SIZE_BYTES)
+                {
+                    break;
+                }
+                else if (stored_id_client != received_id_client)
+                {
+                    printf("Wrong client-half of test ID in received 'busy' packet.\n");
+                }
+                else
+                {
+                    retry_after_ms = ntohs(*(uint16_t *)(client_rx_buffer+TEST_PACKET_BUSY_RETRY_AFTER_OFFSET));
+                    if (retry_after_ms == 0) retry_after_ms = BUSY_BACKOFF_BASE_MS;
+                    printf("Device BUSY with %u queued requests, asked to retry after %u ms.\n",
+                            client_rx_buffer[TEST_PACKET_BUSY_QUEUE_DEPTH_OFFSET], retry_after_ms);
+                    test_over = true;
+                }
+                break;
             case TESTMSG_TEST_START_ACK:
                 if (!request_acknowledged && (received_id_client == stored_id_client))
                 {
@@ -231,6 +1087,32 @@ void client_await_response(void)
                     printf("Device acknowledged test ID %u (0x%08X) started.\n", received_id_full, received_id_full);
                 }
                 break;
+            case TESTMSG_TEST_PROGRESS:
+                if (stored_id_full == received_id_full && received_bytes >= TEST_PROGRESS_PACKET_SIZE_BYTES)
+                {
+                    client_print_progress();
+                }
+                break;
+            case TESTMSG_TEST_CANCEL_ACK:
+                break;
+            case TESTMSG_TEST_SWEEP_STEP:
+                if (stored_id_full == received_id_full && received_bytes >= TEST_SWEEP_PACKET_SIZE_BYTES)
+                {
+                    client_handle_sweep_step();
+                }
+                break;
+            case TESTMSG_TEST_SWEEP_NOISE:
+                if (stored_id_full == received_id_full && received_bytes >= TEST_NOISE_PACKET_SIZE_BYTES)
+                {
+                    client_handle_sweep_noise();
+                }
+                break;
+            case TESTMSG_TEST_SWEEP_CAPTURE:
+                if (stored_id_full == received_id_full && received_bytes >= TEST_CAPTURE_PACKET_SIZE_BYTES)
+                {
+                    client_handle_sweep_capture();
+                }
+                break;
             case TESTMSG_TEST_OVER_RESULTS:
                 if (!request_acknowledged && (received_id_client == stored_id_client))
                 {
@@ -248,18 +1130,19 @@ void client_await_response(void)
                     test_over = true;
                     float duration = seconds_since_clock(latest_request_clock);
 
-                    printf("Received test results for test ID %u (0x%08X).\n", received_id_full, received_id_full);
+                    printf("\nReceived test results for test ID %u (0x%08X).\n", received_id_full, received_id_full);
 
-                    uint8_t selection_byte = latest_request_buffer[TEST_PACKET_SELECTION_BYTE_OFFSET];
-                    uint8_t results_byte = client_rx_buffer[TEST_PACKET_SELECTION_BYTE_OFFSET];
+                    uint32_t selection = packet_selection_get(latest_request_buffer);
+                    uint32_t results = packet_selection_get(client_rx_buffer);
+                    bool has_details = received_bytes >= TEST_RESULTS_PACKET_SIZE_BYTES;
 
                     for (uint8_t i = 0; i < NUM_POSSIBLE_TESTS; i++)
                     {
-                        if (0x01 & (selection_byte >> (uint8_t)i))
+                        if (selection & ((uint32_t)1 << i))
                         {
                             printf("%s Test ", test_names[i]);
 
-                            if (0x01 & (results_byte >> (uint8_t)i))
+                            if (results & ((uint32_t)1 << i))
                             {
                                 printf("Passed.\n");
                             }
@@ -267,9 +1150,27 @@ void client_await_response(void)
                             {
                                 printf("Failed.\n");
                             }
+
+                            if (has_details)
+                            {
+                                client_print_result_details(i);
+                            }
+
+                            if (latest_request_buffer[TEST_PACKET_FLAGS_BYTE_OFFSET] & TEST_PACKET_FLAG_SWEEP)
+                            {
+                                if (sweep_best_setting[i] > 0)
+                                {
+                                    printf("    Highest error-free sweep setting: %u.\n", sweep_best_setting[i]);
+                                }
+                            }
                         }
                     }
                     db_append_results(client_rx_buffer, latest_request_buffer, duration);
+
+                    if (has_details)
+                    {
+                        db_append_result_details(client_rx_buffer, latest_request_buffer);
+                    }
                 }
                 break;
             case TESTMSG_FLAG_CLIENT:
@@ -277,6 +1178,7 @@ void client_await_response(void)
             case TESTMSG_TEST_NEW_REQUEST:
             case TESTMSG_TEST_START_REQUEST:
             case TESTMSG_TEST_OVER_ACK:
+            case TESTMSG_TEST_CANCEL_REQUEST:
             case TESTMSG_PAIRING_PROBE:
             case TESTMSG_PAIRING_BEACON:
             default:
@@ -289,17 +1191,404 @@ void client_await_response(void)
             printf("Received invalid packet.\n");
         }
     }
+
+    // leave the board free for other requests rather than running on unattended
+    if (should_terminate && request_acknowledged && !test_over)
+    {
+        client_cancel_test(*(uint32_t *)(latest_request_buffer+TEST_PACKET_ID_BYTE_OFFSET));
+    }
+
+    return retry_after_ms;
+}
+
+void client_backoff_sleep(uint16_t retry_after_ms, uint8_t attempt)
+{
+    uint32_t delay_ms = BUSY_BACKOFF_BASE_MS << (attempt < 8 ? attempt : 8);
+
+    if (delay_ms < retry_after_ms) delay_ms = retry_after_ms;
+    if (delay_ms > BUSY_BACKOFF_MAX_MS) delay_ms = BUSY_BACKOFF_MAX_MS;
+
+    // jitter upwards by up to half the delay, never retrying earlier than the server asked
+    delay_ms += rand() % (delay_ms / 2 + 1);
+
+    printf("Retrying in %u ms (attempt %u).\n", delay_ms, attempt);
+
+    // sleep in short slices to stay responsive to termination signals
+    for (uint32_t slept_ms = 0; slept_ms < delay_ms && !should_terminate; slept_ms += BUSY_BACKOFF_SLICE_MS)
+    {
+        usleep(BUSY_BACKOFF_SLICE_MS * 1000);
+    }
+}
+
+/**
+ * @brief The state shared with the benchmark's sender thread.
+ */
+typedef struct BenchmarkSender
+{
+    /// @brief Results packets to send per second, for @ref BENCHMARK_STEP_SECS.
+    uint32_t rate;
+    /// @brief Count of packets sent, and whether the sender is done.
+    uint64_t sent;
+    atomic_bool done;
+    /// @brief Seconds the sending took, which is longer than the step if the sender could not keep up.
+    float seconds;
+} BenchmarkSender_t;
+
+/**
+ * @brief Operation of the benchmark's sender thread, sending synthetic results packets to the client's own port
+ * over the loopback interface, paced at the step's rate.
+ */
+static void *client_benchmark_sender_thread(void *argument)
+{
+    BenchmarkSender_t *sender = argument;
+    uint8_t packet[TEST_RESULTS_PACKET_SIZE_BYTES] = {0};
+    uint64_t total = (uint64_t)sender->rate * BENCHMARK_STEP_SECS;
+    struct sockaddr_in client_addr = {0};
+    struct timespec start_clock;
+    int sender_fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    client_addr.sin_family = AF_INET;
+    client_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    client_addr.sin_port = htons(client_port);
+
+    packet[0] = TEST_PACKET_START_BYTE_VALUE;
+    packet[TEST_PACKET_MSG_BYTE_OFFSET] = TESTMSG_TEST_OVER_RESULTS;
+    packet_selection_set(packet, 1);
+    packet[TEST_RESULTS_PACKET_SIZE_BYTES-1] = TEST_PACKET_END_BYTE_VALUE;
+
+    clock_gettime(CLOCK_MONOTONIC, &start_clock);
+
+    while (sender_fd >= 0 && sender->sent < total && !should_terminate)
+    {
+        uint64_t due = (uint64_t)(seconds_since_clock(start_clock) * sender->rate) + 1;
+
+        while (sender->sent < due && sender->sent < total)
+        {
+            uint32_t test_id = (uint32_t)sender->sent;
+            memcpy(packet+TEST_PACKET_ID_BYTE_OFFSET, &test_id, sizeof(test_id));
+
+            if (sendto(sender_fd, packet, sizeof(packet), 0, (struct sockaddr*)&client_addr, sizeof(client_addr)) > 0)
+            {
+                sender->sent++;
+            }
+        }
+
+        usleep(100);
+    }
+
+    sender->seconds = seconds_since_clock(start_clock);
+    if (sender_fd >= 0) close(sender_fd);
+    atomic_store(&sender->done, true);
+
+    return NULL;
+}
+
+bool client_benchmark_pipeline(void)
+{
+    static const char test_string[] = "benchmark";
+    uint8_t request[TEST_REQUEST_PACKET_MAX_SIZE_BYTES+1] = {0};
+    uint32_t sustained_rate = 0;
+
+    request[0] = TEST_PACKET_START_BYTE_VALUE;
+    request[TEST_PACKET_MSG_BYTE_OFFSET] = TESTMSG_TEST_NEW_REQUEST;
+    request[TEST_PACKET_ITERATIONS_BYTE_OFFSET] = 1;
+    request[TEST_PACKET_STRING_LEN_OFFSET] = sizeof(test_string) - 1;
+    memcpy(request+TEST_PACKET_STRING_HEAD_OFFSET, test_string, sizeof(test_string) - 1);
+    packet_selection_set(request, 1);
+
+    printf("\nSending results packets over loopback at doubling rates, for %u s each, and filing them into %s.\n",
+        BENCHMARK_STEP_SECS, BENCHMARK_DB_PATH);
+    printf("%10s %10s %10s %10s %10s %10s %12s %10s\n", "rate/s", "sent/s", "handled", "kernel", "queue", "filed", "filed/s", "per recv");
+
+    for (uint32_t rate = BENCHMARK_START_RATE; rate <= BENCHMARK_MAX_RATE && !should_terminate; rate *= 2)
+    {
+        BenchmarkSender_t sender = { .rate = rate };
+        pthread_t sender_thread;
+        struct timespec start_clock;
+        uint64_t handled = 0;
+        uint64_t kernel_drops_before = atomic_load(&rx_kernel_drops);
+        uint64_t queue_drops_before = atomic_load(&rx_queue_drops);
+        uint64_t received_before = atomic_load(&rx_received);
+        uint64_t calls_before = atomic_load(&rx_calls);
+        size_t filed_before = db_written_count();
+
+        atomic_init(&sender.done, false);
+        clock_gettime(CLOCK_MONOTONIC, &start_clock);
+
+        if (pthread_create(&sender_thread, NULL, client_benchmark_sender_thread, &sender) != 0)
+        {
+            printf("Starting the sender thread failed.\n");
+            return false;
+        }
+
+        // the protocol thread's share of the work: taking each results packet and queueing its writes
+        while (!should_terminate)
+        {
+            ClientDatagram_t *datagram = spsc_queue_peek(&rx_queue, BENCHMARK_DRAIN_MS);
+
+            if (datagram == NULL)
+            {
+                if (atomic_load(&sender.done)) break;
+                continue;
+            }
+
+            if (datagram->size >= TEST_RESULTS_PACKET_SIZE_BYTES
+                && datagram->data[TEST_PACKET_MSG_BYTE_OFFSET] == TESTMSG_TEST_OVER_RESULTS)
+            {
+                db_append_results(datagram->data, request, 0);
+                db_append_result_details(datagram->data, request);
+                handled++;
+            }
+
+            spsc_queue_release(&rx_queue);
+        }
+
+        pthread_join(sender_thread, NULL);
+        db_flush();
+
+        float total_secs = seconds_since_clock(start_clock);
+        uint64_t kernel_drops = atomic_load(&rx_kernel_drops) - kernel_drops_before;
+        uint64_t queue_drops = atomic_load(&rx_queue_drops) - queue_drops_before;
+        size_t filed = (db_written_count() - filed_before) / 2;
+        uint64_t calls = atomic_load(&rx_calls) - calls_before;
+        // datagrams taken per recvmmsg call
+        float per_call = (calls > 0) ? (float)(atomic_load(&rx_received) - received_before) / calls : 0;
+
+        printf("%10u %10.0f %10lu %10lu %10lu %10zu %12.0f %10.1f\n", rate, sender.sent / sender.seconds,
+            handled, kernel_drops, queue_drops, filed, filed / total_secs, per_call);
+
+        if (handled < sender.sent) break;
+
+        sustained_rate = rate;
+    }
+
+    if (sustained_rate == 0)
+    {
+        printf("Results were dropped at every rate.\n");
+        return false;
+    }
+
+    printf("Sustained %u results/s with no drops.\n", sustained_rate);
+    return true;
+}
+
+/**
+ * @brief Sends [count] copies of a packet from [fd] to [destination], one sendto() per datagram,
+ * or in batches of @ref SEND_BATCH_DATAGRAMS with sendmmsg.
+ * @param [out] calls Incremented by the system calls made
+ * @return The count of datagrams sent
+ */
+static uint64_t client_benchmark_send(int fd, const struct sockaddr_in *destination, uint8_t *packet, size_t length,
+    uint64_t count, bool batched, uint64_t *calls)
+{
+    struct iovec iovec = { .iov_base = packet, .iov_len = length };
+    struct mmsghdr messages[SEND_BATCH_DATAGRAMS] = {0};
+    uint64_t sent = 0;
+
+    for (int i = 0; i < SEND_BATCH_DATAGRAMS; i++)
+    {
+        messages[i].msg_hdr.msg_iov = &iovec;
+        messages[i].msg_hdr.msg_iovlen = 1;
+        messages[i].msg_hdr.msg_name = (void *)destination;
+        messages[i].msg_hdr.msg_namelen = sizeof(*destination);
+    }
+
+    while (sent < count && !should_terminate)
+    {
+        int ret;
+
+        if (batched)
+        {
+            int batch_count = ((count - sent) < SEND_BATCH_DATAGRAMS) ? (int)(count - sent) : SEND_BATCH_DATAGRAMS;
+            ret = sendmmsg(fd, messages, batch_count, 0);
+        }
+        else
+        {
+            ret = (sendto(fd, packet, length, 0, (struct sockaddr*)destination, sizeof(*destination)) > 0) ? 1 : -1;
+        }
+
+        (*calls)++;
+
+        if (ret <= 0) break;
+
+        sent += ret;
+    }
+
+    return sent;
+}
+
+/**
+ * @brief Receives every datagram queued on [fd] without blocking, one recvfrom() per datagram,
+ * or in batches of @ref RECEIVER_BATCH_DATAGRAMS with recvmmsg, as the receiver thread does.
+ * @param [out] calls Incremented by the system calls made, including the last, which finds the socket empty
+ * @return The count of datagrams received
+ */
+static uint64_t client_benchmark_drain(int fd, bool batched, uint64_t *calls)
+{
+    static uint8_t buffers[RECEIVER_BATCH_DATAGRAMS][CLIENT_RX_BUFFER_SIZE];
+    static struct sockaddr_in addrs[RECEIVER_BATCH_DATAGRAMS];
+    static struct iovec iovecs[RECEIVER_BATCH_DATAGRAMS];
+    static struct mmsghdr messages[RECEIVER_BATCH_DATAGRAMS];
+    uint64_t received = 0;
+
+    for (int i = 0; i < RECEIVER_BATCH_DATAGRAMS; i++)
+    {
+        iovecs[i].iov_base = buffers[i];
+        iovecs[i].iov_len = sizeof(buffers[i]);
+        messages[i].msg_hdr.msg_iov = &iovecs[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+        messages[i].msg_hdr.msg_name = &addrs[i];
+    }
+
+    for (;;)
+    {
+        int ret;
+
+        if (batched)
+        {
+            for (int i = 0; i < RECEIVER_BATCH_DATAGRAMS; i++) messages[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+
+            ret = recvmmsg(fd, messages, RECEIVER_BATCH_DATAGRAMS, MSG_DONTWAIT, NULL);
+        }
+        else
+        {
+            socklen_t addr_len = sizeof(addrs[0]);
+            ret = (recvfrom(fd, buffers[0], sizeof(buffers[0]), MSG_DONTWAIT, (struct sockaddr*)&addrs[0], &addr_len) > 0) ? 1 : -1;
+        }
+
+        (*calls)++;
+
+        if (ret <= 0) break;
+
+        received += ret;
+    }
+
+    return received;
+}
+
+bool client_benchmark_socket_io(void)
+{
+    static const char *const paths[] = { "sendto", "sendmmsg", "recvfrom", "recvmmsg" };
+    uint8_t packet[TEST_RESULTS_PACKET_SIZE_BYTES] = {0};
+    struct sockaddr_in sink_addr = {0};
+    socklen_t sink_addr_len = sizeof(sink_addr);
+    float rates[4] = {0};
+    int source_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    int sink_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    bool ok = false;
+
+    sink_addr.sin_family = AF_INET;
+    sink_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (source_fd < 0 || sink_fd < 0 || bind(sink_fd, (struct sockaddr*)&sink_addr, sizeof(sink_addr)) < 0
+        || getsockname(sink_fd, (struct sockaddr*)&sink_addr, &sink_addr_len) < 0)
+    {
+        perror("Setting up the benchmark sockets failed");
+        goto cleanup;
+    }
+
+    packet[0] = TEST_PACKET_START_BYTE_VALUE;
+    packet[TEST_PACKET_MSG_BYTE_OFFSET] = TESTMSG_TEST_OVER_RESULTS;
+    packet[TEST_RESULTS_PACKET_SIZE_BYTES-1] = TEST_PACKET_END_BYTE_VALUE;
+
+    printf("\nSending and receiving %u results packets over loopback, one datagram per system call, then in batches.\n",
+        SOCKET_BENCHMARK_DATAGRAMS);
+    printf("%10s %12s %12s %14s %12s\n", "path", "datagrams", "calls", "datagrams/s", "calls/dgram");
+
+    for (int path = 0; path < 4 && !should_terminate; path++)
+    {
+        bool batched = (path % 2) == 1;
+        uint64_t datagrams = 0;
+        uint64_t calls = 0;
+        float seconds = 0;
+
+        if (path < 2)
+        {
+            // the sink is never read, so most datagrams are dropped by the kernel, past the send path measured
+            struct timespec start_clock;
+            clock_gettime(CLOCK_MONOTONIC, &start_clock);
+            datagrams = client_benchmark_send(source_fd, &sink_addr, packet, sizeof(packet), SOCKET_BENCHMARK_DATAGRAMS, batched, &calls);
+            seconds = seconds_since_clock(start_clock);
+        }
+        else
+        {
+            uint64_t send_calls = 0;
+            client_benchmark_drain(sink_fd, true, &send_calls);
+
+            // in rounds that fit the socket buffer, only the draining of which is timed
+            while (datagrams < SOCKET_BENCHMARK_DATAGRAMS && !should_terminate)
+            {
+                struct timespec start_clock;
+                client_benchmark_send(source_fd, &sink_addr, packet, sizeof(packet), SOCKET_BENCHMARK_ROUND, true, &send_calls);
+                clock_gettime(CLOCK_MONOTONIC, &start_clock);
+                uint64_t round = client_benchmark_drain(sink_fd, batched, &calls);
+                seconds += seconds_since_clock(start_clock);
+
+                if (round == 0) break;
+
+                datagrams += round;
+            }
+        }
+
+        rates[path] = (seconds > 0) ? datagrams / seconds : 0;
+        printf("%10s %12lu %12lu %14.0f %12.2f\n", paths[path], datagrams, calls, rates[path],
+            (datagrams > 0) ? (float)calls / datagrams : 0);
+    }
+
+    if (rates[0] > 0 && rates[2] > 0)
+    {
+        printf("Batching sends %.1fx and receives %.1fx as many datagrams per second.\n", rates[1] / rates[0], rates[3] / rates[2]);
+        ok = true;
+    }
+
+cleanup:
+    if (source_fd >= 0) close(source_fd);
+    if (sink_fd >= 0) close(sink_fd);
+    return ok;
+}
+
+bool client_set_options(const char *port, const char *server_address)
+{
+    if (port != NULL)
+    {
+        char *end = NULL;
+        long value = strtol(port, &end, 10);
+
+        if (end == port || *end != '\0' || value < 0 || value > UINT16_MAX)
+        {
+            printf("Invalid client port: %s\n", port);
+            return false;
+        }
+
+        client_port = (uint16_t)value;
+    }
+
+    if (server_address != NULL)
+    {
+        if (inet_aton(server_address, &fixed_server_addr) == 0)
+        {
+            printf("Invalid server address: %s\n", server_address);
+            return false;
+        }
+
+        is_server_fixed = true;
+    }
+
+    return true;
 }
 
 void client_init(void)
 {
+    // only the receiver thread waits on the socket, and wakes up this often to see whether it should stop
     static const struct timeval timeout =
     {
-        .tv_sec = SOCKET_TIMEOUT_SEC,
-        .tv_usec = 0,
+        .tv_sec = 0,
+        .tv_usec = RECEIVER_POLL_MS * 1000,
     };
     static const int one = 1;
 
+    srand(time(NULL) ^ getpid());
+
     if ((sockfd = socket(AF_INET, SOCK_DGRAM, 0)) < 0)
     {
         perror("Socket creation failed");
@@ -307,8 +1596,9 @@ void client_init(void)
     }
 
     struct sockaddr_in bound_addr = {0};
+    socklen_t bound_addr_len = sizeof(bound_addr);
     bound_addr.sin_addr.s_addr = INADDR_ANY;
-    bound_addr.sin_port = htons(CLIENT_PORT);
+    bound_addr.sin_port = htons(client_port);
 
     if (bind(sockfd, &bound_addr, sizeof(bound_addr)) < 0)
     {
@@ -316,7 +1606,14 @@ void client_init(void)
         close(sockfd);
         exit(EXIT_FAILURE);
     }
-    
+
+    // servers answer the port requests come from, so any will do
+    if (getsockname(sockfd, (struct sockaddr*)&bound_addr, &bound_addr_len) == 0)
+    {
+        client_port = ntohs(bound_addr.sin_port);
+        printf("Client bound to port %u.\n", client_port);
+    }
+
     if (setsockopt (sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout) < 0)
     {
         perror("Setting socket timeout failed");
@@ -330,11 +1627,40 @@ void client_init(void)
         close(sockfd);
         exit(EXIT_FAILURE);
     }
+
+    if(setsockopt(sockfd, SOL_SOCKET, SO_RXQ_OVFL, &one, sizeof(one)) < 0)
+    {
+        perror("Setting socket drop counting failed");
+    }
+
+    if (!spsc_queue_init(&rx_queue, sizeof(ClientDatagram_t), RECEIVER_QUEUE_SLOTS))
+    {
+        printf("Allocating the receive queue failed.\n");
+        close(sockfd);
+        exit(EXIT_FAILURE);
+    }
+
+    atomic_store(&receiver_running, true);
+
+    if (pthread_create(&receiver_thread, NULL, client_receiver_thread, NULL) != 0)
+    {
+        printf("Starting the receiver thread failed.\n");
+        close(sockfd);
+        exit(EXIT_FAILURE);
+    }
 }
 
 void client_deinit(void)
 {
+    if (atomic_load(&receiver_running))
+    {
+        atomic_store(&receiver_running, false);
+        pthread_join(receiver_thread, NULL);
+        spsc_queue_deinit(&rx_queue);
+    }
+
     if (sockfd > 0) close(sockfd);
+    sockfd = 0;
 }
 
 void client_fill_pairing_packet(void)
@@ -351,18 +1677,19 @@ void client_fill_test_message_packet(TestPacketMsg_t msg, uint32_t test_id)
     client_tx_buffer[0] = TEST_PACKET_START_BYTE_VALUE;
     client_tx_buffer[TEST_PACKET_MSG_BYTE_OFFSET] = msg;
     *(uint32_t *)(client_tx_buffer+TEST_PACKET_ID_BYTE_OFFSET) = htonl(test_id);
-    client_tx_buffer[TEST_PACKET_SELECTION_BYTE_OFFSET] = 0;
+    packet_selection_set(client_tx_buffer, 0);
     client_tx_buffer[TEST_PACKET_ITERATIONS_BYTE_OFFSET] = TEST_PACKET_END_BYTE_VALUE;
 }
 
-void client_fill_test_request_packet(TestPacketMsg_t msg, uint16_t client_test_id, uint8_t test_selection, uint8_t iterations, uint8_t str_len, char *str_ptr)
+void client_fill_test_request_packet(TestPacketMsg_t msg, uint16_t client_test_id, uint32_t test_selection, uint8_t iterations, uint8_t flags, uint8_t str_len, char *str_ptr)
 {
     explicit_bzero(client_tx_buffer, TEST_REQUEST_PACKET_MAX_SIZE_BYTES);
     client_tx_buffer[0] = TEST_PACKET_START_BYTE_VALUE;
     client_tx_buffer[TEST_PACKET_MSG_BYTE_OFFSET] = msg;
     *(uint16_t *)(client_tx_buffer+TEST_PACKET_ID_BYTE_OFFSET+2) = htons(client_test_id);
-    client_tx_buffer[TEST_PACKET_SELECTION_BYTE_OFFSET] = test_selection;
+    packet_selection_set(client_tx_buffer, test_selection);
     client_tx_buffer[TEST_PACKET_ITERATIONS_BYTE_OFFSET] = iterations;
+    client_tx_buffer[TEST_PACKET_FLAGS_BYTE_OFFSET] = flags;
 
     if (str_len > 0 && str_ptr != NULL)
     {
@@ -7,7 +7,19 @@
 #define CLIENT_H
 
 /**
- * @brief Initializes a singular socket for the test client and binds it to the pre-determined client port.
+ * @brief Sets the port the client binds to and the server it pairs with, from the command line. Called before @ref client_init().
+ * @details
+ * Servers answer requests at the port they come from, so several clients may run on the same host,
+ * each bound to its own port (or to one picked by the OS), and each given one of the servers to share them out.
+ * @param [in] port The port to bind to, 0 for one picked by the OS, or NULL for @ref CLIENT_PORT
+ * @param [in] server_address The IPv4 address of the only server to pair with, or NULL to pair with any
+ * @retval true The options were valid
+ * @retval false An option was malformed
+ */
+bool client_set_options(const char *port, const char *server_address);
+/**
+ * @brief Initializes a singular socket for the test client and binds it to the client port
+ * (@ref CLIENT_PORT, unless set otherwise by @ref client_set_options()).
  */
 void client_init(void);
 /**
@@ -25,7 +37,7 @@ void client_fill_test_message_packet(TestPacketMsg_t msg, uint32_t test_id);
 /**
  * @brief Prepares a test request packet in the outgoing packet buffer.
  */
-void client_fill_test_request_packet(TestPacketMsg_t msg, uint16_t client_test_id, uint8_t test_selection, uint8_t iterations, uint8_t str_len, char *str_ptr);
+void client_fill_test_request_packet(TestPacketMsg_t msg, uint16_t client_test_id, uint32_t test_selection, uint8_t iterations, uint8_t flags, uint8_t str_len, char *str_ptr);
 /**
  * @brief Attempts to pair with a compatible testing server.
  */
@@ -34,6 +46,51 @@ void client_try_pairing(void);
  * @brief Returns whether the client has already been paired with a testing server.
  */
 bool client_is_paired(void);
+/**
+ * @brief Requests the paired server's network buffer usage and boot profile, and prints the telemetry it answers with.
+ * @retval true Telemetry and boot profile were received
+ * @retval false A request could not be sent, or no answer arrived before the socket timed out
+ */
+bool client_request_telemetry(void);
+/**
+ * @brief Sends telemetry requests to the paired server one after the other, timing each round trip,
+ * and prints the round trip times and the rate requests were answered at.
+ * @param [in] count The count of requests to send
+ * @retval true At least one request was answered
+ * @retval false No request was answered
+ */
+bool client_measure_round_trip(uint16_t count);
+/**
+ * @brief Fetches the paired server's journal records past the last one filed, and files them along with
+ * the results they hold that were missed (e.g. while the client was away).
+ * @details
+ * The server answers in bursts of packets. A lost or corrupt packet is noticed by the record ID it follows,
+ * and the rest is fetched again from the last record filed, once the burst is over.
+ * @retval true The journal was fetched in full
+ * @retval false A request could not be sent, or the server stopped answering
+ */
+bool client_resync_journal(void);
+/**
+ * @brief Measures the rate of results the client sustains with no drops, end to end (receiver thread, protocol thread
+ * and DB writer thread), by sending itself synthetic results packets over the loopback interface at doubling rates.
+ * @details
+ * Meant to be run on its own, with the DB opened at @ref BENCHMARK_DB_PATH, which the results are filed into.
+ * Prints the packets handled and dropped (by the kernel, on a full socket buffer, or on the full receive queue)
+ * and the rows filed at each rate.
+ * @retval true Some rate was sustained with no drops
+ * @retval false Results were dropped at every rate, or the sender could not be started
+ */
+bool client_benchmark_pipeline(void);
+/**
+ * @brief Measures the socket I/O paths alone, on a pair of sockets of its own over the loopback interface:
+ * sending and receiving results packets with one system call per datagram (sendto, recvfrom),
+ * then in batches (sendmmsg, recvmmsg), as the client does when fanning out probes and receiving.
+ * @details
+ * Prints the datagrams per second and the system calls per datagram of each path.
+ * @retval true Every path was measured
+ * @retval false The sockets could not be set up
+ */
+bool client_benchmark_socket_io(void);
 /**
  * @brief Sends a portion of the outgoing packet buffer corresponding to the size of a test message packet.
  */
@@ -49,7 +106,16 @@ bool client_send_test_request_packet(void);
 void client_save_test_request(void);
 /**
  * @brief Listens for responses from a test server following the sending of a test request.
+ * @retval 0 The request was concluded (fulfilled, rejected or timed out) and should not be resent.
+ * @retval other The server was too busy to queue the request, and asked to retry after this many milliseconds.
+ */
+uint16_t client_await_response(void);
+/**
+ * @brief Sleeps before retrying a request turned away by a busy server.
+ * @details
+ * The delay honors the server's retry-after value, grows exponentially with the attempt count,
+ * and is randomly jittered so that many clients turned away together do not return in lockstep.
  */
-void client_await_response(void);
+void client_backoff_sleep(uint16_t retry_after_ms, uint8_t attempt);
 
 #endif
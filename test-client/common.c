@@ -3,6 +3,8 @@
  * @brief Source file for common variables and functions used by different parts of the test client module.
  */
 
+#include <arpa/inet.h>
+
 #include "common.h"
 
 #define PERSISTENCE_FILE_PATH ("persistence.dat")
@@ -135,3 +137,16 @@ void load_last_client_test_id(void)
 
     last_test_id_client_half = id;
 }
+
+uint32_t packet_selection_get(const uint8_t *packet)
+{
+    uint32_t selection_net;
+    memcpy(&selection_net, packet+TEST_PACKET_SELECTION_OFFSET, sizeof(selection_net));
+    return ntohl(selection_net);
+}
+
+void packet_selection_set(uint8_t *packet, uint32_t selection)
+{
+    uint32_t selection_net = htonl(selection);
+    memcpy(packet+TEST_PACKET_SELECTION_OFFSET, &selection_net, sizeof(selection_net));
+}
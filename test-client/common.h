@@ -21,6 +21,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <signal.h>
+#include <pthread.h>
 
 #include "test_packet_def.h"
 
@@ -86,4 +87,14 @@ void save_last_client_test_id(void);
  */
 void load_last_client_test_id(void);
 
+/**
+ * @brief Reads the 32 bit SELECTION field of a packet (see @ref TEST_PACKET_SELECTION_OFFSET), in host byte order.
+ */
+uint32_t packet_selection_get(const uint8_t *packet);
+
+/**
+ * @brief Writes the 32 bit SELECTION field of a packet, in network byte order.
+ */
+void packet_selection_set(uint8_t *packet, uint32_t selection);
+
 #endif
@@ -3,18 +3,71 @@
  * @brief Source file for the test client module's database functions.
  */
 
+#include <arpa/inet.h>
+
 #include "sqlite3.h"
+#include "spsc_queue.h"
 #include "db.h"
 
-#define TESTS_DB_PATH "tests.db"
+#define DB_BUSY_TIMEOUT_MS (2000)
+#define DB_COMMIT_ATTEMPTS (5)
+#define DB_JOB_QUEUE_SLOTS (1024)
+#define DB_WRITER_BATCH_JOBS (256)
+#define DB_WRITER_POLL_MS (100)
+#define DB_QUEUE_FULL_WAIT_US (200)
+
+typedef enum DbJobType
+{
+    DBJOB_REQUEST,
+    DBJOB_RESULTS,
+    DBJOB_RESULT_DETAILS,
+    DBJOB_SWEEP_STEP,
+    DBJOB_SWEEP_NOISE,
+    DBJOB_SWEEP_CAPTURE,
+} DbJobType_t;
+
+/**
+ * @brief A write queued for the writer thread, holding copies of the packets it files.
+ */
+typedef struct DbJob
+{
+    DbJobType_t type;
+    /// @brief The date-time the write was queued at, which rows are stamped with.
+    char datetime[32];
+    float duration_secs;
+    uint8_t packet[SERVER_PACKET_MAX_SIZE_BYTES];
+    uint8_t request[TEST_REQUEST_PACKET_MAX_SIZE_BYTES+1];
+} DbJob_t;
 
 static sqlite3_stmt *stmt_append_request = NULL;
 static sqlite3_stmt *stmt_append_result = NULL;
-
-static sqlite3 *open_tests_db(void)
+static sqlite3_stmt *stmt_append_result_detail = NULL;
+static sqlite3_stmt *stmt_append_sweep_step = NULL;
+static sqlite3_stmt *stmt_append_sweep_noise = NULL;
+static sqlite3_stmt *stmt_append_sweep_capture = NULL;
+static sqlite3_stmt *stmt_last_journal_record = NULL;
+static sqlite3_stmt *stmt_append_journal_record = NULL;
+static sqlite3_stmt *stmt_append_journal_result = NULL;
+static sqlite3_stmt *stmt_save_server = NULL;
+static sqlite3_stmt *stmt_known_servers = NULL;
+
+/// @brief Writes queued by the protocol thread for the writer thread.
+static SpscQueue_t job_queue = {0};
+static pthread_t writer_thread;
+static atomic_bool writer_running = false;
+static bool writer_started = false;
+/// @brief Count of writes queued (by the protocol thread only), and of writes committed by the writer thread.
+static size_t jobs_queued = 0;
+static _Atomic size_t jobs_written = 0;
+/// @brief Count of writes the writer thread lost to transactions it could not commit.
+static _Atomic size_t jobs_lost = 0;
+/// @brief Count of times the protocol thread found the queue full, and waited for the writer.
+static size_t queue_full_waits = 0;
+
+static sqlite3 *open_tests_db(const char *path)
 {
     sqlite3 *tests_db = NULL;
-    int ret = sqlite3_open(TESTS_DB_PATH, &tests_db);
+    int ret = sqlite3_open(path, &tests_db);
 
     if (ret != SQLITE_OK)
     {
@@ -22,10 +75,15 @@ static sqlite3 *open_tests_db(void)
         return NULL;
     }
 
+    // several clients may run side by side on one host, each briefly locking the DB to write
+    sqlite3_busy_timeout(tests_db, DB_BUSY_TIMEOUT_MS);
+
     return tests_db;
 }
 
-void db_init(void)
+static void *db_writer_thread(void *argument);
+
+void db_init(const char *path)
 {
     static const char db_str_create_requests_table[] =
     {
@@ -49,6 +107,80 @@ void db_init(void)
         "duration_seconds REAL NOT NULL );"
     };
 
+    static const char db_str_create_result_details_table[] =
+    {
+        "CREATE TABLE IF NOT EXISTS result_details ("
+        "test_id INTEGER NOT NULL, "
+        "test_name TEXT NOT NULL, "
+        "iterations_done INTEGER NOT NULL, "
+        "iterations_failed INTEGER NOT NULL, "
+        "timeouts INTEGER NOT NULL, "
+        "data_errors INTEGER NOT NULL, "
+        "bit_errors INTEGER NOT NULL, "
+        "first_error_offset INTEGER );"
+    };
+
+    static const char db_str_create_sweep_steps_table[] =
+    {
+        "CREATE TABLE IF NOT EXISTS sweep_steps ("
+        "test_id INTEGER NOT NULL, "
+        "test_name TEXT NOT NULL, "
+        "step INTEGER NOT NULL, "
+        "setting INTEGER NOT NULL, "
+        "throughput_bps INTEGER NOT NULL, "
+        "transfers INTEGER NOT NULL, "
+        "errors INTEGER NOT NULL, "
+        "bus_errors INTEGER NOT NULL, "
+        "nacks INTEGER NOT NULL, "
+        "arb_losses INTEGER NOT NULL );"
+    };
+
+    static const char db_str_create_sweep_noise_table[] =
+    {
+        "CREATE TABLE IF NOT EXISTS sweep_noise ("
+        "test_id INTEGER NOT NULL, "
+        "step INTEGER NOT NULL, "
+        "samples INTEGER NOT NULL, "
+        "min INTEGER NOT NULL, "
+        "max INTEGER NOT NULL, "
+        "mean_milli INTEGER NOT NULL, "
+        "stddev_milli INTEGER NOT NULL, "
+        "center INTEGER NOT NULL, "
+        "histogram TEXT NOT NULL );"
+    };
+
+    static const char db_str_create_sweep_capture_table[] =
+    {
+        "CREATE TABLE IF NOT EXISTS sweep_capture ("
+        "test_id INTEGER NOT NULL, "
+        "step INTEGER NOT NULL, "
+        "edges INTEGER NOT NULL, "
+        "duty_error_mean_ps INTEGER NOT NULL, "
+        "duty_error_min_ps INTEGER NOT NULL, "
+        "duty_error_max_ps INTEGER NOT NULL, "
+        "duty_jitter_ps INTEGER NOT NULL, "
+        "period_jitter_ps INTEGER NOT NULL, "
+        "frequency_error_ppm INTEGER NOT NULL );"
+    };
+
+    static const char db_str_create_journal_records_table[] =
+    {
+        "CREATE TABLE IF NOT EXISTS journal_records ("
+        "record_id INTEGER PRIMARY KEY, "
+        "test_id INTEGER NOT NULL );"
+    };
+
+    static const char db_str_create_known_servers_table[] =
+    {
+        "CREATE TABLE IF NOT EXISTS known_servers ("
+        "uid TEXT PRIMARY KEY, "
+        "address TEXT NOT NULL, "
+        "firmware_version TEXT NOT NULL, "
+        "tests_available INTEGER NOT NULL, "
+        "features INTEGER NOT NULL, "
+        "last_seen TEXT NOT NULL );"
+    };
+
     static const char db_str_append_request[] =
     {
         "INSERT INTO requests VALUES(?, ?, ?, ?, ?)"
@@ -59,7 +191,56 @@ void db_init(void)
         "INSERT INTO results VALUES(?, ?, ?, ?, ?, ?, ?)"
     };
 
-    sqlite3 *tests_db = open_tests_db();
+    static const char db_str_append_result_detail[] =
+    {
+        "INSERT INTO result_details VALUES(?, ?, ?, ?, ?, ?, ?, ?)"
+    };
+
+    static const char db_str_append_sweep_step[] =
+    {
+        "INSERT INTO sweep_steps VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?, ?)"
+    };
+
+    static const char db_str_append_sweep_noise[] =
+    {
+        "INSERT INTO sweep_noise VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?)"
+    };
+
+    static const char db_str_append_sweep_capture[] =
+    {
+        "INSERT INTO sweep_capture VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?)"
+    };
+
+    static const char db_str_last_journal_record[] =
+    {
+        "SELECT IFNULL(MAX(record_id), 0) FROM journal_records"
+    };
+
+    static const char db_str_append_journal_record[] =
+    {
+        "INSERT OR IGNORE INTO journal_records VALUES(?, ?)"
+    };
+
+    static const char db_str_save_server[] =
+    {
+        "INSERT OR REPLACE INTO known_servers VALUES(?, ?, ?, ?, ?, ?)"
+    };
+
+    static const char db_str_known_servers[] =
+    {
+        "SELECT uid, address FROM known_servers ORDER BY last_seen DESC LIMIT ?"
+    };
+
+    // the test string is only known from the request, if this client sent it;
+    // results the client already received live are not filed twice
+    static const char db_str_append_journal_result[] =
+    {
+        "INSERT INTO results SELECT ?1, ?2, "
+        "(SELECT test_string FROM requests WHERE test_id = ?1 ORDER BY rowid DESC LIMIT 1), ?3, ?4, ?5, ?6 "
+        "WHERE NOT EXISTS (SELECT 1 FROM results WHERE test_id = ?1)"
+    };
+
+    sqlite3 *tests_db = open_tests_db(path);
 
     if (tests_db == NULL)
     {
@@ -80,6 +261,42 @@ void db_init(void)
         goto exec_failure;
     }
 
+    if (SQLITE_OK != sqlite3_exec(tests_db, db_str_create_result_details_table, NULL, NULL, &sqlite_error_msg))
+    {
+        printf("Error creating result details table: %s\n", sqlite_error_msg);
+        goto exec_failure;
+    }
+
+    if (SQLITE_OK != sqlite3_exec(tests_db, db_str_create_sweep_steps_table, NULL, NULL, &sqlite_error_msg))
+    {
+        printf("Error creating sweep steps table: %s\n", sqlite_error_msg);
+        goto exec_failure;
+    }
+
+    if (SQLITE_OK != sqlite3_exec(tests_db, db_str_create_sweep_noise_table, NULL, NULL, &sqlite_error_msg))
+    {
+        printf("Error creating sweep noise table: %s\n", sqlite_error_msg);
+        goto exec_failure;
+    }
+
+    if (SQLITE_OK != sqlite3_exec(tests_db, db_str_create_sweep_capture_table, NULL, NULL, &sqlite_error_msg))
+    {
+        printf("Error creating sweep capture table: %s\n", sqlite_error_msg);
+        goto exec_failure;
+    }
+
+    if (SQLITE_OK != sqlite3_exec(tests_db, db_str_create_journal_records_table, NULL, NULL, &sqlite_error_msg))
+    {
+        printf("Error creating journal records table: %s\n", sqlite_error_msg);
+        goto exec_failure;
+    }
+
+    if (SQLITE_OK != sqlite3_exec(tests_db, db_str_create_known_servers_table, NULL, NULL, &sqlite_error_msg))
+    {
+        printf("Error creating known servers table: %s\n", sqlite_error_msg);
+        goto exec_failure;
+    }
+
     int ret;
     ret = sqlite3_prepare_v2(tests_db, db_str_append_request, strlen(db_str_append_request), &stmt_append_request, NULL);
 
@@ -97,11 +314,108 @@ void db_init(void)
         goto prepare_failure;
     }
 
+    ret = sqlite3_prepare_v2(tests_db, db_str_append_result_detail, strlen(db_str_append_result_detail), &stmt_append_result_detail, NULL);
+
+    if(ret != SQLITE_OK)
+    {
+        printf("Error preparing append result detail statement: %s\n", sqlite3_errstr(ret));
+        goto prepare_failure;
+    }
+
+    ret = sqlite3_prepare_v2(tests_db, db_str_append_sweep_step, strlen(db_str_append_sweep_step), &stmt_append_sweep_step, NULL);
+
+    if(ret != SQLITE_OK)
+    {
+        printf("Error preparing append sweep step statement: %s\n", sqlite3_errstr(ret));
+        goto prepare_failure;
+    }
+
+    ret = sqlite3_prepare_v2(tests_db, db_str_append_sweep_noise, strlen(db_str_append_sweep_noise), &stmt_append_sweep_noise, NULL);
+
+    if(ret != SQLITE_OK)
+    {
+        printf("Error preparing append sweep noise statement: %s\n", sqlite3_errstr(ret));
+        goto prepare_failure;
+    }
+
+    ret = sqlite3_prepare_v2(tests_db, db_str_append_sweep_capture, strlen(db_str_append_sweep_capture), &stmt_append_sweep_capture, NULL);
+
+    if(ret != SQLITE_OK)
+    {
+        printf("Error preparing append sweep capture statement: %s\n", sqlite3_errstr(ret));
+        goto prepare_failure;
+    }
+
+    ret = sqlite3_prepare_v2(tests_db, db_str_last_journal_record, strlen(db_str_last_journal_record), &stmt_last_journal_record, NULL);
+
+    if(ret != SQLITE_OK)
+    {
+        printf("Error preparing last journal record statement: %s\n", sqlite3_errstr(ret));
+        goto prepare_failure;
+    }
+
+    ret = sqlite3_prepare_v2(tests_db, db_str_append_journal_record, strlen(db_str_append_journal_record), &stmt_append_journal_record, NULL);
+
+    if(ret != SQLITE_OK)
+    {
+        printf("Error preparing append journal record statement: %s\n", sqlite3_errstr(ret));
+        goto prepare_failure;
+    }
+
+    ret = sqlite3_prepare_v2(tests_db, db_str_append_journal_result, strlen(db_str_append_journal_result), &stmt_append_journal_result, NULL);
+
+    if(ret != SQLITE_OK)
+    {
+        printf("Error preparing append journal result statement: %s\n", sqlite3_errstr(ret));
+        goto prepare_failure;
+    }
+
+    ret = sqlite3_prepare_v2(tests_db, db_str_save_server, strlen(db_str_save_server), &stmt_save_server, NULL);
+
+    if(ret != SQLITE_OK)
+    {
+        printf("Error preparing save server statement: %s\n", sqlite3_errstr(ret));
+        goto prepare_failure;
+    }
+
+    ret = sqlite3_prepare_v2(tests_db, db_str_known_servers, strlen(db_str_known_servers), &stmt_known_servers, NULL);
+
+    if(ret != SQLITE_OK)
+    {
+        printf("Error preparing known servers statement: %s\n", sqlite3_errstr(ret));
+        goto prepare_failure;
+    }
+
+    if (!spsc_queue_init(&job_queue, sizeof(DbJob_t), DB_JOB_QUEUE_SLOTS))
+    {
+        printf("Error allocating the DB write queue.\n");
+        goto prepare_failure;
+    }
+
+    atomic_store(&writer_running, true);
+
+    if (pthread_create(&writer_thread, NULL, db_writer_thread, NULL) != 0)
+    {
+        printf("Error starting the DB writer thread.\n");
+        spsc_queue_deinit(&job_queue);
+        goto prepare_failure;
+    }
+
+    writer_started = true;
     sqlite3_close(tests_db);
     return;
 
 prepare_failure:
     if (stmt_append_request != NULL) sqlite3_finalize(stmt_append_request);
+    if (stmt_append_result != NULL) sqlite3_finalize(stmt_append_result);
+    if (stmt_append_result_detail != NULL) sqlite3_finalize(stmt_append_result_detail);
+    if (stmt_append_sweep_step != NULL) sqlite3_finalize(stmt_append_sweep_step);
+    if (stmt_append_sweep_noise != NULL) sqlite3_finalize(stmt_append_sweep_noise);
+    if (stmt_append_sweep_capture != NULL) sqlite3_finalize(stmt_append_sweep_capture);
+    if (stmt_last_journal_record != NULL) sqlite3_finalize(stmt_last_journal_record);
+    if (stmt_append_journal_record != NULL) sqlite3_finalize(stmt_append_journal_record);
+    if (stmt_append_journal_result != NULL) sqlite3_finalize(stmt_append_journal_result);
+    if (stmt_save_server != NULL) sqlite3_finalize(stmt_save_server);
 exec_failure:
     sqlite3_free(sqlite_error_msg);
     sqlite3_close(tests_db);
@@ -113,22 +427,38 @@ open_failure:
 
 void db_deinit(void)
 {
+    if (writer_started)
+    {
+        // the writer drains the queue before it stops
+        atomic_store(&writer_running, false);
+        pthread_join(writer_thread, NULL);
+        spsc_queue_deinit(&job_queue);
+        writer_started = false;
+
+        if (queue_full_waits > 0) printf("DB writes waited on a full queue %zu times.\n", queue_full_waits);
+        if (atomic_load(&jobs_lost) > 0) printf("DB writes lost to failed commits: %zu.\n", atomic_load(&jobs_lost));
+    }
+
     if (stmt_append_request != NULL) sqlite3_finalize(stmt_append_request);
     if (stmt_append_result != NULL) sqlite3_finalize(stmt_append_result);
+    if (stmt_append_result_detail != NULL) sqlite3_finalize(stmt_append_result_detail);
+    if (stmt_append_sweep_step != NULL) sqlite3_finalize(stmt_append_sweep_step);
+    if (stmt_append_sweep_noise != NULL) sqlite3_finalize(stmt_append_sweep_noise);
+    if (stmt_append_sweep_capture != NULL) sqlite3_finalize(stmt_append_sweep_capture);
+    if (stmt_last_journal_record != NULL) sqlite3_finalize(stmt_last_journal_record);
+    if (stmt_append_journal_record != NULL) sqlite3_finalize(stmt_append_journal_record);
+    if (stmt_append_journal_result != NULL) sqlite3_finalize(stmt_append_journal_result);
+    if (stmt_save_server != NULL) sqlite3_finalize(stmt_save_server);
+    if (stmt_known_servers != NULL) sqlite3_finalize(stmt_known_servers);
 }
 
-void db_append_request(uint8_t *request_buffer)
+static void write_request(uint8_t *request_buffer, const char *datetime)
 {
-    char datetime[64] = {0};
-    datetime_str_nonalloc(datetime, sizeof(datetime));
-
-    printf("Recording request to DB at date-time: %s\n", datetime);
-
     sqlite3_bind_int(stmt_append_request, 1, *(uint32_t *)(request_buffer+TEST_PACKET_ID_BYTE_OFFSET));
     sqlite3_bind_text(stmt_append_request, 2, datetime, strlen(datetime), SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt_append_request, 3, (char *)request_buffer+TEST_PACKET_STRING_HEAD_OFFSET, request_buffer[TEST_PACKET_STRING_LEN_OFFSET], SQLITE_TRANSIENT);
     sqlite3_bind_int(stmt_append_request, 4, request_buffer[TEST_PACKET_ITERATIONS_BYTE_OFFSET]);
-    sqlite3_bind_int(stmt_append_request, 5, request_buffer[TEST_PACKET_SELECTION_BYTE_OFFSET]);
+    sqlite3_bind_int64(stmt_append_request, 5, packet_selection_get(request_buffer));
 
     int ret = sqlite3_step(stmt_append_request);
 
@@ -140,19 +470,14 @@ void db_append_request(uint8_t *request_buffer)
     sqlite3_reset(stmt_append_request);
 }
 
-void db_append_results(uint8_t *results_buffer, uint8_t *request_buffer, float duration_secs)
+static void write_results(uint8_t *results_buffer, uint8_t *request_buffer, float duration_secs, const char *datetime)
 {
-    char datetime[64] = {0};
-    datetime_str_nonalloc(datetime, sizeof(datetime));
-
-    printf("Recording result to DB at date-time: %s\n", datetime);
-
     sqlite3_bind_int(stmt_append_result, 1, *(uint32_t *)(results_buffer+TEST_PACKET_ID_BYTE_OFFSET));
     sqlite3_bind_text(stmt_append_result, 2, datetime, strlen(datetime), SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt_append_result, 3, (char *)request_buffer+TEST_PACKET_STRING_HEAD_OFFSET, request_buffer[TEST_PACKET_STRING_LEN_OFFSET], SQLITE_TRANSIENT);
     sqlite3_bind_int(stmt_append_result, 4, request_buffer[TEST_PACKET_ITERATIONS_BYTE_OFFSET]);
-    sqlite3_bind_int(stmt_append_result, 5, request_buffer[TEST_PACKET_SELECTION_BYTE_OFFSET]);
-    sqlite3_bind_int(stmt_append_result, 6, results_buffer[TEST_PACKET_SELECTION_BYTE_OFFSET]);
+    sqlite3_bind_int64(stmt_append_result, 5, packet_selection_get(request_buffer));
+    sqlite3_bind_int64(stmt_append_result, 6, packet_selection_get(results_buffer));
     sqlite3_bind_double(stmt_append_result, 7, duration_secs);
 
     int ret = sqlite3_step(stmt_append_result);
@@ -164,3 +489,513 @@ void db_append_results(uint8_t *results_buffer, uint8_t *request_buffer, float d
 
     sqlite3_reset(stmt_append_result);
 }
+
+/**
+ * @brief Files the results detail blocks of every selected test, starting at [details].
+ * @param [in] test_id_raw The test ID, as found in packets
+ */
+static void append_result_details(uint32_t test_id_raw, uint32_t selection, const uint8_t *details)
+{
+    for (uint8_t i = 0; i < NUM_POSSIBLE_TESTS; i++)
+    {
+        if (!(selection & ((uint32_t)1 << i))) continue;
+
+        const uint8_t *detail = details + (TEST_RESULTS_DETAIL_SIZE_BYTES * i);
+        uint32_t bit_errors_net;
+        memcpy(&bit_errors_net, detail + TEST_RESULTS_DETAIL_BIT_ERRORS_OFFSET, sizeof(bit_errors_net));
+
+        sqlite3_bind_int(stmt_append_result_detail, 1, test_id_raw);
+        sqlite3_bind_text(stmt_append_result_detail, 2, test_names[i], strlen(test_names[i]), SQLITE_STATIC);
+        sqlite3_bind_int(stmt_append_result_detail, 3, detail[TEST_RESULTS_DETAIL_DONE_OFFSET]);
+        sqlite3_bind_int(stmt_append_result_detail, 4, detail[TEST_RESULTS_DETAIL_FAILED_OFFSET]);
+        sqlite3_bind_int(stmt_append_result_detail, 5, detail[TEST_RESULTS_DETAIL_TIMEOUTS_OFFSET]);
+        sqlite3_bind_int(stmt_append_result_detail, 6, detail[TEST_RESULTS_DETAIL_DATA_ERRORS_OFFSET]);
+        sqlite3_bind_int64(stmt_append_result_detail, 7, ntohl(bit_errors_net));
+
+        if (detail[TEST_RESULTS_DETAIL_FIRST_ERROR_OFFSET] == TEST_RESULTS_NO_ERROR_OFFSET)
+        {
+            sqlite3_bind_null(stmt_append_result_detail, 8);
+        }
+        else
+        {
+            sqlite3_bind_int(stmt_append_result_detail, 8, detail[TEST_RESULTS_DETAIL_FIRST_ERROR_OFFSET]);
+        }
+
+        int ret = sqlite3_step(stmt_append_result_detail);
+
+        if (ret != SQLITE_DONE)
+        {
+            printf ("Statement step error: %s\n", sqlite3_errstr(ret));
+        }
+
+        sqlite3_reset(stmt_append_result_detail);
+    }
+}
+
+static void write_result_details(uint8_t *results_buffer, uint8_t *request_buffer)
+{
+    append_result_details(*(uint32_t *)(results_buffer+TEST_PACKET_ID_BYTE_OFFSET), packet_selection_get(request_buffer),
+        results_buffer + TEST_PACKET_RESULTS_DETAIL_OFFSET);
+}
+
+static void write_sweep_step(uint8_t *sweep_buffer)
+{
+    uint8_t test_idx = sweep_buffer[TEST_PACKET_SWEEP_TEST_OFFSET];
+    uint32_t setting_net;
+    uint32_t throughput_net;
+    uint16_t transfers_net;
+    uint16_t errors_net;
+    uint16_t bus_errors_net;
+    uint16_t nacks_net;
+    uint16_t arb_losses_net;
+
+    if (test_idx >= NUM_POSSIBLE_TESTS) return;
+
+    memcpy(&setting_net, sweep_buffer+TEST_PACKET_SWEEP_SETTING_OFFSET, sizeof(setting_net));
+    memcpy(&throughput_net, sweep_buffer+TEST_PACKET_SWEEP_THROUGHPUT_OFFSET, sizeof(throughput_net));
+    memcpy(&transfers_net, sweep_buffer+TEST_PACKET_SWEEP_TRANSFERS_OFFSET, sizeof(transfers_net));
+    memcpy(&errors_net, sweep_buffer+TEST_PACKET_SWEEP_ERRORS_OFFSET, sizeof(errors_net));
+    memcpy(&bus_errors_net, sweep_buffer+TEST_PACKET_SWEEP_BUS_ERRORS_OFFSET, sizeof(bus_errors_net));
+    memcpy(&nacks_net, sweep_buffer+TEST_PACKET_SWEEP_NACKS_OFFSET, sizeof(nacks_net));
+    memcpy(&arb_losses_net, sweep_buffer+TEST_PACKET_SWEEP_ARB_LOSSES_OFFSET, sizeof(arb_losses_net));
+
+    sqlite3_bind_int(stmt_append_sweep_step, 1, *(uint32_t *)(sweep_buffer+TEST_PACKET_ID_BYTE_OFFSET));
+    sqlite3_bind_text(stmt_append_sweep_step, 2, test_names[test_idx], strlen(test_names[test_idx]), SQLITE_STATIC);
+    sqlite3_bind_int(stmt_append_sweep_step, 3, sweep_buffer[TEST_PACKET_SWEEP_STEP_OFFSET]);
+    sqlite3_bind_int64(stmt_append_sweep_step, 4, ntohl(setting_net));
+    sqlite3_bind_int64(stmt_append_sweep_step, 5, ntohl(throughput_net));
+    sqlite3_bind_int(stmt_append_sweep_step, 6, ntohs(transfers_net));
+    sqlite3_bind_int(stmt_append_sweep_step, 7, ntohs(errors_net));
+    sqlite3_bind_int(stmt_append_sweep_step, 8, ntohs(bus_errors_net));
+    sqlite3_bind_int(stmt_append_sweep_step, 9, ntohs(nacks_net));
+    sqlite3_bind_int(stmt_append_sweep_step, 10, ntohs(arb_losses_net));
+
+    int ret = sqlite3_step(stmt_append_sweep_step);
+
+    if (ret != SQLITE_DONE)
+    {
+        printf ("Statement step error: %s\n", sqlite3_errstr(ret));
+    }
+
+    sqlite3_reset(stmt_append_sweep_step);
+}
+
+static void write_sweep_noise(uint8_t *noise_buffer)
+{
+    uint32_t samples_net;
+    uint16_t min_net;
+    uint16_t max_net;
+    uint32_t mean_net;
+    uint32_t stddev_net;
+    uint16_t center_net;
+    char histogram[TEST_PACKET_NOISE_HISTOGRAM_BINS * 12] = {0};
+    size_t histogram_len = 0;
+
+    memcpy(&samples_net, noise_buffer+TEST_PACKET_NOISE_SAMPLES_OFFSET, sizeof(samples_net));
+    memcpy(&min_net, noise_buffer+TEST_PACKET_NOISE_MIN_OFFSET, sizeof(min_net));
+    memcpy(&max_net, noise_buffer+TEST_PACKET_NOISE_MAX_OFFSET, sizeof(max_net));
+    memcpy(&mean_net, noise_buffer+TEST_PACKET_NOISE_MEAN_OFFSET, sizeof(mean_net));
+    memcpy(&stddev_net, noise_buffer+TEST_PACKET_NOISE_STDDEV_OFFSET, sizeof(stddev_net));
+    memcpy(&center_net, noise_buffer+TEST_PACKET_NOISE_CENTER_OFFSET, sizeof(center_net));
+
+    for (uint8_t i = 0; i < TEST_PACKET_NOISE_HISTOGRAM_BINS; i++)
+    {
+        uint32_t bin_net;
+        memcpy(&bin_net, noise_buffer+TEST_PACKET_NOISE_HISTOGRAM_OFFSET+(i*sizeof(bin_net)), sizeof(bin_net));
+        histogram_len += snprintf(histogram+histogram_len, sizeof(histogram)-histogram_len, i == 0 ? "%u" : ",%u", ntohl(bin_net));
+    }
+
+    sqlite3_bind_int(stmt_append_sweep_noise, 1, *(uint32_t *)(noise_buffer+TEST_PACKET_ID_BYTE_OFFSET));
+    sqlite3_bind_int(stmt_append_sweep_noise, 2, noise_buffer[TEST_PACKET_NOISE_STEP_OFFSET]);
+    sqlite3_bind_int64(stmt_append_sweep_noise, 3, ntohl(samples_net));
+    sqlite3_bind_int(stmt_append_sweep_noise, 4, ntohs(min_net));
+    sqlite3_bind_int(stmt_append_sweep_noise, 5, ntohs(max_net));
+    sqlite3_bind_int64(stmt_append_sweep_noise, 6, ntohl(mean_net));
+    sqlite3_bind_int64(stmt_append_sweep_noise, 7, ntohl(stddev_net));
+    sqlite3_bind_int(stmt_append_sweep_noise, 8, ntohs(center_net));
+    sqlite3_bind_text(stmt_append_sweep_noise, 9, histogram, histogram_len, SQLITE_TRANSIENT);
+
+    int ret = sqlite3_step(stmt_append_sweep_noise);
+
+    if (ret != SQLITE_DONE)
+    {
+        printf ("Statement step error: %s\n", sqlite3_errstr(ret));
+    }
+
+    sqlite3_reset(stmt_append_sweep_noise);
+}
+
+static void write_sweep_capture(uint8_t *capture_buffer)
+{
+    uint32_t fields_net[7];
+
+    // the fields are laid out back to back, from EDGES to FREQ ERR PPM
+    memcpy(fields_net, capture_buffer+TEST_PACKET_CAPTURE_EDGES_OFFSET, sizeof(fields_net));
+
+    sqlite3_bind_int(stmt_append_sweep_capture, 1, *(uint32_t *)(capture_buffer+TEST_PACKET_ID_BYTE_OFFSET));
+    sqlite3_bind_int(stmt_append_sweep_capture, 2, capture_buffer[TEST_PACKET_CAPTURE_STEP_OFFSET]);
+    sqlite3_bind_int64(stmt_append_sweep_capture, 3, ntohl(fields_net[0]));
+    sqlite3_bind_int(stmt_append_sweep_capture, 4, (int32_t)ntohl(fields_net[1]));
+    sqlite3_bind_int(stmt_append_sweep_capture, 5, (int32_t)ntohl(fields_net[2]));
+    sqlite3_bind_int(stmt_append_sweep_capture, 6, (int32_t)ntohl(fields_net[3]));
+    sqlite3_bind_int64(stmt_append_sweep_capture, 7, ntohl(fields_net[4]));
+    sqlite3_bind_int64(stmt_append_sweep_capture, 8, ntohl(fields_net[5]));
+    sqlite3_bind_int(stmt_append_sweep_capture, 9, (int32_t)ntohl(fields_net[6]));
+
+    int ret = sqlite3_step(stmt_append_sweep_capture);
+
+    if (ret != SQLITE_DONE)
+    {
+        printf ("Statement step error: %s\n", sqlite3_errstr(ret));
+    }
+
+    sqlite3_reset(stmt_append_sweep_capture);
+}
+
+/**
+ * @brief Runs a queued write.
+ */
+static void write_job(DbJob_t *job)
+{
+    switch (job->type)
+    {
+    case DBJOB_REQUEST:
+        write_request(job->request, job->datetime);
+        break;
+    case DBJOB_RESULTS:
+        write_results(job->packet, job->request, job->duration_secs, job->datetime);
+        break;
+    case DBJOB_RESULT_DETAILS:
+        write_result_details(job->packet, job->request);
+        break;
+    case DBJOB_SWEEP_STEP:
+        write_sweep_step(job->packet);
+        break;
+    case DBJOB_SWEEP_NOISE:
+        write_sweep_noise(job->packet);
+        break;
+    case DBJOB_SWEEP_CAPTURE:
+        write_sweep_capture(job->packet);
+        break;
+    }
+}
+
+/**
+ * @brief Commits the writer's transaction, retrying while other clients keep the DB locked past @ref DB_BUSY_TIMEOUT_MS,
+ * and rolls it back if it still fails, so that the next transaction can begin.
+ * @retval true The transaction was committed
+ * @retval false The transaction was rolled back, and its writes lost
+ */
+static bool commit_writes(sqlite3 *tests_db)
+{
+    int ret = SQLITE_BUSY;
+
+    for (int attempt = 0; attempt < DB_COMMIT_ATTEMPTS && ret == SQLITE_BUSY; attempt++)
+    {
+        ret = sqlite3_exec(tests_db, "COMMIT", NULL, NULL, NULL);
+    }
+
+    if (ret == SQLITE_OK) return true;
+
+    printf("DB commit error: %s\n", sqlite3_errmsg(tests_db));
+
+    // a failed commit may have rolled back already
+    if (!sqlite3_get_autocommit(tests_db))
+    {
+        sqlite3_exec(tests_db, "ROLLBACK", NULL, NULL, NULL);
+    }
+
+    return false;
+}
+
+/**
+ * @brief Operation loop of the writer thread, running the queued writes in transactions of up to @ref DB_WRITER_BATCH_JOBS,
+ * so that a burst of results costs a single commit (and sync to disk) rather than one each.
+ * If no transaction can begin, the writes are committed one by one instead.
+ */
+static void *db_writer_thread(void *argument)
+{
+    (void)argument;
+    sqlite3 *tests_db = sqlite3_db_handle(stmt_append_request);
+
+    while (atomic_load(&writer_running) || spsc_queue_count(&job_queue) > 0)
+    {
+        DbJob_t *job = spsc_queue_peek(&job_queue, DB_WRITER_POLL_MS);
+
+        if (job == NULL) continue;
+
+        size_t written = 0;
+        int begin_ret = sqlite3_exec(tests_db, "BEGIN", NULL, NULL, NULL);
+
+        if (begin_ret != SQLITE_OK)
+        {
+            printf("DB begin error: %s\n", sqlite3_errmsg(tests_db));
+        }
+
+        do
+        {
+            write_job(job);
+            spsc_queue_release(&job_queue);
+            written++;
+        }
+        while (written < DB_WRITER_BATCH_JOBS && (job = spsc_queue_peek(&job_queue, 0)) != NULL);
+
+        if (begin_ret != SQLITE_OK || commit_writes(tests_db))
+        {
+            atomic_fetch_add(&jobs_written, written);
+        }
+        else
+        {
+            printf("DB lost %zu writes.\n", written);
+            atomic_fetch_add(&jobs_lost, written);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Returns a free slot of the write queue, waiting for the writer if the queue is full, or NULL if there is no writer.
+ */
+static DbJob_t *reserve_job(DbJobType_t type)
+{
+    if (!writer_started) return NULL;
+
+    DbJob_t *job;
+
+    if ((job = spsc_queue_reserve(&job_queue)) == NULL)
+    {
+        queue_full_waits++;
+
+        while ((job = spsc_queue_reserve(&job_queue)) == NULL)
+        {
+            usleep(DB_QUEUE_FULL_WAIT_US);
+        }
+    }
+
+    job->type = type;
+    datetime_str_nonalloc(job->datetime, sizeof(job->datetime));
+
+    return job;
+}
+
+/**
+ * @brief Hands the reserved slot to the writer.
+ */
+static void publish_job(void)
+{
+    jobs_queued++;
+    spsc_queue_publish(&job_queue);
+}
+
+void db_append_request(uint8_t *request_buffer)
+{
+    DbJob_t *job = reserve_job(DBJOB_REQUEST);
+
+    if (job == NULL) return;
+
+    memcpy(job->request, request_buffer, sizeof(job->request));
+    publish_job();
+}
+
+void db_append_results(uint8_t *results_buffer, uint8_t *request_buffer, float duration_secs)
+{
+    DbJob_t *job = reserve_job(DBJOB_RESULTS);
+
+    if (job == NULL) return;
+
+    memcpy(job->packet, results_buffer, sizeof(job->packet));
+    memcpy(job->request, request_buffer, sizeof(job->request));
+    job->duration_secs = duration_secs;
+    publish_job();
+}
+
+void db_append_result_details(uint8_t *results_buffer, uint8_t *request_buffer)
+{
+    DbJob_t *job = reserve_job(DBJOB_RESULT_DETAILS);
+
+    if (job == NULL) return;
+
+    memcpy(job->packet, results_buffer, sizeof(job->packet));
+    memcpy(job->request, request_buffer, sizeof(job->request));
+    publish_job();
+}
+
+/**
+ * @brief Queues the filing of a sweep packet.
+ */
+static void append_sweep_packet(DbJobType_t type, uint8_t *packet_buffer)
+{
+    DbJob_t *job = reserve_job(type);
+
+    if (job == NULL) return;
+
+    memcpy(job->packet, packet_buffer, sizeof(job->packet));
+    publish_job();
+}
+
+void db_append_sweep_step(uint8_t *sweep_buffer)
+{
+    append_sweep_packet(DBJOB_SWEEP_STEP, sweep_buffer);
+}
+
+void db_append_sweep_noise(uint8_t *noise_buffer)
+{
+    append_sweep_packet(DBJOB_SWEEP_NOISE, noise_buffer);
+}
+
+void db_append_sweep_capture(uint8_t *capture_buffer)
+{
+    append_sweep_packet(DBJOB_SWEEP_CAPTURE, capture_buffer);
+}
+
+void db_flush(void)
+{
+    if (!writer_started) return;
+
+    while (atomic_load(&jobs_written) + atomic_load(&jobs_lost) != jobs_queued)
+    {
+        usleep(DB_QUEUE_FULL_WAIT_US);
+    }
+}
+
+size_t db_written_count(void)
+{
+    return atomic_load(&jobs_written);
+}
+
+uint32_t db_last_journal_record(void)
+{
+    db_flush();
+
+    uint32_t record_id = 0;
+    int ret = sqlite3_step(stmt_last_journal_record);
+
+    if (ret == SQLITE_ROW)
+    {
+        record_id = (uint32_t)sqlite3_column_int64(stmt_last_journal_record, 0);
+    }
+    else
+    {
+        printf ("Statement step error: %s\n", sqlite3_errstr(ret));
+    }
+
+    sqlite3_reset(stmt_last_journal_record);
+    return record_id;
+}
+
+static uint32_t record_u32(const uint8_t *field)
+{
+    uint32_t value_net;
+    memcpy(&value_net, field, sizeof(value_net));
+    return ntohl(value_net);
+}
+
+bool db_append_journal_record(const uint8_t *record)
+{
+    uint32_t test_id_raw;
+    memcpy(&test_id_raw, record + TEST_JOURNAL_RECORD_TEST_ID_OFFSET, sizeof(test_id_raw));
+
+    sqlite3_bind_int64(stmt_append_journal_record, 1, record_u32(record + TEST_JOURNAL_RECORD_ID_OFFSET));
+    sqlite3_bind_int(stmt_append_journal_record, 2, test_id_raw);
+
+    int ret = sqlite3_step(stmt_append_journal_record);
+    sqlite3_reset(stmt_append_journal_record);
+
+    if (ret != SQLITE_DONE)
+    {
+        printf ("Statement step error: %s\n", sqlite3_errstr(ret));
+        return false;
+    }
+
+    sqlite3 *tests_db = sqlite3_db_handle(stmt_append_journal_record);
+
+    // already synced
+    if (sqlite3_changes(tests_db) == 0) return false;
+
+    char datetime[64] = {0};
+    datetime_str_nonalloc(datetime, sizeof(datetime));
+
+    uint32_t selection = record_u32(record + TEST_JOURNAL_RECORD_SELECTION_OFFSET);
+
+    sqlite3_bind_int(stmt_append_journal_result, 1, test_id_raw);
+    sqlite3_bind_text(stmt_append_journal_result, 2, datetime, strlen(datetime), SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt_append_journal_result, 3, record[TEST_JOURNAL_RECORD_ITERATIONS_OFFSET]);
+    sqlite3_bind_int64(stmt_append_journal_result, 4, selection);
+    sqlite3_bind_int64(stmt_append_journal_result, 5, record_u32(record + TEST_JOURNAL_RECORD_PASSED_OFFSET));
+    sqlite3_bind_double(stmt_append_journal_result, 6, record_u32(record + TEST_JOURNAL_RECORD_DURATION_OFFSET) / 1000.0);
+
+    ret = sqlite3_step(stmt_append_journal_result);
+    sqlite3_reset(stmt_append_journal_result);
+
+    if (ret != SQLITE_DONE)
+    {
+        printf ("Statement step error: %s\n", sqlite3_errstr(ret));
+    }
+    else if (sqlite3_changes(tests_db) != 0)
+    {
+        append_result_details(test_id_raw, selection, record + TEST_JOURNAL_RECORD_DETAIL_OFFSET);
+    }
+
+    return true;
+}
+
+void db_save_server(const char *uid, const char *address, const char *firmware_version, uint32_t tests_available, uint8_t features)
+{
+    db_flush();
+
+    char datetime[64] = {0};
+    datetime_str_nonalloc(datetime, sizeof(datetime));
+
+    sqlite3_bind_text(stmt_save_server, 1, uid, strlen(uid), SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt_save_server, 2, address, strlen(address), SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt_save_server, 3, firmware_version, strlen(firmware_version), SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt_save_server, 4, tests_available);
+    sqlite3_bind_int(stmt_save_server, 5, features);
+    sqlite3_bind_text(stmt_save_server, 6, datetime, strlen(datetime), SQLITE_TRANSIENT);
+
+    int ret = sqlite3_step(stmt_save_server);
+
+    if (ret != SQLITE_DONE)
+    {
+        printf ("Statement step error: %s\n", sqlite3_errstr(ret));
+    }
+
+    sqlite3_reset(stmt_save_server);
+}
+
+size_t db_known_servers(KnownServer_t *servers, size_t max_count)
+{
+    db_flush();
+
+    size_t count = 0;
+    int ret = SQLITE_DONE;
+
+    sqlite3_bind_int64(stmt_known_servers, 1, (sqlite3_int64)max_count);
+
+    while (count < max_count && (ret = sqlite3_step(stmt_known_servers)) == SQLITE_ROW)
+    {
+        snprintf(servers[count].uid, sizeof(servers[count].uid), "%s", (const char *)sqlite3_column_text(stmt_known_servers, 0));
+        snprintf(servers[count].address, sizeof(servers[count].address), "%s", (const char *)sqlite3_column_text(stmt_known_servers, 1));
+        count++;
+    }
+
+    if (count < max_count && ret != SQLITE_DONE)
+    {
+        printf ("Statement step error: %s\n", sqlite3_errstr(ret));
+    }
+
+    sqlite3_reset(stmt_known_servers);
+    return count;
+}
+
+void db_begin(void)
+{
+    db_flush();
+    sqlite3_exec(sqlite3_db_handle(stmt_append_journal_record), "BEGIN", NULL, NULL, NULL);
+}
+
+void db_commit(void)
+{
+    sqlite3_exec(sqlite3_db_handle(stmt_append_journal_record), "COMMIT", NULL, NULL, NULL);
+}
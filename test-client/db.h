@@ -8,9 +8,72 @@
 
 #include "common.h"
 
-void db_init(void);
+#define TESTS_DB_PATH "tests.db"
+#define BENCHMARK_DB_PATH "benchmark.db"
+
+/**
+ * @brief A server seen before, as recorded from its beacon.
+ */
+typedef struct KnownServer
+{
+    /// @brief The board's unique ID, in hex.
+    char uid[(TEST_PACKET_BEACON_UID_SIZE_BYTES * 2) + 1];
+    /// @brief The IPv4 address it was last seen at, in dotted decimal.
+    char address[16];
+} KnownServer_t;
+
+/**
+ * @brief Opens the DB at [path], creating its tables if needed, and starts the writer thread.
+ * @details
+ * The append functions only queue their writes, copying the packets, and return at once;
+ * the writer thread files them in batches, so that a slow commit never holds up the receiving of packets.
+ * They are called from the protocol (main) thread only, the queue's only producer.
+ */
+void db_init(const char *path);
+/**
+ * @brief Files the queued writes, stops the writer thread and releases the prepared statements.
+ */
 void db_deinit(void);
+/**
+ * @brief Waits for the writer thread to file (or lose, to a failed commit) every queued write.
+ * The functions that read the DB or open a transaction call it first.
+ */
+void db_flush(void);
+/**
+ * @brief Returns the count of queued writes the writer thread filed so far, in committed transactions.
+ */
+size_t db_written_count(void);
 void db_append_request(uint8_t *request_buffer);
 void db_append_results(uint8_t *results_buffer, uint8_t *request_buffer, float duration_secs);
+void db_append_result_details(uint8_t *results_buffer, uint8_t *request_buffer);
+void db_append_sweep_step(uint8_t *sweep_buffer);
+void db_append_sweep_noise(uint8_t *noise_buffer);
+void db_append_sweep_capture(uint8_t *capture_buffer);
+/**
+ * @brief Returns the ID of the last server journal record filed, or 0 if none.
+ */
+uint32_t db_last_journal_record(void);
+/**
+ * @brief Files a server journal record (see @ref TESTMSG_JOURNAL_RECORDS), along with its results unless
+ * they were already filed when received live.
+ * @retval true The record was new
+ * @retval false The record was filed before (or could not be)
+ */
+bool db_append_journal_record(const uint8_t *record);
+/**
+ * @brief Records a server's identity and address from its beacon, as the last server seen.
+ */
+void db_save_server(const char *uid, const char *address, const char *firmware_version, uint32_t tests_available, uint8_t features);
+/**
+ * @brief Looks up the servers seen before, most recently seen first, so that they may be probed directly on the next run.
+ * @param [out] servers Storage for up to [max_count] servers
+ * @return The count of servers written to [servers], 0 if none was seen yet
+ */
+size_t db_known_servers(KnownServer_t *servers, size_t max_count);
+/**
+ * @brief Groups the following appends into a single transaction, until @ref db_commit().
+ */
+void db_begin(void);
+void db_commit(void);
 
 #endif
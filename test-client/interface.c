@@ -2,6 +2,12 @@
 #include "client.h"
 #include "interface.h"
 
+#define BUSY_MAX_RETRIES (8)
+#define TELEMETRY_COMMAND "telemetry"
+#define ROUND_TRIP_COMMAND "latency"
+#define ROUND_TRIP_COUNT (200)
+#define JOURNAL_COMMAND "resync"
+
 void interface_init(void)
 {
     load_last_client_test_id();
@@ -15,8 +21,9 @@ void interface_loop(void)
     static char test_str_buff[TEST_PACKET_STR_MAX_LEN] = {0};
     static int numeric_input_int = 0;
     static uint8_t test_str_len = 0;
-    static uint8_t test_selection_byte = 0;
+    static uint32_t test_selection = 0;
     static uint8_t test_iterations_byte = 0;
+    static uint8_t test_flags_byte = 0;
 
     while(!should_terminate)
     {
@@ -32,10 +39,11 @@ void interface_loop(void)
         explicit_bzero(short_input_buff, sizeof(short_input_buff));
 
         test_str_len = 0;
-        test_selection_byte = 0;
+        test_selection = 0;
         test_iterations_byte = 0;
+        test_flags_byte = 0;
 
-        printf("\nPlease input a test string (or Ctrl-c to quit).\nInput: ");
+        printf("\nPlease input a test string (or \"" TELEMETRY_COMMAND "\" for the server's network buffer usage and boot profile, \"" ROUND_TRIP_COMMAND "\" to time round trips to it, \"" JOURNAL_COMMAND "\" to fetch the results it journaled, or Ctrl-c to quit).\nInput: ");
         fflush(stdout);
         fgets(test_str_buff, sizeof(test_str_buff), stdin);
 
@@ -51,6 +59,24 @@ void interface_loop(void)
 
         printf("Given input: [%s]\n", test_str_buff);
 
+        if (strcmp(test_str_buff, TELEMETRY_COMMAND) == 0)
+        {
+            client_request_telemetry();
+            continue;
+        }
+
+        if (strcmp(test_str_buff, ROUND_TRIP_COMMAND) == 0)
+        {
+            client_measure_round_trip(ROUND_TRIP_COUNT);
+            continue;
+        }
+
+        if (strcmp(test_str_buff, JOURNAL_COMMAND) == 0)
+        {
+            client_resync_journal();
+            continue;
+        }
+
 
         for (uint8_t i = 0; i < NUM_POSSIBLE_TESTS; i++)
         {
@@ -67,7 +93,7 @@ void interface_loop(void)
                 {
                     case 'y':
                     case 'Y':
-                        test_selection_byte |= (uint8_t)1 << (uint8_t)i;
+                        test_selection |= (uint32_t)1 << i;
                         // intentional fallthrough, thx
                     case 'n':
                     case 'N':
@@ -81,7 +107,7 @@ void interface_loop(void)
             }
         }
 
-        if (test_selection_byte == 0)
+        if (test_selection == 0)
         {
             printf("No tests....? \n");
             continue;
@@ -104,24 +130,113 @@ void interface_loop(void)
 
         test_iterations_byte = (uint8_t)numeric_input_int;
 
+        selection_valid = false;
+
+        while (!selection_valid && !should_terminate)
+        {
+            printf("Interactive priority, preempting bulk requests? (y/n): ");
+            fflush(stdout);
+            fgets(short_input_buff, sizeof(short_input_buff), stdin);
+
+            switch(short_input_buff[0])
+            {
+                case 'y':
+                case 'Y':
+                    test_flags_byte |= TESTPRIO_INTERACTIVE & TEST_PACKET_FLAG_PRIORITY_MASK;
+                    selection_valid = true;
+                    break;
+                case 'n':
+                case 'N':
+                    test_flags_byte |= TESTPRIO_BULK & TEST_PACKET_FLAG_PRIORITY_MASK;
+                    selection_valid = true;
+                    break;
+                default:
+                    break;
+            }
+
+            printf("\n");
+        }
+
+        selection_valid = false;
+
+        while (!selection_valid && !should_terminate)
+        {
+            printf("Stop each test at its first failed iteration? (y/n): ");
+            fflush(stdout);
+            fgets(short_input_buff, sizeof(short_input_buff), stdin);
+
+            switch(short_input_buff[0])
+            {
+                case 'y':
+                case 'Y':
+                    test_flags_byte |= TEST_PACKET_FLAG_FAIL_FAST;
+                    // intentional fallthrough
+                case 'n':
+                case 'N':
+                    selection_valid = true;
+                    break;
+                default:
+                    break;
+            }
+
+            printf("\n");
+        }
+
+        selection_valid = false;
+
+        while (!selection_valid && !should_terminate)
+        {
+            printf("Sweep peripheral settings where supported, running the iterations at each setting? (y/n): ");
+            fflush(stdout);
+            fgets(short_input_buff, sizeof(short_input_buff), stdin);
+
+            switch(short_input_buff[0])
+            {
+                case 'y':
+                case 'Y':
+                    test_flags_byte |= TEST_PACKET_FLAG_SWEEP;
+                    // intentional fallthrough
+                case 'n':
+                case 'N':
+                    selection_valid = true;
+                    break;
+                default:
+                    break;
+            }
+
+            printf("\n");
+        }
+
         if (should_terminate)
         {
             break;
         }
 
         last_test_id_client_half = (last_test_id_client_half == UINT16_MAX) ? 1 : last_test_id_client_half + 1;
-        client_fill_test_request_packet(TESTMSG_TEST_NEW_REQUEST, last_test_id_client_half, test_selection_byte, test_iterations_byte, test_str_len, test_str_buff);
+        client_fill_test_request_packet(TESTMSG_TEST_NEW_REQUEST, last_test_id_client_half, test_selection, test_iterations_byte, test_flags_byte, test_str_len, test_str_buff);
         save_last_client_test_id();
 
-        if(client_send_test_request_packet())
+        for (uint8_t attempt = 1; !should_terminate; attempt++)
         {
+            if(!client_send_test_request_packet())
+            {
+                printf("Failed to send test request.\n");
+                break;
+            }
+
             printf("Sent test request.\n");
             client_save_test_request();
-            client_await_response();
-        }
-        else
-        {
-            printf("Failed to send test request.\n");
+            uint16_t retry_after_ms = client_await_response();
+
+            if (retry_after_ms == 0) break;
+
+            if (attempt > BUSY_MAX_RETRIES)
+            {
+                printf("Device still busy after %u attempts, giving up on request.\n", attempt);
+                break;
+            }
+
+            client_backoff_sleep(retry_after_ms, attempt);
         }
     }
 
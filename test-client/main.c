@@ -4,14 +4,70 @@
  */
 
 #include "common.h"
+#include "client.h"
 #include "interface.h"
 #include "db.h"
 
-int main(void)
+/**
+ * @brief Prints the command line options.
+ */
+static void print_usage(const char *program)
+{
+    printf("Usage: %s [-p client port (0 for any, default %u)] [-s server address (default any, found by broadcast)]\n",
+        program, CLIENT_PORT);
+    printf("       %s -b (benchmarks the socket I/O, and the results the client sustains, on its own, then quits)\n", program);
+}
+
+int main(int argc, char *argv[])
 {
+    const char *port = NULL;
+    const char *server_address = NULL;
+    bool benchmark = false;
+    int option;
+
+    while ((option = getopt(argc, argv, "p:s:bh")) != -1)
+    {
+        switch (option)
+        {
+        case 'b':
+            benchmark = true;
+            break;
+        case 'p':
+            port = optarg;
+            break;
+        case 's':
+            server_address = optarg;
+            break;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!client_set_options(port, server_address))
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
     initialize_signal_handler();
+
+    if (benchmark)
+    {
+        // any free port, so as not to take the port of a client running alongside
+        client_set_options(port != NULL ? port : "0", NULL);
+        db_init(BENCHMARK_DB_PATH);
+        client_init();
+        bool measured = client_benchmark_socket_io();
+        bool sustained = client_benchmark_pipeline();
+        client_deinit();
+        db_deinit();
+        remove(BENCHMARK_DB_PATH);
+        return (measured && sustained) ? 0 : 1;
+    }
+
     interface_init();
-    db_init();
+    db_init(TESTS_DB_PATH);
     interface_loop();
     db_deinit();
 
@@ -0,0 +1,105 @@
+/**
+ * @file spsc_queue.c
+ * @brief Source file for the single producer, single consumer queues connecting the test client's threads.
+ */
+
+#include "spsc_queue.h"
+
+bool spsc_queue_init(SpscQueue_t *queue, size_t slot_size, size_t capacity)
+{
+    size_t rounded_capacity = 1;
+
+    while (rounded_capacity < capacity) rounded_capacity <<= 1;
+
+    queue->slots = calloc(rounded_capacity, slot_size);
+
+    if (queue->slots == NULL) return false;
+
+    queue->slot_size = slot_size;
+    queue->capacity = rounded_capacity;
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+
+    if (sem_init(&queue->published, 0, 0) != 0)
+    {
+        free(queue->slots);
+        queue->slots = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+void spsc_queue_deinit(SpscQueue_t *queue)
+{
+    if (queue->slots == NULL) return;
+
+    sem_destroy(&queue->published);
+    free(queue->slots);
+    queue->slots = NULL;
+}
+
+void *spsc_queue_reserve(SpscQueue_t *queue)
+{
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    // the consumer's reads of a slot are done before it releases it
+    size_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+
+    if (tail - head >= queue->capacity) return NULL;
+
+    return queue->slots + ((tail & (queue->capacity - 1)) * queue->slot_size);
+}
+
+void spsc_queue_publish(SpscQueue_t *queue)
+{
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+    // the slot's contents are visible to the consumer before the new tail is
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    sem_post(&queue->published);
+}
+
+void *spsc_queue_peek(SpscQueue_t *queue, uint32_t timeout_ms)
+{
+    int ret;
+
+    if (timeout_ms == 0)
+    {
+        ret = sem_trywait(&queue->published);
+    }
+    else
+    {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+
+        if (deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        while ((ret = sem_timedwait(&queue->published, &deadline)) != 0 && errno == EINTR && !should_terminate);
+    }
+
+    if (ret != 0) return NULL;
+
+    size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    // pairs with the release in spsc_queue_publish(), though the semaphore orders them as well
+    atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+    return queue->slots + ((head & (queue->capacity - 1)) * queue->slot_size);
+}
+
+void spsc_queue_release(SpscQueue_t *queue)
+{
+    size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+}
+
+size_t spsc_queue_count(SpscQueue_t *queue)
+{
+    return atomic_load_explicit(&queue->tail, memory_order_acquire) - atomic_load_explicit(&queue->head, memory_order_acquire);
+}
@@ -0,0 +1,70 @@
+/**
+ * @file spsc_queue.h
+ * @brief Header file for the single producer, single consumer queues connecting the test client's threads.
+ * @details
+ * A queue is a ring of fixed size slots. The producer fills the slot at the tail in place and then publishes it,
+ * and the consumer reads the slot at the head in place and then releases it, so neither takes a lock,
+ * and each index is only ever written by one side.
+ * A semaphore counts the published slots, so that an idle consumer sleeps rather than spins.
+ */
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include "common.h"
+
+#include <stdatomic.h>
+#include <semaphore.h>
+
+typedef struct SpscQueue
+{
+    /// @brief Storage for [capacity] slots of [slot_size] bytes.
+    uint8_t *slots;
+    size_t slot_size;
+    /// @brief The count of slots, a power of two.
+    size_t capacity;
+    /// @brief Count of slots released, written by the consumer only.
+    _Atomic size_t head;
+    /// @brief Count of slots published, written by the producer only.
+    _Atomic size_t tail;
+    /// @brief Count of published slots the consumer has not waited for yet.
+    sem_t published;
+} SpscQueue_t;
+
+/**
+ * @brief Allocates a queue's slots.
+ * @param [in] capacity The count of slots, rounded up to a power of two
+ * @retval true The queue is ready
+ * @retval false Allocation failed
+ */
+bool spsc_queue_init(SpscQueue_t *queue, size_t slot_size, size_t capacity);
+/**
+ * @brief Frees a queue's slots. Neither side may use the queue anymore.
+ */
+void spsc_queue_deinit(SpscQueue_t *queue);
+/**
+ * @brief Returns the slot at the tail, for the producer to fill, or NULL if the queue is full.
+ * The slot is only handed to the consumer by @ref spsc_queue_publish().
+ */
+void *spsc_queue_reserve(SpscQueue_t *queue);
+/**
+ * @brief Hands the slot last returned by @ref spsc_queue_reserve() to the consumer.
+ */
+void spsc_queue_publish(SpscQueue_t *queue);
+/**
+ * @brief Waits for the slot at the head to be published, and returns it for the consumer to read.
+ * The slot stays the consumer's until @ref spsc_queue_release().
+ * @param [in] timeout_ms How long to wait, 0 to return at once
+ * @return The slot, or NULL if none was published in time
+ */
+void *spsc_queue_peek(SpscQueue_t *queue, uint32_t timeout_ms);
+/**
+ * @brief Hands the slot last returned by @ref spsc_queue_peek() back to the producer.
+ */
+void spsc_queue_release(SpscQueue_t *queue);
+/**
+ * @brief Returns the count of published slots the consumer has not released yet.
+ */
+size_t spsc_queue_count(SpscQueue_t *queue);
+
+#endif
@@ -0,0 +1,140 @@
+/**
+ * @file i2c_timing_test.c
+ * @brief Host test for the server's I2C TIMINGR calculator (f756-peripheral-tests-server/App/i2c_timing.c).
+ * @details
+ * Built and run with `make test`. Every computed value is decoded and checked against the reference manual's
+ * I2C timing constraints, for the I2C kernel clock the server runs at (PCLK1, see RCC.I2C1Freq_Value in the .ioc).
+ * Core/Src/i2c.c only holds CubeMX's Standard mode value, which must pass the same checks,
+ * and run the bus at the same SCL frequency as the computed value.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "i2c_timing.h"
+
+#define I2CCLK_HZ (36000000)
+/// @brief The TIMINGR CubeMX generated for both I2C peripherals (100 kHz, rise and fall times of 0 ns).
+#define CUBEMX_STANDARD_TIMINGR (0x00808CD2)
+/// @brief How far the computed SCL frequency may fall below the requested one, in percent.
+#define SCL_TOLERANCE_PERCENT (3)
+
+#define PS_PER_NS (1000ULL)
+#define PS_PER_S (1000000000000ULL)
+/// @brief The analog filter's delay range, in ns.
+#define ANALOG_FILTER_MIN_NS (50)
+#define ANALOG_FILTER_MAX_NS (260)
+
+/**
+ * @brief I2C specification limits of a speed mode, in ns.
+ */
+typedef struct BusSpec
+{
+    const char *name;
+    uint32_t bus_hz;
+    uint32_t low_min_ns;
+    uint32_t high_min_ns;
+    uint32_t data_setup_min_ns;
+    uint32_t data_valid_max_ns;
+} BusSpec_t;
+
+static const BusSpec_t standard_spec = { "Standard", I2C_TIMING_STANDARD_HZ, 4700, 4000, 250, 3450 };
+static const BusSpec_t fast_spec = { "Fast", I2C_TIMING_FAST_HZ, 1300, 600, 100, 900 };
+static const BusSpec_t fast_plus_spec = { "Fast-mode Plus", I2C_TIMING_FAST_PLUS_HZ, 500, 260, 50, 450 };
+
+static int failures = 0;
+
+static void check(bool condition, const char *what, const char *spec_name, uint32_t timingr)
+{
+    if (condition) return;
+
+    printf("FAIL %s, TIMINGR 0x%08X: %s\n", spec_name, timingr, what);
+    failures++;
+}
+
+/**
+ * @brief Decodes a TIMINGR value, and checks its SCL phases and data delays against the mode's limits.
+ */
+static void check_timingr(const BusSpec_t *spec, uint32_t timingr, uint32_t rise_ns, uint32_t fall_ns)
+{
+    // durations are converted from whole kernel clock counts, as a single clock is not a whole count of ps
+    uint64_t presc = ((timingr >> 28) & 0xF) + 1;
+    uint64_t scldel_ps = (((timingr >> 20) & 0xF) + 1) * presc * PS_PER_S / I2CCLK_HZ;
+    uint64_t sdadel_ps = ((timingr >> 16) & 0xF) * presc * PS_PER_S / I2CCLK_HZ;
+    // each SCL phase is stretched by at least the analog filter delay and 2 kernel clocks of synchronization
+    uint64_t sync_ps = (ANALOG_FILTER_MIN_NS * PS_PER_NS) + (2 * PS_PER_S / I2CCLK_HZ);
+    uint64_t high_ps = ((((timingr >> 8) & 0xFF) + 1) * presc * PS_PER_S / I2CCLK_HZ) + sync_ps;
+    uint64_t low_ps = (((timingr & 0xFF) + 1) * presc * PS_PER_S / I2CCLK_HZ) + sync_ps;
+    int64_t sdadel_min_ps = (int64_t)(fall_ns * PS_PER_NS) - (int64_t)(ANALOG_FILTER_MIN_NS * PS_PER_NS)
+        - (int64_t)(3 * PS_PER_S / I2CCLK_HZ);
+    int64_t sdadel_max_ps = (int64_t)(spec->data_valid_max_ns * PS_PER_NS) - (int64_t)(rise_ns * PS_PER_NS)
+        - (int64_t)(ANALOG_FILTER_MAX_NS * PS_PER_NS) - (int64_t)(4 * PS_PER_S / I2CCLK_HZ);
+
+    check(low_ps >= spec->low_min_ns * PS_PER_NS, "SCL low period below tLOW(min)", spec->name, timingr);
+    check(high_ps >= spec->high_min_ns * PS_PER_NS, "SCL high period below tHIGH(min)", spec->name, timingr);
+    check(scldel_ps >= (rise_ns + spec->data_setup_min_ns) * PS_PER_NS, "SCLDEL below tr + tSU;DAT(min)", spec->name, timingr);
+    check((int64_t)sdadel_ps >= sdadel_min_ps, "SDADEL below tf - tAF(min) - 3 tI2CCLK", spec->name, timingr);
+    check((int64_t)sdadel_ps <= sdadel_max_ps, "SDADEL above tVD;DAT(max) - tr - tAF(max) - 4 tI2CCLK", spec->name, timingr);
+}
+
+/**
+ * @brief Computes a TIMINGR value for the mode's fastest bus clock, and checks it.
+ * @return The SCL frequency the value yields, 0 if none was computed
+ */
+static uint32_t check_mode(const BusSpec_t *spec, uint32_t rise_ns, uint32_t fall_ns)
+{
+    uint32_t timingr = 0;
+
+    if (!i2c_timing_compute(I2CCLK_HZ, spec->bus_hz, rise_ns, fall_ns, &timingr))
+    {
+        check(false, "no value computed", spec->name, timingr);
+        return 0;
+    }
+
+    uint32_t scl_hz = i2c_timing_scl_hz(I2CCLK_HZ, timingr, rise_ns, fall_ns);
+
+    check_timingr(spec, timingr, rise_ns, fall_ns);
+    check(scl_hz <= spec->bus_hz, "SCL faster than requested", spec->name, timingr);
+    check(scl_hz >= spec->bus_hz / 100 * (100 - SCL_TOLERANCE_PERCENT), "SCL too far below the requested clock", spec->name, timingr);
+
+    printf("%-14s rise %4u ns, fall %3u ns: TIMINGR 0x%08X, SCL %u Hz\n", spec->name, rise_ns, fall_ns, timingr, scl_hz);
+
+    return scl_hz;
+}
+
+int main(void)
+{
+    uint32_t timingr = 0;
+
+    // the edge times CubeMX was given, then the slowest edges each mode allows from this kernel clock
+    uint32_t standard_hz = check_mode(&standard_spec, 0, 0);
+    check_mode(&fast_spec, 0, 0);
+    check_mode(&fast_plus_spec, 0, 0);
+    check_mode(&standard_spec, 1000, 300);
+    check_mode(&fast_spec, 300, 300);
+    check_mode(&fast_plus_spec, 50, 50);
+
+    check_timingr(&standard_spec, CUBEMX_STANDARD_TIMINGR, 0, 0);
+    uint32_t cubemx_hz = i2c_timing_scl_hz(I2CCLK_HZ, CUBEMX_STANDARD_TIMINGR, 0, 0);
+    uint32_t difference_hz = (standard_hz > cubemx_hz) ? standard_hz - cubemx_hz : cubemx_hz - standard_hz;
+    printf("%-14s CubeMX TIMINGR 0x%08X, SCL %u Hz\n", standard_spec.name, CUBEMX_STANDARD_TIMINGR, cubemx_hz);
+    check(difference_hz <= cubemx_hz / 100, "SCL more than 1% off CubeMX's", standard_spec.name, CUBEMX_STANDARD_TIMINGR);
+
+    // out of range requests must be rejected
+    check(!i2c_timing_compute(I2CCLK_HZ, I2C_TIMING_FAST_PLUS_HZ + 1, 0, 0, &timingr), "faster than Fast-mode Plus accepted", "Rejection", timingr);
+    check(!i2c_timing_compute(I2CCLK_HZ, 0, 0, 0, &timingr), "0 Hz accepted", "Rejection", timingr);
+    check(!i2c_timing_compute(0, I2C_TIMING_STANDARD_HZ, 0, 0, &timingr), "0 Hz kernel clock accepted", "Rejection", timingr);
+    check(!i2c_timing_compute(I2CCLK_HZ, I2C_TIMING_FAST_HZ, 1000, 300, &timingr), "rise time beyond Fast mode's accepted", "Rejection", timingr);
+    // tVD;DAT(max) leaves no room for the data hold delay with edges this slow, at this kernel clock
+    check(!i2c_timing_compute(I2CCLK_HZ, I2C_TIMING_FAST_PLUS_HZ, 120, 120, &timingr), "unreachable Fast-mode Plus data valid time accepted", "Rejection", timingr);
+
+    if (failures > 0)
+    {
+        printf("%d checks failed.\n", failures);
+        return 1;
+    }
+
+    printf("All checks passed.\n");
+    return 0;
+}
@@ -15,17 +15,97 @@
  |   Pairing Packet  |START(1)|MSG(1)|END(1)|
  |      3 bytes      |0       |1     |2     |
  @endverbatim
+ * * Beacon packets answer a client's pairing probe, unicast to the prober, and identify the server:
+ * the board's unique ID, the firmware version, the registered tests (as a SELECTION mask) and the optional features built in.
+ @verbatim
+ |   Beacon Packet   |START(1)|MSG(1)|UID(12)|VERSION MAJOR(1)|VERSION MINOR(1)|TESTS(4)|FEATURES(1)|END(1)|
+ |     22 bytes      |0       |1     |2      |14              |15              |16      |20         |21    |
+ @endverbatim
  * * Message packets are slightly larger and include the Test ID and Selection fields,
  * to carry messages pertaining to an existing test request.
  @verbatim
- |Test Message Packet|START(1)|MSG(1)|TEST ID(4)|SELECTION(1)|END(1)|
- |      8 bytes      |0       |1     |2         |6           |7     |
+ |Test Message Packet|START(1)|MSG(1)|TEST ID(4)|SELECTION(4)|END(1)|
+ |     11 bytes      |0       |1     |2         |6           |10    |
  @endverbatim
  * * Request packets are only used for requesting an entirely new test,
  * and are the largest as they carry a test string of variable length.
  @verbatim
- |Test Request Packet|START(1)|MSG(1)|TEST ID(4)|SELECTION(1)|ITERATIONS(1)|STRLEN(1)|STRING(0-150)|END(1)|
- |   10-160 bytes    |0       |1     |2         |6           | 7           |8        |9            |9-159 |
+ |Test Request Packet|START(1)|MSG(1)|TEST ID(4)|SELECTION(4)|ITERATIONS(1)|FLAGS(1)|STRLEN(1)|STRING(0-150)|END(1)|
+ |   14-164 bytes    |0       |1     |2         |6           |10           |11      |12       |13           |13-163|
+ @endverbatim
+ * * Results packets conclude a test request. Following the SELECTION field (which marks the passed tests),
+ * they carry a block of failure statistics per test type (in @ref PeripheralTestIdx_t order).
+ @verbatim
+ |  Results Packet   |START(1)|MSG(1)|TEST ID(4)|SELECTION(4)|{RESULTS DETAIL(9)} x NUM_POSSIBLE_TESTS|END(1)|
+ |     56 bytes      |0       |1     |2         |6           |10                                      |55    |
+
+ |  Results Detail   |DONE(1)|FAILED(1)|TIMEOUTS(1)|DATA ERRORS(1)|BIT ERRORS(4)|FIRST ERROR OFFSET(1)|
+ |      9 bytes      |0      |1        |2          |3             |4            |8                    |
+ @endverbatim
+ * * Progress packets are sent periodically by a server while a test request is running.
+ * Following the SELECTION field, they carry a pair of counters per test type (in @ref PeripheralTestIdx_t order):
+ * the number of iterations done and the number of iterations failed so far.
+ @verbatim
+ |  Progress Packet  |START(1)|MSG(1)|TEST ID(4)|SELECTION(4)|{DONE(1)|FAILED(1)} x NUM_POSSIBLE_TESTS|END(1)|
+ |     21 bytes      |0       |1     |2         |6           |10                                     |20    |
+ @endverbatim
+ * * Sweep packets are sent by a server running a request in sweep mode (@ref TEST_PACKET_FLAG_SWEEP),
+ * one for each step a test has completed, carrying the setting of the step and its measurements.
+ @verbatim
+ |   Sweep Packet    |START(1)|MSG(1)|TEST ID(4)|TEST(1)|STEP(1)|STEP COUNT(1)|SETTING(4)|THROUGHPUT(4)|TRANSFERS(2)|ERRORS(2)|BUS ERRORS(2)|NACKS(2)|ARB LOSSES(2)|END(1)|
+ |     28 bytes      |0       |1     |2         |6      |7      |8            |9         |13           |17          |19        |21           |23      |25           |27    |
+ @endverbatim
+ * * Noise packets follow the sweep packets of steps that sampled an analog input (the ADC sweep),
+ * carrying the statistics of the step's samples.
+ @verbatim
+ |   Noise Packet    |START(1)|MSG(1)|TEST ID(4)|STEP(1)|SAMPLES(4)|MIN(2)|MAX(2)|MEAN(4)|STDDEV(4)|CENTER(2)|HISTOGRAM(4 x 8)|END(1)|
+ |     58 bytes      |0       |1     |2         |6      |7         |11    |13    |15     |19       |23       |25              |57    |
+ @endverbatim
+ * * Capture packets follow the sweep packets of steps that captured PWM periods (the timer sweep),
+ * carrying the statistics of the captured periods, with all durations in picoseconds.
+ @verbatim
+ |  Capture Packet   |START(1)|MSG(1)|TEST ID(4)|STEP(1)|EDGES(4)|DUTY ERR MEAN(4)|DUTY ERR MIN(4)|DUTY ERR MAX(4)|DUTY JITTER(4)|PERIOD JITTER(4)|FREQ ERR PPM(4)|END(1)|
+ |     36 bytes      |0       |1     |2         |6      |7       |11              |15             |19             |23            |27              |31             |35    |
+ @endverbatim
+ * * Busy packets are sent by a server in place of an acknowledgement, when its test queue is full.
+ * They carry the current queue depth and the delay after which the client may retry the same request.
+ @verbatim
+ |    Busy Packet    |START(1)|MSG(1)|TEST ID(4)|QUEUE DEPTH(1)|RETRY AFTER MS(2)|END(1)|
+ |     10 bytes      |0       |1     |2         |6             |7                |9     |
+ @endverbatim
+ * * Telemetry packets answer a client's telemetry request (sent in a pairing sized packet) with the usage of the server's
+ * network buffers, one block per @ref TelemetryPool_t, followed by the count of packets dropped on full mailboxes or in UDP.
+ @verbatim
+ | Telemetry Packet  |START(1)|MSG(1)|FLAGS(1)|{AVAIL(2)|USED(2)|MAX(2)|ERR(2)} x NUM_TELEMETRY_POOLS|MBOX ERRORS(2)|UDP DROPS(2)|END(1)|
+ |     56 bytes      |0       |1     |2       |3                                                    |51            |53           |55    |
+ @endverbatim
+ * * Boot profile packets answer a client's boot profile request (sent in a pairing sized packet) with the time from reset
+ * at which the server reached each @ref BootStage_t, in microseconds (0 for stages not reached yet).
+ @verbatim
+ |Boot Profile Packet|START(1)|MSG(1)|FLAGS(1)|{STAGE US(4)} x NUM_BOOT_STAGES|END(1)|
+ |     44 bytes      |0       |1     |2       |3                              |43    |
+ @endverbatim
+ * * Journal packets answer a client's journal fetch request with the server's journaled results following a record ID,
+ * several records per packet, in bursts of packets. AFTER ID is the ID of the record preceding the packet's first one
+ * (the fetch request's SINCE ID in the first packet of a burst), so that a client notices a lost packet.
+ * Every record carries the results of a concluded request, along with what the client needs to file them
+ * (the requested tests and iterations, and the request's duration), followed by an FNV-1a checksum of the record.
+ @verbatim
+ |Journal Fetch Packet|START(1)|MSG(1)|SINCE ID(4)|END(1)|
+ |      7 bytes       |0       |1     |2          |6     |
+
+ |  Journal Packet   |START(1)|MSG(1)|FLAGS(1)|COUNT(1)|AFTER ID(4)|{JOURNAL RECORD(72)} x COUNT|END(1)|
+ |   9-1161 bytes    |0       |1     |2       |3       |4          |8                           |8-1160|
+
+ |  Journal Record   |RECORD ID(4)|TEST ID(4)|SELECTION(4)|PASSED(4)|DURATION MS(4)|ITERATIONS(1)|{RESULTS DETAIL(9)} x NUM_POSSIBLE_TESTS|PADDING(2)|CHECKSUM(4)|
+ |     72 bytes      |0           |4         |8           |12       |16            |20           |21                                      |66        |68         |
+ @endverbatim
+ * * Batch packets carry several packets a server sent the same client within a short window, each prefixed with its length,
+ * when the server is built to aggregate them (see transmitter.h). Only packets about test requests are batched
+ * (acknowledgements, busy, progress, sweep steps, results and cancellation acknowledgements), never a lone packet.
+ @verbatim
+ |   Batch Packet    |START(1)|MSG(1)|COUNT(1)|{LEN(1)|PACKET(LEN)} x COUNT|END(1)|
+ |   4-512 bytes     |0       |1     |2       |3                           |3-511 |
  @endverbatim
  * 
  * "Why all these cumbersome offsets? Why not use a struct?"
@@ -43,24 +123,104 @@
 #define SERVER_PORT (45678)
 
 /**
- * @brief The pre-determined fixed size of "pairing" packets (@ref TESTMSG_PAIRING_BEACON, @ref TESTMSG_PAIRING_PROBE).
+ * @brief The pre-determined fixed size of "pairing" packets (@ref TESTMSG_PAIRING_PROBE).
  */
 #define PAIRING_PACKET_SIZE_BYTES (3)
 
 /**
- * @brief The pre-determined fixed size of "test message" packets (@ref TESTMSG_TEST_NEW_ACK, @ref TESTMSG_TEST_START_ACK, @ref TESTMSG_TEST_START_REQUEST).
+ * @brief The pre-determined fixed size of "beacon" packets (@ref TESTMSG_PAIRING_BEACON).
+ */
+#define TEST_BEACON_PACKET_SIZE_BYTES (22)
+
+/**
+ * @brief The pre-determined fixed size of "test message" packets (@ref TESTMSG_TEST_NEW_ACK, @ref TESTMSG_TEST_START_ACK, @ref TESTMSG_TEST_START_REQUEST,
+ * @ref TESTMSG_TEST_CANCEL_REQUEST, @ref TESTMSG_TEST_CANCEL_ACK).
+ */
+#define TEST_MSG_PACKET_SIZE_BYTES (11)
+
+/**
+ * @brief The pre-determined fixed size of "busy" packets (@ref TESTMSG_TEST_NEW_BUSY).
+ */
+#define TEST_BUSY_PACKET_SIZE_BYTES (10)
+
+/**
+ * @brief The pre-determined fixed size of "results" packets (@ref TESTMSG_TEST_OVER_RESULTS).
+ */
+#define TEST_RESULTS_PACKET_SIZE_BYTES (TEST_PACKET_RESULTS_DETAIL_OFFSET + (TEST_RESULTS_DETAIL_SIZE_BYTES * NUM_POSSIBLE_TESTS) + 1)
+
+/**
+ * @brief The pre-determined fixed size of "progress" packets (@ref TESTMSG_TEST_PROGRESS).
  */
-#define TEST_MSG_PACKET_SIZE_BYTES (8)
+#define TEST_PROGRESS_PACKET_SIZE_BYTES (TEST_PACKET_PROGRESS_COUNTERS_OFFSET + (2 * NUM_POSSIBLE_TESTS) + 1)
+
+/**
+ * @brief The pre-determined fixed size of "sweep" packets (@ref TESTMSG_TEST_SWEEP_STEP).
+ */
+#define TEST_SWEEP_PACKET_SIZE_BYTES (28)
+
+/**
+ * @brief The pre-determined fixed size of "noise" packets (@ref TESTMSG_TEST_SWEEP_NOISE).
+ */
+#define TEST_NOISE_PACKET_SIZE_BYTES (TEST_PACKET_NOISE_HISTOGRAM_OFFSET + (4 * TEST_PACKET_NOISE_HISTOGRAM_BINS) + 1)
+
+/**
+ * @brief The pre-determined fixed size of "capture" packets (@ref TESTMSG_TEST_SWEEP_CAPTURE).
+ */
+#define TEST_CAPTURE_PACKET_SIZE_BYTES (36)
+
+/**
+ * @brief The pre-determined fixed size of "telemetry" packets (@ref TESTMSG_TELEMETRY).
+ */
+#define TEST_TELEMETRY_PACKET_SIZE_BYTES (TEST_PACKET_TELEMETRY_POOLS_OFFSET + (TEST_TELEMETRY_POOL_SIZE_BYTES * NUM_TELEMETRY_POOLS) + 5)
+
+/**
+ * @brief The pre-determined fixed size of "boot profile" packets (@ref TESTMSG_BOOT_PROFILE).
+ */
+#define TEST_BOOT_PROFILE_PACKET_SIZE_BYTES (TEST_PACKET_BOOT_STAGES_OFFSET + (4 * NUM_BOOT_STAGES) + 1)
+
+/**
+ * @brief The pre-determined fixed size of "journal fetch" packets (@ref TESTMSG_JOURNAL_FETCH_REQUEST).
+ */
+#define TEST_JOURNAL_FETCH_PACKET_SIZE_BYTES (7)
+
+/**
+ * @brief The size of the journal records carried by journal packets, a whole count of 32 bit words
+ * (so that a server programs them into flash a word at a time).
+ */
+#define TEST_JOURNAL_RECORD_SIZE_BYTES ((TEST_JOURNAL_RECORD_DETAIL_OFFSET + (TEST_RESULTS_DETAIL_SIZE_BYTES * NUM_POSSIBLE_TESTS) + 4 + 3) & ~3)
+
+/**
+ * @brief The largest count of records in a single journal packet.
+ */
+#define TEST_JOURNAL_RECORDS_PER_PACKET (16)
+
+/**
+ * @brief The size of the largest "journal" packets (@ref TESTMSG_JOURNAL_RECORDS), those carrying
+ * @ref TEST_JOURNAL_RECORDS_PER_PACKET records.
+ */
+#define TEST_JOURNAL_PACKET_MAX_SIZE_BYTES (TEST_PACKET_JOURNAL_RECORDS_OFFSET + (TEST_JOURNAL_RECORD_SIZE_BYTES * TEST_JOURNAL_RECORDS_PER_PACKET) + 1)
+
+/**
+ * @brief The size of the largest "batch" packets (@ref TESTMSG_BATCH), which fits a few results packets.
+ */
+#define TEST_BATCH_PACKET_MAX_SIZE_BYTES (512)
+
+/**
+ * @brief The size of the largest fixed size packet a server sends (@ref TESTMSG_TEST_SWEEP_NOISE,
+ * or @ref TESTMSG_TEST_OVER_RESULTS once enough test types are registered).
+ */
+#define SERVER_PACKET_MAX_SIZE_BYTES (TEST_RESULTS_PACKET_SIZE_BYTES > TEST_NOISE_PACKET_SIZE_BYTES \
+		? TEST_RESULTS_PACKET_SIZE_BYTES : TEST_NOISE_PACKET_SIZE_BYTES)
 
 /**
  * @brief The absolute minimum size of "test request" packets, which currently only includes @ref TESTMSG_TEST_NEW_REQUEST.
  */
-#define TEST_REQUEST_PACKET_MIN_SIZE_BYTES (10)
+#define TEST_REQUEST_PACKET_MIN_SIZE_BYTES (14)
 
 /**
  * @brief The absolute maximum size of "test request" packets, which currently only includes "new test request".
  */
-#define TEST_REQUEST_PACKET_MAX_SIZE_BYTES (160)
+#define TEST_REQUEST_PACKET_MAX_SIZE_BYTES (164)
 
 /**
  * @brief The pre-determined value of the very first byte, to help filter foreign or malformed packets.
@@ -95,30 +255,65 @@
 #define TEST_PACKET_ID_BYTE_OFFSET (2)
 
 /**
- * @brief the 'offset' (array index) of the 'selection' byte in a packet.
+ * @brief the 'offset' (array index) of the 'selection' field in a packet.
  * @details
- * The SELECTION byte is used by the client to inform the server which tests are requested,
+ * The SELECTION field is a 32 bit value in network byte order, used by the client to inform the server which tests are requested,
  * and by the server in test results to indicate which of the requested tests have passed.
- * the test types are represented by the individual bits, with a 1 indicating that a test
+ * the test types are represented by the individual bits (up to @ref TEST_SELECTION_MAX_TESTS of them), with a 1 indicating that a test
  * has been requested or passed, respectively. it is also used by the server in acknowledgements,
  * to indicate whether a request has been accepted or rejected (1 and 0 respectively).
  * with the exception of a "new test request" packet, it is immediately followed by the END byte.
  */
-#define TEST_PACKET_SELECTION_BYTE_OFFSET (6)
+#define TEST_PACKET_SELECTION_OFFSET (6)
+
+/**
+ * @brief The number of test types the SELECTION field can address.
+ */
+#define TEST_SELECTION_MAX_TESTS (32)
 
 /**
  * @brief the 'offset' (array index) of the 'test iterations' byte in a packet.
  * @details
  * The ITERATIONS byte is used by the client to inform the server how many test iterations are requested.
  */
-#define TEST_PACKET_ITERATIONS_BYTE_OFFSET (7)
+#define TEST_PACKET_ITERATIONS_BYTE_OFFSET (10)
+
+/**
+ * @brief the 'offset' (array index) of the 'flags' byte in a packet.
+ * @details
+ * The FLAGS byte is used by the client to qualify how a new test request should be handled.
+ * Its low bits hold the request's @ref TestPriority_t class (see @ref TEST_PACKET_FLAG_PRIORITY_MASK).
+ */
+#define TEST_PACKET_FLAGS_BYTE_OFFSET (11)
+
+/**
+ * @brief Mask of the FLAGS byte bits holding the request's @ref TestPriority_t class.
+ */
+#define TEST_PACKET_FLAG_PRIORITY_MASK (0x03)
+
+/**
+ * @brief FLAGS byte bit requesting that each test stops at its first failed iteration.
+ * @details
+ * When clear, every requested iteration is run and failures are counted,
+ * with any failure still marking the test as failed in the results.
+ */
+#define TEST_PACKET_FLAG_FAIL_FAST (0x04)
+
+/**
+ * @brief FLAGS byte bit requesting that each selected test sweeps its peripheral settings.
+ * @details
+ * Tests with a sweep implementation run the ITERATIONS count of transfers at every setting,
+ * reporting each step in a "sweep" packet, and pass if at least one setting was error-free.
+ * Tests without one run their plain iterations as usual.
+ */
+#define TEST_PACKET_FLAG_SWEEP (0x08)
 
 /**
  * @brief the 'offset' (array index) of the 'string length' byte in a packet.
  * @details
  * The STRING_LEN byte is used by the client to indicate the length of the following test string.
  */
-#define TEST_PACKET_STRING_LEN_OFFSET (8)
+#define TEST_PACKET_STRING_LEN_OFFSET (12)
 
 /**
  * @brief the 'offset' (array index) of the 'string head' byte in a packet.
@@ -126,19 +321,508 @@
  * The STRING_HEAD byte is the first byte of the string included in a "new test request" packet.
  * in a "new test request" packet, the final byte of this string is immediately followed by the END byte.
  */
-#define TEST_PACKET_STRING_HEAD_OFFSET (9)
+#define TEST_PACKET_STRING_HEAD_OFFSET (13)
+
+/**
+ * @brief the 'offset' (array index) of the first results detail block in a results packet.
+ * @details
+ * The detail block of test type N is at this offset + (N * @ref TEST_RESULTS_DETAIL_SIZE_BYTES).
+ */
+#define TEST_PACKET_RESULTS_DETAIL_OFFSET (10)
+
+/**
+ * @brief The size of the results detail block of a single test type.
+ */
+#define TEST_RESULTS_DETAIL_SIZE_BYTES (9)
+
+/**
+ * @brief the 'offset' (within a results detail block) of the 'iterations done' byte.
+ */
+#define TEST_RESULTS_DETAIL_DONE_OFFSET (0)
+
+/**
+ * @brief the 'offset' (within a results detail block) of the 'iterations failed' byte.
+ * @details
+ * Every failed iteration is counted either as a timeout or as a data error.
+ */
+#define TEST_RESULTS_DETAIL_FAILED_OFFSET (1)
+
+/**
+ * @brief the 'offset' (within a results detail block) of the 'timeouts' byte.
+ * @details
+ * Counts iterations failed because a peripheral operation did not complete (timeout, bus or HAL error).
+ */
+#define TEST_RESULTS_DETAIL_TIMEOUTS_OFFSET (2)
+
+/**
+ * @brief the 'offset' (within a results detail block) of the 'data errors' byte.
+ * @details
+ * Counts iterations that completed, but whose transferred or measured data did not match the reference.
+ */
+#define TEST_RESULTS_DETAIL_DATA_ERRORS_OFFSET (3)
+
+/**
+ * @brief the 'offset' (within a results detail block) of the 'bit errors' field.
+ * @details
+ * The BIT ERRORS field is a 32 bit value in network byte order, holding the total count of
+ * flipped bits between the reference and the transferred data, over all iterations.
+ */
+#define TEST_RESULTS_DETAIL_BIT_ERRORS_OFFSET (4)
+
+/**
+ * @brief the 'offset' (within a results detail block) of the 'first error offset' byte.
+ * @details
+ * Holds the offset of the earliest mismatching byte seen in the test string over all iterations,
+ * or @ref TEST_RESULTS_NO_ERROR_OFFSET if no data mismatch was seen.
+ */
+#define TEST_RESULTS_DETAIL_FIRST_ERROR_OFFSET (8)
+
+/**
+ * @brief 'first error offset' value indicating that no data mismatch was seen.
+ */
+#define TEST_RESULTS_NO_ERROR_OFFSET (0xFF)
+
+/**
+ * @brief the 'offset' (array index) of the first progress counter in a progress packet.
+ * @details
+ * The 'iterations done' counter of test type N is at this offset + 2N,
+ * and its 'iterations failed' counter immediately follows.
+ */
+#define TEST_PACKET_PROGRESS_COUNTERS_OFFSET (10)
+
+/**
+ * @brief the 'offset' (array index) of the 'test' byte in a sweep packet, holding a @ref PeripheralTestIdx_t value.
+ */
+#define TEST_PACKET_SWEEP_TEST_OFFSET (6)
+
+/**
+ * @brief the 'offset' (array index) of the zero based 'step' byte in a sweep packet.
+ */
+#define TEST_PACKET_SWEEP_STEP_OFFSET (7)
+
+/**
+ * @brief the 'offset' (array index) of the 'step count' byte in a sweep packet, holding the total steps of the test's sweep.
+ */
+#define TEST_PACKET_SWEEP_STEP_COUNT_OFFSET (8)
+
+/**
+ * @brief the 'offset' (array index) of the 'setting' field in a sweep packet.
+ * @details
+ * The SETTING field is a 32 bit value in network byte order, holding the setting the step ran at,
+ * such as a baud rate or a bus clock frequency in Hz.
+ */
+#define TEST_PACKET_SWEEP_SETTING_OFFSET (9)
+
+/**
+ * @brief the 'offset' (array index) of the 'throughput' field in a sweep packet.
+ * @details
+ * The THROUGHPUT field is a 32 bit value in network byte order, holding the bytes per second
+ * measured over the step's error-free transfers (0 if there were none).
+ * For the ADC sweep, it holds the achieved sample rate in samples per second instead.
+ */
+#define TEST_PACKET_SWEEP_THROUGHPUT_OFFSET (13)
+
+/**
+ * @brief the 'offset' (array index) of the 'transfers' field (16 bit, network byte order) in a sweep packet.
+ */
+#define TEST_PACKET_SWEEP_TRANSFERS_OFFSET (17)
+
+/**
+ * @brief the 'offset' (array index) of the 'errors' field (16 bit, network byte order) in a sweep packet.
+ * @details
+ * Counts the step's transfers that timed out or whose data did not match the reference.
+ */
+#define TEST_PACKET_SWEEP_ERRORS_OFFSET (19)
+
+/**
+ * @brief the 'offset' (array index) of the 'bus errors' field (16 bit, network byte order) in a sweep packet.
+ * @details
+ * Counts the step's transfers during which the peripheral flagged a bus level error (e.g. framing, noise, overrun).
+ */
+#define TEST_PACKET_SWEEP_BUS_ERRORS_OFFSET (21)
+
+/**
+ * @brief the 'offset' (array index) of the 'NACKs' field (16 bit, network byte order) in a sweep packet.
+ * @details
+ * Counts the step's transfers that were not acknowledged by their addressee (I2C only, 0 otherwise).
+ */
+#define TEST_PACKET_SWEEP_NACKS_OFFSET (23)
+
+/**
+ * @brief the 'offset' (array index) of the 'arbitration losses' field (16 bit, network byte order) in a sweep packet.
+ * @details
+ * Counts the step's transfers during which a master lost bus arbitration (I2C only, 0 otherwise).
+ */
+#define TEST_PACKET_SWEEP_ARB_LOSSES_OFFSET (25)
+
+/**
+ * @brief the 'offset' (array index) of the zero based 'step' byte in a noise packet, matching the preceding sweep packet.
+ */
+#define TEST_PACKET_NOISE_STEP_OFFSET (6)
+
+/**
+ * @brief the 'offset' (array index) of the 'samples' field (32 bit, network byte order) in a noise packet.
+ */
+#define TEST_PACKET_NOISE_SAMPLES_OFFSET (7)
+
+/**
+ * @brief the 'offset' (array index) of the 'min' field (16 bit, network byte order) in a noise packet, holding the lowest sample.
+ */
+#define TEST_PACKET_NOISE_MIN_OFFSET (11)
+
+/**
+ * @brief the 'offset' (array index) of the 'max' field (16 bit, network byte order) in a noise packet, holding the highest sample.
+ */
+#define TEST_PACKET_NOISE_MAX_OFFSET (13)
+
+/**
+ * @brief the 'offset' (array index) of the 'mean' field (32 bit, network byte order) in a noise packet.
+ * @details
+ * The MEAN field holds the mean of the samples in thousandths of an LSB.
+ */
+#define TEST_PACKET_NOISE_MEAN_OFFSET (15)
+
+/**
+ * @brief the 'offset' (array index) of the 'stddev' field (32 bit, network byte order) in a noise packet.
+ * @details
+ * The STDDEV field holds the standard deviation of the samples (their RMS noise) in thousandths of an LSB.
+ */
+#define TEST_PACKET_NOISE_STDDEV_OFFSET (19)
+
+/**
+ * @brief the 'offset' (array index) of the 'center' field (16 bit, network byte order) in a noise packet.
+ * @details
+ * The CENTER field holds the code the histogram bins are centered on (the rounded mean of the first samples).
+ */
+#define TEST_PACKET_NOISE_CENTER_OFFSET (23)
+
+/**
+ * @brief the 'offset' (array index) of the histogram in a noise packet.
+ * @details
+ * The histogram is made of @ref TEST_PACKET_NOISE_HISTOGRAM_BINS 32 bit counters in network byte order.
+ * Bin N counts the samples at CENTER + N - (BINS / 2), and the first and last bins also count the samples below and above them.
+ */
+#define TEST_PACKET_NOISE_HISTOGRAM_OFFSET (25)
+
+/**
+ * @brief Number of 1 LSB wide bins in the histogram of a noise packet.
+ */
+#define TEST_PACKET_NOISE_HISTOGRAM_BINS (8)
+
+/**
+ * @brief the 'offset' (array index) of the zero based 'step' byte in a capture packet, matching the preceding sweep packet.
+ */
+#define TEST_PACKET_CAPTURE_STEP_OFFSET (6)
+
+/**
+ * @brief the 'offset' (array index) of the 'edges' field (32 bit, network byte order) in a capture packet, holding the count of captured periods.
+ */
+#define TEST_PACKET_CAPTURE_EDGES_OFFSET (7)
+
+/**
+ * @brief the 'offset' (array index) of the 'duty error mean' field (signed 32 bit, network byte order) in a capture packet.
+ * @details
+ * The DUTY ERR fields hold the mean, lowest and highest difference between the captured high times and the generated ones.
+ * They include the latency of the input path, by which the loopback stretches every pulse.
+ */
+#define TEST_PACKET_CAPTURE_DUTY_ERR_MEAN_OFFSET (11)
+
+/**
+ * @brief the 'offset' (array index) of the 'duty error min' field (signed 32 bit, network byte order) in a capture packet.
+ */
+#define TEST_PACKET_CAPTURE_DUTY_ERR_MIN_OFFSET (15)
+
+/**
+ * @brief the 'offset' (array index) of the 'duty error max' field (signed 32 bit, network byte order) in a capture packet.
+ */
+#define TEST_PACKET_CAPTURE_DUTY_ERR_MAX_OFFSET (19)
+
+/**
+ * @brief the 'offset' (array index) of the 'duty jitter' field (32 bit, network byte order) in a capture packet, holding the standard deviation of the duty errors.
+ */
+#define TEST_PACKET_CAPTURE_DUTY_JITTER_OFFSET (23)
+
+/**
+ * @brief the 'offset' (array index) of the 'period jitter' field (32 bit, network byte order) in a capture packet, holding the standard deviation of the captured periods.
+ */
+#define TEST_PACKET_CAPTURE_PERIOD_JITTER_OFFSET (27)
+
+/**
+ * @brief the 'offset' (array index) of the 'frequency error' field (signed 32 bit, network byte order) in a capture packet.
+ * @details
+ * The FREQ ERR PPM field holds the deviation of the mean captured frequency from the generated one, in parts per million.
+ */
+#define TEST_PACKET_CAPTURE_FREQ_ERR_OFFSET (31)
+
+/**
+ * @brief the 'offset' (array index) of the 'queue depth' byte in a busy packet.
+ * @details
+ * The QUEUE DEPTH byte is used by the server to report how many requests are already waiting in its test queue.
+ */
+#define TEST_PACKET_BUSY_QUEUE_DEPTH_OFFSET (6)
+
+/**
+ * @brief the 'offset' (array index) of the 'retry after' field in a busy packet.
+ * @details
+ * The RETRY AFTER field is a 16 bit value in network byte order,
+ * holding the number of milliseconds the client should wait before resending its request.
+ */
+#define TEST_PACKET_BUSY_RETRY_AFTER_OFFSET (7)
+
+/**
+ * @brief the 'offset' (array index) of the END byte in a busy packet.
+ */
+#define TEST_PACKET_BUSY_END_OFFSET (9)
+
+/**
+ * @brief the 'offset' (array index) of the 'flags' byte in a telemetry packet.
+ */
+#define TEST_PACKET_TELEMETRY_FLAGS_OFFSET (2)
+
+/**
+ * @brief Telemetry FLAGS byte bit set when the server was built with network statistics.
+ * @details
+ * When clear, only the AVAIL field of each pool is filled, and every counter is 0.
+ */
+#define TEST_PACKET_TELEMETRY_FLAG_STATS (0x01)
+
+/**
+ * @brief the 'offset' (array index) of the first pool block in a telemetry packet.
+ * @details
+ * The block of pool N is at this offset + (N * @ref TEST_TELEMETRY_POOL_SIZE_BYTES).
+ */
+#define TEST_PACKET_TELEMETRY_POOLS_OFFSET (3)
+
+/**
+ * @brief The size of the telemetry block of a single pool.
+ */
+#define TEST_TELEMETRY_POOL_SIZE_BYTES (8)
+
+/**
+ * @brief the 'offset' (within a telemetry pool block) of the 'avail' field (16 bit, network byte order), holding the pool's capacity.
+ * @details
+ * Pools are counted in elements, and the heap in bytes.
+ */
+#define TEST_TELEMETRY_POOL_AVAIL_OFFSET (0)
+
+/**
+ * @brief the 'offset' (within a telemetry pool block) of the 'used' field (16 bit, network byte order), holding the current usage.
+ */
+#define TEST_TELEMETRY_POOL_USED_OFFSET (2)
+
+/**
+ * @brief the 'offset' (within a telemetry pool block) of the 'max' field (16 bit, network byte order), holding the peak usage since boot.
+ */
+#define TEST_TELEMETRY_POOL_MAX_OFFSET (4)
+
+/**
+ * @brief the 'offset' (within a telemetry pool block) of the 'err' field (16 bit, network byte order), holding the count of failed allocations.
+ */
+#define TEST_TELEMETRY_POOL_ERR_OFFSET (6)
+
+/**
+ * @brief the 'offset' (array index) of the 'mailbox errors' field (16 bit, network byte order) in a telemetry packet.
+ * @details
+ * Counts the packets (and messages) dropped because a mailbox was full, such as the listener's receive mailbox.
+ */
+#define TEST_PACKET_TELEMETRY_MBOX_ERRORS_OFFSET (51)
+
+/**
+ * @brief the 'offset' (array index) of the 'UDP drops' field (16 bit, network byte order) in a telemetry packet.
+ */
+#define TEST_PACKET_TELEMETRY_UDP_DROPS_OFFSET (53)
+
+/**
+ * @brief The network buffers reported in telemetry packets, in the order of their blocks.
+ */
+typedef enum TelemetryPool
+{
+	/// The heap outgoing packets are allocated from
+	TELEMETRY_POOL_HEAP = 0,
+	/// The receive buffers the Ethernet DMA writes frames into, held until the listener is done with them
+	TELEMETRY_POOL_RX = 1,
+	/// The netbufs queued in the receive mailboxes
+	TELEMETRY_POOL_NETBUF = 2,
+	/// The messages carrying received frames to the tcpip thread (reported empty when frames are input under the core lock)
+	TELEMETRY_POOL_TCPIP_INPKT = 3,
+	/// The messages carrying netconn API calls to the tcpip thread
+	TELEMETRY_POOL_TCPIP_API = 4,
+	/// The generic pbuf pool
+	TELEMETRY_POOL_PBUF = 5,
+} TelemetryPool_t;
+
+/**
+ * @brief The count of pools reported in telemetry packets.
+ */
+#define NUM_TELEMETRY_POOLS (6)
+
+/**
+ * @brief the 'offset' (array index) of the 'flags' byte in a boot profile packet.
+ */
+#define TEST_PACKET_BOOT_FLAGS_OFFSET (2)
+
+/**
+ * @brief Boot profile FLAGS byte bit set when the server came up on its cached DHCP lease (fast boot).
+ */
+#define TEST_PACKET_BOOT_FLAG_CACHED_LEASE (0x01)
+
+/**
+ * @brief the 'offset' (array index) of the first stage field (32 bit, network byte order) in a boot profile packet.
+ * @details
+ * The field of stage N is at this offset + (N * 4).
+ */
+#define TEST_PACKET_BOOT_STAGES_OFFSET (3)
+
+/**
+ * @brief The startup stages reported in boot profile packets, in the order of their fields.
+ */
+typedef enum BootStage
+{
+	/// HAL and its tick initialized
+	BOOT_STAGE_HAL = 0,
+	/// System clock configured
+	BOOT_STAGE_CLOCK = 1,
+	/// Peripherals needed from the start initialized (the test units' own are initialized on their first use)
+	BOOT_STAGE_PERIPHERALS = 2,
+	/// Test units registered
+	BOOT_STAGE_REGISTRY = 3,
+	/// Scheduler started
+	BOOT_STAGE_SCHEDULER = 4,
+	/// lwIP initialized and DHCP started
+	BOOT_STAGE_LWIP = 5,
+	/// Ethernet link up
+	BOOT_STAGE_LINK = 6,
+	/// IPv4 address bound (by DHCP, or from the cached lease)
+	BOOT_STAGE_ADDRESS = 7,
+	/// Listener ready to receive requests
+	BOOT_STAGE_LISTENER = 8,
+	/// First test request accepted
+	BOOT_STAGE_FIRST_REQUEST = 9,
+} BootStage_t;
+
+/**
+ * @brief The count of stages reported in boot profile packets.
+ */
+#define NUM_BOOT_STAGES (10)
+
+/**
+ * @brief the 'offset' (array index) of the 'since ID' field (32 bit, network byte order) in a journal fetch packet.
+ * The server answers with the records following this ID (0 for all of its records).
+ */
+#define TEST_PACKET_JOURNAL_SINCE_OFFSET (2)
+
+/**
+ * @brief the 'offset' (array index) of the 'flags' byte in a journal packet.
+ */
+#define TEST_PACKET_JOURNAL_FLAGS_OFFSET (2)
+
+/**
+ * @brief Journal FLAGS byte bit set when the server has records past the packet's last one.
+ */
+#define TEST_PACKET_JOURNAL_FLAG_MORE (0x01)
+
+/**
+ * @brief Journal FLAGS byte bit set on the last packet of a burst.
+ * If @ref TEST_PACKET_JOURNAL_FLAG_MORE is set as well, the client fetches the rest since the packet's last record.
+ */
+#define TEST_PACKET_JOURNAL_FLAG_BURST_END (0x02)
+
+/**
+ * @brief the 'offset' (array index) of the 'count' byte (of records) in a journal packet.
+ */
+#define TEST_PACKET_JOURNAL_COUNT_OFFSET (3)
+
+/**
+ * @brief the 'offset' (array index) of the 'after ID' field (32 bit, network byte order) in a journal packet.
+ */
+#define TEST_PACKET_JOURNAL_AFTER_ID_OFFSET (4)
+
+/**
+ * @brief the 'offset' (array index) of the first record in a journal packet.
+ * @details
+ * Record N is at this offset + (N * @ref TEST_JOURNAL_RECORD_SIZE_BYTES).
+ */
+#define TEST_PACKET_JOURNAL_RECORDS_OFFSET (8)
+
+/**
+ * @brief the 'offsets' (array indices) of the fields of a journal record, relative to the record's start.
+ * @details
+ * The record ID, selection, passed, duration and checksum fields are 32 bit, in network byte order.
+ * The test ID is copied as is from the request, and the results detail blocks are those of the results packet.
+ */
+#define TEST_JOURNAL_RECORD_ID_OFFSET (0)
+#define TEST_JOURNAL_RECORD_TEST_ID_OFFSET (4)
+#define TEST_JOURNAL_RECORD_SELECTION_OFFSET (8)
+#define TEST_JOURNAL_RECORD_PASSED_OFFSET (12)
+#define TEST_JOURNAL_RECORD_DURATION_OFFSET (16)
+#define TEST_JOURNAL_RECORD_ITERATIONS_OFFSET (20)
+#define TEST_JOURNAL_RECORD_DETAIL_OFFSET (21)
+#define TEST_JOURNAL_RECORD_CHECKSUM_OFFSET (TEST_JOURNAL_RECORD_SIZE_BYTES - 4)
+
+/**
+ * @brief the 'offset' (array index) of the server's unique ID (12 bytes) in a beacon packet.
+ */
+#define TEST_PACKET_BEACON_UID_OFFSET (2)
+
+/**
+ * @brief The size of the server's unique ID in a beacon packet.
+ */
+#define TEST_PACKET_BEACON_UID_SIZE_BYTES (12)
+
+/**
+ * @brief the 'offsets' (array indices) of the server's firmware version bytes in a beacon packet.
+ */
+#define TEST_PACKET_BEACON_VERSION_MAJOR_OFFSET (14)
+#define TEST_PACKET_BEACON_VERSION_MINOR_OFFSET (15)
+
+/**
+ * @brief the 'offset' (array index) of the 'tests' field (32 bit, network byte order) in a beacon packet,
+ * a mask of the tests the server runs, with the bits of the SELECTION field.
+ */
+#define TEST_PACKET_BEACON_TESTS_OFFSET (16)
+
+/**
+ * @brief the 'offset' (array index) of the 'features' byte in a beacon packet.
+ */
+#define TEST_PACKET_BEACON_FEATURES_OFFSET (20)
+
+/**
+ * @brief Beacon FEATURES byte bit set when the server keeps a result journal (see @ref TESTMSG_JOURNAL_FETCH_REQUEST).
+ */
+#define TEST_PACKET_BEACON_FEATURE_JOURNAL (0x01)
+
+/**
+ * @brief Beacon FEATURES byte bit set when the server batches the packets it sends (see @ref TESTMSG_BATCH).
+ */
+#define TEST_PACKET_BEACON_FEATURE_BATCH (0x02)
+
+/**
+ * @brief the 'offset' (array index) of the 'count' byte (of batched packets) in a batch packet.
+ */
+#define TEST_PACKET_BATCH_COUNT_OFFSET (2)
+
+/**
+ * @brief the 'offset' (array index) of the first batched packet's length byte in a batch packet.
+ * @details
+ * Each batched packet follows its length byte, and the next length byte follows the packet.
+ */
+#define TEST_PACKET_BATCH_RECORDS_OFFSET (3)
 
 /**
  * @brief The pre-determined total number of test types available on the test device.
+ * @details
+ * Sizes the per-test blocks of results and progress packets, and the server's test registry.
+ * Adding a test type only raises this count (up to @ref TEST_SELECTION_MAX_TESTS), the packet layouts stay the same.
  */
 #define NUM_POSSIBLE_TESTS (5)
 
 /**
  * @brief Numerical values associated with individual peripheral tests.
  * @details
- * The PeripheralTestIdx_t enum values are associated with the SELECTION byte of packets,
+ * The PeripheralTestIdx_t enum values are associated with the SELECTION field of packets,
  * where they are used to indicate the position (in left-shifts) of the bit associated with a test type.
  * They are also used in other contexts as array indices for data relevant to the different tests.
+ * On the server, they are the indices the test types are registered at (see test_registry.h).
  */
 typedef enum PeripheralTestIdx
 {
@@ -149,6 +833,21 @@ typedef enum PeripheralTestIdx
 	TESTIDX_ADC = 4,
 } PeripheralTestIdx_t;
 
+/**
+ * @brief Priority classes of test requests.
+ * @details
+ * The TestPriority_t enum values are carried in the FLAGS byte of "new test request" packets.
+ * Interactive requests are served ahead of any queued bulk requests,
+ * and preempt running bulk tests between iterations when they need the same test units.
+ */
+typedef enum TestPriority
+{
+    /// Long-running or scripted work, served in order of arrival
+    TESTPRIO_BULK = 0,
+    /// Quick checks from an engineer waiting on the result
+    TESTPRIO_INTERACTIVE = 1,
+} TestPriority_t;
+
 /**
  * @brief Numerical values associated with different packet types.
  * @details
@@ -181,8 +880,36 @@ typedef enum TestPacketMsg
     TESTMSG_TEST_OVER_RESULTS = 7,
     /// Client probe for auto-pairing
     TESTMSG_PAIRING_PROBE = 8,
-    /// Server beacon for auto-pairing
+    /// Server beacon for auto-pairing, identity fields attached
     TESTMSG_PAIRING_BEACON = 9,
+    /// Server cannot queue new test request, retry-after attached (answers @ref TESTMSG_TEST_NEW_REQUEST, value 10 is unused)
+    TESTMSG_TEST_NEW_BUSY = 11,
+    /// Client requests a queued or running test be cancelled
+    TESTMSG_TEST_CANCEL_REQUEST = 12,
+    /// Server acknowledges cancellation (SELECTION 1 if the test was running, 0 if it will be dropped if still queued)
+    TESTMSG_TEST_CANCEL_ACK = 13,
+    /// Server reports progress of a running test, counters attached (value 14 is unused)
+    TESTMSG_TEST_PROGRESS = 15,
+    /// Server reports a completed sweep step, measurements attached (value 16 is unused)
+    TESTMSG_TEST_SWEEP_STEP = 17,
+    /// Server reports the sample statistics of a completed sweep step (value 18 is unused)
+    TESTMSG_TEST_SWEEP_NOISE = 19,
+    /// Server reports the capture statistics of a completed sweep step (value 20 is unused)
+    TESTMSG_TEST_SWEEP_CAPTURE = 21,
+    /// Client requests the server's network buffer usage
+    TESTMSG_TELEMETRY_REQUEST = 22,
+    /// Server reports its network buffer usage, pool blocks attached
+    TESTMSG_TELEMETRY = 23,
+    /// Client requests the server's boot profile
+    TESTMSG_BOOT_PROFILE_REQUEST = 24,
+    /// Server reports the time it reached each startup stage at, stage fields attached
+    TESTMSG_BOOT_PROFILE = 25,
+    /// Client requests the server's journaled results following a record ID
+    TESTMSG_JOURNAL_FETCH_REQUEST = 26,
+    /// Server sends journaled results, records attached
+    TESTMSG_JOURNAL_RECORDS = 27,
+    /// Server sends several packets at once, packets attached (value 28 is unused)
+    TESTMSG_BATCH = 29,
 } TestPacketMsg_t;
 
 #endif